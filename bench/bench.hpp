@@ -0,0 +1,161 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_BENCH_HPP_INCLUDED
+#define TORRENT_BENCH_HPP_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a minimal benchmark harness, modeled after Google Benchmark. A benchmark
+// is a function taking a bench::state, running its body in a loop:
+//
+//   void bench_foo(bench::state& s)
+//   {
+//     setup();
+//     while (s.keep_running()) foo();
+//     s.set_items_processed(s.iterations());
+//   }
+//   BENCHMARK(bench_foo);
+//
+// The harness picks the number of iterations to run for at least the minimum
+// time, and repeats the measurement a number of times, reporting the median.
+
+namespace bench {
+
+	using clock_type = std::chrono::steady_clock;
+
+	struct state
+	{
+		explicit state(std::int64_t max_iterations);
+
+		bool keep_running()
+		{
+			if (m_iterations == 0) start();
+			if (m_iterations < m_max_iterations)
+			{
+				++m_iterations;
+				return true;
+			}
+			stop();
+			return false;
+		}
+
+		// exclude setup work inside the loop from the measurement
+		void pause_timing();
+		void resume_timing();
+
+		std::int64_t iterations() const { return m_iterations; }
+
+		void set_bytes_processed(std::int64_t b) { m_bytes = b; }
+		void set_items_processed(std::int64_t i) { m_items = i; }
+
+		// custom metrics reported alongside the timing, e.g. the number of
+		// peers in a transfer. The values are reported as-is, not per
+		// iteration
+		void counter(std::string name, double value);
+
+		// the benchmark can't run in this environment. This is reported
+		// instead of a time
+		void skip(std::string reason) { m_skipped = std::move(reason); }
+
+		// internal
+		std::int64_t elapsed_ns() const { return m_elapsed_ns; }
+		std::int64_t cpu_ns() const { return m_cpu_ns; }
+		std::int64_t bytes() const { return m_bytes; }
+		std::int64_t items() const { return m_items; }
+		std::string const& skipped() const { return m_skipped; }
+		std::vector<std::pair<std::string, double>> const& counters() const
+		{ return m_counters; }
+
+	private:
+		void start();
+		void stop();
+
+		std::int64_t m_max_iterations;
+		std::int64_t m_iterations = 0;
+		clock_type::time_point m_start;
+		std::int64_t m_start_cpu = 0;
+		std::int64_t m_elapsed_ns = 0;
+		std::int64_t m_cpu_ns = 0;
+		bool m_running = false;
+		std::int64_t m_bytes = 0;
+		std::int64_t m_items = 0;
+		std::string m_skipped;
+		std::vector<std::pair<std::string, double>> m_counters;
+	};
+
+	// prevent the compiler from optimizing away the computation of a value
+	template <typename T>
+	void do_not_optimize(T const& v)
+	{
+#if defined __GNUC__ || defined __clang__
+		asm volatile("" : : "r,m"(v) : "memory");
+#else
+		static volatile char const* sink;
+		sink = reinterpret_cast<char const*>(&v);
+#endif
+	}
+
+	// returns the resident set size of the process, or -1 if it's not known
+	std::int64_t resident_bytes();
+
+	// returns the number of bytes currently allocated on the heap, or -1 if
+	// it's not known. Unlike the resident set size, this is exact
+	std::int64_t heap_bytes();
+
+	using bench_fun = void (*)(state&);
+
+	struct registrar
+	{
+		// if iterations is 0, the harness picks the number of iterations
+		// to run for at least the minimum time. Macro benchmarks set it to 1
+		registrar(char const* name, bench_fun f, std::int64_t iterations);
+	};
+}
+
+#define BENCH_CAT2(a, b) a##b
+#define BENCH_CAT(a, b) BENCH_CAT2(a, b)
+
+#define BENCHMARK(fun) \
+	static bench::registrar BENCH_CAT(bench_reg_, __LINE__)("micro/" #fun, &fun, 0)
+
+// macro benchmarks run a single iteration per repetition, and are only run
+// when asked for on the command line
+#define BENCHMARK_MACRO(fun) \
+	static bench::registrar BENCH_CAT(bench_reg_, __LINE__)("macro/" #fun, &fun, 1)
+
+#endif
@@ -0,0 +1,216 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/choker.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/aux_/time.hpp"
+#include "libtorrent/aux_/unchoke_compare.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+int const num_peers = 10000;
+int const unchoke_slots = 8;
+
+// stand-ins for torrent and peer_connection, exposing the state the unchoke
+// comparators look at
+struct fake_torrent_info
+{
+	int piece_length() const { return 0x4000; }
+	std::int64_t total_size() const { return 0x4000 * 1000; }
+};
+
+struct fake_torrent
+{
+	fake_torrent_info const& torrent_file() const { return m_info; }
+	fake_torrent_info m_info;
+};
+
+struct fake_stat
+{
+	std::int64_t total_payload_upload() const { return uploaded; }
+	std::int64_t uploaded;
+};
+
+struct fake_peer
+{
+	enum channels { upload_channel, download_channel };
+
+	int get_priority(int) const { return priority; }
+	std::int64_t downloaded_in_last_round() const { return downloaded; }
+	std::int64_t uploaded_in_last_round() const { return uploaded; }
+	std::int64_t uploaded_since_unchoked() const { return since_unchoked; }
+	bool is_choked() const { return choked; }
+	lt::time_point time_of_last_unchoke() const { return last_unchoke; }
+	int num_have_pieces() const { return have_pieces; }
+	fake_stat const& statistics() const { return stats; }
+	std::weak_ptr<fake_torrent> associated_torrent() const { return t; }
+
+	std::shared_ptr<fake_torrent> t;
+	int priority;
+	std::int64_t downloaded;
+	std::int64_t uploaded;
+	std::int64_t since_unchoked;
+	int have_pieces;
+	fake_stat stats;
+	lt::time_point last_unchoke;
+	bool choked;
+};
+
+std::vector<fake_peer> const& test_peers()
+{
+	static std::vector<fake_peer> const peers = []
+	{
+		std::mt19937 rng(0x1337);
+		std::uniform_int_distribution<int> prio(1, 3);
+		std::uniform_int_distribution<std::int64_t> rate(0, 1000000);
+		std::uniform_int_distribution<int> pieces(0, 1000);
+		std::uniform_int_distribution<int> time(0, 100000);
+		auto const t = std::make_shared<fake_torrent>();
+		lt::time_point const now = lt::aux::time_now();
+		std::vector<fake_peer> ret;
+		for (int i = 0; i < num_peers; ++i)
+		{
+			std::int64_t const up = rate(rng);
+			ret.push_back({t, prio(rng), rate(rng), up, rate(rng) * 8
+				, pieces(rng), {up}, now - lt::seconds(time(rng)), (i % 3) == 0});
+		}
+		return ret;
+	}();
+	return peers;
+}
+
+// ranks the peers the way unchoke_sort() does for the seed choking
+// algorithms, either by sorting all of them (the way it used to) or by only
+// selecting the top unchoke slots
+template <typename Cmp>
+void rank_peers(bench::state& s, bool const full_sort, Cmp cmp)
+{
+	std::vector<fake_peer> const& storage = test_peers();
+	std::vector<fake_peer const*> peers;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		peers.clear();
+		for (auto const& p : storage) peers.push_back(&p);
+		s.resume_timing();
+
+		if (full_sort)
+			std::sort(peers.begin(), peers.end(), cmp);
+		else
+			lt::aux::select_top(peers.begin(), peers.end(), unchoke_slots, cmp);
+		bench::do_not_optimize(peers.data());
+	}
+	s.set_items_processed(s.iterations() * num_peers);
+}
+
+bool round_robin_cmp(fake_peer const* lhs, fake_peer const* rhs)
+{
+	return lt::aux::unchoke_compare_rr(lhs, rhs, 20);
+}
+
+void unchoke_round_robin_sort(bench::state& s)
+{ rank_peers(s, true, &round_robin_cmp); }
+BENCHMARK(unchoke_round_robin_sort);
+
+void unchoke_round_robin_select_top(bench::state& s)
+{ rank_peers(s, false, &round_robin_cmp); }
+BENCHMARK(unchoke_round_robin_select_top);
+
+void unchoke_anti_leech_sort(bench::state& s)
+{ rank_peers(s, true, &lt::aux::unchoke_compare_anti_leech<fake_peer>); }
+BENCHMARK(unchoke_anti_leech_sort);
+
+void unchoke_anti_leech_select_top(bench::state& s)
+{ rank_peers(s, false, &lt::aux::unchoke_compare_anti_leech<fake_peer>); }
+BENCHMARK(unchoke_anti_leech_select_top);
+
+// the rate based choker visits peers in order of upload rate until one falls
+// below the threshold, which increases with every unchoke slot
+void unchoke_rate_based(bench::state& s, bool const full_sort)
+{
+	std::vector<fake_peer> const& storage = test_peers();
+	std::vector<fake_peer const*> peers;
+	int slots = 0;
+	auto const cmp = &lt::aux::upload_rate_compare<fake_peer>;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		peers.clear();
+		for (auto const& p : storage) peers.push_back(&p);
+		s.resume_timing();
+
+		std::int64_t threshold = 1024;
+		if (full_sort)
+		{
+			std::sort(peers.begin(), peers.end(), cmp);
+			slots = 0;
+			for (auto const* p : peers)
+			{
+				if (p->uploaded < threshold) break;
+				++slots;
+				threshold += 2048 * 64;
+			}
+		}
+		else
+		{
+			slots = lt::aux::ranked_walk(peers.begin(), peers.end(), cmp
+				, [&](fake_peer const* p)
+				{
+					if (p->uploaded < threshold) return false;
+					threshold += 2048 * 64;
+					return true;
+				});
+		}
+		bench::do_not_optimize(slots);
+	}
+	s.set_items_processed(s.iterations() * num_peers);
+	s.counter("slots", slots);
+}
+
+void unchoke_rate_based_sort(bench::state& s)
+{ unchoke_rate_based(s, true); }
+BENCHMARK(unchoke_rate_based_sort);
+
+void unchoke_rate_based_ranked_walk(bench::state& s)
+{ unchoke_rate_based(s, false); }
+BENCHMARK(unchoke_rate_based_ranked_walk);
+
+}
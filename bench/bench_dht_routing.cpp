@@ -0,0 +1,191 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "bench.hpp"
+
+#include "libtorrent/config.hpp"
+
+#ifndef TORRENT_DISABLE_DHT
+
+#include "libtorrent/kademlia/routing_table.hpp"
+#include "libtorrent/kademlia/node_id.hpp"
+#include "libtorrent/aux_/session_settings.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/socket.hpp"
+
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// the memory used by a DHT routing table, and the cost of the lookups done
+// on it for every incoming packet
+
+namespace {
+
+struct test_node
+{
+	lt::dht::node_id id;
+	lt::udp::endpoint ep;
+};
+
+std::vector<test_node> random_nodes(int const num)
+{
+	std::vector<test_node> ret(static_cast<std::size_t>(num));
+	for (auto& n : ret)
+	{
+		lt::aux::random_bytes(n.id);
+		n.ep = lt::udp::endpoint(lt::address_v4(lt::random(0xffffffff))
+			, std::uint16_t(1024 + lt::random(60000)));
+	}
+	return ret;
+}
+
+lt::aux::session_settings table_settings()
+{
+	lt::aux::session_settings sett;
+	// the random node IDs don't match their IPs
+	sett.set_bool(lt::settings_pack::dht_prefer_verified_node_ids, false);
+	return sett;
+}
+
+// a routing table filled up with responding nodes, and the nodes that were
+// offered to it
+std::unique_ptr<lt::dht::routing_table> full_table(lt::aux::session_settings const& sett
+	, std::vector<test_node> const& nodes)
+{
+	lt::dht::node_id self;
+	lt::aux::random_bytes(self);
+	std::unique_ptr<lt::dht::routing_table> ret(new lt::dht::routing_table(
+		self, lt::udp::v4(), 8, sett, nullptr));
+	for (auto const& n : nodes)
+		ret->node_seen(n.id, n.ep, 50);
+	return ret;
+}
+
+void dht_routing_table_memory(bench::state& s)
+{
+	int const num_tables = 16;
+	auto const sett = table_settings();
+	std::vector<test_node> const nodes = random_nodes(10000);
+
+	std::int64_t heap = 0;
+	int num_nodes = 0;
+	while (s.keep_running())
+	{
+		std::int64_t const before = bench::heap_bytes();
+		std::vector<std::unique_ptr<lt::dht::routing_table>> tables;
+		for (int i = 0; i < num_tables; ++i)
+			tables.push_back(full_table(sett, nodes));
+
+		s.pause_timing();
+		heap = bench::heap_bytes() - before;
+		int live;
+		int replacements;
+		std::tie(live, replacements, std::ignore) = tables.front()->size();
+		num_nodes = live + replacements;
+		tables.clear();
+		s.resume_timing();
+	}
+	s.set_items_processed(s.iterations() * num_tables);
+	s.counter("nodes_per_table", num_nodes);
+	s.counter("node_entry_bytes", double(sizeof(lt::dht::node_entry)));
+	if (heap > 0)
+	{
+		s.counter("bytes_per_table", double(heap) / num_tables);
+		s.counter("bytes_per_node", double(heap) / num_tables / num_nodes);
+	}
+}
+BENCHMARK_MACRO(dht_routing_table_memory);
+
+// the IP check done for every node offered to the routing table, half of
+// them hits
+void dht_ip_set_lookup(bench::state& s)
+{
+	std::vector<test_node> const nodes = random_nodes(2000);
+	lt::dht::ip_set ips;
+	for (std::size_t i = 0; i < nodes.size(); i += 2)
+		ips.insert(nodes[i].ep.address());
+
+	std::size_t i = 0;
+	while (s.keep_running())
+	{
+		bench::do_not_optimize(ips.exists(nodes[i].ep.address()));
+		i = (i + 1) % nodes.size();
+	}
+	s.set_items_processed(s.iterations());
+	s.counter("ip_set_bytes", double(ips.memory_usage()));
+}
+BENCHMARK(dht_ip_set_lookup);
+
+// every response we receive updates the node in the routing table
+void dht_routing_table_node_seen(bench::state& s)
+{
+	auto const sett = table_settings();
+	std::vector<test_node> const nodes = random_nodes(20000);
+	auto const table = full_table(sett, nodes);
+
+	std::size_t i = 0;
+	while (s.keep_running())
+	{
+		auto const& n = nodes[i];
+		bench::do_not_optimize(table->node_seen(n.id, n.ep, 50));
+		i = (i + 1) % nodes.size();
+	}
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(dht_routing_table_node_seen);
+
+// the lookup done for every find_node and get_peers request we answer
+void dht_routing_table_find_node(bench::state& s)
+{
+	auto const sett = table_settings();
+	std::vector<test_node> const nodes = random_nodes(100000);
+	auto const table = full_table(sett, nodes);
+
+	std::vector<lt::dht::node_id> targets(1000);
+	for (auto& t : targets) lt::aux::random_bytes(t);
+
+	std::size_t i = 0;
+	while (s.keep_running())
+	{
+		bench::do_not_optimize(table->find_node(targets[i], {}, 8));
+		i = (i + 1) % targets.size();
+	}
+	s.set_items_processed(s.iterations());
+	s.counter("active_buckets", table->num_active_buckets());
+}
+BENCHMARK(dht_routing_table_find_node);
+
+}
+
+#endif // TORRENT_DISABLE_DHT
@@ -0,0 +1,191 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+#include "bench.hpp"
+
+#include "libtorrent/config.hpp"
+
+#ifndef TORRENT_DISABLE_DHT
+
+#include "libtorrent/kademlia/dht_storage.hpp"
+#include "libtorrent/aux_/session_settings.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/entry.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/socket.hpp"
+
+#include <memory>
+#include <vector>
+
+// these benchmarks compare the default and the compact DHT storage when
+// tracking very many torrents, as a bootstrap or indexer node would. The
+// announce benchmarks also report the resident memory per stored info-hash
+
+namespace {
+
+std::vector<lt::sha1_hash> random_hashes(int const num)
+{
+	std::vector<lt::sha1_hash> ret(static_cast<std::size_t>(num));
+	for (auto& h : ret) lt::aux::random_bytes(h);
+	return ret;
+}
+
+lt::tcp::endpoint peer_endpoint(int const i)
+{
+	return lt::tcp::endpoint(lt::address_v4(std::uint32_t(0x0a000000 + i))
+		, std::uint16_t(6881 + i % 1000));
+}
+
+lt::aux::session_settings storage_settings(int const num_torrents)
+{
+	lt::aux::session_settings sett;
+	sett.set_int(lt::settings_pack::dht_max_torrents, num_torrents);
+	return sett;
+}
+
+void announce(bench::state& s, lt::dht::dht_storage_constructor_type const& constructor)
+{
+	int const num_torrents = 1000000;
+	std::vector<lt::sha1_hash> const hashes = random_hashes(num_torrents);
+	auto const sett = storage_settings(num_torrents);
+
+	std::int64_t rss = 0;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		std::int64_t const before = bench::resident_bytes();
+		s.resume_timing();
+
+		std::unique_ptr<lt::dht::dht_storage_interface> storage = constructor(sett);
+		for (int i = 0; i < num_torrents; ++i)
+			storage->announce_peer(hashes[std::size_t(i)], peer_endpoint(i), "", false);
+
+		// destructing the storage is not included
+		s.pause_timing();
+		rss = std::max(rss, bench::resident_bytes() - before);
+	}
+	s.set_items_processed(s.iterations() * num_torrents);
+	if (rss > 0) s.counter("bytes_per_infohash", double(rss) / num_torrents);
+}
+
+void dht_announce_default_1m(bench::state& s)
+{ announce(s, lt::dht::dht_default_storage_constructor); }
+BENCHMARK_MACRO(dht_announce_default_1m);
+
+void dht_announce_compact_1m(bench::state& s)
+{ announce(s, lt::dht::dht_compact_storage_constructor); }
+BENCHMARK_MACRO(dht_announce_compact_1m);
+
+void get_peers(bench::state& s, lt::dht::dht_storage_constructor_type const& constructor)
+{
+	int const num_torrents = 100000;
+	int const peers_per_torrent = 8;
+	std::vector<lt::sha1_hash> const hashes = random_hashes(num_torrents);
+	auto const sett = storage_settings(num_torrents);
+
+	std::unique_ptr<lt::dht::dht_storage_interface> storage = constructor(sett);
+	for (int p = 0; p < peers_per_torrent; ++p)
+		for (int i = 0; i < num_torrents; ++i)
+			storage->announce_peer(hashes[std::size_t(i)], peer_endpoint(i * peers_per_torrent + p)
+				, "", false);
+
+	lt::address const requester = lt::make_address_v4("192.168.1.1");
+	std::size_t i = 0;
+	while (s.keep_running())
+	{
+		lt::entry peers;
+		storage->get_peers(hashes[i], false, false, requester, peers);
+		bench::do_not_optimize(peers);
+		i = (i + 7919) % hashes.size();
+	}
+	s.set_items_processed(s.iterations());
+}
+
+void dht_get_peers_default(bench::state& s)
+{ get_peers(s, lt::dht::dht_default_storage_constructor); }
+BENCHMARK(dht_get_peers_default);
+
+void dht_get_peers_compact(bench::state& s)
+{ get_peers(s, lt::dht::dht_compact_storage_constructor); }
+BENCHMARK(dht_get_peers_compact);
+
+// a BEP 33 scrape of a single torrent with many peers
+void scrape(bench::state& s, lt::dht::dht_storage_constructor_type const& constructor
+	, int const num_peers)
+{
+	lt::aux::session_settings sett;
+	sett.set_int(lt::settings_pack::dht_max_peers, num_peers);
+	lt::sha1_hash const ih = random_hashes(1).front();
+
+	std::unique_ptr<lt::dht::dht_storage_interface> storage = constructor(sett);
+	for (int i = 0; i < num_peers; ++i)
+		storage->announce_peer(ih, peer_endpoint(i), "", i % 4 == 0);
+
+	lt::address const requester = lt::make_address_v4("192.168.1.1");
+	while (s.keep_running())
+	{
+		lt::entry peers;
+		storage->get_peers(ih, false, true, requester, peers);
+		bench::do_not_optimize(peers);
+	}
+	s.set_items_processed(s.iterations());
+}
+
+void dht_scrape_default_10(bench::state& s)
+{ scrape(s, lt::dht::dht_default_storage_constructor, 10); }
+BENCHMARK(dht_scrape_default_10);
+
+void dht_scrape_default_1k(bench::state& s)
+{ scrape(s, lt::dht::dht_default_storage_constructor, 1000); }
+BENCHMARK(dht_scrape_default_1k);
+
+void dht_scrape_default_10k(bench::state& s)
+{ scrape(s, lt::dht::dht_default_storage_constructor, 10000); }
+BENCHMARK(dht_scrape_default_10k);
+
+void dht_scrape_compact_10(bench::state& s)
+{ scrape(s, lt::dht::dht_compact_storage_constructor, 10); }
+BENCHMARK(dht_scrape_compact_10);
+
+void dht_scrape_compact_1k(bench::state& s)
+{ scrape(s, lt::dht::dht_compact_storage_constructor, 1000); }
+BENCHMARK(dht_scrape_compact_1k);
+
+void dht_scrape_compact_10k(bench::state& s)
+{ scrape(s, lt::dht::dht_compact_storage_constructor, 10000); }
+BENCHMARK(dht_scrape_compact_10k);
+
+}
+
+#endif // TORRENT_DISABLE_DHT
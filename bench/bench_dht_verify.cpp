@@ -0,0 +1,139 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/config.hpp"
+
+#ifndef TORRENT_DISABLE_DHT
+
+#include "libtorrent/kademlia/ed25519.hpp"
+#include "libtorrent/kademlia/item.hpp"
+#include "libtorrent/kademlia/signature_verifier.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/entry.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// the rate at which mutable item puts (BEP 44) can be verified, on the
+// calling thread and by the signature_verifier threads
+
+namespace {
+
+// mutable puts of small items under different keys, with valid signatures
+std::vector<lt::dht::mutable_put> const& test_puts()
+{
+	static std::vector<lt::dht::mutable_put> const puts = []
+	{
+		std::vector<lt::dht::mutable_put> ret(256);
+		int i = 0;
+		for (auto& p : ret)
+		{
+			lt::dht::public_key pk;
+			lt::dht::secret_key sk;
+			std::tie(pk, sk) = lt::dht::ed25519_create_keypair(lt::dht::ed25519_create_seed());
+			lt::bencode(std::back_inserter(p.value), lt::entry("value-" + std::to_string(i++)));
+			p.seq = lt::dht::sequence_number(1);
+			p.pk = pk;
+			p.sig = lt::dht::sign_mutable_item(p.value, {}, p.seq, pk, sk);
+		}
+		return ret;
+	}();
+	return puts;
+}
+
+void dht_verify_put(bench::state& s)
+{
+	auto const& puts = test_puts();
+	std::size_t i = 0;
+	while (s.keep_running())
+	{
+		auto const& p = puts[i];
+		bench::do_not_optimize(lt::dht::verify_mutable_item(p.value, p.salt, p.seq, p.pk, p.sig));
+		i = (i + 1) % puts.size();
+	}
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(dht_verify_put);
+
+void verifier_threads(bench::state& s, int const num_threads)
+{
+	auto const& puts = test_puts();
+
+	std::mutex m;
+	std::condition_variable cond;
+	bool woken = false;
+	lt::dht::signature_verifier verifier(num_threads, [&] {
+		std::lock_guard<std::mutex> l(m);
+		woken = true;
+		cond.notify_all();
+	});
+
+	// every iteration is a burst of puts, waiting for all of them to be
+	// verified
+	std::vector<lt::dht::mutable_put> out;
+	while (s.keep_running())
+	{
+		for (auto const& p : puts)
+		{
+			lt::dht::mutable_put copy = p;
+			verifier.post(std::move(copy));
+		}
+
+		std::size_t done = 0;
+		while (done < puts.size())
+		{
+			std::unique_lock<std::mutex> l(m);
+			cond.wait(l, [&] { return woken; });
+			woken = false;
+			l.unlock();
+			verifier.take(out);
+			done += out.size();
+			out.clear();
+		}
+	}
+	verifier.stop();
+	s.set_items_processed(s.iterations() * std::int64_t(puts.size()));
+}
+
+void dht_verify_put_1_thread(bench::state& s) { verifier_threads(s, 1); }
+BENCHMARK(dht_verify_put_1_thread);
+
+void dht_verify_put_4_threads(bench::state& s) { verifier_threads(s, 4); }
+BENCHMARK(dht_verify_put_4_threads);
+
+}
+
+#endif // TORRENT_DISABLE_DHT
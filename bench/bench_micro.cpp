@@ -0,0 +1,501 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/bdecode.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/bitfield.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/entry.hpp"
+#include "libtorrent/file_storage.hpp"
+#include "libtorrent/hasher.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/performance_counters.hpp"
+#include "libtorrent/alert_types.hpp"
+#include "libtorrent/aux_/alert_manager.hpp"
+#include "libtorrent/aux_/bandwidth_manager.hpp"
+#include "libtorrent/aux_/bandwidth_limit.hpp"
+#include "libtorrent/aux_/bandwidth_socket.hpp"
+#include "libtorrent/aux_/heterogeneous_queue.hpp"
+#include "libtorrent/aux_/merkle.hpp"
+#include "libtorrent/aux_/trace.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// a v1 torrent with 100 files and 4096 pieces, representative of what's
+// parsed when loading .torrent files and resume data
+std::vector<char> const& test_torrent()
+{
+	static std::vector<char> const buf = []
+	{
+		lt::file_storage fs;
+		for (int i = 0; i < 100; ++i)
+			fs.add_file("bench/directory/file-" + std::to_string(i), 0xa00000 + i);
+		lt::create_torrent t(fs, 0x40000, lt::create_torrent::v1_only);
+		for (lt::piece_index_t i(0); i < fs.end_piece(); ++i)
+		{
+			lt::sha1_hash h;
+			lt::aux::random_bytes(h);
+			t.set_hash(i, h);
+		}
+		std::vector<char> ret;
+		lt::bencode(std::back_inserter(ret), t.generate());
+		return ret;
+	}();
+	return buf;
+}
+
+// a DHT get_peers response with 8 nodes and 16 peers, representative of
+// the bulk of the DHT traffic
+std::vector<char> const& test_dht_packet()
+{
+	static std::vector<char> const buf = []
+	{
+		lt::entry e;
+		e["y"] = "r";
+		e["t"] = "aa";
+		lt::entry& r = e["r"];
+		r["id"] = std::string(20, 'a');
+		r["token"] = std::string(8, 'b');
+		r["nodes"] = std::string(8 * 26, 'c');
+		lt::entry::list_type& values = r["values"].list();
+		for (int i = 0; i < 16; ++i)
+			values.push_back(std::string(6, char('d' + i)));
+		std::vector<char> ret;
+		lt::bencode(std::back_inserter(ret), e);
+		return ret;
+	}();
+	return buf;
+}
+
+void bdecode_torrent(bench::state& s)
+{
+	std::vector<char> const& buf = test_torrent();
+	lt::error_code ec;
+	while (s.keep_running())
+	{
+		lt::bdecode_node const n = lt::bdecode(buf, ec);
+		bench::do_not_optimize(n);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(buf.size()));
+}
+BENCHMARK(bdecode_torrent);
+
+void bdecode_torrent_reuse(bench::state& s)
+{
+	std::vector<char> const& buf = test_torrent();
+	lt::bdecode_node n;
+	lt::error_code ec;
+	while (s.keep_running())
+	{
+		// this overload reuses the token buffer in n
+		lt::bdecode(buf, n, ec);
+		bench::do_not_optimize(n);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(buf.size()));
+}
+BENCHMARK(bdecode_torrent_reuse);
+
+void bdecode_dht_packet(bench::state& s)
+{
+	std::vector<char> const& buf = test_dht_packet();
+	lt::error_code ec;
+	while (s.keep_running())
+	{
+		lt::bdecode_node const n = lt::bdecode(buf, ec, nullptr, 10, 500);
+		bench::do_not_optimize(n);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(buf.size()));
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(bdecode_dht_packet);
+
+void bdecode_dht_packet_reuse(bench::state& s)
+{
+	std::vector<char> const& buf = test_dht_packet();
+	lt::bdecode_node n;
+	lt::error_code ec;
+	while (s.keep_running())
+	{
+		// this is how dht_tracker decodes incoming packets
+		lt::bdecode(buf, n, ec, nullptr, 10, 500);
+		bench::do_not_optimize(n);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(buf.size()));
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(bdecode_dht_packet_reuse);
+
+void bdecode_torrent_walk(bench::state& s)
+{
+	std::vector<char> const& buf = test_torrent();
+	lt::bdecode_node const n = lt::bdecode(buf);
+	while (s.keep_running())
+	{
+		// look up every file in the file list, the way torrent_info does
+		lt::bdecode_node const files = n.dict_find_dict("info").dict_find_list("files");
+		std::int64_t total = 0;
+		for (int i = 0; i < files.list_size(); ++i)
+			total += files.list_at(i).dict_find_int_value("length");
+		bench::do_not_optimize(total);
+	}
+	s.set_items_processed(s.iterations() * 100);
+}
+BENCHMARK(bdecode_torrent_walk);
+
+void hasher_sha1_block(bench::state& s)
+{
+	std::array<char, 0x4000> block;
+	lt::aux::random_bytes(block);
+	while (s.keep_running())
+	{
+		lt::sha1_hash const h = lt::hasher(block).final();
+		bench::do_not_optimize(h);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(block.size()));
+}
+BENCHMARK(hasher_sha1_block);
+
+void hasher_sha256_block(bench::state& s)
+{
+	std::array<char, 0x4000> block;
+	lt::aux::random_bytes(block);
+	while (s.keep_running())
+	{
+		lt::sha256_hash const h = lt::hasher256(block).final();
+		bench::do_not_optimize(h);
+	}
+	s.set_bytes_processed(s.iterations() * std::int64_t(block.size()));
+}
+BENCHMARK(hasher_sha256_block);
+
+void bitfield_count(bench::state& s)
+{
+	lt::bitfield b(100000, false);
+	for (int i = 0; i < b.size(); i += 3) b.set_bit(i);
+	while (s.keep_running())
+	{
+		int const c = b.count();
+		bench::do_not_optimize(c);
+	}
+	s.set_items_processed(s.iterations() * b.size());
+}
+BENCHMARK(bitfield_count);
+
+void bitfield_set_clear(bench::state& s)
+{
+	lt::bitfield b(100000, false);
+	while (s.keep_running())
+	{
+		for (int i = 0; i < b.size(); i += 7) b.set_bit(i);
+		bool const all = b.all_set();
+		for (int i = 0; i < b.size(); i += 7) b.clear_bit(i);
+		bench::do_not_optimize(all);
+	}
+	s.set_items_processed(s.iterations() * 2 * (b.size() / 7));
+}
+BENCHMARK(bitfield_set_clear);
+
+struct base_item
+{
+	explicit base_item(int v) : value(v) {}
+	base_item(base_item&&) noexcept = default;
+	virtual ~base_item() = default;
+	int value;
+};
+
+struct small_item : base_item
+{
+	explicit small_item(int v) : base_item(v) {}
+	small_item(small_item&&) noexcept = default;
+};
+
+struct large_item : base_item
+{
+	explicit large_item(int v) : base_item(v) { std::memset(payload, v & 0xff, sizeof(payload)); }
+	large_item(large_item&&) noexcept = default;
+	char payload[200];
+};
+
+void heterogeneous_queue_push_clear(bench::state& s)
+{
+	lt::heterogeneous_queue<base_item> q;
+	while (s.keep_running())
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			if (i & 1) q.emplace_back<small_item>(i);
+			else q.emplace_back<large_item>(i);
+		}
+		int sum = 0;
+		q.for_each([&sum](base_item const* item) { sum += item->value; });
+		bench::do_not_optimize(sum);
+		q.clear();
+	}
+	s.set_items_processed(s.iterations() * 1000);
+}
+BENCHMARK(heterogeneous_queue_push_clear);
+
+void merkle_fill_tree(bench::state& s)
+{
+	int const num_leafs = 0x4000;
+	std::vector<lt::sha256_hash> tree(std::size_t(lt::merkle_num_nodes(num_leafs)));
+	int const first_leaf = lt::merkle_first_leaf(num_leafs);
+	for (int i = 0; i < num_leafs; ++i)
+		lt::aux::random_bytes(tree[std::size_t(first_leaf + i)]);
+
+	while (s.keep_running())
+	{
+		lt::merkle_fill_tree(tree, num_leafs);
+		bench::do_not_optimize(tree[0]);
+	}
+	s.set_items_processed(s.iterations() * num_leafs);
+}
+BENCHMARK(merkle_fill_tree);
+
+void merkle_root(bench::state& s)
+{
+	std::vector<lt::sha256_hash> leafs(3000);
+	for (auto& l : leafs) lt::aux::random_bytes(l);
+
+	while (s.keep_running())
+	{
+		lt::sha256_hash const root = lt::merkle_root(leafs);
+		bench::do_not_optimize(root);
+	}
+	s.set_items_processed(s.iterations() * std::int64_t(leafs.size()));
+}
+BENCHMARK(merkle_root);
+
+// alerts posted by a number of threads, while the calling thread consumes
+// them. Each iteration posts 10000 alerts per producer
+void alert_throughput(bench::state& s, int const num_producers, bool const use_handler)
+{
+	int const alerts_per_producer = 10000;
+	lt::aux::alert_manager mgr(num_producers * alerts_per_producer
+		, lt::alert_category::all);
+
+	std::int64_t received = 0;
+	std::vector<lt::alert*> alerts;
+	while (s.keep_running())
+	{
+		std::atomic<int> producers_done{0};
+		std::vector<std::thread> producers;
+		for (int p = 0; p < num_producers; ++p)
+		{
+			producers.emplace_back([&mgr, &producers_done] {
+				for (int i = 0; i < alerts_per_producer; ++i)
+					mgr.emplace_alert<lt::dht_bootstrap_alert>();
+				++producers_done;
+			});
+		}
+
+		for (;;)
+		{
+			bool const done = producers_done == num_producers;
+			std::int64_t batch = 0;
+			if (use_handler)
+			{
+				mgr.get_all([&batch](lt::alert*) { ++batch; });
+			}
+			else
+			{
+				mgr.get_all(alerts);
+				batch = std::int64_t(alerts.size());
+			}
+			received += batch;
+			if (done && batch == 0) break;
+		}
+		for (auto& t : producers) t.join();
+	}
+	s.set_items_processed(received);
+}
+
+void alert_throughput_1_producer(bench::state& s)
+{ alert_throughput(s, 1, false); }
+BENCHMARK(alert_throughput_1_producer);
+
+void alert_throughput_4_producers(bench::state& s)
+{ alert_throughput(s, 4, false); }
+BENCHMARK(alert_throughput_4_producers);
+
+void alert_throughput_4_producers_handler(bench::state& s)
+{ alert_throughput(s, 4, true); }
+BENCHMARK(alert_throughput_4_producers_handler);
+
+
+// the layout counters used to have. One contiguous array of atomics
+struct flat_counters
+{
+	std::atomic<std::int64_t> counter[lt::counters::num_counters] = {};
+	void inc_stats_counter(int const c)
+	{ counter[c].fetch_add(1, std::memory_order_relaxed); }
+};
+
+// every thread bumps a different counter, which is the pattern of the
+// network thread and disk threads counting their own events
+template <typename Counters>
+void counter_contention(bench::state& s, int const num_threads)
+{
+	int const increments = 100000;
+	auto c = std::make_unique<Counters>();
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		std::atomic<bool> start{false};
+		std::vector<std::thread> threads;
+		for (int t = 0; t < num_threads; ++t)
+		{
+			int const idx = lt::counters::num_blocks_written + (t % 4);
+			threads.emplace_back([&c, &start, idx, increments] {
+				while (!start) std::this_thread::yield();
+				for (int i = 0; i < increments; ++i)
+					c->inc_stats_counter(idx);
+			});
+		}
+		s.resume_timing();
+		start = true;
+		for (auto& t : threads) t.join();
+	}
+	s.set_items_processed(s.iterations() * num_threads * increments);
+}
+
+void counter_contention_flat_1_thread(bench::state& s)
+{ counter_contention<flat_counters>(s, 1); }
+BENCHMARK(counter_contention_flat_1_thread);
+
+void counter_contention_flat_4_threads(bench::state& s)
+{ counter_contention<flat_counters>(s, 4); }
+BENCHMARK(counter_contention_flat_4_threads);
+
+void counter_contention_sharded_1_thread(bench::state& s)
+{ counter_contention<lt::counters>(s, 1); }
+BENCHMARK(counter_contention_sharded_1_thread);
+
+void counter_contention_sharded_4_threads(bench::state& s)
+{ counter_contention<lt::counters>(s, 4); }
+BENCHMARK(counter_contention_sharded_4_threads);
+
+
+// a peer that always wants more bandwidth than it's given
+struct bandwidth_peer : lt::aux::bandwidth_socket
+	, std::enable_shared_from_this<bandwidth_peer>
+{
+	bandwidth_peer(lt::aux::bandwidth_manager& bwm, lt::aux::bandwidth_channel& torrent
+		, lt::aux::bandwidth_channel& global)
+		: m_bwm(bwm), m_torrent(torrent), m_global(global)
+	{}
+
+	void assign_bandwidth(int, int) override { request(); }
+	bool is_disconnecting() const override { return false; }
+
+	void request()
+	{
+		lt::aux::bandwidth_channel* channels[] = { &m_channel, &m_torrent, &m_global };
+		m_bwm.request_bandwidth(shared_from_this(), 400000000, 200, channels, 3);
+	}
+
+	lt::aux::bandwidth_manager& m_bwm;
+	lt::aux::bandwidth_channel m_channel;
+	lt::aux::bandwidth_channel& m_torrent;
+	lt::aux::bandwidth_channel& m_global;
+};
+
+// one tick of the rate limiter, with every peer waiting for bandwidth
+void bandwidth_update_quotas(bench::state& s, int const num_torrents
+	, int const peers_per_torrent)
+{
+	int const global_limit = 100000000;
+	lt::aux::bandwidth_manager manager(0);
+	lt::aux::bandwidth_channel global;
+	global.throttle(global_limit);
+
+	std::vector<lt::aux::bandwidth_channel> torrents(static_cast<std::size_t>(num_torrents));
+	std::vector<std::shared_ptr<bandwidth_peer>> peers;
+	for (auto& t : torrents)
+	{
+		t.throttle(global_limit / num_torrents * 2);
+		for (int i = 0; i < peers_per_torrent; ++i)
+			peers.push_back(std::make_shared<bandwidth_peer>(manager, t, global));
+	}
+	for (auto& p : peers) p->request();
+
+	while (s.keep_running())
+		manager.update_quotas(lt::milliseconds(500));
+
+	s.set_items_processed(s.iterations());
+	s.counter("queued_requests", manager.queue_size());
+	manager.close();
+}
+
+void bandwidth_update_quotas_100_torrents(bench::state& s)
+{ bandwidth_update_quotas(s, 100, 10); }
+BENCHMARK(bandwidth_update_quotas_100_torrents);
+
+void bandwidth_update_quotas_1000_torrents(bench::state& s)
+{ bandwidth_update_quotas(s, 1000, 10); }
+BENCHMARK(bandwidth_update_quotas_1000_torrents);
+
+// the cost of a trace scope around e.g. a disk job, when tracing is
+// disabled (the common case) and when it's recording
+void trace_overhead(bench::state& s, bool const enabled)
+{
+	lt::aux::clear_trace();
+	lt::aux::set_trace_enabled(enabled);
+	int i = 0;
+	while (s.keep_running())
+	{
+		lt::aux::trace_scope t("bench", "scope", i++);
+	}
+	lt::aux::set_trace_enabled(false);
+	lt::aux::clear_trace();
+	s.set_items_processed(s.iterations());
+}
+
+void trace_scope_disabled(bench::state& s) { trace_overhead(s, false); }
+BENCHMARK(trace_scope_disabled);
+
+void trace_scope_enabled(bench::state& s) { trace_overhead(s, true); }
+BENCHMARK(trace_scope_enabled);
+
+}
@@ -0,0 +1,221 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/piece_picker.hpp"
+#include "libtorrent/peer_list.hpp"
+#include "libtorrent/torrent_peer.hpp"
+#include "libtorrent/torrent_peer_allocator.hpp"
+#include "libtorrent/performance_counters.hpp"
+#include "libtorrent/bitfield.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/socket.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+int const num_pieces = 10000;
+int const piece_size = 0x40000;
+int const num_swarm_peers = 50;
+
+// the peers in a simulated swarm, each having a random half of the pieces
+struct swarm
+{
+	swarm()
+	{
+		for (int i = 0; i < num_swarm_peers; ++i)
+		{
+			lt::tcp::endpoint const ep(lt::make_address_v4("10.0.0.1"), std::uint16_t(1000 + i));
+			peers.emplace_back(new lt::ipv4_peer(ep, true, {}));
+#if TORRENT_USE_ASSERTS
+			peers.back()->in_use = true;
+#endif
+			lt::typed_bitfield<lt::piece_index_t> have(num_pieces, false);
+			for (lt::piece_index_t p(0); p < have.end_index(); ++p)
+				if (lt::random(1)) have.set_bit(p);
+			bitfields.push_back(std::move(have));
+		}
+	}
+
+	void join(lt::piece_picker& p) const
+	{
+		for (std::size_t i = 0; i < peers.size(); ++i)
+			p.inc_refcount(bitfields[i], peers[i].get());
+	}
+
+	std::vector<std::unique_ptr<lt::ipv4_peer>> peers;
+	std::vector<lt::typed_bitfield<lt::piece_index_t>> bitfields;
+};
+
+swarm const& test_swarm()
+{
+	static swarm const s;
+	return s;
+}
+
+void piece_picker_pick_pieces(bench::state& s)
+{
+	swarm const& sw = test_swarm();
+	lt::piece_picker p(std::int64_t(num_pieces) * piece_size, piece_size);
+	sw.join(p);
+
+	lt::counters cnt;
+	std::vector<lt::piece_block> picked;
+	std::vector<lt::piece_index_t> const suggested;
+	while (s.keep_running())
+	{
+		picked.clear();
+		p.pick_pieces(sw.bitfields[0], picked, 16, 0, sw.peers[0].get()
+			, lt::piece_picker::rarest_first, suggested, num_swarm_peers, cnt);
+		bench::do_not_optimize(picked.data());
+	}
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(piece_picker_pick_pieces);
+
+void piece_picker_peer_join_leave(bench::state& s)
+{
+	swarm const& sw = test_swarm();
+	lt::piece_picker p(std::int64_t(num_pieces) * piece_size, piece_size);
+	sw.join(p);
+
+	// make sure the picker's piece list is built, which is what makes
+	// changing the availability expensive
+	lt::counters cnt;
+	std::vector<lt::piece_block> picked;
+	p.pick_pieces(sw.bitfields[0], picked, 1, 0, sw.peers[0].get()
+		, lt::piece_picker::rarest_first, {}, num_swarm_peers, cnt);
+
+	while (s.keep_running())
+	{
+		p.dec_refcount(sw.bitfields[1], sw.peers[1].get());
+		p.inc_refcount(sw.bitfields[1], sw.peers[1].get());
+	}
+	s.set_items_processed(s.iterations() * 2);
+}
+BENCHMARK(piece_picker_peer_join_leave);
+
+void piece_picker_download_all(bench::state& s)
+{
+	swarm const& sw = test_swarm();
+	int const blocks_per_piece = piece_size / lt::default_block_size;
+	int const pieces = 1000;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		lt::piece_picker p(std::int64_t(pieces) * piece_size, piece_size);
+		s.resume_timing();
+
+		lt::torrent_peer* peer = sw.peers[0].get();
+		for (lt::piece_index_t i(0); i < lt::piece_index_t(pieces); ++i)
+		{
+			for (int b = 0; b < blocks_per_piece; ++b)
+			{
+				lt::piece_block const blk(i, b);
+				p.mark_as_downloading(blk, peer);
+				p.mark_as_writing(blk, peer);
+				p.mark_as_finished(blk, peer);
+			}
+			p.piece_passed(i);
+			p.we_have(i);
+		}
+		bench::do_not_optimize(p.num_passed());
+	}
+	s.set_items_processed(s.iterations() * pieces * blocks_per_piece);
+}
+BENCHMARK(piece_picker_download_all);
+
+lt::torrent_state peer_list_state()
+{
+	lt::torrent_state st;
+	st.max_peerlist_size = 4000;
+	st.port = 6881;
+	return st;
+}
+
+lt::tcp::endpoint peer_endpoint(int const i)
+{
+	return lt::tcp::endpoint(lt::address_v4(std::uint32_t(0x0a000000 + i * 13))
+		, std::uint16_t(6881 + i % 100));
+}
+
+void peer_list_add_peers(bench::state& s)
+{
+	lt::torrent_peer_allocator allocator;
+	int const num_peers = 2000;
+	while (s.keep_running())
+	{
+		lt::peer_list p(allocator);
+		lt::torrent_state st = peer_list_state();
+		for (int i = 0; i < num_peers; ++i)
+		{
+			p.add_peer(peer_endpoint(i), {}, {}, &st);
+			st.erased.clear();
+		}
+		bench::do_not_optimize(p.num_peers());
+		s.pause_timing();
+		p.clear();
+		s.resume_timing();
+	}
+	s.set_items_processed(s.iterations() * num_peers);
+}
+BENCHMARK(peer_list_add_peers);
+
+void peer_list_connect_one_peer(bench::state& s)
+{
+	lt::torrent_peer_allocator allocator;
+	lt::peer_list p(allocator);
+	lt::torrent_state st = peer_list_state();
+	for (int i = 0; i < 2000; ++i)
+	{
+		p.add_peer(peer_endpoint(i), {}, {}, &st);
+		st.erased.clear();
+	}
+
+	int session_time = 0;
+	while (s.keep_running())
+	{
+		// no connection is made, so every call picks among all peers in the
+		// list again
+		lt::torrent_peer* peer = p.connect_one_peer(session_time++, &st);
+		bench::do_not_optimize(peer);
+	}
+	s.set_items_processed(s.iterations());
+	p.clear();
+}
+BENCHMARK(peer_list_connect_one_peer);
+
+}
@@ -0,0 +1,432 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/session.hpp"
+#include "libtorrent/session_params.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/add_torrent_params.hpp"
+#include "libtorrent/torrent_info.hpp"
+#include "libtorrent/torrent_status.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/disabled_disk_io.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/aux_/path.hpp"
+#include "libtorrent/alert_types.hpp"
+#include "libtorrent/session_stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// these benchmarks run complete sessions, transferring data over the loopback
+// interface. Transfers use the disabled disk I/O subsystem, to measure the
+// networking and protocol overhead rather than the disk.
+
+namespace {
+
+auto const transfer_timeout = std::chrono::minutes(2);
+
+lt::settings_pack bench_settings()
+{
+	lt::settings_pack pack;
+	pack.set_str(lt::settings_pack::listen_interfaces, "127.0.0.1:0");
+	pack.set_bool(lt::settings_pack::enable_dht, false);
+	pack.set_bool(lt::settings_pack::enable_lsd, false);
+	pack.set_bool(lt::settings_pack::enable_upnp, false);
+	pack.set_bool(lt::settings_pack::enable_natpmp, false);
+	pack.set_bool(lt::settings_pack::allow_multiple_connections_per_ip, true);
+	pack.set_int(lt::settings_pack::alert_mask, lt::alert_category::error);
+	pack.set_int(lt::settings_pack::send_buffer_watermark, 4 * 1024 * 1024);
+	pack.set_int(lt::settings_pack::max_out_request_queue, 1000);
+	pack.set_int(lt::settings_pack::unchoke_slots_limit, -1);
+	return pack;
+}
+
+// a v1 torrent whose piece hashes are all zero, which is what the disabled
+// disk I/O subsystem produces
+std::shared_ptr<lt::torrent_info> make_torrent(std::int64_t const size)
+{
+	lt::file_storage fs;
+	fs.add_file("bench/transfer", size);
+	lt::create_torrent t(fs, 0x100000, lt::create_torrent::v1_only);
+	for (lt::piece_index_t i(0); i < fs.end_piece(); ++i)
+		t.set_hash(i, lt::sha1_hash());
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<lt::torrent_info>(buf, lt::from_span);
+}
+
+bool wait_for(std::vector<lt::torrent_handle> const& handles
+	, lt::torrent_status::state_t const st)
+{
+	auto const deadline = std::chrono::steady_clock::now() + transfer_timeout;
+	for (auto const& h : handles)
+	{
+		while (h.status({}).state != st)
+		{
+			if (std::chrono::steady_clock::now() > deadline) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+	return true;
+}
+
+void transfer(bench::state& s, bool const utp, int const num_downloaders
+	, std::int64_t const size)
+{
+	auto const ti = make_torrent(size);
+
+	lt::settings_pack pack = bench_settings();
+	pack.set_bool(lt::settings_pack::enable_outgoing_utp, utp);
+	pack.set_bool(lt::settings_pack::enable_incoming_utp, utp);
+	pack.set_bool(lt::settings_pack::enable_outgoing_tcp, !utp);
+	pack.set_bool(lt::settings_pack::enable_incoming_tcp, !utp);
+
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		lt::session_params params(pack);
+		params.disk_io_constructor = lt::disabled_disk_io_constructor;
+
+		lt::session seed(params);
+		lt::add_torrent_params atp;
+		atp.ti = ti;
+		atp.save_path = ".";
+		atp.flags |= lt::torrent_flags::seed_mode;
+		atp.flags &= ~(lt::torrent_flags::auto_managed | lt::torrent_flags::paused);
+		lt::torrent_handle const seed_handle = seed.add_torrent(atp);
+
+		std::vector<std::unique_ptr<lt::session>> sessions;
+		std::vector<lt::torrent_handle> handles;
+		atp.flags &= ~lt::torrent_flags::seed_mode;
+		for (int i = 0; i < num_downloaders; ++i)
+		{
+			sessions.emplace_back(new lt::session(params));
+			handles.push_back(sessions.back()->add_torrent(atp));
+		}
+
+		if (!wait_for({seed_handle}, lt::torrent_status::seeding)
+			|| !wait_for(handles, lt::torrent_status::downloading))
+		{
+			s.skip("timed out starting sessions");
+			return;
+		}
+		lt::tcp::endpoint const seed_ep(lt::make_address_v4("127.0.0.1")
+			, seed.listen_port());
+		s.resume_timing();
+
+		for (auto const& h : handles) h.connect_peer(seed_ep);
+		if (!wait_for(handles, lt::torrent_status::seeding))
+		{
+			s.skip("timed out transferring");
+			return;
+		}
+
+		// the timer is resumed after setting up the next iteration. Tear down
+		// the sessions in parallel
+		s.pause_timing();
+		std::vector<lt::session_proxy> proxies;
+		proxies.push_back(seed.abort());
+		for (auto& ses : sessions) proxies.push_back(ses->abort());
+	}
+	s.set_bytes_processed(s.iterations() * num_downloaders * size);
+	s.counter("peers", num_downloaders);
+}
+
+// returns the session's stats counters
+std::vector<std::int64_t> session_counters(lt::session& ses)
+{
+	ses.post_session_stats();
+	auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	std::vector<lt::alert*> alerts;
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		ses.wait_for_alert(lt::seconds(1));
+		ses.pop_alerts(&alerts);
+		for (lt::alert* a : alerts)
+		{
+			if (auto* sa = lt::alert_cast<lt::session_stats_alert>(a))
+			{
+				auto const c = sa->counters();
+				return {c.begin(), c.end()};
+			}
+		}
+	}
+	return {};
+}
+
+// a session with many torrents, none of which has a peer that may be
+// connected to, because they all failed and are waiting for their reconnect
+// timeout. This measures the CPU the session spends on them while idle
+void idle_connect_candidates(bench::state& s)
+{
+	int const num_torrents = 2000;
+	int const peers_per_torrent = 4;
+
+	lt::settings_pack pack = bench_settings();
+	pack.set_int(lt::settings_pack::alert_mask, lt::alert_category::stats);
+	pack.set_int(lt::settings_pack::connection_speed, 5000);
+	pack.set_int(lt::settings_pack::connections_limit, 10000);
+	pack.set_bool(lt::settings_pack::smooth_connects, false);
+	pack.set_bool(lt::settings_pack::enable_outgoing_utp, false);
+
+	int const attempts_idx = lt::find_metric_idx("peer.connection_attempts");
+	int const loops_idx = lt::find_metric_idx("peer.connection_attempt_loops");
+	int const deferred_idx = lt::find_metric_idx("peer.deferred_connection_attempts");
+	if (attempts_idx < 0 || loops_idx < 0 || deferred_idx < 0)
+	{
+		s.skip("missing counters");
+		return;
+	}
+
+	std::int64_t loops = 0;
+	std::int64_t deferred = 0;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		lt::session_params params(pack);
+		params.disk_io_constructor = lt::disabled_disk_io_constructor;
+		lt::session ses(params);
+
+		// the peers are ports on the loopback interface that nothing listens
+		// on, so connection attempts fail right away
+		lt::add_torrent_params atp;
+		atp.save_path = ".";
+		atp.flags &= ~(lt::torrent_flags::auto_managed | lt::torrent_flags::paused);
+		for (int k = 0; k < peers_per_torrent; ++k)
+			atp.peers.emplace_back(lt::make_address_v4("127.0.0.1"), std::uint16_t(k + 1));
+		for (int i = 0; i < num_torrents; ++i)
+		{
+			lt::aux::random_bytes(atp.info_hashes.v1);
+			ses.async_add_torrent(atp);
+		}
+
+		// wait for every peer to have been tried
+		auto const deadline = std::chrono::steady_clock::now() + transfer_timeout;
+		std::vector<std::int64_t> before = session_counters(ses);
+		while (!before.empty() && before[std::size_t(attempts_idx)]
+			< std::int64_t(num_torrents) * peers_per_torrent)
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				s.skip("timed out connecting");
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			before = session_counters(ses);
+		}
+		if (before.empty())
+		{
+			s.skip("no session stats");
+			return;
+		}
+
+		s.resume_timing();
+		std::this_thread::sleep_for(std::chrono::seconds(5));
+		s.pause_timing();
+
+		std::vector<std::int64_t> const after = session_counters(ses);
+		if (after.empty())
+		{
+			s.skip("no session stats");
+			return;
+		}
+		loops += after[std::size_t(loops_idx)] - before[std::size_t(loops_idx)];
+		deferred += after[std::size_t(deferred_idx)];
+	}
+	s.counter("torrents", num_torrents);
+	s.counter("peer list iterations per second", double(loops) / double(s.iterations()) / 5);
+	s.counter("deferrals", double(deferred) / double(s.iterations()));
+}
+BENCHMARK_MACRO(idle_connect_candidates);
+
+void transfer_tcp(bench::state& s) { transfer(s, false, 1, 1024 * 1024 * 1024); }
+BENCHMARK_MACRO(transfer_tcp);
+
+void transfer_utp(bench::state& s) { transfer(s, true, 1, 256 * 1024 * 1024); }
+BENCHMARK_MACRO(transfer_utp);
+
+void seed_to_8_peers(bench::state& s) { transfer(s, false, 8, 128 * 1024 * 1024); }
+BENCHMARK_MACRO(seed_to_8_peers);
+
+// a single piece torrent with a random piece hash, to give every seed a
+// distinct info-hash
+std::shared_ptr<lt::torrent_info> make_seed(int const idx)
+{
+	lt::file_storage fs;
+	fs.add_file("seed/" + std::to_string(idx), 0x4000);
+	lt::create_torrent t(fs, 0x4000);
+	lt::sha1_hash h;
+	lt::aux::random_bytes(h);
+	t.set_hash(lt::piece_index_t(0), h);
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<lt::torrent_info>(buf, lt::from_span);
+}
+
+// a session with many auto-managed torrents, half of them seeds. This
+// measures how long the network thread is blocked recalculating the
+// auto-managed torrent queue, which is forced by changing active_seeds
+void auto_manage_queue(bench::state& s, int const num_torrents)
+{
+	lt::settings_pack pack = bench_settings();
+	pack.set_int(lt::settings_pack::alert_mask, 0);
+	pack.set_int(lt::settings_pack::active_downloads, 100);
+	pack.set_int(lt::settings_pack::active_seeds, 100);
+	pack.set_int(lt::settings_pack::active_limit, 200);
+
+	int const rounds = 10;
+	lt::time_duration worst{};
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		lt::session_params params(pack);
+		params.disk_io_constructor = lt::disabled_disk_io_constructor;
+		lt::session ses(params);
+
+		for (int i = 0; i < num_torrents; ++i)
+		{
+			lt::add_torrent_params atp;
+			atp.save_path = ".";
+			atp.flags |= lt::torrent_flags::auto_managed | lt::torrent_flags::paused;
+			if (i & 1)
+			{
+				atp.ti = make_seed(i);
+				atp.flags |= lt::torrent_flags::seed_mode;
+			}
+			else
+			{
+				lt::aux::random_bytes(atp.info_hashes.v1);
+			}
+			ses.async_add_torrent(std::move(atp));
+		}
+		// wait for all torrents to be added
+		ses.get_torrents();
+
+		for (int i = 0; i < rounds; ++i)
+		{
+			// the auto-manager won't run more than once per second
+			std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+			lt::settings_pack sp;
+			sp.set_int(lt::settings_pack::active_seeds, (i & 1) ? 100 : 99);
+			s.resume_timing();
+			auto const start = lt::clock_type::now();
+			ses.apply_settings(std::move(sp));
+			// the recalculation is posted to the network thread. Two
+			// round-trips guarantee it has run by the time we get the second
+			// response
+			ses.is_paused();
+			ses.is_paused();
+			worst = std::max(worst, lt::clock_type::now() - start);
+			s.pause_timing();
+		}
+	}
+	s.set_items_processed(s.iterations() * rounds);
+	s.counter("torrents", num_torrents);
+	s.counter("worst recalculation (us)", double(lt::total_microseconds(worst)));
+}
+
+void auto_manage_queue_10k(bench::state& s) { auto_manage_queue(s, 10000); }
+BENCHMARK_MACRO(auto_manage_queue_10k);
+
+void auto_manage_queue_100k(bench::state& s) { auto_manage_queue(s, 100000); }
+BENCHMARK_MACRO(auto_manage_queue_100k);
+
+// hash-check files on disk, using the default disk I/O subsystem. Since the
+// files were just written, they are most likely in the page cache, making
+// this a measure of hashing and disk job overhead rather than the drive
+void check_files(bench::state& s)
+{
+	std::string const save_path = "bench_checking";
+	std::int64_t const size = 256 * 1024 * 1024;
+	lt::error_code ec;
+	lt::create_directories(save_path + "/bench", ec);
+	{
+		std::vector<char> buf(0x100000);
+		FILE* f = std::fopen((save_path + "/bench/checking").c_str(), "wb+");
+		if (f == nullptr)
+		{
+			s.skip("failed to create file");
+			return;
+		}
+		for (std::int64_t written = 0; written < size; written += std::int64_t(buf.size()))
+		{
+			lt::aux::random_bytes(buf);
+			std::fwrite(buf.data(), 1, buf.size(), f);
+		}
+		std::fclose(f);
+	}
+
+	lt::file_storage fs;
+	lt::add_files(fs, save_path + "/bench");
+	lt::create_torrent t(fs, 0x100000);
+	lt::set_piece_hashes(t, save_path, ec);
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	auto const ti = std::make_shared<lt::torrent_info>(buf, lt::from_span);
+
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		lt::session ses(bench_settings());
+		s.resume_timing();
+
+		lt::add_torrent_params atp;
+		atp.ti = ti;
+		atp.save_path = save_path;
+		atp.flags &= ~(lt::torrent_flags::auto_managed | lt::torrent_flags::paused);
+		lt::torrent_handle const h = ses.add_torrent(atp);
+		if (!wait_for({h}, lt::torrent_status::seeding))
+		{
+			s.skip("timed out checking");
+			break;
+		}
+
+		// shutting down the session is not included
+		s.pause_timing();
+	}
+	s.set_bytes_processed(s.iterations() * size);
+	lt::remove_all(save_path, ec);
+}
+BENCHMARK_MACRO(check_files);
+
+}
@@ -0,0 +1,194 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+
+#include "libtorrent/torrent_info.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/file_storage.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/random.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+// these benchmarks load .torrent files with very many files from disk, both
+// by reading them into a buffer and by memory mapping them
+// (load_torrent_limits::map_file). Each benchmark also reports the increase
+// in resident memory while the loaded torrent_info is alive.
+
+namespace {
+
+// writes a torrent with the specified number of files to disk (once) and
+// returns its filename
+std::string make_torrent_file(int const num_files, bool const v2)
+{
+	std::string const filename = "bench_" + std::to_string(num_files)
+		+ (v2 ? "_v2" : "_v1") + ".torrent";
+	if (std::ifstream(filename).good()) return filename;
+
+	int const piece_size = 0x4000;
+	lt::file_storage fs;
+	for (int i = 0; i < num_files; ++i)
+	{
+		fs.add_file("bench/dir-" + std::to_string(i / 1000)
+			+ "/file-" + std::to_string(i), 2 * piece_size);
+	}
+	lt::create_torrent t(fs, piece_size
+		, v2 ? lt::create_torrent::v2_only : lt::create_torrent::v1_only);
+	if (v2)
+	{
+		for (lt::file_index_t f : fs.file_range())
+		{
+			for (int p = 0; p < 2; ++p)
+			{
+				lt::sha256_hash h;
+				lt::aux::random_bytes(h);
+				t.set_hash2(f, lt::piece_index_t::diff_type(p), h);
+			}
+		}
+	}
+	else
+	{
+		for (lt::piece_index_t i(0); i < fs.end_piece(); ++i)
+		{
+			lt::sha1_hash h;
+			lt::aux::random_bytes(h);
+			t.set_hash(i, h);
+		}
+	}
+
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	std::ofstream out(filename, std::ios_base::binary);
+	out.write(buf.data(), std::streamsize(buf.size()));
+	return filename;
+}
+
+void load_torrent(bench::state& s, int const num_files, bool const v2
+	, bool const map_file)
+{
+	std::string const filename = make_torrent_file(num_files, v2);
+
+	lt::load_torrent_limits cfg;
+	cfg.max_buffer_size = std::numeric_limits<int>::max();
+	cfg.max_decode_tokens = std::numeric_limits<int>::max();
+	cfg.max_pieces = std::numeric_limits<int>::max();
+	cfg.map_file = map_file;
+
+	std::int64_t rss = 0;
+	while (s.keep_running())
+	{
+		s.pause_timing();
+		std::int64_t const before = bench::resident_bytes();
+		s.resume_timing();
+
+		lt::torrent_info const ti(filename, cfg);
+		bench::do_not_optimize(ti);
+
+		// destructing the torrent_info is not included
+		s.pause_timing();
+		rss = std::max(rss, bench::resident_bytes() - before);
+	}
+	s.set_items_processed(s.iterations() * num_files);
+	if (rss > 0) s.counter("rss_delta_mb", double(rss) / 1024.0 / 1024.0);
+}
+
+void load_torrent_v1_100k(bench::state& s) { load_torrent(s, 100000, false, false); }
+BENCHMARK_MACRO(load_torrent_v1_100k);
+
+void load_torrent_v1_100k_mapped(bench::state& s) { load_torrent(s, 100000, false, true); }
+BENCHMARK_MACRO(load_torrent_v1_100k_mapped);
+
+void load_torrent_v2_100k(bench::state& s) { load_torrent(s, 100000, true, false); }
+BENCHMARK_MACRO(load_torrent_v2_100k);
+
+void load_torrent_v2_100k_mapped(bench::state& s) { load_torrent(s, 100000, true, true); }
+BENCHMARK_MACRO(load_torrent_v2_100k_mapped);
+
+void load_torrent_v1_1m(bench::state& s) { load_torrent(s, 1000000, false, false); }
+BENCHMARK_MACRO(load_torrent_v1_1m);
+
+void load_torrent_v1_1m_mapped(bench::state& s) { load_torrent(s, 1000000, false, true); }
+BENCHMARK_MACRO(load_torrent_v1_1m_mapped);
+
+// a dataset-like layout, with long directory names repeated across many
+// files
+lt::file_storage dataset_files(int const num_files)
+{
+	lt::file_storage fs;
+	fs.set_piece_length(0x4000);
+	for (int i = 0; i < num_files; ++i)
+	{
+		fs.add_file("dataset/training-images-high-resolution/split-" + std::to_string(i % 10)
+			+ "/category-" + std::to_string(i % 1000)
+			+ "/subject-" + std::to_string(i % 5000)
+			+ "/image-" + std::to_string(i) + ".jpg", 0x3000);
+	}
+	return fs;
+}
+
+void file_index_at_offset_100k(bench::state& s)
+{
+	lt::file_storage const fs = dataset_files(100000);
+	std::int64_t i = 0;
+	while (s.keep_running())
+	{
+		std::int64_t const offset = (i * 7919 * 0x3000 + i) % fs.total_size();
+		bench::do_not_optimize(fs.file_index_at_offset(offset));
+		++i;
+	}
+	s.set_items_processed(s.iterations());
+}
+BENCHMARK(file_index_at_offset_100k);
+
+void file_path_100k(bench::state& s)
+{
+	lt::file_storage const fs = dataset_files(100000);
+	lt::file_index_t i{0};
+	while (s.keep_running())
+	{
+		bench::do_not_optimize(fs.file_path(i));
+		if (++i == fs.end_file()) i = lt::file_index_t{0};
+	}
+	s.set_items_processed(s.iterations());
+	s.counter("directories", double(fs.paths().size()));
+}
+BENCHMARK(file_path_100k);
+
+}
@@ -0,0 +1,353 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "bench.hpp"
+#include "libtorrent/config.hpp"
+#include "libtorrent/version.hpp"
+
+#include <algorithm>
+#include <cinttypes> // for PRId64
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h> // for mallinfo2
+#endif
+
+namespace bench {
+
+namespace {
+
+	struct benchmark
+	{
+		std::string name;
+		bench_fun fun;
+		std::int64_t iterations;
+	};
+
+	std::vector<benchmark>& registry()
+	{
+		static std::vector<benchmark> r;
+		return r;
+	}
+
+	// process CPU time, including all threads
+	std::int64_t process_cpu_ns()
+	{
+		return std::int64_t(std::clock()) * 1000000000 / CLOCKS_PER_SEC;
+	}
+
+	struct result
+	{
+		std::string name;
+		std::int64_t iterations = 0;
+		int repetitions = 0;
+		double real_ns = 0;
+		double cpu_ns = 0;
+		double bytes_per_second = 0;
+		double items_per_second = 0;
+		std::string skipped;
+		std::vector<std::pair<std::string, double>> counters;
+	};
+
+	state run_once(benchmark const& b, std::int64_t const iterations)
+	{
+		state s(iterations);
+		b.fun(s);
+		return s;
+	}
+
+	// find the number of iterations needed to run for at least min_time
+	std::int64_t calibrate(benchmark const& b, double const min_time)
+	{
+		std::int64_t n = 1;
+		for (;;)
+		{
+			state const s = run_once(b, n);
+			if (!s.skipped().empty()) return n;
+			double const elapsed = double(s.elapsed_ns()) / 1e9;
+			if (elapsed >= min_time || n >= 1000000000) return n;
+			double const factor = elapsed <= 0.0 ? 100.0
+				: std::min(100.0, min_time * 1.4 / elapsed);
+			n = std::max(n + 1, std::int64_t(double(n) * factor));
+		}
+	}
+
+	result run(benchmark const& b, double const min_time, int const repetitions)
+	{
+		result r;
+		r.name = b.name;
+		r.iterations = b.iterations > 0 ? b.iterations : calibrate(b, min_time);
+
+		std::vector<state> runs;
+		for (int i = 0; i < repetitions; ++i)
+		{
+			runs.push_back(run_once(b, r.iterations));
+			if (!runs.back().skipped().empty())
+			{
+				r.skipped = runs.back().skipped();
+				return r;
+			}
+		}
+
+		// report the median run, to be robust against outliers
+		std::sort(runs.begin(), runs.end(), [](state const& lhs, state const& rhs)
+			{ return lhs.elapsed_ns() < rhs.elapsed_ns(); });
+		state const& m = runs[runs.size() / 2];
+
+		double const seconds = double(m.elapsed_ns()) / 1e9;
+		r.repetitions = repetitions;
+		r.real_ns = double(m.elapsed_ns()) / double(r.iterations);
+		r.cpu_ns = double(m.cpu_ns()) / double(r.iterations);
+		if (seconds > 0.0)
+		{
+			r.bytes_per_second = double(m.bytes()) / seconds;
+			r.items_per_second = double(m.items()) / seconds;
+		}
+		r.counters = m.counters();
+		return r;
+	}
+
+	void print_result(result const& r)
+	{
+		if (!r.skipped.empty())
+		{
+			std::printf("%-45s SKIPPED: %s\n", r.name.c_str(), r.skipped.c_str());
+			return;
+		}
+		std::printf("%-45s %14.1f ns %14.1f ns cpu %12" PRId64 " iterations"
+			, r.name.c_str(), r.real_ns, r.cpu_ns, r.iterations);
+		if (r.bytes_per_second > 0.0)
+			std::printf(" %10.2f MiB/s", r.bytes_per_second / (1024 * 1024));
+		if (r.items_per_second > 0.0)
+			std::printf(" %12.0f items/s", r.items_per_second);
+		for (auto const& c : r.counters)
+			std::printf(" %s=%g", c.first.c_str(), c.second);
+		std::printf("\n");
+	}
+
+	std::string json_string(std::string const& s)
+	{
+		std::string ret = "\"";
+		for (char const c : s)
+		{
+			if (c == '"' || c == '\\') ret += '\\';
+			ret += c;
+		}
+		ret += '"';
+		return ret;
+	}
+
+	bool write_json(char const* filename, std::vector<result> const& results)
+	{
+		FILE* f = std::fopen(filename, "w+");
+		if (f == nullptr) return false;
+
+		char date[100];
+		std::time_t const now = std::time(nullptr);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+		std::fprintf(f, "{\n\"context\": {\n"
+			"  \"date\": \"%s\",\n"
+			"  \"libtorrent_version\": \"%s\",\n"
+			"  \"libtorrent_revision\": \"%s\",\n"
+			"  \"num_cpus\": %u,\n"
+#if TORRENT_USE_ASSERTS
+			"  \"assertions\": true\n"
+#else
+			"  \"assertions\": false\n"
+#endif
+			"},\n\"benchmarks\": [\n"
+			, date, LIBTORRENT_VERSION, LIBTORRENT_REVISION
+			, std::thread::hardware_concurrency());
+
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			result const& r = results[i];
+			std::fprintf(f, "  {\"name\": %s", json_string(r.name).c_str());
+			if (!r.skipped.empty())
+			{
+				std::fprintf(f, ", \"skipped\": %s", json_string(r.skipped).c_str());
+			}
+			else
+			{
+				std::fprintf(f, ", \"iterations\": %" PRId64 ", \"repetitions\": %d"
+					", \"real_time_ns\": %.1f, \"cpu_time_ns\": %.1f"
+					", \"bytes_per_second\": %.1f, \"items_per_second\": %.1f"
+					, r.iterations, r.repetitions, r.real_ns, r.cpu_ns
+					, r.bytes_per_second, r.items_per_second);
+				for (auto const& c : r.counters)
+					std::fprintf(f, ", %s: %g", json_string(c.first).c_str(), c.second);
+			}
+			std::fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+		}
+		std::fprintf(f, "]\n}\n");
+		std::fclose(f);
+		return true;
+	}
+
+	[[noreturn]] void print_usage()
+	{
+		std::fputs("usage: libtorrent_bench [options]\n\n"
+			"OPTIONS:\n"
+			"--filter=<str>       only run benchmarks whose name contains <str>\n"
+			"--macro              also run the macro benchmarks (transfers over\n"
+			"                     the loopback interface and checking files)\n"
+			"--min-time=<sec>     the minimum time to run each micro benchmark for\n"
+			"                     (default: 0.5)\n"
+			"--repetitions=<n>    the number of times to repeat each benchmark,\n"
+			"                     the median is reported (default: 3)\n"
+			"--json=<file>        write the results to <file> in JSON format\n"
+			"--list               list the benchmarks and exit\n"
+			, stderr);
+		std::exit(1);
+	}
+}
+
+	state::state(std::int64_t const max_iterations)
+		: m_max_iterations(max_iterations)
+	{}
+
+	void state::start()
+	{
+		m_running = true;
+		m_start = clock_type::now();
+		m_start_cpu = process_cpu_ns();
+	}
+
+	void state::stop()
+	{
+		if (!m_running) return;
+		m_running = false;
+		m_elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			clock_type::now() - m_start).count();
+		m_cpu_ns += process_cpu_ns() - m_start_cpu;
+	}
+
+	void state::pause_timing() { stop(); }
+	void state::resume_timing() { start(); }
+
+	void state::counter(std::string name, double const value)
+	{
+		m_counters.emplace_back(std::move(name), value);
+	}
+
+	registrar::registrar(char const* name, bench_fun f, std::int64_t const iterations)
+	{
+		registry().push_back({name, f, iterations});
+	}
+
+	std::int64_t resident_bytes()
+	{
+#ifdef __linux__
+		FILE* f = std::fopen("/proc/self/statm", "r");
+		if (f == nullptr) return -1;
+		long size = 0;
+		long resident = 0;
+		int const ret = std::fscanf(f, "%ld %ld", &size, &resident);
+		std::fclose(f);
+		if (ret != 2) return -1;
+		return std::int64_t(resident) * 4096;
+#else
+		return -1;
+#endif
+	}
+
+	std::int64_t heap_bytes()
+	{
+#if defined __GLIBC__ && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+		return std::int64_t(::mallinfo2().uordblks);
+#else
+		return -1;
+#endif
+	}
+}
+
+int main(int argc, char const* argv[])
+{
+	std::string filter;
+	bool macro = false;
+	double min_time = 0.5;
+	int repetitions = 3;
+	char const* json = nullptr;
+	bool list = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		char const* arg = argv[i];
+		if (std::strncmp(arg, "--filter=", 9) == 0) filter = arg + 9;
+		else if (std::strcmp(arg, "--macro") == 0) macro = true;
+		else if (std::strncmp(arg, "--min-time=", 11) == 0) min_time = std::atof(arg + 11);
+		else if (std::strncmp(arg, "--repetitions=", 14) == 0) repetitions = std::max(1, std::atoi(arg + 14));
+		else if (std::strncmp(arg, "--json=", 7) == 0) json = arg + 7;
+		else if (std::strcmp(arg, "--list") == 0) list = true;
+		else bench::print_usage();
+	}
+
+	// run benchmarks in a deterministic order, regardless of the order
+	// translation units were initialized in
+	auto& benchmarks = bench::registry();
+	std::sort(benchmarks.begin(), benchmarks.end()
+		, [](bench::benchmark const& lhs, bench::benchmark const& rhs)
+		{ return lhs.name < rhs.name; });
+
+	std::vector<bench::result> results;
+	for (auto const& b : benchmarks)
+	{
+		bool const is_macro = b.name.compare(0, 6, "macro/") == 0;
+		if (is_macro && !macro) continue;
+		if (!filter.empty() && b.name.find(filter) == std::string::npos) continue;
+
+		if (list)
+		{
+			std::printf("%s\n", b.name.c_str());
+			continue;
+		}
+
+		results.push_back(bench::run(b, min_time, repetitions));
+		bench::print_result(results.back());
+		std::fflush(stdout);
+	}
+
+	if (json != nullptr && !bench::write_json(json, results))
+	{
+		std::fprintf(stderr, "failed to write \"%s\"\n", json);
+		return 1;
+	}
+	return 0;
+}
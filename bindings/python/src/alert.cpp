@@ -166,6 +166,20 @@ list dht_sample_infohashes_nodes(dht_sample_infohashes_alert const& alert)
     return result;
 }
 
+list handler_profile_top_handlers(handler_profile_alert const& alert)
+{
+    list result;
+    for (auto const& h : alert.top_handlers)
+    {
+        dict d;
+        d["category"] = h.category;
+        d["wall_time"] = h.wall_time;
+        d["cpu_time"] = h.cpu_time;
+        result.append(d);
+    }
+    return result;
+}
+
 #if TORRENT_ABI_VERSION == 1
 entry const& get_resume_data_entry(save_resume_data_alert const& self)
 {
@@ -272,6 +286,8 @@ namespace boost
 	POLY(session_stats_alert)
 	POLY(socks5_alert)
 	POLY(file_prio_alert)
+	POLY(dht_crawl_alert)
+	POLY(handler_profile_alert)
 
 #if TORRENT_ABI_VERSION == 1
 	POLY(anonymous_mode_alert)
@@ -1137,6 +1153,21 @@ void bind_alert()
         .add_property("nodes", &dht_sample_infohashes_nodes)
         ;
 
+    class_<dht_crawl_alert, bases<alert>, noncopyable>(
+       "dht_crawl_alert", no_init)
+        .add_property("num_infohashes", &dht_crawl_alert::num_infohashes)
+        .add_property("infohashes", &dht_crawl_alert::infohashes)
+        .add_property("num_requests", &dht_crawl_alert::num_requests)
+        .add_property("num_responses", &dht_crawl_alert::num_responses)
+        .add_property("num_unique", &dht_crawl_alert::num_unique)
+        .add_property("concurrency", &dht_crawl_alert::concurrency)
+        ;
+
+    class_<handler_profile_alert, bases<alert>, noncopyable>(
+       "handler_profile_alert", no_init)
+        .add_property("top_handlers", &handler_profile_top_handlers)
+        ;
+
     class_<dht_bootstrap_alert, bases<alert>, noncopyable>(
         "dht_bootstrap_alert", no_init)
         ;
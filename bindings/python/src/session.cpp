@@ -844,6 +844,9 @@ void bind_session()
     dict_to_settings();
     to_python_converter<lt::settings_pack, settings_to_dict>();
 
+    void (lt::session::*post_torrent_updates0)(lt::status_flags_t) = &lt::session::post_torrent_updates;
+    void (lt::session::*post_torrent_updates1)(lt::status_flags_t, lt::torrent_updates_flags_t) = &lt::session::post_torrent_updates;
+
 #ifndef TORRENT_DISABLE_DHT
     void (lt::session::*dht_get_immutable_item)(sha1_hash const&) = &lt::session::dht_get_item;
     sha1_hash (lt::session::*dht_put_immutable_item)(entry data) = &lt::session::dht_put_item;
@@ -1132,9 +1135,11 @@ void bind_session()
         )
         .def("outgoing_ports", depr(&outgoing_ports))
 #endif
-        .def("post_torrent_updates", allow_threads(&lt::session::post_torrent_updates), arg("flags") = 0xffffffff)
+        .def("post_torrent_updates", allow_threads(post_torrent_updates0), arg("flags") = 0xffffffff)
+        .def("post_torrent_updates", allow_threads(post_torrent_updates1), (arg("flags"), arg("updates_flags")))
         .def("post_dht_stats", allow_threads(&lt::session::post_dht_stats))
         .def("post_session_stats", allow_threads(&lt::session::post_session_stats))
+        .def("dump_trace", allow_threads(&lt::session::dump_trace))
         .def("is_listening", allow_threads(&lt::session::is_listening))
         .def("listen_port", allow_threads(&lt::session::listen_port))
 #ifndef TORRENT_DISABLE_DHT
@@ -1158,6 +1163,8 @@ void bind_session()
         .def("dht_announce", allow_threads(&lt::session::dht_announce))
         .def("dht_live_nodes", allow_threads(&lt::session::dht_live_nodes))
         .def("dht_sample_infohashes", allow_threads(&lt::session::dht_sample_infohashes))
+        .def("dht_start_crawl", allow_threads(&lt::session::dht_start_crawl))
+        .def("dht_stop_crawl", allow_threads(&lt::session::dht_stop_crawl))
 #endif // TORRENT_DISABLE_DHT
         .def("add_torrent", &add_torrent)
         .def("async_add_torrent", &async_add_torrent)
@@ -1277,6 +1284,8 @@ void bind_session()
 
     s.attr("delete_files") = lt::session::delete_files;
     s.attr("delete_partfile") = lt::session::delete_partfile;
+
+    s.attr("changed_fields_only") = lt::session::changed_fields_only;
     }
 
 #if TORRENT_ABI_VERSION == 1
@@ -1330,9 +1339,11 @@ void bind_session()
 	enum_<metric_type_t>("metric_type_t")
 		.value("counter", metric_type_t::counter)
 		.value("gauge", metric_type_t::gauge)
+		.value("histogram", metric_type_t::histogram)
 		;
 
     def("session_stats_metrics", session_stats_metrics);
+    def("session_stats_histograms", session_stats_histograms);
     def("find_metric_idx", find_metric_idx_wrap);
 
     scope().attr("create_ut_metadata_plugin") = "ut_metadata";
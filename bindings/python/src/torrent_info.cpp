@@ -296,6 +296,11 @@ load_torrent_limits dict_to_limits(dict limits)
             ret.max_decode_tokens = extract<int>(value);
             continue;
         }
+        else if (key == "map_file")
+        {
+            ret.map_file = extract<bool>(value);
+            continue;
+        }
     }
     return ret;
 }
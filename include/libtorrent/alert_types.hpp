@@ -97,7 +97,7 @@ namespace libtorrent {
 	constexpr int user_alert_id = 10000;
 
 	// this constant represents "max_alert_index" + 1
-	constexpr int num_alert_types = 99;
+	constexpr int num_alert_types = 101;
 
 	// internal
 	constexpr int abi_alert_count = 128;
@@ -2101,7 +2101,7 @@ TORRENT_VERSION_NAMESPACE_3
 	{
 		// internal
 		TORRENT_UNEXPORT state_update_alert(aux::stack_allocator& alloc
-			, std::vector<torrent_status> st);
+			, std::vector<torrent_status> st, std::vector<status_flags_t> fields);
 
 		TORRENT_DEFINE_ALERT_PRIO(state_update_alert, 68, alert_priority::high)
 
@@ -2114,6 +2114,13 @@ TORRENT_VERSION_NAMESPACE_3
 		// suggested to have all torrents sorted by the torrent_handle or hashed
 		// by it, for efficient updates.
 		std::vector<torrent_status> status;
+
+		// the ``query_*`` flags each entry in ``status`` was populated with,
+		// in the same order. When posted via post_torrent_updates() with
+		// session_handle::changed_fields_only, the expensive fields whose
+		// flags are not set were left out, because they have not changed
+		// since they were last posted.
+		std::vector<status_flags_t> queried_fields;
 	};
 
 #if TORRENT_ABI_VERSION == 1
@@ -2996,6 +3003,82 @@ TORRENT_VERSION_NAMESPACE_3_END
 		file_index_t reserved;
 	};
 
+	// posted about once a second while crawling the DHT, which is started by
+	// session::dht_start_crawl(). It carries the info-hashes found since the
+	// previous alert. Each info-hash is reported once per crawl. The set of
+	// info-hashes already reported is probabilistic though, so a small
+	// fraction of new ones (well below 1%) are mistaken for reported ones and
+	// skipped.
+	struct TORRENT_EXPORT dht_crawl_alert final : alert
+	{
+		// internal
+		TORRENT_UNEXPORT dht_crawl_alert(aux::stack_allocator& alloc
+			, std::vector<sha1_hash> const& infohashes
+			, std::int64_t requests, std::int64_t responses
+			, std::int64_t unique, int concurrency);
+
+		TORRENT_DEFINE_ALERT(dht_crawl_alert, 99)
+
+		static constexpr alert_category_t static_category = alert_category::dht_operation;
+		std::string message() const override;
+
+		// the info-hashes found since the previous alert.
+		// ``num_infohashes()`` is more efficient than ``infohashes().size()``.
+		int num_infohashes() const;
+		std::vector<sha1_hash> infohashes() const;
+
+		// the number of sample_infohashes requests sent, and responses
+		// received, since the crawl started
+		std::int64_t const num_requests;
+		std::int64_t const num_responses;
+
+		// the number of unique info-hashes found since the crawl started
+		std::int64_t const num_unique;
+
+		// the number of requests the crawler currently allows in flight. It
+		// adapts to the rate of requests timing out
+		int const concurrency;
+
+	private:
+		std::reference_wrapper<aux::stack_allocator> m_alloc;
+		int const m_num_infohashes;
+		aux::allocation_slot m_infohashes_idx;
+	};
+
+	// posted along with every session_stats_alert when the
+	// ``profile_handlers`` setting is enabled. It ranks the categories of
+	// handlers run by the network thread by the time spent in them since the
+	// previous handler_profile_alert, to point out the ones stalling the
+	// event loop.
+	struct TORRENT_EXPORT handler_profile_alert final : alert
+	{
+		// the time spent in one category of handlers
+		struct handler_time
+		{
+			// the name of the category, matching the suffix of the
+			// ``net.handler_wall_*`` and ``net.handler_cpu_*`` metrics
+			char const* category;
+
+			// the wall-clock time and the (sampled) CPU time spent in handlers
+			// of this category, in microseconds
+			std::int64_t wall_time;
+			std::int64_t cpu_time;
+		};
+
+		// internal
+		TORRENT_UNEXPORT handler_profile_alert(aux::stack_allocator& alloc
+			, std::vector<handler_time> h);
+
+		TORRENT_DEFINE_ALERT(handler_profile_alert, 100)
+
+		static constexpr alert_category_t static_category = alert_category::stats;
+		std::string message() const override;
+
+		// the categories that any time was spent in, ordered by wall-clock
+		// time, the top offender first
+		std::vector<handler_time> top_handlers;
+	};
+
 	// internal
 	TORRENT_EXTRA_EXPORT char const* performance_warning_str(performance_alert::performance_warning_t i);
 
@@ -68,38 +68,33 @@ namespace aux {
 
 		~alert_manager();
 
+		// returns false if the alert was dropped, because the queue is full
 		template <class T, typename... Args>
-		void emplace_alert(Args&&... args) try
+		bool emplace_alert(Args&&... args) try
 		{
-			std::unique_lock<std::recursive_mutex> lock(m_mutex);
+			std::unique_lock<std::mutex> lock(m_mutex);
 
-			heterogeneous_queue<alert>& queue = m_alerts[m_generation];
+			T* const a = emplace_locked<T>(std::forward<Args>(args)...);
+			if (a == nullptr) return false;
 
-			// don't add more than this number of alerts, unless it's a
-			// high priority alert, in which case we try harder to deliver it
-			// for high priority alerts, double the upper limit
-			if (queue.size() / (1 + static_cast<int>(T::priority)) >= m_queue_size_limit)
-			{
-				// record that we dropped an alert of this type
-				m_dropped.set(T::alert_type);
-				return;
-			}
-
-			T& alert = queue.emplace_back<T>(
-				m_allocations[m_generation], std::forward<Args>(args)...);
-
-			maybe_notify(&alert);
+			maybe_notify(a, lock);
+			return true;
 		}
 		catch (std::bad_alloc const&)
 		{
 			// record that we dropped an alert of this type
-			std::unique_lock<std::recursive_mutex> lock(m_mutex);
+			std::lock_guard<std::mutex> lock(m_mutex);
 			m_dropped.set(T::alert_type);
+			return false;
 		}
 
 		bool pending() const;
 		void get_all(std::vector<alert*>& alerts);
 
+		// calls ``handler`` for every pending alert, in the order they were
+		// posted. The alerts stay valid until the next call to get_all()
+		void get_all(std::function<void(alert*)> const& handler);
+
 		template <class T>
 		bool should_post() const
 		{
@@ -129,13 +124,50 @@ namespace aux {
 
 	private:
 
-		void maybe_notify(alert* a);
+		// constructs the alert in the current generation. Returns nullptr if
+		// it was dropped because the queue is full. Must be called with
+		// m_mutex held
+		template <class T, typename... Args>
+		T* emplace_locked(Args&&... args)
+		{
+			heterogeneous_queue<alert>& queue = m_alerts[m_generation];
+
+			// don't add more than this number of alerts, unless it's a
+			// high priority alert, in which case we try harder to deliver it
+			// for high priority alerts, double the upper limit
+			if (queue.size() / (1 + static_cast<int>(T::priority)) >= m_queue_size_limit)
+			{
+				// record that we dropped an alert of this type
+				m_dropped.set(T::alert_type);
+				return nullptr;
+			}
 
-		// this mutex protects everything. Since it's held while executing user
-		// callbacks (the notify function and extension on_alert()) it must be
-		// recursive to support recursively post new alerts.
-		mutable std::recursive_mutex m_mutex;
-		std::condition_variable_any m_condition;
+			return &queue.emplace_back<T>(
+				m_allocations[m_generation], std::forward<Args>(args)...);
+		}
+
+		// wakes up the consumer if this is the first alert in the queue, and
+		// passes the alert to the extensions. The extensions are called with
+		// the lock released, which lets them post alerts of their own
+		void maybe_notify(alert* a, std::unique_lock<std::mutex>& lock);
+
+		// hands the pending alerts over to the client. Returns the generation
+		// the client now owns, or -1 if there were no alerts. Must be called
+		// with m_consumer_mutex held
+		int swap_buffers();
+
+		// this mutex protects the generation being posted to. It's held while
+		// constructing alerts and while calling the notify function, but not
+		// while calling extensions' on_alert(), which may post new alerts.
+		mutable std::mutex m_mutex;
+
+		// serializes the consumers of alerts (get_all()). Only the consumer
+		// modifies m_generation, and the generation not currently being posted
+		// to is owned by the consumer. This lets the consumer destruct and
+		// iterate over alerts without holding m_mutex, which keeps the time
+		// producers may be blocked by the consumer short and constant.
+		std::mutex m_consumer_mutex;
+		std::condition_variable m_condition;
 		std::atomic<alert_category_t> m_alert_mask;
 		int m_queue_size_limit;
 
@@ -157,6 +189,8 @@ namespace aux {
 		// the alert_manager is allowed to use right now. This is swapped when
 		// the client calls get_all(), at which point all of the alert objects
 		// passed to the client will be owned by libtorrent again, and reset.
+		// It's only written to by the consumer, holding both m_consumer_mutex
+		// and m_mutex.
 		int m_generation = 0;
 
 		// this is where all alerts are queued up. There are two heterogeneous
@@ -170,6 +204,11 @@ namespace aux {
 		// such as strings, to go with the alerts.
 		aux::array<stack_allocator, 2> m_allocations;
 
+		// the number of extension on_alert() calls in progress, for alerts in
+		// each generation. The consumer waits for these to finish before
+		// destructing the alerts of a generation
+		aux::array<std::atomic<int>, 2> m_in_callback;
+
 #ifndef TORRENT_DISABLE_EXTENSIONS
 		std::list<std::shared_ptr<plugin>> m_ses_extensions;
 #endif
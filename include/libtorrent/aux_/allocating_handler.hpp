@@ -41,6 +41,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/aligned_storage.hpp"
 
 #include "libtorrent/debug.hpp" // for TORRENT_ASSERT
+#include "libtorrent/aux_/handler_timer.hpp"
 
 #include <type_traits>
 #include <memory> // for shared_ptr
@@ -140,6 +141,9 @@ namespace libtorrent { namespace aux {
 		defer_handler, utp_handler, submit_handler
 	};
 
+	static_assert(int(submit_handler) == int(handler_category::submit)
+		, "handler names must map to their handler_category");
+
 	// this is meant to provide the actual storage for the handler allocator.
 	// There's only a single slot, so the allocator is only supposed to be used
 	// for handlers where there's only a single outstanding operation at a time,
@@ -260,6 +264,7 @@ namespace libtorrent { namespace aux {
 		template <class... A>
 		void operator()(A&&... a)
 		{
+			handler_timer timer(static_cast<handler_category>(Name));
 #ifdef BOOST_NO_EXCEPTIONS
 			handler(std::forward<A>(a)...);
 #else
@@ -326,6 +331,7 @@ namespace libtorrent { namespace aux {
 		template <class... A>
 		void operator()(A&&... a)
 		{
+			handler_timer timer(static_cast<handler_category>(StorageType::name));
 #ifdef BOOST_NO_EXCEPTIONS
 			(ptr_.get()->*Handler)(std::forward<A>(a)...);
 #else
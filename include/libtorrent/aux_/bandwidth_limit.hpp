@@ -85,6 +85,11 @@ struct TORRENT_EXTRA_EXPORT bandwidth_channel
 	// bandwidth
 	int tmp;
 
+	// the bandwidth_manager round in which tmp was last reset. This
+	// lets the manager reset and accumulate tmp in a single pass over
+	// its queue. It's 0 outside of bandwidth_manager::update_quotas()
+	std::uint64_t round;
+
 	// this is the number of bytes to distribute this round
 	int distribute_quota;
 
@@ -78,6 +78,17 @@ private:
 
 	// these are the consumers that want bandwidth
 	std::vector<bw_request> m_queue;
+
+	// scratch space for update_quotas(). The channels with
+	// queued requests and the requests that are done this round. These
+	// are kept as members to not reallocate them every tick
+	std::vector<bandwidth_channel*> m_channels;
+	std::vector<bw_request> m_done;
+
+	// incremented every update_quotas(). Channels are stamped with the
+	// round they were last reset in
+	std::uint64_t m_round = 0;
+
 	// the number of bytes all the requests in queue are for
 	std::int64_t m_queued_bytes;
 
@@ -0,0 +1,157 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_HANDLER_TIMER_HPP_INCLUDED
+#define TORRENT_HANDLER_TIMER_HPP_INCLUDED
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/aux_/array.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace libtorrent {
+
+	struct counters;
+
+namespace aux {
+
+	// the categories the network thread's time is attributed to. The first
+	// entries mirror HandlerName (in allocating_handler.hpp), so a handler's
+	// name can be cast directly to its category
+	enum class handler_category : std::uint8_t
+	{
+		peer_write,
+		peer_read,
+		udp,
+		tick,
+		abort,
+		defer,
+		utp,
+		submit,
+		session_call,
+		torrent_tick,
+		auto_manage,
+		dht,
+		tracker,
+		num_categories
+	};
+
+	constexpr int num_handler_categories = static_cast<int>(handler_category::num_categories);
+
+	// returns the name of the category, as used in the handler_wall_* and
+	// handler_cpu_* metrics (without the prefix)
+	TORRENT_EXTRA_EXPORT char const* handler_category_name(handler_category c);
+
+	// handler timers are off by default. When disabled, a timer doesn't read
+	// any clock, the only cost is a relaxed load of a global flag. Like
+	// tracing, this is process-wide, i.e. shared by all sessions.
+	TORRENT_EXTRA_EXPORT extern std::atomic<bool> g_handler_timers_enabled;
+
+	inline bool handler_timers_enabled()
+	{ return g_handler_timers_enabled.load(std::memory_order_relaxed); }
+
+	TORRENT_EXTRA_EXPORT void set_handler_timers_enabled(bool e);
+
+	// CPU time is only measured for one in this many top-level handlers, since
+	// reading the thread CPU clock is a system call on most platforms. The
+	// sampled time is scaled up by this factor
+	constexpr int handler_cpu_sample_interval = 16;
+
+	// returns the CPU time consumed by the calling thread, in nanoseconds, or
+	// -1 if it's not supported on this platform
+	TORRENT_EXTRA_EXPORT std::int64_t thread_cpu_time();
+
+	// time spent in handlers on the current thread, in nanoseconds, since it
+	// was last drained
+	struct handler_times
+	{
+		aux::array<std::int64_t, num_handler_categories> wall{};
+		aux::array<std::int64_t, num_handler_categories> cpu{};
+	};
+
+	// measures the time from construction to destruction and attributes it to
+	// the given category. Timers may nest, in which case the time of the inner
+	// one is subtracted from the outer one. i.e. the time attributed to each
+	// category is exclusive. Wall time is measured with a real-time clock, even
+	// in simulations, since it's meant to find handlers that stall the event
+	// loop. If handler timers are disabled when the timer is constructed, it
+	// does nothing.
+	struct TORRENT_EXTRA_EXPORT handler_timer
+	{
+		explicit handler_timer(handler_category c)
+		{
+			if (handler_timers_enabled()) start(c);
+		}
+
+		~handler_timer()
+		{
+			if (m_category != handler_category::num_categories) stop();
+		}
+
+		handler_timer(handler_timer const&) = delete;
+		handler_timer& operator=(handler_timer const&) = delete;
+
+	private:
+		void start(handler_category c);
+		void stop();
+
+		handler_timer* m_parent = nullptr;
+		std::chrono::steady_clock::time_point m_start;
+		std::int64_t m_start_cpu = -1;
+		std::int64_t m_child_wall = 0;
+		std::int64_t m_child_cpu = 0;
+
+		// num_categories means this timer is inactive
+		handler_category m_category = handler_category::num_categories;
+	};
+
+	// adds the time accumulated by handlers on the calling thread to the
+	// corresponding counters and resets the accumulators. Since every session
+	// has its own network thread, this is called by the session on its own
+	// thread.
+	TORRENT_EXTRA_EXPORT void drain_handler_times(counters& c);
+
+	// makes handler timers on the calling thread do nothing. Only the
+	// session's network thread is drained, so this is called by the worker
+	// threads the session starts (e.g. for the DHT), which would otherwise
+	// accumulate time that's never reported
+	TORRENT_EXTRA_EXPORT void exclude_thread_from_handler_timers();
+
+	// returns the times accumulated by the calling thread, without resetting
+	// them
+	TORRENT_EXTRA_EXPORT handler_times const& current_handler_times();
+}}
+
+#endif
@@ -132,6 +132,23 @@ namespace aux {
 			}
 		}
 
+		// calls f with a pointer to each element, in the order they were
+		// added, without copying the pointers anywhere
+		template <typename Fun>
+		void for_each(Fun f)
+		{
+			char* ptr = m_storage.get();
+			char const* const end = m_storage.get() + m_size;
+			while (ptr < end)
+			{
+				header_t* hdr = reinterpret_cast<header_t*>(ptr);
+				ptr += sizeof(header_t) + hdr->pad_bytes;
+				TORRENT_ASSERT(ptr + hdr->len <= end);
+				f(reinterpret_cast<T*>(ptr));
+				ptr += hdr->len;
+			}
+		}
+
 		void swap(heterogeneous_queue& rhs)
 		{
 			std::swap(m_storage, rhs.m_storage);
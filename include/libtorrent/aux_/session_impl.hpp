@@ -87,6 +87,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/extensions.hpp"
 #include "libtorrent/aux_/portmap.hpp"
 #include "libtorrent/aux_/lsd.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
 #include "libtorrent/io_context.hpp"
 #include "libtorrent/flags.hpp"
 #include "libtorrent/span.hpp"
@@ -432,6 +433,8 @@ namespace aux {
 			// need the initial push to connect peers
 			void prioritize_connections(std::weak_ptr<torrent> t) override;
 
+			void defer_connect(std::weak_ptr<torrent> t, std::uint16_t until) override;
+
 			void async_accept(std::shared_ptr<tcp::acceptor> const&, transport);
 			void on_accept_connection(true_tcp_socket s, error_code const&
 				, std::weak_ptr<tcp::acceptor>, transport);
@@ -521,6 +524,8 @@ namespace aux {
 
 			void dht_live_nodes(sha1_hash const& nid);
 			void dht_sample_infohashes(udp::endpoint const& ep, sha1_hash const& target);
+			void dht_start_crawl();
+			void dht_stop_crawl();
 
 			void dht_direct_request(udp::endpoint const& ep, entry& e, client_data_t userdata);
 
@@ -615,13 +620,15 @@ namespace aux {
 				, status_flags_t flags) const;
 			void refresh_torrent_status(std::vector<torrent_status>* ret
 				, status_flags_t flags) const;
-			void post_torrent_updates(status_flags_t flags);
+			void post_torrent_updates(status_flags_t flags
+				, torrent_updates_flags_t updates_flags);
 			void post_session_stats();
 			void post_dht_stats();
 
 			std::vector<torrent_handle> get_torrents() const;
 
 			void pop_alerts(std::vector<alert*>* alerts);
+			void pop_alerts(std::function<void(alert*)> const& handler);
 			alert* wait_for_alert(time_duration max_wait);
 
 #if TORRENT_ABI_VERSION == 1
@@ -843,6 +850,8 @@ namespace aux {
 			void update_resolver_cache_timeout();
 
 			void update_ip_notifier();
+			void update_tracing();
+			void update_profile_handlers();
 			void update_upnp();
 			void update_natpmp();
 			void update_lsd();
@@ -887,6 +896,11 @@ namespace aux {
 
 			counters m_stats_counters;
 
+			// the handler_wall_* and handler_cpu_* counters (in microseconds)
+			// as of the last handler_profile_alert. The alert reports the
+			// time spent since then
+			handler_times m_reported_handler_times;
+
 			// this is a pool allocator for torrent_peer objects
 			// torrents and the disk cache (implicitly by holding references to the
 			// torrents) depend on this outliving them.
@@ -1101,15 +1115,21 @@ namespace aux {
 
 			void on_tick(error_code const& e);
 
-			void try_connect_more_peers();
+			void try_connect_more_peers(time_duration dt);
 			void auto_manage_checking_torrents(std::vector<torrent*>& list
 				, int& limit);
 			void auto_manage_torrents(std::vector<torrent*>& list
 				, int& dht_limit, int& tracker_limit
 				, int& lsd_limit, int& hard_limit, int type_limit);
 			void recalculate_auto_managed_torrents();
-			void recalculate_unchoke_slots();
-			void recalculate_optimistic_unchoke_slots();
+
+			// when the regular and the optimistic unchoke run in the same tick,
+			// the regular pass collects the peers relevant to the optimistic
+			// pass into ``candidates``, to avoid scanning all connections twice
+			void recalculate_unchoke_slots(
+				std::vector<std::shared_ptr<peer_connection>>* candidates = nullptr);
+			void recalculate_optimistic_unchoke_slots(
+				std::vector<std::shared_ptr<peer_connection>> const* candidates = nullptr);
 
 			time_point m_created;
 			std::uint16_t session_time() const override
@@ -1140,6 +1160,10 @@ namespace aux {
 			// and stopped (only the auto managed ones)
 			time_point m_last_auto_manage;
 
+			// scratch space for recalculate_auto_managed_torrents(), to not
+			// reallocate it every time
+			std::vector<std::pair<int, torrent*>> m_seed_ranks;
+
 			// when outgoing_ports is configured, this is the
 			// port we'll bind the next outgoing socket to
 			mutable int m_next_port = 0;
@@ -1237,6 +1261,12 @@ namespace aux {
 			// this is deducted from the connect speed
 			int m_boost_connections = 0;
 
+			// the number of outgoing connection attempts we may make, in
+			// thousandths. This accrues connection_speed per second, and lets
+			// try_connect_more_peers() pace connection attempts evenly across
+			// ticks
+			std::int64_t m_connect_credit = 0;
+
 			// mask is a bitmask of which protocols to remap on:
 			enum remap_port_mask_t
 			{
@@ -1281,6 +1311,12 @@ namespace aux {
 			// torrents prioritized to get connection attempts
 			std::deque<std::pair<std::weak_ptr<torrent>, int>> m_prio_torrents;
 
+			// torrents whose connect candidates are all waiting for their
+			// reconnect timeout, and so are not in the want-peers lists. This
+			// is a min-heap by the time they may want peers again
+			using deferred_connect = std::pair<time_point, std::weak_ptr<torrent>>;
+			std::vector<deferred_connect> m_deferred_connects;
+
 			// this announce timer is used
 			// by Local service discovery
 			deadline_timer m_lsd_announce_timer;
@@ -219,6 +219,11 @@ namespace aux {
 
 		virtual void prioritize_connections(std::weak_ptr<torrent> t) = 0;
 
+		// the torrent has taken itself off the want-peers lists until the
+		// session time ``until``, when its first connect candidate may be
+		// connected to again. The session calls update_want_peers() on it then
+		virtual void defer_connect(std::weak_ptr<torrent> t, std::uint16_t until) = 0;
+
 		virtual void trigger_auto_manage() = 0;
 
 		virtual void apply_settings_pack(std::shared_ptr<settings_pack> pack) = 0;
@@ -0,0 +1,125 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_TRACE_HPP_INCLUDED
+#define TORRENT_TRACE_HPP_INCLUDED
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace libtorrent { namespace aux {
+
+	// The tracing facility records events into a fixed-size ring buffer per
+	// thread. Recording an event is wait-free and does not allocate (except
+	// for the first event on a thread, which claims a buffer). When tracing is
+	// disabled, the only cost is a relaxed load of a global flag. Tracing is
+	// process-wide, i.e. shared by all sessions.
+	//
+	// ``name`` and ``category`` must be string literals (or otherwise outlive
+	// the trace buffer), only the pointers are recorded.
+
+	TORRENT_EXTRA_EXPORT extern std::atomic<bool> g_trace_enabled;
+
+	inline bool trace_enabled()
+	{ return g_trace_enabled.load(std::memory_order_relaxed); }
+
+	TORRENT_EXTRA_EXPORT void set_trace_enabled(bool e);
+
+	// record an event with a start time and duration (nanoseconds). A
+	// duration of 0 is recorded as an instant event
+	TORRENT_EXTRA_EXPORT void trace_event(char const* category, char const* name
+		, std::int64_t start, std::int64_t duration, std::int64_t arg);
+
+	// nanoseconds since the clock epoch, this is the time base for all trace
+	// events
+	inline std::int64_t trace_now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			clock_type::now().time_since_epoch()).count();
+	}
+
+	inline void trace_instant(char const* category, char const* name
+		, std::int64_t arg = 0)
+	{
+		if (!trace_enabled()) return;
+		trace_event(category, name, trace_now(), 0, arg);
+	}
+
+	// records a complete event spanning the lifetime of this object. Whether
+	// tracing is enabled is determined at construction
+	struct trace_scope
+	{
+		trace_scope(char const* category, char const* name, std::int64_t arg = 0)
+			: m_category(category)
+			, m_name(name)
+			, m_arg(arg)
+			, m_start(trace_enabled() ? trace_now() : -1)
+		{}
+
+		~trace_scope()
+		{
+			if (m_start < 0) return;
+			std::int64_t const dur = std::max(std::int64_t(1), trace_now() - m_start);
+			trace_event(m_category, m_name, m_start, dur, m_arg);
+		}
+
+		// the argument is recorded when the scope ends, so it may be updated
+		// with information that's only known at that point
+		void arg(std::int64_t a) { m_arg = a; }
+
+		trace_scope(trace_scope const&) = delete;
+		trace_scope& operator=(trace_scope const&) = delete;
+
+	private:
+		char const* m_category;
+		char const* m_name;
+		std::int64_t m_arg;
+		std::int64_t m_start;
+	};
+
+	// returns all events currently held in the trace buffers, in the Chrome
+	// trace event JSON format (which can also be loaded by Perfetto). Events
+	// recorded concurrently with this call may or may not be included. The
+	// buffers are not cleared.
+	TORRENT_EXTRA_EXPORT std::string dump_trace();
+
+	// discard all events recorded so far
+	TORRENT_EXTRA_EXPORT void clear_trace();
+}}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_UNCHOKE_COMPARE_HPP_INCLUDED
+#define TORRENT_UNCHOKE_COMPARE_HPP_INCLUDED
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/aux_/time.hpp"
+#include "libtorrent/assert.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+// the comparators used by unchoke_sort() to rank peers. They are templates
+// over the peer type to allow the tests to exercise them with stand-ins for
+// peer_connection
+namespace libtorrent {
+namespace aux {
+
+	template <typename Peer>
+	int compare_peers(Peer const* lhs, Peer const* rhs)
+	{
+		int const prio1 = lhs->get_priority(Peer::upload_channel);
+		int const prio2 = rhs->get_priority(Peer::upload_channel);
+
+		if (prio1 != prio2) return prio1 > prio2 ? 1 : -1;
+
+		// compare how many bytes they've sent us
+		std::int64_t const c1 = lhs->downloaded_in_last_round();
+		std::int64_t const c2 = rhs->downloaded_in_last_round();
+
+		if (c1 != c2) return c1 > c2 ? 1 : -1;
+		return 0;
+	}
+
+	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
+	template <typename Peer>
+	bool unchoke_compare_rr(Peer const* lhs, Peer const* rhs, int const pieces)
+	{
+		int const cmp = compare_peers(lhs, rhs);
+		if (cmp != 0) return cmp > 0;
+
+		// when seeding, rotate which peer is unchoked in a round-robin fasion
+
+		// the amount uploaded since unchoked (not just in the last round)
+		std::int64_t const u1 = lhs->uploaded_since_unchoked();
+		std::int64_t const u2 = rhs->uploaded_since_unchoked();
+
+		// the way the round-robin unchoker works is that it,
+		// by default, prioritizes any peer that is already unchoked.
+		// this maintain the status quo across unchoke rounds. However,
+		// peers that are unchoked, but have sent more than one quota
+		// since they were unchoked, they get de-prioritized.
+
+		auto const t1 = lhs->associated_torrent().lock();
+		auto const t2 = rhs->associated_torrent().lock();
+		TORRENT_ASSERT(t1);
+		TORRENT_ASSERT(t2);
+
+		// if a peer is already unchoked, the number of bytes sent since it was unchoked
+		// is greater than the send quanta, and it has been unchoked for at least one minute
+		// then it's done with its upload slot, and we can de-prioritize it
+		bool const c1_quota_complete = !lhs->is_choked()
+			&& u1 > std::int64_t(t1->torrent_file().piece_length()) * pieces
+			&& aux::time_now() - lhs->time_of_last_unchoke() > minutes(1);
+		bool const c2_quota_complete = !rhs->is_choked()
+			&& u2 > std::int64_t(t2->torrent_file().piece_length()) * pieces
+			&& aux::time_now() - rhs->time_of_last_unchoke() > minutes(1);
+
+		// if c2 has completed a quanta, it should be de-prioritized
+		// and vice versa
+		if (c1_quota_complete != c2_quota_complete)
+			return int(c1_quota_complete) < int(c2_quota_complete);
+
+		// when seeding, prefer the peer we're uploading the fastest to
+
+		// force the upload rate to zero for choked peers because
+		// if the peers just got choked the previous round
+		// there may have been a residual transfer which was already
+		// in-flight at the time and we don't want that to cause the peer
+		// to be ranked at the top of the choked peers
+		std::int64_t const c1 = lhs->is_choked() ? 0 : lhs->uploaded_in_last_round();
+		std::int64_t const c2 = rhs->is_choked() ? 0 : rhs->uploaded_in_last_round();
+
+		if (c1 != c2) return c1 > c2;
+
+		// if the peers are still identical (say, they're both waiting to be unchoked)
+		// prioritize the one that has waited the longest to be unchoked
+		// the round-robin unchoker relies on this logic. Don't change it
+		// without moving this into that unchoker logic
+		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
+	}
+
+	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
+	template <typename Peer>
+	bool unchoke_compare_fastest_upload(Peer const* lhs, Peer const* rhs)
+	{
+		int const cmp = compare_peers(lhs, rhs);
+		if (cmp != 0) return cmp > 0;
+
+		// when seeding, prefer the peer we're uploading the fastest to
+		std::int64_t const c1 = lhs->uploaded_in_last_round();
+		std::int64_t const c2 = rhs->uploaded_in_last_round();
+
+		if (c1 != c2) return c1 > c2;
+
+		// prioritize the one that has waited the longest to be unchoked
+		// the round-robin unchoker relies on this logic. Don't change it
+		// without moving this into that unchoker logic
+		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
+	}
+
+	template <typename Peer>
+	int anti_leech_score(Peer const* peer)
+	{
+		// the anti-leech seeding algorithm is based on the paper "Improving
+		// BitTorrent: A Simple Approach" from Chow et. al. and ranks peers based
+		// on how many pieces they have, preferring to unchoke peers that just
+		// started and peers that are close to completing. Like this:
+		//   ^
+		//   | \                       / |
+		//   |  \                     /  |
+		//   |   \                   /   |
+		// s |    \                 /    |
+		// c |     \               /     |
+		// o |      \             /      |
+		// r |       \           /       |
+		// e |        \         /        |
+		//   |         \       /         |
+		//   |          \     /          |
+		//   |           \   /           |
+		//   |            \ /            |
+		//   |             V             |
+		//   +---------------------------+
+		//   0%    num have pieces     100%
+		auto const t = peer->associated_torrent().lock();
+		TORRENT_ASSERT(t);
+
+		std::int64_t const total_size = t->torrent_file().total_size();
+		if (total_size == 0) return 0;
+		std::int64_t const have_size = std::max(peer->statistics().total_payload_upload()
+			, std::int64_t(t->torrent_file().piece_length()) * peer->num_have_pieces());
+		return int(std::abs((have_size - total_size / 2) * 2000 / total_size));
+	}
+
+	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
+	template <typename Peer>
+	bool unchoke_compare_anti_leech(Peer const* lhs, Peer const* rhs)
+	{
+		int const cmp = compare_peers(lhs, rhs);
+		if (cmp != 0) return cmp > 0;
+
+		int const score1 = anti_leech_score(lhs);
+		int const score2 = anti_leech_score(rhs);
+		if (score1 != score2) return score1 > score2;
+
+		// prioritize the one that has waited the longest to be unchoked
+		// the round-robin unchoker relies on this logic. Don't change it
+		// without moving this into that unchoker logic
+		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
+	}
+
+	template <typename Peer>
+	bool upload_rate_compare(Peer const* lhs, Peer const* rhs)
+	{
+		// take torrent priority into account
+		std::int64_t const c1 = lhs->uploaded_in_last_round()
+			* lhs->get_priority(Peer::upload_channel);
+		std::int64_t const c2 = rhs->uploaded_in_last_round()
+			* rhs->get_priority(Peer::upload_channel);
+
+		return c1 > c2;
+	}
+}
+}
+
+#endif
@@ -276,14 +276,8 @@ struct bdecode_token
 // There are 5 different types of nodes, see type_t.
 struct TORRENT_EXPORT bdecode_node
 {
-#if TORRENT_ABI_VERSION == 1
-	TORRENT_EXPORT friend int bdecode(char const* start, char const* end, bdecode_node& ret
-		, error_code& ec, int* error_pos, int depth_limit
-		, int token_limit);
-#endif
-
 	// hidden
-	TORRENT_EXPORT friend bdecode_node bdecode(span<char const> buffer
+	TORRENT_EXPORT friend int bdecode(span<char const> buffer, bdecode_node& ret
 		, error_code& ec, int* error_pos, int depth_limit, int token_limit);
 
 	// creates a default constructed node, it will have the type ``none_t``.
@@ -407,6 +401,12 @@ struct TORRENT_EXPORT bdecode_node
 	// or its children
 	bool has_soft_error(span<char> error) const;
 
+	// internal
+	// the token storage owned by a root node, and the number of tokens it
+	// has room for
+	aux::bdecode_token const* token_storage() const { return m_tokens.data(); }
+	std::size_t token_capacity() const { return m_tokens.capacity(); }
+
 private:
 	bdecode_node(aux::bdecode_token const* tokens, char const* buf
 		, int len, int idx);
@@ -472,6 +472,16 @@ TORRENT_EXPORT std::string print_entry(bdecode_node const& e
 TORRENT_EXPORT int bdecode(char const* start, char const* end, bdecode_node& ret
 	, error_code& ec, int* error_pos = nullptr, int depth_limit = 100
 	, int token_limit = 2000000);
+
+// The overloads taking the resulting ``bdecode_node`` by reference decode
+// into an existing node, reusing the memory of its token buffer from any
+// previous call. When decoding many messages in a loop (such as DHT
+// packets), keeping one node around and decoding into it avoids a heap
+// allocation per message. Any child nodes referring to the previous tree
+// are invalidated. Returns 0 on success and -1 on failure.
+TORRENT_EXPORT int bdecode(span<char const> buffer, bdecode_node& ret
+	, error_code& ec, int* error_pos = nullptr, int depth_limit = 100
+	, int token_limit = 2000000);
 TORRENT_EXPORT bdecode_node bdecode(span<char const> buffer
 	, error_code& ec, int* error_pos = nullptr, int depth_limit = 100
 	, int token_limit = 2000000);
@@ -38,6 +38,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <cmath> // for log()
 #include <cstdint>
+#include <cstring> // for memset()
 
 namespace libtorrent {
 
@@ -45,6 +46,20 @@ namespace libtorrent {
 	TORRENT_EXTRA_EXPORT bool has_bits(std::uint8_t const* k, std::uint8_t const* bits, int len);
 	TORRENT_EXTRA_EXPORT int count_zero_bits(std::uint8_t const* bits, int len);
 
+	// sets every bit in ``bits`` that's set in ``other``. Both are ``len``
+	// bytes
+	TORRENT_EXTRA_EXPORT void merge_bits(std::uint8_t* bits, std::uint8_t const* other, int len);
+
+	// increments the counters of the two bits of ``k``, setting the bits in
+	// ``bits``. ``counters`` has one entry per bit, ``len`` * 8
+	TORRENT_EXTRA_EXPORT void add_counts(std::uint8_t const* k, std::uint8_t* counters
+		, std::uint8_t* bits, int len);
+
+	// decrements the counters of the two bits of ``k``, clearing the bits
+	// whose counter reaches zero. Saturated counters are left alone
+	TORRENT_EXTRA_EXPORT void remove_counts(std::uint8_t const* k, std::uint8_t* counters
+		, std::uint8_t* bits, int len);
+
 	template <int N>
 	struct bloom_filter
 	{
@@ -62,6 +77,10 @@ namespace libtorrent {
 
 		void clear() { std::memset(bits, 0, N); }
 
+		// adds all keys in ``f`` to this filter
+		void merge(bloom_filter const& f)
+		{ merge_bits(bits, f.bits, N); }
+
 		float size() const
 		{
 			int const c = (std::min)(count_zero_bits(bits, N), (N * 8) - 1);
@@ -75,6 +94,37 @@ namespace libtorrent {
 		std::uint8_t bits[N];
 	};
 
+	// a bloom filter that supports removing keys, by counting the number of
+	// keys setting each bit. The counters saturate at 255, after which the
+	// bit stays set. It's meant to be maintained as keys come and go,
+	// rendering the plain bloom_filter for free
+	template <int N>
+	struct counting_bloom_filter
+	{
+		bool find(sha1_hash const& k) const
+		{ return has_bits(&k[0], bits, N); }
+
+		void add(sha1_hash const& k)
+		{ add_counts(&k[0], counters, bits, N); }
+
+		// ``k`` must have been added
+		void remove(sha1_hash const& k)
+		{ remove_counts(&k[0], counters, bits, N); }
+
+		std::string to_string() const
+		{ return std::string(reinterpret_cast<char const*>(&bits[0]), N); }
+
+		counting_bloom_filter()
+		{
+			std::memset(bits, 0, N);
+			std::memset(counters, 0, N * 8);
+		}
+
+	private:
+		std::uint8_t bits[N];
+		std::uint8_t counters[N * 8];
+	};
+
 }
 
 #endif // TORRENT_BLOOM_FILTER_HPP_INCLUDED
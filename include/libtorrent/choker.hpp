@@ -37,11 +37,52 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/config.hpp"
 #include "libtorrent/time.hpp" // for time_duration
 #include <vector>
+#include <algorithm>
+#include <iterator>
 
 namespace libtorrent {
 
 namespace aux {
 	struct session_settings;
+
+	// reorders the range [first, last) such that the ``n`` elements ranking
+	// highest according to ``cmp`` are at the front, in sorted order. The
+	// order of the remaining elements is unspecified. This is O(N + n log n),
+	// as opposed to O(N log n) for std::partial_sort.
+	template <typename It, typename Cmp>
+	void select_top(It first, It last, int n, Cmp cmp)
+	{
+		auto const size = std::distance(first, last);
+		if (n <= 0 || size == 0) return;
+		if (n < size) std::nth_element(first, first + n, last, cmp);
+		else n = int(size);
+		std::sort(first, first + n, cmp);
+	}
+
+	// visits the elements in [first, last) in the order defined by ``cmp``,
+	// until ``f`` returns false. Returns the number of elements ``f``
+	// returned true for. The range is used as a heap and is left in
+	// unspecified order. This is O(N + k log N), where k is the number of
+	// elements visited, which is cheaper than sorting the whole range when
+	// the walk terminates early.
+	template <typename It, typename Cmp, typename Fun>
+	int ranked_walk(It first, It last, Cmp cmp, Fun f)
+	{
+		// the heap functions keep the *greatest* element at the front, invert
+		// the comparison to visit the element ranking highest first
+		auto const inv = [&cmp](auto const& lhs, auto const& rhs)
+		{ return cmp(rhs, lhs); };
+		std::make_heap(first, last, inv);
+		int ret = 0;
+		while (first != last)
+		{
+			if (!f(*first)) break;
+			std::pop_heap(first, last, inv);
+			--last;
+			++ret;
+		}
+		return ret;
+	}
 }
 	struct peer_connection;
 
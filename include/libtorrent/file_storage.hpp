@@ -190,6 +190,21 @@ namespace aux {
 		aux::path_index_t path_index = file_entry::no_path;
 	};
 
+	// a directory in file_storage's directory tree. Each directory only holds
+	// its own name and the index of its parent, so directory prefixes shared
+	// by many files are stored once.
+	struct directory_entry
+	{
+		// the parent directory, or file_entry::no_path for directories
+		// directly under the root directory of the torrent
+		aux::path_index_t parent;
+
+		// the name of this directory, as a range of
+		// file_storage::m_path_segments
+		std::uint32_t name_offset;
+		std::uint32_t name_len;
+	};
+
 } // aux namespace
 
 	// represents a window of a file in a torrent.
@@ -548,11 +563,14 @@ namespace aux {
 		static constexpr file_flags_t flag_symlink = 3_bit;
 
 		// internal
-		// returns all directories used in the torrent. Files in the torrent are
-		// located in one of these directories. This is not a tree, it's a flat
-		// list of all *leaf* directories. i.e. the union of the parent paths of
-		// all files.
-		aux::vector<std::string, aux::path_index_t> const& paths() const { return m_paths; }
+		// returns the paths of all directories in the torrent, indexed by
+		// path_index. Files in the torrent are located in one of these
+		// directories. The paths are assembled from the directory tree, so
+		// this allocates a new string for each directory. Unlike a list of
+		// the directories holding files, this includes every parent
+		// directory of every file, so callers looking for collisions with
+		// directory names don't need to consider the prefixes of each path.
+		aux::vector<std::string, aux::path_index_t> paths() const;
 
 		// returns a bitmask of flags from file_flags_t that apply
 		// to file at ``index``.
@@ -635,6 +653,37 @@ namespace aux {
 
 		aux::path_index_t get_or_add_path(string_view path);
 
+		// returns the directory with the specified parent and name, adding it if
+		// it doesn't exist yet
+		aux::path_index_t get_or_add_dir(aux::path_index_t parent, string_view name);
+
+		// returns the directory at the specified path, or no_path if there is
+		// no such directory. The root directory (the empty path) is never
+		// found
+		aux::path_index_t find_path(string_view path) const;
+
+		// returns the slot in m_path_lookup for the directory with the specified
+		// parent and name. The slot is either empty (no_path) or holds the
+		// directory
+		std::size_t find_dir_slot(aux::path_index_t parent, string_view name) const;
+		void grow_path_lookup();
+
+		string_view dir_name(aux::path_index_t idx) const;
+
+		// calls f with the name of each directory from the root of the tree
+		// down to the specified one
+		template <typename Fun>
+		void for_each_dir_name(aux::path_index_t idx, Fun const& f) const;
+
+		// appends the path of the directory, relative to the root directory
+		// of the torrent, to out. Paths are assembled in place, to not
+		// allocate a temporary string for every file path
+		void append_dir_path(std::string& out, aux::path_index_t idx) const;
+
+		// an upper bound of the length of the directory's path, including a
+		// trailing separator
+		std::size_t dir_path_size(aux::path_index_t idx) const;
+
 		// the number of bytes in a regular piece
 		// (i.e. not the potentially truncated last piece)
 		int m_piece_length = 0;
@@ -674,12 +723,20 @@ namespace aux {
 		// index in m_files
 		aux::vector<std::time_t, file_index_t> m_mtime;
 
-		// all unique paths files have. The aux::file_entry::path_index
-		// points into this array. The paths don't include the root directory
-		// name for multi-file torrents. The m_name field need to be
-		// prepended to these paths, and the filename of a specific file
-		// entry appended, to form full file paths
-		aux::vector<std::string, aux::path_index_t> m_paths;
+		// the directory tree. The aux::file_entry::path_index points into this
+		// array. The paths don't include the root directory name for
+		// multi-file torrents. The m_name field need to be prepended to these
+		// paths, and the filename of a specific file entry appended, to form
+		// full file paths
+		aux::vector<aux::directory_entry, aux::path_index_t> m_paths;
+
+		// the names of all directories in m_paths, back to back
+		std::string m_path_segments;
+
+		// open addressing hash table of indices into m_paths, keyed by parent
+		// and name, to look up directories when adding files. Empty slots are
+		// no_path. The size is always a power of two.
+		std::vector<aux::path_index_t> m_path_lookup;
 
 		// name of torrent. For multi-file torrents
 		// this is always the root directory
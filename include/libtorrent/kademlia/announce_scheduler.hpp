@@ -0,0 +1,121 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_DHT_ANNOUNCE_SCHEDULER_HPP
+#define TORRENT_DHT_ANNOUNCE_SCHEDULER_HPP
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/sha1_hash.hpp"
+#include "libtorrent/socket.hpp"
+#include "libtorrent/kademlia/announce_flags.hpp"
+
+#include <map>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace libtorrent {
+namespace dht {
+
+	// queues DHT announces and releases them within a budget of packets per
+	// second. Announces are released in info-hash order, sweeping the key
+	// space, so traversals started close in time look up nearby keys and
+	// find the same nodes.
+	struct TORRENT_EXTRA_EXPORT announce_scheduler
+	{
+		using callback_t = std::function<void(std::vector<tcp::endpoint> const&)>;
+
+		struct request
+		{
+			sha1_hash info_hash;
+			int port;
+			announce_flags_t flags;
+			callback_t callback;
+		};
+
+		// queues an announce. If the info-hash is already waiting to be
+		// announced, the new request replaces it and false is returned
+		bool add(request r);
+
+		// appends the announces that fit in the packet budget to ``out``.
+		// ``rate`` is the budget in packets per second, ``traversals`` the
+		// number of traversals an announce starts (one per DHT node)
+		void pop(time_point now, int rate, int traversals, std::vector<request>& out);
+
+		// appends all queued announces to ``out``, regardless of the budget
+		void pop_all(std::vector<request>& out);
+
+		// called when an announce traversal completes, with the number of
+		// packets it sent. This refines the cost estimate of future ones
+		void traversal_done(int packets);
+
+		// the time until pop() may release more announces
+		time_duration next_release(int rate) const;
+
+		int size() const { return int(m_queue.size()); }
+		bool empty() const { return m_queue.empty(); }
+		void clear() { m_queue.clear(); }
+
+		// the estimated number of packets sent by one announce traversal
+		int packets_per_traversal() const { return (m_cost + 128) / 256; }
+
+	private:
+
+		struct queued
+		{
+			int port;
+			announce_flags_t flags;
+			callback_t callback;
+		};
+
+		std::map<sha1_hash, queued> m_queue;
+
+		// the next announce to release is the first one at or after this key
+		sha1_hash m_cursor;
+
+		// the number of packets we may still send, in thousandths of packets.
+		// This goes negative when announces are released, and is refilled at
+		// the packet rate
+		std::int64_t m_budget = 0;
+		time_point m_last_refill{};
+
+		// running average of the packets sent per traversal, in 1/256th of
+		// packets. A get_peers lookup followed by announce_peer to 8 nodes
+		// typically sends a few dozen
+		int m_cost = 40 * 256;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_DHT_SNAPSHOT_HPP
+#define TORRENT_DHT_SNAPSHOT_HPP
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/span.hpp"
+#include "libtorrent/kademlia/dht_storage.hpp"
+#include "libtorrent/kademlia/node_entry.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace libtorrent {
+namespace dht {
+
+	// A snapshot of the routing tables and the storage of the DHT, saved as
+	// dht_state::snapshot. It starts with the 4 byte magic "LTds", a version
+	// byte and the time it was written, in seconds since the epoch (8
+	// bytes). Then follow records, each with its type (1 byte) and the size
+	// of the rest of the record (4 bytes). Readers skip records of types
+	// they don't know. Integers are big endian. Endpoints are the address
+	// family (4 or 6), the address and the port.
+	//
+	// node
+	//   node ID (20), RTT (2), seconds since node_entry::last_queried (4),
+	//   failed requests (1), endpoint
+	// torrent
+	//   info-hash (20), name length (1), name, then for every peer: seed
+	//   flag (1), the time it announced in seconds since the epoch (4),
+	//   endpoint
+	// immutable item
+	//   target (20), value
+	// mutable item
+	//   target (20), public key (32), signature (64), sequence number (8),
+	//   salt length (1), salt, value
+	struct TORRENT_EXTRA_EXPORT snapshot_writer final : dht_storage_visitor
+	{
+		// records are appended to ``out``. ``now`` is the current time, in
+		// seconds since the epoch
+		snapshot_writer(std::string& out, std::int64_t now)
+			: m_out(out), m_now(now) {}
+
+		void header();
+
+		// a node from the routing table. ``now`` is the current time_point,
+		// to save the time since its last_queried
+		void node(node_entry const& n, time_point now);
+
+		// appends records written by another snapshot_writer
+		void append(string_view records);
+
+		void torrent(sha1_hash const& info_hash, string_view name) override;
+		void peer(tcp::endpoint const& ep, bool seed, time_duration age) override;
+		void immutable_item(sha1_hash const& target
+			, span<char const> value) override;
+		void mutable_item(sha1_hash const& target
+			, span<char const> value
+			, signature const& sig
+			, sequence_number seq
+			, public_key const& pk
+			, span<char const> salt) override;
+
+		// fills in the size of the last record. This must be called before
+		// the output is used
+		void flush();
+
+	private:
+
+		void begin_record(std::uint8_t type);
+
+		std::string& m_out;
+		std::int64_t const m_now;
+
+		// the offset of the record whose size hasn't been written yet
+		std::size_t m_open = std::string::npos;
+	};
+
+	// reads a snapshot. The nodes whose last_queried is less than 2 hours
+	// before ``now`` (in seconds since the epoch) are appended to ``nodes``,
+	// with their last_queried and failed requests restored. Torrents and
+	// items are put in ``storage``. The peers that announced less than 45
+	// minutes ago are restored with dht_storage_interface::restore_peer().
+	// Returns false if the snapshot is malformed. The records before the
+	// malformed one are still restored.
+	TORRENT_EXTRA_EXPORT bool read_snapshot(span<char const> buf, std::int64_t now
+		, std::vector<node_entry>& nodes, dht_storage_interface& storage);
+}
+}
+
+#endif
@@ -43,6 +43,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <libtorrent/kademlia/node_id.hpp>
 
 #include <vector>
+#include <string>
 #include <utility>
 
 namespace libtorrent {
@@ -69,6 +70,14 @@ namespace dht {
 		// the bootstrap nodes saved from the IPv6 buckets node
 		std::vector<udp::endpoint> nodes6;
 
+		// a binary snapshot of the routing tables, with the RTT of every
+		// node and when it last responded, and of the torrents and items in
+		// the DHT storage. It's only saved when
+		// settings_pack::dht_save_snapshot is enabled. A node restarted from
+		// a snapshot starts out with a full routing table and answers
+		// queries for what it stored before the restart.
+		std::string snapshot;
+
 		void clear();
 	};
 
@@ -37,6 +37,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #define TORRENT_DHT_STORAGE_HPP
 
 #include <functional>
+#include <cstdint>
 
 #include <libtorrent/kademlia/node_id.hpp>
 #include <libtorrent/kademlia/types.hpp>
@@ -45,6 +46,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <libtorrent/address.hpp>
 #include <libtorrent/span.hpp>
 #include <libtorrent/string_view.hpp>
+#include <libtorrent/time.hpp>
 
 namespace libtorrent {
 	class entry;
@@ -66,6 +68,43 @@ namespace dht {
 		void reset();
 	};
 
+	// The interface dht_storage_interface::visit() reports the stored
+	// torrents and items through. It's used to save a snapshot of the
+	// storage (see settings_pack::dht_save_snapshot).
+	struct TORRENT_EXPORT dht_storage_visitor
+	{
+		// a stored torrent. It's followed by a call to peer() for each of its
+		// peers. ``age`` is the time since the peer announced
+		virtual void torrent(sha1_hash const& info_hash, string_view name) = 0;
+		virtual void peer(tcp::endpoint const& ep, bool seed, time_duration age) = 0;
+
+		virtual void immutable_item(sha1_hash const& target
+			, span<char const> value) = 0;
+		virtual void mutable_item(sha1_hash const& target
+			, span<char const> value
+			, signature const& sig
+			, sequence_number seq
+			, public_key const& pk
+			, span<char const> salt) = 0;
+
+		// hidden
+		virtual ~dht_storage_visitor() {}
+	};
+
+	// where dht_storage_interface::visit() continues from. A default
+	// constructed position is the beginning of the storage
+	struct TORRENT_EXPORT dht_storage_position
+	{
+		// the kind of entry to continue with, and the key or the index of
+		// the entry. What they mean is up to the storage
+		int kind = 0;
+		sha1_hash key;
+		std::uint32_t index = 0;
+
+		// set by visit() once every entry was visited
+		bool done = false;
+	};
+
 	// The DHT storage interface is a pure virtual class that can
 	// be implemented to customize how the data for the DHT is stored.
 	//
@@ -73,11 +112,13 @@ namespace dht {
 	// the peers, mutable and immutable items and it's designed to
 	// provide a fast and fully compliant behavior of the BEPs.
 	//
-	// libtorrent comes with one built-in storage implementation:
+	// libtorrent comes with two built-in storage implementations:
 	// ``dht_default_storage`` (private non-accessible class). Its
 	// constructor function is called dht_default_storage_constructor().
 	// You should know that if this storage becomes full of DHT items,
 	// the current implementation could degrade in performance.
+	// The other one is returned by dht_compact_storage_constructor(). It's
+	// meant for nodes that store a very large number of torrents and items.
 	struct TORRENT_EXPORT dht_storage_interface
 	{
 #if TORRENT_ABI_VERSION == 1
@@ -141,6 +182,20 @@ namespace dht {
 			, tcp::endpoint const& endp
 			, string_view name, bool seed) = 0;
 
+		// Adds a peer restored from a snapshot (see
+		// settings_pack::dht_save_snapshot), which announced ``age`` ago. It
+		// should expire as if it had been stored back then.
+		//
+		// The default implementation calls announce_peer(), so the peer is
+		// kept as long as one that just announced.
+		virtual void restore_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool seed, time_duration age)
+		{
+			TORRENT_UNUSED(age);
+			announce_peer(info_hash, endp, name, seed);
+		}
+
 		// This function retrieves the immutable item given its target hash.
 		//
 		// For future implementers:
@@ -226,6 +281,24 @@ namespace dht {
 		// return stats counters for the store
 		virtual dht_storage_counters counters() const = 0;
 
+		// Reports the stored torrents and items to ``v``, continuing from
+		// ``pos`` and stopping once ``count`` torrents and items have been
+		// visited. ``pos`` is updated to where the next call continues, and
+		// its ``done`` member is set once the end was reached. Positions only
+		// have a meaning to the storage filling them in. Entries added or
+		// removed between two calls may be missed, but the others are visited
+		// once.
+		//
+		// The default implementation visits nothing, so the contents of
+		// storages not implementing it are not included in snapshots.
+		virtual void visit(dht_storage_visitor& v
+			, dht_storage_position& pos, int count) const
+		{
+			TORRENT_UNUSED(v);
+			TORRENT_UNUSED(count);
+			pos.done = true;
+		}
+
 		// hidden
 		virtual ~dht_storage_interface() {}
 	};
@@ -239,6 +312,21 @@ namespace dht {
 	TORRENT_EXPORT std::unique_ptr<dht_storage_interface> dht_default_storage_constructor(
 		settings_interface const& settings);
 
+	// constructor for a DHT storage meant for nodes tracking millions of
+	// torrents, such as bootstrap nodes and indexers. Torrents and items are
+	// kept in open addressing hash tables and peers are stored packed, 8
+	// bytes per IPv4 peer. Expired peers are found through a timer wheel
+	// rather than scanning every torrent in tick().
+	//
+	// When ``dht_max_torrents`` or ``dht_max_dht_items`` is reached, or the
+	// memory use exceeds ``settings_pack::dht_storage_memory_limit``, the
+	// least recently announced torrent or least recently put item is evicted
+	// to make room, instead of rejecting the new one. Unlike the default
+	// storage, the node IDs passed to update_node_ids() are not taken into
+	// account when picking what to evict.
+	TORRENT_EXPORT std::unique_ptr<dht_storage_interface> dht_compact_storage_constructor(
+		settings_interface const& settings);
+
 } // namespace dht
 } // namespace libtorrent
 
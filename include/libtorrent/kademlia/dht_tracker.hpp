@@ -38,10 +38,16 @@ POSSIBILITY OF SUCH DAMAGE.
 #define TORRENT_DHT_TRACKER
 
 #include <functional>
+#include <mutex>
+#include <memory>
 
 #include <libtorrent/kademlia/node.hpp>
 #include <libtorrent/kademlia/dos_blocker.hpp>
 #include <libtorrent/kademlia/dht_state.hpp>
+#include <libtorrent/kademlia/dht_worker_pool.hpp>
+#include <libtorrent/kademlia/signature_verifier.hpp>
+#include <libtorrent/kademlia/announce_scheduler.hpp>
+#include <libtorrent/kademlia/infohash_crawler.hpp>
 
 #include <libtorrent/aux_/listen_socket_handle.hpp>
 #include <libtorrent/socket.hpp>
@@ -110,6 +116,10 @@ namespace dht {
 		void add_node(udp::endpoint const& node);
 		void add_router_node(udp::endpoint const& node);
 
+		// if settings_pack::dht_save_snapshot is set, this includes a
+		// snapshot of the routing tables and of the storage, as of the last
+		// complete pass over it. Until the first pass completes, the storage
+		// isn't included
 		dht_state state() const;
 
 		void get_peers(sha1_hash const& ih
@@ -123,6 +133,14 @@ namespace dht {
 				, int, std::vector<sha1_hash>
 				, std::vector<std::pair<sha1_hash, udp::endpoint>>)> f);
 
+		// crawls the DHT for info-hashes (see infohash_crawler). The
+		// callback is called with the new info-hashes found, about once a
+		// second
+		using crawl_callback = std::function<void(std::vector<sha1_hash> const&
+			, infohash_crawler const&)>;
+		void start_crawl(crawl_callback f);
+		void stop_crawl();
+
 		void get_item(sha1_hash const& target
 			, std::function<void(item const&)> cb);
 
@@ -187,9 +205,42 @@ namespace dht {
 		void connection_timeout(aux::listen_socket_handle const& s, error_code const& e);
 		void refresh_timeout(error_code const& e);
 		void refresh_key(error_code const& e);
+
+		// start the queued announces the packet budget allows, and arm the
+		// timer to release the rest
+		void release_announces();
+		void announce_timeout(error_code const& e);
+		void start_announce(announce_scheduler::request r);
+
+		// send the requests the crawler has ready, and pass on the
+		// info-hashes it found
+		void crawl();
+		void flush_crawl();
+		void crawl_timeout(error_code const& e);
+
+		// visits the next ``count`` torrents and items of the storage, for
+		// the storage part of the snapshot
+		void update_storage_snapshot(int count);
 		void update_storage_node_ids();
 		node* get_node(node_id const& id, std::string const& family_name);
 
+		bool incoming_message(aux::listen_socket_handle const& s
+			, udp::endpoint const& ep, span<char const> buf);
+
+		// publish a new snapshot of the nodes to the worker threads, if
+		// there are any
+		void publish_nodes();
+
+		// send the replies, and handle the messages bounced back, from the
+		// worker threads
+		void drain_workers();
+
+		// complete the mutable puts whose signatures have been checked
+		void drain_verifier();
+
+		bool send_buffer(aux::listen_socket_handle const& s
+			, span<char const> buf, udp::endpoint const& addr);
+
 		// implements socket_manager
 		bool has_quota() override;
 		bool send_packet(aux::listen_socket_handle const& s, entry& e, udp::endpoint const& addr) override;
@@ -200,8 +251,26 @@ namespace dht {
 		bdecode_node m_msg;
 
 		counters& m_counters;
+
+		// when there are worker threads, the nodes access the storage via this
+		// wrapper, to synchronize with them
+		std::unique_ptr<locked_dht_storage> m_locked_storage;
 		dht_storage_interface& m_storage;
 		dht_state m_state; // to be used only once
+
+		// the routing table nodes from the snapshot in m_state. They are added
+		// to the routing table of the node with the same address family, as
+		// the sockets are opened
+		std::vector<node_entry> m_snapshot_nodes;
+
+		// the storage part of the snapshot (see
+		// settings_pack::dht_save_snapshot). m_storage_snapshot holds the
+		// records of the last complete pass over the storage, m_next_snapshot
+		// the pass in progress, which continues from m_snapshot_pos every
+		// refresh_timeout(). Both are freed when snapshots are disabled
+		std::string m_storage_snapshot;
+		std::string m_next_snapshot;
+		dht_storage_position m_snapshot_pos;
 		tracker_nodes_t m_nodes;
 		send_fun_t m_send_fun;
 		dht_observer* m_log;
@@ -213,16 +282,40 @@ namespace dht {
 		deadline_timer m_refresh_timer;
 		aux::session_settings const& m_settings;
 
+		// announces waiting for the packet budget (see
+		// settings_pack::dht_announce_rate_limit)
+		announce_scheduler m_announces;
+		deadline_timer m_announce_timer;
+		bool m_announce_timer_armed = false;
+
+		// set while crawling for info-hashes
+		std::unique_ptr<infohash_crawler> m_crawler;
+		crawl_callback m_crawl_callback;
+		deadline_timer m_crawl_timer;
+
 		bool m_running;
 
 		// used to resolve hostnames for nodes
 		udp::resolver m_host_resolver;
 
-		// state for the send rate limit
+		// state for the send rate limit. The worker threads check the quota
+		// too, it's protected by m_quota_mutex
+		std::mutex m_quota_mutex;
 		int m_send_quota;
 		time_point m_last_tick;
 
 		io_context& m_ioc;
+
+		// the threads answering stateless queries (see
+		// settings_pack::dht_worker_threads). This is the last member, to
+		// stop the threads before anything they refer to is destructed
+		std::vector<dht_worker_pool::packet> m_finished;
+		std::unique_ptr<dht_worker_pool> m_workers;
+
+		// the threads checking signatures of mutable puts (see
+		// settings_pack::dht_verify_threads)
+		std::vector<mutable_put> m_verified;
+		std::unique_ptr<signature_verifier> m_verifier;
 	};
 } // namespace dht
 } // namespace libtorrent
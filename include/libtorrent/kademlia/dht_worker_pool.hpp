@@ -0,0 +1,219 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_DHT_WORKER_POOL_HPP
+#define TORRENT_DHT_WORKER_POOL_HPP
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/socket.hpp"
+#include "libtorrent/span.hpp"
+#include "libtorrent/bdecode.hpp"
+#include "libtorrent/aux_/listen_socket_handle.hpp"
+#include "libtorrent/kademlia/node_id.hpp"
+#include "libtorrent/kademlia/node_entry.hpp"
+#include "libtorrent/kademlia/dht_storage.hpp"
+
+namespace libtorrent {
+
+	struct counters;
+	struct entry;
+namespace aux {
+	struct session_settings;
+}
+}
+
+namespace libtorrent {
+namespace dht {
+
+	struct dht_observer;
+	struct socket_manager;
+	struct msg;
+
+	// adds our client version ("v") to an outgoing DHT message
+	TORRENT_EXTRA_EXPORT void add_client_version(entry& e);
+
+	// the parts of a node needed to answer queries that don't modify it.
+	// It's a copy taken on the network thread, and re-published whenever
+	// the routing table or the write token secret changes.
+	struct TORRENT_EXTRA_EXPORT node_snapshot
+	{
+		aux::listen_socket_handle sock;
+		node_id nid;
+		char const* family_name;
+		char const* nodes_key;
+		std::array<char, 4> write_key;
+		// the confirmed nodes from the routing table
+		std::vector<node_entry> nodes;
+		int bucket_size;
+	};
+
+	// serializes access to a DHT storage shared by the network thread and
+	// the DHT worker threads. The const functions take a shared lock, all
+	// others an exclusive one.
+	struct TORRENT_EXTRA_EXPORT locked_dht_storage final : dht_storage_interface
+	{
+		explicit locked_dht_storage(dht_storage_interface& s);
+
+		size_t num_torrents() const override;
+		size_t num_peers() const override;
+		void update_node_ids(std::vector<node_id> const& ids) override;
+		bool get_peers(sha1_hash const& info_hash
+			, bool noseed, bool scrape, address const& requester
+			, entry& peers) const override;
+		void announce_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool seed) override;
+		void restore_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool seed, time_duration age) override;
+		bool get_immutable_item(sha1_hash const& target
+			, entry& item) const override;
+		void put_immutable_item(sha1_hash const& target
+			, span<char const> buf
+			, address const& addr) override;
+		bool get_mutable_item_seq(sha1_hash const& target
+			, sequence_number& seq) const override;
+		bool get_mutable_item(sha1_hash const& target
+			, sequence_number seq, bool force_fill
+			, entry& item) const override;
+		void put_mutable_item(sha1_hash const& target
+			, span<char const> buf
+			, signature const& sig
+			, sequence_number seq
+			, public_key const& pk
+			, span<char const> salt
+			, address const& addr) override;
+		int get_infohashes_sample(entry& item) override;
+		void tick() override;
+		dht_storage_counters counters() const override;
+		void visit(dht_storage_visitor& v
+			, dht_storage_position& pos, int count) const override;
+
+	private:
+		dht_storage_interface& m_storage;
+		mutable std::shared_timed_mutex m_mutex;
+	};
+
+	// a pool of threads answering ping, find_node, get_peers and
+	// sample_infohashes queries. The network thread hands packets over
+	// with post(), the replies (or packets the workers decide the network
+	// thread has to handle after all) are collected with take(). The wake
+	// function is called from a worker thread whenever the output queue
+	// goes from empty to non-empty. It's expected to schedule a call to
+	// take() on the network thread.
+	struct TORRENT_EXTRA_EXPORT dht_worker_pool
+	{
+		struct packet
+		{
+			aux::listen_socket_handle sock;
+			udp::endpoint ep;
+			std::vector<char> buf;
+			// if true, buf is the bencoded reply to send to ep. Otherwise
+			// it's the original message, for the network thread to handle
+			bool reply = false;
+			// if true, the querying node should be added to the routing
+			// table, as the node would have done had it answered itself
+			bool heard = false;
+			node_id id;
+		};
+
+		dht_worker_pool(int num_threads
+			, aux::session_settings const& settings
+			, counters& cnt
+			, dht_storage_interface& storage
+			, dht_observer* observer
+			, socket_manager* sock_man
+			, std::function<void()> wake);
+		~dht_worker_pool();
+		dht_worker_pool(dht_worker_pool const&) = delete;
+		dht_worker_pool& operator=(dht_worker_pool const&) = delete;
+
+		// returns false if the queue is full. The caller is expected to
+		// handle the packet itself in that case
+		bool post(aux::listen_socket_handle const& s, udp::endpoint const& ep
+			, span<char const> buf);
+
+		void publish(std::shared_ptr<std::vector<node_snapshot> const> nodes);
+
+		// moves all finished packets into out
+		void take(std::vector<packet>& out);
+
+		// stops and joins all threads. Queued packets are dropped
+		void stop();
+
+	private:
+
+		void thread_fun();
+
+		// returns false if the packet has to be handled by the network thread
+		bool handle(packet& p, std::vector<node_snapshot> const* nodes
+			, bdecode_node& msg_node, std::vector<node_entry const*>& scratch);
+		void incoming_request(node_snapshot const& n
+			, std::vector<node_snapshot> const& nodes
+			, msg const& m, entry& e, packet& p
+			, std::vector<node_entry const*>& scratch);
+		void write_nodes_entries(node_snapshot const& n
+			, std::vector<node_snapshot> const& nodes
+			, sha1_hash const& target, bdecode_node const& want, entry& r
+			, std::vector<node_entry const*>& scratch);
+
+		aux::session_settings const& m_settings;
+		counters& m_counters;
+		dht_storage_interface& m_storage;
+		dht_observer* m_observer;
+		socket_manager* m_sock_man;
+		std::function<void()> m_wake;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::deque<packet> m_incoming;
+		std::vector<packet> m_outgoing;
+		std::shared_ptr<std::vector<node_snapshot> const> m_nodes;
+		bool m_abort = false;
+
+		std::vector<std::thread> m_threads;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TORRENT_DHT_INFOHASH_CRAWLER_HPP
+#define TORRENT_DHT_INFOHASH_CRAWLER_HPP
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/sha1_hash.hpp"
+#include "libtorrent/socket.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace libtorrent {
+namespace dht {
+
+	// walks the DHT key space with sample_infohashes requests (BEP 51),
+	// collecting the info-hashes the nodes return. The crawler decides
+	// which nodes to ask, and when. The caller sends the requests and
+	// reports the responses back.
+	//
+	// The number of requests in flight adapts to the timeout rate. Each
+	// node is asked at most once per the ``interval`` it returned. Each
+	// info-hash is reported once, deduplicated by a fixed size
+	// probabilistic set. The memory use is bounded by max_nodes and the
+	// size of that set.
+	struct TORRENT_EXTRA_EXPORT infohash_crawler
+	{
+		infohash_crawler();
+
+		struct request
+		{
+			udp::endpoint ep;
+			sha1_hash target;
+		};
+
+		// the most nodes the crawler keeps track of. Once reached, a new node
+		// replaces the one waiting the longest for its next query
+		static constexpr int max_nodes = 10000;
+
+		// the limits of the number of requests in flight
+		static constexpr int min_window = 4;
+		static constexpr int max_window = 64;
+
+		// adds a node to query, unless it's already known
+		void add_node(udp::endpoint const& ep, time_point32 now);
+
+		// appends the requests to send now to ``out``, as many as the window
+		// of requests in flight allows
+		void next_requests(time_point32 now, std::vector<request>& out);
+
+		// the node at ``ep`` responded to a request. If it has no more
+		// info-hashes than it returned, it's forgotten
+		void got_samples(udp::endpoint const& ep, time_point32 now
+			, time_duration interval, int num, std::vector<sha1_hash> const& samples
+			, std::vector<std::pair<sha1_hash, udp::endpoint>> const& nodes);
+
+		// the request to ``ep`` timed out, or could not be sent. The node is
+		// forgotten
+		void failed(udp::endpoint const& ep, time_point32 now);
+
+		// moves the info-hashes found since the last call to ``out``
+		void take_infohashes(std::vector<sha1_hash>& out);
+
+		// the number of info-hashes waiting to be taken
+		int num_pending_infohashes() const { return int(m_found.size()); }
+
+		// true if there are no nodes ready to be queried
+		bool idle(time_point32 now) const;
+
+		std::int64_t num_requests() const { return m_requests; }
+		std::int64_t num_responses() const { return m_responses; }
+		std::int64_t num_unique() const { return m_unique; }
+		int window() const { return m_window; }
+		int outstanding() const { return m_outstanding; }
+		int num_nodes() const { return int(m_nodes.size()); }
+
+	private:
+
+		struct crawl_node
+		{
+			bool pending = false;
+		};
+
+		// when a node may be queried again
+		using schedule_entry = std::pair<time_point32, udp::endpoint>;
+
+		void schedule(udp::endpoint const& ep, time_point32 t);
+		void completed(bool ok);
+		sha1_hash next_target();
+
+		// returns true if ``ih`` had not been seen before, and records it
+		bool insert_seen(sha1_hash const& ih);
+
+		std::map<udp::endpoint, crawl_node> m_nodes;
+
+		// the nodes that are not pending, ordered by when they may be
+		// queried next. The last one is the first to be evicted
+		std::set<schedule_entry> m_schedule;
+
+		// the unique info-hashes found, not yet taken
+		std::vector<sha1_hash> m_found;
+
+		// the seen info-hashes are recorded in two generations of bloom
+		// filters with 4 bits per key. When the current generation is full,
+		// it replaces the previous one. Info-hashes seen in either are
+		// considered seen
+		std::vector<std::uint64_t> m_seen[2];
+		int m_seen_count = 0;
+		int m_current = 0;
+		std::uint64_t m_seed[4];
+
+		// the number of requests allowed in flight, and how many are
+		std::int32_t m_window = min_window;
+		std::int32_t m_outstanding = 0;
+
+		// the requests completed since the window was last adjusted, and
+		// whether the window was the limit at any point since
+		std::int32_t m_round_ok = 0;
+		std::int32_t m_round_failed = 0;
+		bool m_window_limited = false;
+
+		// the targets walk the key space in bit-reversed order of this
+		// counter, spreading consecutive requests evenly
+		std::uint16_t m_walk = 0;
+
+		std::int64_t m_requests = 0;
+		std::int64_t m_responses = 0;
+		std::int64_t m_unique = 0;
+	};
+}
+}
+
+#endif
@@ -67,12 +67,19 @@ namespace libtorrent {
 namespace dht {
 
 struct traversal_algorithm;
+struct get_peers;
 struct dht_observer;
+struct signature_verifier;
+struct mutable_put;
 struct msg;
 struct settings;
 
 TORRENT_EXTRA_EXPORT entry write_nodes_entry(std::vector<node_entry> const& nodes);
 
+// the write token handed out to addr, for info_hash, with the given secret
+TORRENT_EXTRA_EXPORT std::string generate_write_token(udp::endpoint const& addr
+	, sha1_hash const& info_hash, std::array<char, 4> const& secret);
+
 class announce_observer : public observer
 {
 public:
@@ -155,8 +162,19 @@ public:
 		, std::function<void(std::vector<tcp::endpoint> const&)> dcallback
 		, std::function<void(std::vector<std::pair<node_entry, std::string>> const&)> ncallback
 		, announce_flags_t flags);
+	// ``done`` is called once the announce_peer messages have been sent,
+	// with the number of packets the whole announce cost
 	void announce(sha1_hash const& info_hash, int listen_port, announce_flags_t flags
-		, std::function<void(std::vector<tcp::endpoint> const&)> f);
+		, std::function<void(std::vector<tcp::endpoint> const&)> f
+		, std::function<void(int)> done = {});
+
+	// remember the nodes found close to an info-hash. Announces of nearby
+	// info-hashes start their lookups from them
+	void add_nearby_nodes(std::vector<std::pair<node_entry, std::string>> const& v);
+
+	// forget a node remembered by add_nearby_nodes(), once it failed to
+	// respond
+	void nearby_node_failed(node_id const& id, udp::endpoint const& ep);
 
 	void direct_request(udp::endpoint const& ep, entry& e
 		, std::function<void(msg const&)> f);
@@ -164,16 +182,29 @@ public:
 	void get_item(sha1_hash const& target, std::function<void(item const&)> f);
 	void get_item(public_key const& pk, std::string const& salt, std::function<void(item const&, bool)> f);
 
+	// when set, the signatures of incoming mutable puts are checked by the
+	// verifier, and the puts are completed by put_verified() once they come
+	// back. nullptr (the default) verifies them inline
+	void set_signature_verifier(signature_verifier* v) { m_verifier = v; }
+
+	// stores a mutable put checked by the signature verifier, and sends the
+	// response
+	void put_verified(mutable_put& p);
+
 	void put_item(sha1_hash const& target, entry const& data, std::function<void(int)> f);
 	void put_item(public_key const& pk, std::string const& salt
 		, std::function<void(item const&, int)> f
 		, std::function<void(item&)> data_cb);
 
-	void sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
+	// returns false if the request could not be sent. Otherwise either ``f``
+	// or ``failed`` is called (if set), when the response arrives or the
+	// request times out
+	bool sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
 		, std::function<void(sha1_hash
 			, time_duration
 			, int, std::vector<sha1_hash>
-			, std::vector<std::pair<sha1_hash, udp::endpoint>>)> f);
+			, std::vector<std::pair<sha1_hash, udp::endpoint>>)> f
+		, std::function<void()> failed = nullptr);
 
 	bool verify_token(string_view token, sha1_hash const& info_hash
 		, udp::endpoint const& addr) const;
@@ -187,6 +218,9 @@ public:
 	// generates a new secret number used to generate write tokens
 	void new_write_key();
 
+	// the secret write tokens are currently generated with
+	std::array<char, 4> const& write_key() const { return m_secret[0]; }
+
 	// pings the given node, and adds it to
 	// the routing table if it response and if the
 	// bucket is not full.
@@ -208,7 +242,7 @@ public:
 
 	dht_status status() const;
 
-	std::tuple<int, int, int> get_stats_counters() const;
+	std::tuple<int, int, int, int> get_stats_counters() const;
 
 #if TORRENT_ABI_VERSION == 1
 #include "libtorrent/aux_/disable_deprecation_warnings_push.hpp"
@@ -242,6 +276,13 @@ private:
 	bool lookup_peers(sha1_hash const& info_hash, entry& reply
 		, bool noseed, bool scrape, address const& requester) const;
 
+	// the lookup shared by get_peers() and announce(), honoring
+	// dht_privacy_lookups. It's not started yet
+	std::shared_ptr<dht::get_peers> make_get_peers(sha1_hash const& info_hash
+		, std::function<void(std::vector<tcp::endpoint> const&)> dcallback
+		, std::function<void(std::vector<std::pair<node_entry, std::string>> const&)> ncallback
+		, announce_flags_t flags);
+
 	aux::session_settings const& m_settings;
 
 	mutable std::mutex m_mutex;
@@ -250,6 +291,7 @@ private:
 	// since it might have references to it
 	std::set<traversal_algorithm*> m_running_requests;
 
+	// leaves the entry undefined if the response is deferred
 	void incoming_request(msg const&, entry&);
 
 	void write_nodes_entries(sha1_hash const& info_hash
@@ -294,6 +336,17 @@ private:
 
 	dht_storage_interface& m_storage;
 
+	signature_verifier* m_verifier = nullptr;
+
+	// the nodes closest to recently announced info-hashes. Once full,
+	// entries are replaced round-robin. When announcing a large number of
+	// torrents, the lookups for info-hashes sharing a prefix end up in the
+	// same neighbourhood of the keyspace, and can skip most of the hops to
+	// get there
+	static constexpr int max_nearby_nodes = 256;
+	std::vector<node_entry> m_nearby_nodes;
+	int m_nearby_cursor = 0;
+
 #ifndef TORRENT_DISABLE_LOGGING
 	std::uint32_t m_search_id = 0;
 #endif
@@ -69,12 +69,16 @@ struct TORRENT_EXTRA_EXPORT node_entry
 		return std::make_tuple(!verified, rtt) < std::make_tuple(!rhs.verified, rhs.rtt);
 	}
 
+	// the timestamps are kept at a resolution of seconds, to keep the
+	// entries small. There are hundreds of them per routing table, and one
+	// routing table per listen socket
 #ifndef TORRENT_DISABLE_LOGGING
-	time_point first_seen = aux::time_now();
+	time_point32 first_seen = aux::time_now32();
 #endif
 
-	// the time we last received a response for a request to this peer
-	time_point last_queried = min_time();
+	// the time we last received a response for a request to this peer.
+	// time_point32::min() means never
+	time_point32 last_queried = (time_point32::min)();
 
 	node_id id{nullptr};
 
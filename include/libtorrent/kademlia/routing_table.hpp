@@ -40,10 +40,10 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <vector>
 #include <set>
-#include <unordered_set>
 #include <cstdint>
 #include <tuple>
 #include <array>
+#include <cstring> // for memcpy
 
 #include <libtorrent/fwd.hpp>
 #include <libtorrent/kademlia/node_id.hpp>
@@ -70,49 +70,127 @@ struct routing_table_node
 	bucket_t live_nodes;
 };
 
-struct ipv4_hash
+// an open-addressing hash set of IP addresses, counting the number of
+// times each address was inserted. It uses linear probing in a single array,
+// rather than a heap allocated node per entry like std::unordered_multiset.
+// Bytes is the address_v4::bytes_type or address_v6::bytes_type
+template <typename Bytes>
+struct TORRENT_EXTRA_EXPORT ip_table
 {
-	using argument_type = address_v4::bytes_type;
-	using result_type = std::size_t;
-	result_type operator()(argument_type const& ip) const
+	void insert(Bytes const& ip);
+	void erase(Bytes const& ip);
+
+	// this is called for every node we hear about, so it's inline
+	bool exists(Bytes const& ip) const
 	{
-		return std::hash<std::uint32_t>()(*reinterpret_cast<std::uint32_t const*>(&ip[0]));
+		if (m_slots.empty()) return false;
+		return m_slots[find_slot(ip)].count != 0;
 	}
-};
 
-struct ipv6_hash
-{
-	using argument_type = address_v6::bytes_type;
-	using result_type = std::size_t;
-	result_type operator()(argument_type const& ip) const
+	void clear()
+	{
+		m_slots.clear();
+		m_slots.shrink_to_fit();
+		m_used = 0;
+		m_size = 0;
+	}
+
+	bool operator==(ip_table const& rh) const;
+
+	// the number of addresses, including duplicates
+	std::size_t size() const { return m_size; }
+
+	// the number of bytes allocated by the table
+	std::size_t memory_usage() const { return m_slots.capacity() * sizeof(slot); }
+
+private:
+
+	struct slot
+	{
+		Bytes ip;
+		// 0 means the slot is empty
+		std::uint16_t count = 0;
+	};
+
+	// the address folded into a single word, with fixed size loads
+	static std::uint64_t fold(address_v4::bytes_type const& ip)
+	{
+		std::uint32_t w;
+		std::memcpy(&w, ip.data(), sizeof(w));
+		return w;
+	}
+
+	static std::uint64_t fold(address_v6::bytes_type const& ip)
+	{
+		std::uint64_t w[2];
+		std::memcpy(w, ip.data(), sizeof(w));
+		return w[0] ^ w[1];
+	}
+
+	// the high bits of a multiplicative hash of the address
+	std::size_t home(Bytes const& ip) const
+	{
+		std::uint64_t const h = fold(ip) * 0x9e3779b97f4a7c15ULL;
+		return std::size_t(h >> 32) & (m_slots.size() - 1);
+	}
+
+	// returns the slot holding ip, or the empty slot where it would be
+	// inserted
+	std::size_t find_slot(Bytes const& ip) const
 	{
-		return std::hash<std::uint64_t>()(*reinterpret_cast<std::uint64_t const*>(&ip[0]));
+		TORRENT_ASSERT(!m_slots.empty());
+		std::size_t const mask = m_slots.size() - 1;
+		std::size_t i = home(ip);
+		while (m_slots[i].count != 0 && m_slots[i].ip != ip)
+			i = (i + 1) & mask;
+		return i;
 	}
+
+	void grow();
+
+	// the size is always a power of 2, and at most half the slots are used
+	std::vector<slot> m_slots;
+
+	// the number of non-empty slots
+	std::size_t m_used = 0;
+	std::size_t m_size = 0;
 };
 
 struct TORRENT_EXTRA_EXPORT ip_set
 {
 	void insert(address const& addr);
-	bool exists(address const& addr) const;
 	void erase(address const& addr);
 
+	// like ip_table::exists(), this is inline since it's called for every
+	// node we hear about
+	bool exists(address const& addr) const
+	{
+		if (addr.is_v6())
+			return m_ip6s.exists(addr.to_v6().to_bytes());
+		else
+			return m_ip4s.exists(addr.to_v4().to_bytes());
+	}
+
 	void clear()
 	{
 		m_ip4s.clear();
 		m_ip6s.clear();
 	}
 
-	bool operator==(ip_set const& rh)
+	bool operator==(ip_set const& rh) const
 	{
 		return m_ip4s == rh.m_ip4s && m_ip6s == rh.m_ip6s;
 	}
 
 	std::size_t size() const { return m_ip4s.size() + m_ip6s.size(); }
 
-	// these must be multisets because there can be multiple routing table
+	std::size_t memory_usage() const
+	{ return m_ip4s.memory_usage() + m_ip6s.memory_usage(); }
+
+	// these count duplicates because there can be multiple routing table
 	// entries for a single IP when restrict_routing_ips is set to false
-	std::unordered_multiset<address_v4::bytes_type, ipv4_hash> m_ip4s;
-	std::unordered_multiset<address_v6::bytes_type, ipv6_hash> m_ip6s;
+	ip_table<address_v4::bytes_type> m_ip4s;
+	ip_table<address_v6::bytes_type> m_ip6s;
 };
 
 // Each routing table bucket represents node IDs with a certain number of bits
@@ -197,6 +275,10 @@ public:
 	// of its bucket.
 	bool node_seen(node_id const& id, udp::endpoint const& ep, int rtt);
 
+	// adds a node from a snapshot of a routing table, keeping its RTT, the
+	// time it last responded and its failed requests
+	bool restore_node(node_entry const& e);
+
 	// this may add a node to the routing table and mark it as
 	// not pinged. If the bucket the node falls into is full,
 	// the node will be ignored.
@@ -212,7 +294,7 @@ public:
 	static constexpr find_nodes_flags_t include_failed = 0_bit;
 
 	// fills the vector with the count nodes from our buckets that
-	// are nearest to the given id.
+	// are nearest to the given id, closest first.
 	std::vector<node_entry> find_node(node_id const& target
 		, find_nodes_flags_t options, int count = 0);
 	void remove_node(node_entry* n, bucket_t* b);
@@ -296,8 +378,40 @@ private:
 
 	void prune_empty_bucket();
 
+	// (re-)builds m_index from the buckets
+	void build_index();
+
+	// appends the (up to) count nodes closest to target, among the indexed
+	// nodes [first, last), to l
+	void closest_in_range(node_id const& target, std::uint32_t first
+		, std::uint32_t last, find_nodes_flags_t options, int count
+		, std::vector<node_entry>& l);
+
 	aux::session_settings const& m_settings;
 
+	// a packed copy of the live nodes, used by find_node() to select the
+	// closest nodes without touching the node_entry objects. The IDs are
+	// stored contiguously, with their first 64 bits also stored as native
+	// integers, to compute XOR distances without byte swapping. It's
+	// rebuilt by find_node() when the buckets have changed since.
+	struct packed_index
+	{
+		// the index of the first node of each bucket, and one past the last
+		// node of the last bucket
+		std::vector<std::uint32_t> bucket_start;
+		std::vector<std::uint64_t> prefix;
+		std::vector<node_id> ids;
+		std::vector<bool> confirmed;
+		std::vector<node_entry const*> entries;
+	};
+	packed_index m_index;
+	bool m_index_dirty = true;
+
+	// scratch space for find_node(). The XOR distance prefixes of the nodes
+	// in a range, and the indices of the candidates among them
+	std::vector<std::uint64_t> m_distance;
+	std::vector<std::uint32_t> m_candidates;
+
 	// (k-bucket, replacement cache) pairs
 	// the first entry is the bucket the furthest
 	// away from our own ID. Each time the bucket
@@ -36,7 +36,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef RPC_MANAGER_HPP
 #define RPC_MANAGER_HPP
 
-#include <unordered_map>
+#include <array>
+#include <deque>
+#include <vector>
 #include <cstdint>
 
 #include <libtorrent/socket.hpp>
@@ -48,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 namespace libtorrent {
 class entry;
+struct counters;
 namespace aux {
 	struct session_settings;
 }
@@ -79,6 +82,7 @@ public:
 		, routing_table& table
 		, aux::listen_socket_handle sock
 		, socket_manager* sock_man
+		, counters& cnt
 		, dht_logger* log);
 	~rpc_manager();
 
@@ -87,7 +91,11 @@ public:
 	// returns true if the node needs a refresh
 	// if so, id is assigned the node id to refresh
 	bool incoming(msg const&, node_id* id);
-	time_duration tick();
+	time_duration tick() { return tick(clock_type::now()); }
+
+	// ``now`` is the current time. It's a parameter for tests to move
+	// time forward
+	time_duration tick(time_point now);
 
 	bool invoke(entry& e, udp::endpoint const& target
 		, observer_ptr o);
@@ -118,6 +126,9 @@ public:
 
 	int num_allocated_observers() const { return m_allocated_observers; }
 
+	// the number of requests we're waiting for a reply to
+	int num_transactions() const { return m_num_transactions; }
+
 	void update_node_id(node_id const& id) { m_our_id = id; }
 
 private:
@@ -125,9 +136,58 @@ private:
 	void* allocate_observer();
 	void free_observer(void* ptr);
 
+	// an outstanding request. Its transaction ID is the index of its slot
+	// in m_transactions followed by a random tag, 2 bytes each. A reply
+	// must match both
+	struct transaction
+	{
+		observer_ptr o;
+		// unique for every request sent, to tell stale timer wheel entries
+		// apart from the transaction currently occupying the slot
+		std::uint32_t serial = 0;
+		std::uint16_t tag = 0;
+	};
+
+	struct timer_entry
+	{
+		std::uint32_t serial;
+		std::uint16_t slot;
+	};
+
+	// returns the transaction in the specified slot, if it has the
+	// specified tag, or nullptr
+	transaction* find_transaction(std::uint16_t slot, std::uint16_t tag);
+	// returns nullptr if all transaction IDs are in use
+	transaction* add_transaction(observer_ptr o);
+	void remove_transaction(transaction& t);
+	bool grow_transactions();
+
+	// puts the transaction in the timer wheel bucket covering ``due``
+	void schedule_timeout(transaction const& t, time_point due);
+
 	mutable lt::aux::pool m_pool_allocator;
 
-	std::unordered_multimap<std::uint16_t, observer_ptr> m_transactions;
+	// indexed by the slot part of the transaction ID. Free slots are reused
+	// in the order they were freed, so a late reply to a request is
+	// unlikely to find its slot taken by another one already
+	std::vector<transaction> m_transactions;
+	std::deque<std::uint16_t> m_free_slots;
+	std::uint32_t m_next_serial = 0;
+	int m_num_transactions = 0;
+
+	// the timeouts of outstanding requests. Every bucket covers
+	// timer_resolution of time, m_wheel_pos being the one starting at
+	// m_wheel_time. Entries are not removed when a reply arrives, they are
+	// discarded once their bucket is due.
+	static constexpr int wheel_size = 256;
+	std::array<std::vector<timer_entry>, wheel_size> m_wheel;
+	int m_wheel_pos = 0;
+	time_point m_wheel_time;
+
+	// scratch space for tick(), to not allocate on every call
+	std::vector<timer_entry> m_due;
+	std::vector<observer_ptr> m_timeouts;
+	std::vector<observer_ptr> m_short_timeouts;
 
 	aux::listen_socket_handle m_sock;
 	socket_manager* m_sock_man;
@@ -136,6 +196,7 @@ private:
 #endif
 	aux::session_settings const& m_settings;
 	routing_table& m_table;
+	counters& m_counters;
 	node_id m_our_id;
 	std::uint32_t m_allocated_observers:31;
 	std::uint32_t m_destructing:1;
@@ -52,9 +52,14 @@ public:
 		, int, std::vector<sha1_hash>
 		, std::vector<std::pair<sha1_hash, udp::endpoint>>)>;
 
+	// called instead of the data callback if the request times out or the
+	// response is invalid
+	using failed_callback = std::function<void()>;
+
 	sample_infohashes(node& dht_node
 		, node_id const& target
-		, data_callback dcallback);
+		, data_callback dcallback
+		, failed_callback fcallback = nullptr);
 
 	char const* name() const override;
 
@@ -63,9 +68,12 @@ public:
 		, int num, std::vector<sha1_hash> samples
 		, std::vector<std::pair<sha1_hash, udp::endpoint>> nodes);
 
+	void request_failed();
+
 protected:
 
 	data_callback m_data_callback;
+	failed_callback m_failed_callback;
 };
 
 class sample_infohashes_observer final : public traversal_observer
@@ -76,6 +84,7 @@ public:
 		, udp::endpoint const& ep, node_id const& id);
 
 	void reply(msg const&) override;
+	void timeout() override;
 };
 
 } // namespace dht
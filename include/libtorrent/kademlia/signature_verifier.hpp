@@ -0,0 +1,120 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TORRENT_SIGNATURE_VERIFIER_HPP
+#define TORRENT_SIGNATURE_VERIFIER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/socket.hpp"
+#include "libtorrent/entry.hpp"
+#include "libtorrent/aux_/listen_socket_handle.hpp"
+#include "libtorrent/kademlia/node_id.hpp"
+#include "libtorrent/kademlia/types.hpp"
+
+namespace libtorrent {
+namespace dht {
+
+	// a mutable item put, waiting for its signature to be checked
+	struct mutable_put
+	{
+		aux::listen_socket_handle sock;
+		udp::endpoint ep;
+		// the node the put came from
+		node_id id;
+		sha1_hash target;
+		std::vector<char> value;
+		std::string salt;
+		sequence_number seq;
+		public_key pk;
+		signature sig;
+		// the "cas" field of the put, if it had one
+		bool has_cas = false;
+		sequence_number cas;
+		// the response, as far as it's been built when the put was
+		// deferred
+		entry response;
+		// set by the verifier
+		bool valid = false;
+	};
+
+	// checks the signatures of mutable puts on a pool of threads, so a
+	// flood of BEP 44 puts doesn't stall the network thread. The workers
+	// take the queued puts in batches, and put them in the output queue a
+	// batch at a time. Finished puts are collected with take(). The wake
+	// function is called from a worker thread whenever the output queue goes
+	// from empty to non-empty. It's expected to schedule a call to take() on
+	// the network thread.
+	struct TORRENT_EXTRA_EXPORT signature_verifier
+	{
+		signature_verifier(int num_threads, std::function<void()> wake);
+		~signature_verifier();
+		signature_verifier(signature_verifier const&) = delete;
+		signature_verifier& operator=(signature_verifier const&) = delete;
+
+		// returns false if the queue is full. The caller is expected to
+		// verify the put itself in that case
+		bool post(mutable_put&& p);
+
+		// moves all verified puts into out
+		void take(std::vector<mutable_put>& out);
+
+		// stops and joins all threads. Queued puts are dropped
+		void stop();
+
+	private:
+
+		void thread_fun();
+
+		std::function<void()> m_wake;
+		int const m_num_threads;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::deque<mutable_put> m_incoming;
+		std::vector<mutable_put> m_outgoing;
+		bool m_abort = false;
+
+		std::vector<std::thread> m_threads;
+	};
+}
+}
+
+#endif
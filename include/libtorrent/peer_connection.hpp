@@ -786,7 +786,8 @@ namespace aux {
 		void do_update_interest();
 		void fill_send_buffer();
 		void on_disk_read_complete(disk_buffer_holder buffer
-			, storage_error const& error, peer_request const&, time_point issue_time);
+			, storage_error const& error, peer_request const&, time_point issue_time
+			, time_point request_time);
 		void on_disk_write_complete(storage_error const& error
 			, peer_request const&, std::shared_ptr<torrent>);
 		void on_seed_mode_hashed(piece_index_t piece
@@ -815,6 +816,10 @@ namespace aux {
 		// to the disk thread yet
 		aux::vector<peer_request> m_requests;
 
+		// the time each request in m_requests was received, in the same
+		// order. Used to measure the time it takes to respond to requests
+		aux::vector<time_point> m_request_times;
+
 		// this peer's peer info struct. This may
 		// be 0, in case the connection is incoming
 		// and hasn't been added to a torrent yet.
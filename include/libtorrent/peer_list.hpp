@@ -81,6 +81,12 @@ namespace libtorrent {
 		// the number of iterations over the peer list for this operation
 		int loop_counter = 0;
 
+		// set by find_connect_candidates() when it did not find any peer to
+		// connect to, even though there are connect candidates, because all of
+		// them are waiting for their reconnect timeout. This is the earliest
+		// session time any of them may be connected to again. 0 means unknown
+		int next_connect = 0;
+
 		// these are used only by find_connect_candidates in order
 		// to implement peer ranking. See:
 		// http://blog.libtorrent.org/2012/12/swarm-connectivity/
@@ -46,6 +46,11 @@ namespace libtorrent {
 
 	struct TORRENT_EXPORT counters
 	{
+		// latency histograms are stored as this many consecutive stats
+		// counters, one per bucket. Buckets are log-linear, see
+		// histogram_bucket().
+		static constexpr int num_histogram_buckets = 88;
+
 		// internal
 		enum stats_counter_t
 		{
@@ -130,6 +135,11 @@ namespace libtorrent {
 			// no peer candidate being found
 			no_peer_connection_attempts,
 
+			// the times a torrent was taken off the connection attempt loop
+			// because all of its connect candidates were waiting for their
+			// reconnect timeout
+			deferred_connection_attempts,
+
 			// successful incoming connections (not rejected for any reason)
 			incoming_connections,
 
@@ -256,6 +266,11 @@ namespace libtorrent {
 			dht_invalid_get,
 			dht_invalid_sample_infohashes,
 
+			dht_announce_requests,
+			dht_announce_merged,
+			dht_announce_traversals,
+			dht_announce_packets,
+
 			// uTP counters.
 			utp_packet_loss,
 			utp_timeout,
@@ -324,7 +339,49 @@ namespace libtorrent {
 			socket_recv_size19,
 			socket_recv_size20,
 
-			num_stats_counters
+			// the time spent in network thread handlers, in microseconds,
+			// by category. See aux::handler_category. The wall-clock and CPU
+			// time blocks must be in the same order as the categories
+			handler_wall_peer_write,
+			handler_wall_peer_read,
+			handler_wall_udp,
+			handler_wall_tick,
+			handler_wall_abort,
+			handler_wall_defer,
+			handler_wall_utp,
+			handler_wall_submit,
+			handler_wall_session_call,
+			handler_wall_torrent_tick,
+			handler_wall_auto_manage,
+			handler_wall_dht,
+			handler_wall_tracker,
+
+			handler_cpu_peer_write,
+			handler_cpu_peer_read,
+			handler_cpu_udp,
+			handler_cpu_tick,
+			handler_cpu_abort,
+			handler_cpu_defer,
+			handler_cpu_utp,
+			handler_cpu_submit,
+			handler_cpu_session_call,
+			handler_cpu_torrent_tick,
+			handler_cpu_auto_manage,
+			handler_cpu_dht,
+			handler_cpu_tracker,
+
+			// latency histograms, in microseconds. Each of these occupies
+			// num_histogram_buckets consecutive counters
+			disk_read_latency,
+			disk_write_latency = disk_read_latency + num_histogram_buckets,
+			disk_hash_latency = disk_write_latency + num_histogram_buckets,
+			disk_other_latency = disk_hash_latency + num_histogram_buckets,
+			event_loop_lag = disk_other_latency + num_histogram_buckets,
+			upload_request_latency = event_loop_lag + num_histogram_buckets,
+			download_request_latency = upload_request_latency + num_histogram_buckets,
+			dht_timeout_latency = download_request_latency + num_histogram_buckets,
+
+			num_stats_counters = dht_timeout_latency + num_histogram_buckets
 		};
 
 		// == ALL FOLLOWING ARE GAUGES ==
@@ -437,6 +494,8 @@ namespace libtorrent {
 			dht_immutable_data,
 			dht_mutable_data,
 			dht_allocated_observers,
+			dht_transactions_in_flight,
+			dht_announce_queue,
 
 			has_incoming_connections,
 
@@ -473,21 +532,57 @@ namespace libtorrent {
 		counters(counters const&) TORRENT_COUNTER_NOEXCEPT;
 		counters& operator=(counters const&) & TORRENT_COUNTER_NOEXCEPT;
 
-		// returns the new value
+		// returns the new value. For stats counters (as opposed to gauges), the
+		// returned value only reflects the increments made by the calling
+		// thread's shard, not the total. Use operator[] to read the total.
 		std::int64_t inc_stats_counter(int c, std::int64_t value = 1) TORRENT_COUNTER_NOEXCEPT;
 		std::int64_t operator[](int i) const TORRENT_COUNTER_NOEXCEPT;
 
 		void set_value(int c, std::int64_t value) TORRENT_COUNTER_NOEXCEPT;
 		void blend_stats_counter(int c, std::int64_t value, int ratio) TORRENT_COUNTER_NOEXCEPT;
 
+		// records ``value`` in the histogram ``h``, which is one of the
+		// histogram counters (e.g. ``disk_read_latency``)
+		void add_histogram_sample(int h, std::int64_t value) TORRENT_COUNTER_NOEXCEPT;
+
+		// returns true if the counter index ``c`` is the first bucket of a
+		// histogram
+		static bool is_histogram(int c) noexcept;
+
+		// the bucket index ``value`` falls into. Values below 4 have a bucket
+		// each, above that every power of two is split into 4 linear buckets.
+		// Values too large are counted in the last bucket.
+		static int histogram_bucket(std::int64_t value) noexcept;
+
+		// the smallest value counted in ``bucket``
+		static std::int64_t histogram_bucket_lower_bound(int bucket) noexcept;
+
+		// the number of copies of the (monotonic) stats counters. Each thread
+		// increments the copy its assigned to, and the copies are summed up
+		// when read. Every shard takes about 7.5 kiB, so there are only a few.
+		// Most increments come from the network thread and a handful of disk
+		// threads. When there are more threads than shards, some of them share
+		// a shard, which is still correct, just not contention free.
+		static constexpr int num_shards = 4;
+
 	private:
 
 		// TODO: some space could be saved here by making gauges 32 bits
-		// TODO: restore these to regular integers. Instead have one copy
-		// of the counters per thread and collect them at convenient
-		// synchronization points
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		aux::array<std::atomic<std::int64_t>, num_counters> m_stats_counter;
+		// stats counters are incremented from the network thread as well as
+		// all disk threads, on every block read, written and hashed. To avoid
+		// all of them bouncing the same cache lines between CPUs, every thread
+		// has its own shard of counters. The padding keeps the counters of one
+		// shard from sharing a cache line with the next shard
+		struct shard
+		{
+			aux::array<std::atomic<std::int64_t>, num_stats_counters> counter;
+			char padding[64];
+		};
+		aux::array<shard, num_shards> m_shards;
+
+		// gauges go up and down and are read frequently, they are not sharded
+		aux::array<std::atomic<std::int64_t>, num_gauges_counters> m_gauges;
 #else
 		// if the atomic type isn't lock-free, use a single lock instead, for
 		// the whole array
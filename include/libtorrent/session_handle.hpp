@@ -220,8 +220,21 @@ namespace libtorrent {
 		// Only torrents who has the state subscription flag set will be
 		// included. This flag is on by default. See add_torrent_params.
 		// the ``flags`` argument is the same as for torrent_handle::status().
-		// see status_flags_t in torrent_handle.
+		// see status_flags_t in torrent_handle. The ``updates_flags`` argument
+		// is a combination of the torrent_updates_flags_t flags, defined
+		// below.
 		void post_torrent_updates(status_flags_t flags = status_flags_t::all());
+		void post_torrent_updates(status_flags_t flags
+			, torrent_updates_flags_t updates_flags);
+
+		// only include the expensive fields requested by
+		// torrent_handle::query_pieces, ``query_verified_pieces``,
+		// ``query_torrent_file``, ``query_name`` and ``query_save_path`` for
+		// a torrent if they have changed since they were last posted in a
+		// state_update_alert. Which fields were included is indicated by
+		// state_update_alert::queried_fields. The client is expected to
+		// retain the previous values of the fields that were left out.
+		static constexpr torrent_updates_flags_t changed_fields_only = 0_bit;
 
 		// This function will post a session_stats_alert object, containing a
 		// snapshot of the performance counters from the internals of libtorrent.
@@ -234,6 +247,12 @@ namespace libtorrent {
 		// This will cause a dht_stats_alert to be posted.
 		void post_dht_stats();
 
+		// returns the events recorded while the enable_tracing setting is
+		// true, in the Chrome trace event JSON format. It can be loaded into
+		// Perfetto or chrome://tracing. Each thread keeps a ring buffer of
+		// its most recent events, the trace is not cleared by this call.
+		std::string dump_trace() const;
+
 		// internal
 		io_context& get_context();
 
@@ -527,6 +546,15 @@ namespace libtorrent {
 		// The result is posted as a ``dht_sample_infohashes_alert``.
 		void dht_sample_infohashes(udp::endpoint const& ep, sha1_hash const& target);
 
+		// Start or stop crawling the DHT for info-hashes. The crawler sends
+		// sample_infohashes requests to the nodes it learns about, walking the
+		// key space, and asks each node at most once per the interval it
+		// returns. The number of requests in flight adapts to the rate of
+		// timeouts. The info-hashes found are posted in batches, about once a
+		// second, as ``dht_crawl_alert``.
+		void dht_start_crawl();
+		void dht_stop_crawl();
+
 		// Send an arbitrary DHT request directly to the specified endpoint. This
 		// function is intended for use by plugins. When a response is received
 		// or the request times out, a dht_direct_response_alert will be posted
@@ -1011,7 +1039,14 @@ namespace libtorrent {
 		// The type of an alert is returned by the polymorphic function
 		// ``alert::type()`` but can also be queries from a concrete type via
 		// ``T::alert_type``, as a static constant.
+		//
+		// The overload taking a ``handler`` calls it once for every new alert,
+		// in the order they were posted, instead of filling in a vector. The
+		// same rules for the lifetime of the alerts apply. The handler is
+		// called without holding any internal locks, but it must not call
+		// ``pop_alerts`` itself.
 		void pop_alerts(std::vector<alert*>* alerts);
+		void pop_alerts(std::function<void(alert*)> const& handler);
 		alert* wait_for_alert(time_duration max_wait);
 		void set_alert_notify(std::function<void()> const& fun);
 
@@ -42,7 +42,13 @@ namespace libtorrent {
 
 	enum class metric_type_t
 	{
-		counter, gauge
+		counter, gauge,
+
+		// only used by session_stats_histograms(). A histogram's value index
+		// refers to the first of counters::num_histogram_buckets consecutive
+		// values, one per bucket. The range of each bucket is given by
+		// counters::histogram_bucket_lower_bound().
+		histogram
 	};
 
 	// describes one statistics metric from the session. For more information,
@@ -68,8 +74,18 @@ namespace libtorrent {
 	// The value index is the index into the array in session_stats_alert where
 	// this metric's value can be found when the session stats is sampled (by
 	// calling post_session_stats()).
+	// There is one metric per value in the array, the buckets of latency
+	// histograms are listed as counters of their own.
 	TORRENT_EXPORT std::vector<stats_metric> session_stats_metrics();
 
+	// returns the latency histograms exposed by libtorrent's statistics API,
+	// with the type metric_type_t::histogram. The buckets of a histogram are
+	// found at consecutive indices in the array in session_stats_alert,
+	// starting at its value index. Note that histograms are posted as plain
+	// 64 bit counters, one per bucket, like all other values. There is no
+	// compact encoding of them.
+	TORRENT_EXPORT std::vector<stats_metric> session_stats_histograms();
+
 	// given a name of a metric, this function returns the counter index of it,
 	// or -1 if it could not be found. The counter index is the index into the
 	// values array returned by session_stats_alert.
@@ -48,6 +48,10 @@ namespace libtorrent {
 	// The flags type used to specify options to removing files of torrents
 	using remove_flags_t = flags::bitfield_flag<std::uint8_t, struct remove_flags_tag>;
 
+	// The flags type used to specify options to
+	// session_handle::post_torrent_updates()
+	using torrent_updates_flags_t = flags::bitfield_flag<std::uint8_t, struct torrent_updates_flags_tag>;
+
 	// hidden
 	using reopen_network_flags_t = flags::bitfield_flag<std::uint8_t, struct reopen_network_flags_tag>;
 }
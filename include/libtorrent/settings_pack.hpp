@@ -1004,6 +1004,31 @@ namespace aux {
 			// protocol may not be valid from the proxy's point of view.
 			socks5_udp_send_local_ep,
 
+			// when true, disk jobs, disk fences, socket reads and writes and
+			// piece picking are recorded into per-thread trace buffers. The
+			// trace can be retrieved with session_handle::dump_trace(). Tracing
+			// is process-wide, if there are multiple sessions, the setting
+			// applied last takes effect.
+			enable_tracing,
+
+			// when true, the DHT state saved with
+			// session_handle::save_dht_state includes a binary snapshot of
+			// the routing tables and the DHT storage (see
+			// dht_state::snapshot). The storage part is brought up to date in
+			// the background, a slice at a time, so saving the state doesn't
+			// stall the session even with millions of stored peers. It may
+			// lag behind the storage by a few minutes.
+			dht_save_snapshot,
+
+			// when true, the time the network thread spends in each category
+			// of handlers is measured and reported in the
+			// ``net.handler_wall_*`` and ``net.handler_cpu_*`` metrics. Every
+			// call to session_handle::post_session_stats() also posts a
+			// handler_profile_alert, ranking the categories by the time spent
+			// in them since the previous one. Like ``enable_tracing``, this is
+			// process-wide.
+			profile_handlers,
+
 			max_bool_setting_internal
 		};
 
@@ -2027,6 +2052,42 @@ namespace aux {
 			// torrents, this limit may have to be raised.
 			metadata_token_limit,
 
+			// the approximate amount of memory, in kiB, the compact DHT storage
+			// (see dht_compact_storage_constructor()) may use for announced
+			// peers and stored items. Once it's exceeded, the torrent or item
+			// that has gone the longest without an announce or put is evicted.
+			// 0 means there is no memory limit, only the ``dht_max_torrents``,
+			// ``dht_max_peers`` and ``dht_max_dht_items`` limits apply. The
+			// default DHT storage ignores this setting.
+			dht_storage_memory_limit,
+
+			// the number of threads used to answer incoming DHT ``ping``,
+			// ``find_node``, ``get_peers`` and ``sample_infohashes`` queries.
+			// These queries don't modify the node's state and can be answered
+			// from a snapshot of the routing table, off of the network thread.
+			// Replies are still sent from the network thread. 0 (the default)
+			// answers all queries on the network thread. This is only meant
+			// for nodes receiving a very high rate of DHT traffic. This
+			// setting takes effect when the DHT is (re-)started. Note that
+			// plugins' ``on_dht_request()`` is not called for queries answered
+			// by the worker threads.
+			dht_worker_threads,
+
+			// the number of packets per second DHT announces may send, on
+			// average. Torrents' announces are queued and started in
+			// info-hash order as the budget allows. If the queue can't keep
+			// up with ``dht_announce_interval``, repeated announces of the
+			// same info-hash are merged. 0 (the default) means announces are
+			// started as soon as they are requested, without a limit.
+			dht_announce_rate_limit,
+
+			// the number of threads checking the signatures of incoming
+			// mutable item puts (BEP 44). The responses to such puts are sent
+			// once the signature has been checked. 0 (the default) checks them
+			// on the network thread. This setting takes effect when the DHT is
+			// (re-)started.
+			dht_verify_threads,
+
 			max_int_setting_internal
 		};
 
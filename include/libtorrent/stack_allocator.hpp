@@ -40,9 +40,11 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/vector.hpp"
 #include "libtorrent/aux_/numeric_cast.hpp"
 
+#include <array>
 #include <cstdarg> // for va_list
 #include <cstdio> // for vsnprintf
 #include <cstring>
+#include <cstdint>
 
 namespace libtorrent {
 namespace aux {
@@ -76,6 +78,13 @@ namespace aux {
 		allocation_slot copy_string(string_view str);
 		allocation_slot copy_string(char const* str);
 
+		// like copy_string(), but if an identical string has already been
+		// interned since the last call to reset(), the slot of that copy is
+		// returned instead of storing it again. This is meant for immutable
+		// strings that are repeated across many allocations, like torrent
+		// names and tracker URLs. The returned string must not be modified.
+		allocation_slot intern_string(string_view str);
+
 		allocation_slot format_string(char const* fmt, va_list v);
 
 		allocation_slot copy_buffer(span<char const> buf);
@@ -88,6 +97,18 @@ namespace aux {
 	private:
 
 		vector<char> m_storage;
+
+		// a small direct-mapped cache of strings interned since the last
+		// reset(). A collision simply evicts the previous entry, which means
+		// the next lookup for it will store another copy
+		struct interned_entry
+		{
+			std::uint32_t hash;
+			int length;
+			allocation_slot slot;
+		};
+		static constexpr std::size_t interned_size = 64;
+		std::array<interned_entry, interned_size> m_interned{};
 	};
 
 }
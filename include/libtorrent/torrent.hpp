@@ -519,7 +519,7 @@ namespace libtorrent {
 		// connect to them
 		void maybe_connect_web_seeds();
 
-		std::string name() const;
+		std::string const& name() const;
 
 		stat statistics() const { return m_stat; }
 		boost::optional<std::int64_t> bytes_left() const;
@@ -719,6 +719,14 @@ namespace libtorrent {
 		void update_gauge();
 
 		bool try_connect_peer();
+
+		// returns true if we know that none of our connect candidates can be
+		// connected to at this session time, because they are all waiting for
+		// their reconnect timeout. The torrent is off the want-peers lists
+		// until then, so the session doesn't search its peer list every tick
+		bool connect_deferred(int const session_time) const
+		{ return session_time < int(m_next_connect_attempt); }
+
 		torrent_peer* add_peer(tcp::endpoint const& adr
 			, peer_source_flags_t source, pex_flags_t flags = {});
 		bool ban_peer(torrent_peer* tp);
@@ -1198,6 +1206,20 @@ namespace libtorrent {
 			m_links[aux::session_interface::torrent_state_updates].clear();
 		}
 
+		// returns the subset of ``flags`` that needs to be included in the next
+		// state update, when the client asked for changed fields only
+		status_flags_t unsent_status_fields(status_flags_t flags) const;
+
+		// the expensive fields in ``f`` were posted in a state_update_alert.
+		// They are left out of the following ones, until
+		// status_fields_changed() is called for them
+		void status_fields_sent(status_flags_t f);
+
+		// marks the expensive status fields in ``f`` as changed, to have them
+		// included in the next state update
+		void status_fields_changed(status_flags_t const f)
+		{ m_sent_status_fields &= ~f; }
+
 		void inc_num_connecting(torrent_peer* pp)
 		{
 			++m_num_connecting;
@@ -1534,6 +1556,18 @@ namespace libtorrent {
 		// connections (if we've reached the connection limit)
 		std::uint16_t m_num_connecting = 0;
 
+		// the session time at which the next connect candidate in our peer list
+		// will have passed its reconnect timeout. This is set when a connection
+		// attempt finds no eligible peer, and reset whenever the set of connect
+		// candidates may have changed. 0 means we don't know, and should try
+		std::uint16_t m_next_connect_attempt = 0;
+
+		// the expensive torrent_status fields (pieces, name, save_path etc.)
+		// that have been posted in a state_update_alert, and have not changed
+		// since. Only used when post_torrent_updates() is called with
+		// session_handle::changed_fields_only
+		status_flags_t m_sent_status_fields{};
+
 		// this is the peer id we generate when we add the torrent. Peers won't
 		// use this (they generate their own peer ids) but this is used in case
 		// the tracker returns peer IDs, to identify ourself in the peer list to
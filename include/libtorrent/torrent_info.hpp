@@ -68,6 +68,7 @@ namespace libtorrent {
 	struct invariant_access;
 
 namespace aux {
+	struct file_view;
 
 	// internal, exposed for the unit test
 	TORRENT_EXTRA_EXPORT void sanitize_append_path_element(std::string& path
@@ -141,6 +142,15 @@ namespace aux {
 
 		// the max number of bdecode tokens
 		int max_decode_tokens = 3000000;
+
+		// when loading a .torrent file by name, memory map it instead of
+		// reading it into a buffer. The torrent_info object keeps the mapping
+		// and refers to the info-dictionary and the piece layers in place,
+		// rather than copying them. This lowers load time and memory usage for
+		// torrents with very many files, but the file must not be modified or
+		// truncated for as long as the torrent_info (or any copy of it) is
+		// alive. This has no effect on platforms without memory mapped files.
+		bool map_file = false;
 	};
 
 	using torrent_info_flags_t = flags::bitfield_flag<std::uint8_t, struct torrent_info_flags_tag>;
@@ -649,6 +659,10 @@ TORRENT_VERSION_NAMESPACE_3
 
 		bool parse_torrent_file(bdecode_node const& torrent_file, error_code& ec, int piece_limit);
 
+		// returns true if buf lies within the memory mapped .torrent file (if
+		// any), and can be referenced rather than copied
+		bool in_file_view(span<char const> buf) const;
+
 		void resolve_duplicate_filenames();
 
 		// the slow path, in case we detect/suspect a name collision
@@ -704,7 +718,18 @@ TORRENT_VERSION_NAMESPACE_3
 
 		// v2 merkle tree for each file
 		// the actual hash buffers are always divisible by 32 (sha256_hash::size())
-		aux::vector<aux::vector<char>, file_index_t> m_piece_layers;
+		// they point into m_piece_layer_storage
+		aux::vector<span<char const>, file_index_t> m_piece_layers;
+
+		// the buffer holding the piece layers. This is either owned by the
+		// torrent_info (and shared between copies of it) or, when loaded from a
+		// memory mapped file, it's the mapping itself.
+		std::shared_ptr<void const> m_piece_layer_storage;
+
+		// if the torrent was loaded with load_torrent_limits::map_file, this
+		// is the mapped .torrent file. m_info_section and m_piece_layers refer
+		// into it.
+		std::shared_ptr<aux::file_view const> m_file_view;
 
 		// this is a copy of the info section from the torrent.
 		// it use maintained in this flat format in order to
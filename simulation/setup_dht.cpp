@@ -237,6 +237,11 @@ struct dht_node final : lt::dht::socket_manager
 		sock().close();
 	}
 
+	void add_torrent(lt::sha1_hash const& ih)
+	{
+		m_dht_storage->announce_peer(ih, rand_tcp_ep(), {}, false);
+	}
+
 	lt::dht::node& dht() { return m_dht; }
 	lt::dht::node const& dht() const { return m_dht; }
 
@@ -314,5 +319,20 @@ void dht_network::stop()
 	for (auto& n : m_nodes) n.stop();
 }
 
+void dht_network::add_torrents(int const num_torrents)
+{
+	std::vector<dht_node*> nodes;
+	nodes.reserve(m_nodes.size());
+	for (auto& n : m_nodes) nodes.push_back(&n);
+
+	for (int i = 0; i < num_torrents; ++i)
+	{
+		lt::sha1_hash ih;
+		lt::aux::random_bytes(ih);
+		for (int k = 0; k < 8; ++k)
+			nodes[lt::random(std::uint32_t(nodes.size() - 1))]->add_torrent(ih);
+	}
+}
+
 #endif // TORRENT_DISABLE_DHT
 
@@ -62,6 +62,9 @@ struct dht_network
 	void stop();
 	std::vector<lt::udp::endpoint> router_nodes() const;
 
+	// announces num_torrents random info-hashes, each to 8 random nodes
+	void add_torrents(int num_torrents);
+
 private:
 
 	// used for all the nodes in the network
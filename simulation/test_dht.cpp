@@ -49,6 +49,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/kademlia/dht_state.hpp"
 #include "libtorrent/aux_/ip_helpers.hpp"
 
+#include <set>
+#include <cinttypes> // for PRId64
+
 using lt::settings_pack;
 
 #ifndef TORRENT_DISABLE_DHT
@@ -329,3 +332,74 @@ TORRENT_TEST(dht_dual_stack_mutable_item)
 
 #endif // TORRENT_DISABLE_DHT
 }
+
+// measures how many unique info-hashes the crawler finds per request sent
+TORRENT_TEST(dht_crawl)
+{
+#ifndef TORRENT_DISABLE_DHT
+	sim::default_config cfg;
+	sim::simulation sim{cfg};
+
+	int const num_torrents = 20000;
+	dht_network dht(sim, 1000);
+	dht.add_torrents(num_torrents);
+
+	std::set<lt::sha1_hash> found;
+	int duplicates = 0;
+	std::int64_t requests = 0;
+	std::int64_t responses = 0;
+	std::int64_t unique = 0;
+	int max_concurrency = 0;
+
+	setup_swarm(1, swarm_test::download, sim
+		// add session
+		, [](lt::settings_pack&) {}
+		// add torrent
+		, [](lt::add_torrent_params&) {}
+		// on alert
+		, [&](lt::alert const* a, lt::session&)
+		{
+			if (auto const* p = lt::alert_cast<lt::dht_crawl_alert>(a))
+			{
+				for (auto const& ih : p->infohashes())
+					if (!found.insert(ih).second) ++duplicates;
+				requests = p->num_requests;
+				responses = p->num_responses;
+				unique = p->num_unique;
+				max_concurrency = std::max(max_concurrency, p->concurrency);
+			}
+		}
+		// terminate?
+		, [&](int ticks, lt::session& ses) -> bool
+		{
+			if (ticks == 0)
+			{
+				bootstrap_session({&dht}, ses);
+			}
+			if (ticks == 10)
+			{
+				ses.dht_start_crawl();
+			}
+			if (ticks > 300)
+			{
+				std::printf("crawl: requests: %" PRId64 " responses: %" PRId64
+					" unique info-hashes: %" PRId64 " (%d torrents) max concurrency: %d\n"
+					"unique info-hashes per request: %.2f\n"
+					, requests, responses, unique, num_torrents, max_concurrency
+					, requests > 0 ? double(unique) / double(requests) : 0.0);
+				ses.dht_stop_crawl();
+				TEST_EQUAL(duplicates, 0);
+				TEST_EQUAL(std::int64_t(found.size()), unique);
+				TEST_CHECK(requests > 0);
+				TEST_CHECK(unique > 0);
+				TEST_CHECK(unique <= num_torrents);
+				dht.stop();
+				return true;
+			}
+			return false;
+		});
+
+	sim.run();
+
+#endif // TORRENT_DISABLE_DHT
+}
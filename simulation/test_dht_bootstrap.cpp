@@ -38,6 +38,11 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "settings.hpp"
 #include "libtorrent/deadline_timer.hpp"
 #include "setup_transfer.hpp" // for addr()
+#include "setup_dht.hpp"
+#include "libtorrent/session.hpp"
+#include "libtorrent/session_params.hpp"
+#include "libtorrent/alert_types.hpp"
+#include "libtorrent/kademlia/dht_state.hpp"
 
 using namespace sim;
 
@@ -107,6 +112,123 @@ TORRENT_TEST(dht_bootstrap)
 	TEST_CHECK(a.dict_find_int_value("bs", -1) == 1);
 }
 
+namespace {
+
+	// the number of routing table entries we consider a warmed up node
+	int const full_table = 100;
+
+	struct restart_run
+	{
+		std::shared_ptr<lt::session> ses;
+		std::unique_ptr<lt::deadline_timer> timer;
+		int ticks = 0;
+		int run_time = 0;
+		// the number of seconds it took to reach full_table nodes, or -1
+		int full_at = -1;
+		std::function<void(int, lt::session&)> done;
+	};
+
+	void sample_routing_table(std::shared_ptr<restart_run> r)
+	{
+		std::vector<lt::alert*> alerts;
+		r->ses->pop_alerts(&alerts);
+		for (lt::alert* a : alerts)
+		{
+			auto const* p = lt::alert_cast<lt::dht_stats_alert>(a);
+			if (p == nullptr || r->full_at >= 0) continue;
+			int nodes = 0;
+			for (auto const& b : p->routing_table)
+				nodes += b.num_nodes;
+			if (nodes >= full_table) r->full_at = r->ticks;
+		}
+
+		if (++r->ticks > r->run_time)
+		{
+			r->done(r->full_at, *r->ses);
+			return;
+		}
+		r->ses->post_dht_stats();
+		r->timer->expires_after(lt::seconds(1));
+		r->timer->async_wait([r](lt::error_code const&) { sample_routing_table(r); });
+	}
+
+	// starts a session on the simulated network, bootstrapping off of
+	// ``state``. The routing table size is sampled every second, and ``done``
+	// is called with the number of seconds it took to reach ``full_table``
+	// nodes once ``run_time`` seconds have passed
+	void run_session(lt::io_context& ios, lt::dht::dht_state state, int const run_time
+		, std::function<void(int, lt::session&)> done)
+	{
+		lt::settings_pack pack = settings();
+		pack.set_int(lt::settings_pack::aio_threads, 0);
+		pack.set_int(lt::settings_pack::hashing_threads, 0);
+		pack.set_bool(lt::settings_pack::enable_lsd, false);
+		pack.set_bool(lt::settings_pack::enable_upnp, false);
+		pack.set_bool(lt::settings_pack::enable_natpmp, false);
+		pack.set_bool(lt::settings_pack::enable_dht, true);
+		pack.set_bool(lt::settings_pack::dht_ignore_dark_internet, false);
+		pack.set_bool(lt::settings_pack::dht_restrict_routing_ips, false);
+		pack.set_bool(lt::settings_pack::dht_save_snapshot, true);
+		pack.set_str(lt::settings_pack::dht_bootstrap_nodes, "");
+
+		lt::session_params params(pack);
+		params.dht_state = std::move(state);
+
+		auto r = std::make_shared<restart_run>();
+		r->ses = std::make_shared<lt::session>(std::move(params), ios);
+		r->timer.reset(new lt::deadline_timer(ios));
+		r->run_time = run_time;
+		r->done = std::move(done);
+		r->timer->expires_after(lt::seconds(1));
+		r->timer->async_wait([r](lt::error_code const&) { sample_routing_table(r); });
+	}
+} // anonymous namespace
+
+// compares how long it takes a node to get a full routing table when
+// bootstrapping from the router nodes and when restarting from the DHT
+// snapshot it saved
+TORRENT_TEST(dht_restart_from_snapshot)
+{
+	sim::default_config cfg;
+	sim::simulation sim{cfg};
+
+	dht_network dht(sim, 1000);
+
+	std::vector<lt::session_proxy> zombies;
+	sim::asio::io_context ios(sim, addr("50.0.0.1"));
+
+	lt::dht::dht_state cold;
+	cold.nodes = dht.router_nodes();
+
+	int cold_time = -1;
+	int warm_time = -1;
+	lt::dht::dht_state saved;
+
+	run_session(ios, cold, 120, [&](int const t, lt::session& ses)
+	{
+		cold_time = t;
+		saved = ses.session_state(lt::session_handle::save_dht_state).dht_state;
+		zombies.push_back(ses.abort());
+
+		run_session(ios, saved, 60, [&](int const t2, lt::session& ses2)
+		{
+			warm_time = t2;
+			zombies.push_back(ses2.abort());
+			dht.stop();
+		});
+	});
+
+	sim.run();
+
+	std::printf("full routing table after: bootstrap: %d s, snapshot: %d s\n"
+		, cold_time, warm_time);
+
+	TEST_CHECK(!saved.snapshot.empty());
+	TEST_CHECK(cold_time >= 0);
+	TEST_CHECK(warm_time >= 0);
+	TEST_CHECK(warm_time <= cold_time);
+}
+
 #else
 TORRENT_TEST(disabled) {}
 #endif // TORRENT_DISABLE_DHT
@@ -45,6 +45,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/session_settings.hpp"
 #include "libtorrent/address.hpp"
 #include "libtorrent/aux_/time.hpp"
+#include "libtorrent/bloom_filter.hpp"
+#include "libtorrent/socket_io.hpp" // for hash_address
 
 #include "simulator/simulator.hpp"
 
@@ -73,9 +75,10 @@ namespace
 	}
 
 	std::unique_ptr<dht_storage_interface> create_default_dht_storage(
-		settings_interface const& sett)
+		settings_interface const& sett
+		, dht_storage_constructor_type const& constructor = dht_default_storage_constructor)
 	{
-		std::unique_ptr<dht_storage_interface> s(dht_default_storage_constructor(sett));
+		std::unique_ptr<dht_storage_interface> s(constructor(sett));
 		TEST_CHECK(s.get() != nullptr);
 
 		s->update_node_ids({to_hash("0000000000000000000000000000000000000200")});
@@ -110,10 +113,10 @@ void test_expiration(simulation& sim
 	sim.run();
 }
 
-TORRENT_TEST(dht_storage_counters)
+void test_storage_counters(dht_storage_constructor_type const& constructor)
 {
 	auto sett = test_settings();
-	std::unique_ptr<dht_storage_interface> s(create_default_dht_storage(sett));
+	std::unique_ptr<dht_storage_interface> s(create_default_dht_storage(sett, constructor));
 
 	TEST_CHECK(s.get() != nullptr);
 
@@ -167,6 +170,19 @@ TORRENT_TEST(dht_storage_counters)
 	test_expiration(sim, hours(1), s, c); // test expiration of everything after 3 hours
 }
 
+TORRENT_TEST(dht_storage_counters)
+{
+	test_storage_counters(dht_default_storage_constructor);
+}
+
+// the compact storage evicts the least recently announced torrent and the
+// least recently put item instead of dropping the new ones, which ends up
+// with the same counts here. Its peers expire through the expiry wheel
+TORRENT_TEST(dht_compact_storage_counters)
+{
+	test_storage_counters(dht_compact_storage_constructor);
+}
+
 TORRENT_TEST(dht_storage_infohashes_sample)
 {
 	default_config cfg;
@@ -214,6 +230,58 @@ TORRENT_TEST(dht_storage_infohashes_sample)
 
 	sim.run();
 }
+// the scrape filters maintained for torrents with many peers must forget
+// the peers that expire
+TORRENT_TEST(dht_storage_scrape_expiry)
+{
+	default_config cfg;
+	simulation sim(cfg);
+	sim::asio::io_context ios(sim, addr("10.0.0.1"));
+
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_peers, 500);
+	std::unique_ptr<dht_storage_interface> s(create_default_dht_storage(sett));
+
+	sha1_hash const n1 = to_hash("5fbfbff10c5d6a4ec8a88e4c6ab4c28b95eee401");
+	auto peer = [](int const i)
+	{ return tcp::endpoint(address_v4(std::uint32_t(0x0a000000 + i)), 6881); };
+
+	// the first 200 peers are announced now, the next 100 after 30 minutes.
+	// After 50 minutes only the second batch is left
+	for (int i = 0; i < 200; ++i)
+		s->announce_peer(n1, peer(i), "torrent_name", i % 2 == 0);
+
+	sim::asio::high_resolution_timer timer(ios);
+	timer.expires_after(minutes(30));
+	timer.async_wait([&](boost::system::error_code const&)
+	{
+		for (int i = 200; i < 300; ++i)
+			s->announce_peer(n1, peer(i), "torrent_name", i % 2 == 0);
+
+		timer.expires_after(minutes(20));
+		timer.async_wait([&](boost::system::error_code const&)
+		{
+			s->tick();
+			TEST_EQUAL(s->counters().peers, 100);
+
+			bloom_filter<256> downloaders;
+			bloom_filter<256> seeds;
+			for (int i = 200; i < 300; ++i)
+			{
+				sha1_hash const iphash = hash_address(peer(i).address());
+				if (i % 2 == 0) seeds.set(iphash);
+				else downloaders.set(iphash);
+			}
+
+			entry peers;
+			s->get_peers(n1, false, true, addr("124.31.75.21"), peers);
+			TEST_EQUAL(peers["BFpe"].string(), downloaders.to_string());
+			TEST_EQUAL(peers["BFsd"].string(), seeds.to_string());
+		});
+	});
+
+	sim.run();
+}
 #else
 TORRENT_TEST(disabled) {}
 #endif // TORRENT_DISABLE_DHT
@@ -37,12 +37,17 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/socket.hpp"
 #include "libtorrent/alert_types.hpp"
 #include "libtorrent/extensions.hpp"
+#include "libtorrent/session_stats.hpp"
 #include "simulator/simulator.hpp"
 #include "simulator/utils.hpp" // for timer
 #include "settings.hpp"
 #include "create_torrent.hpp"
 #include "setup_transfer.hpp" // for addr()
 
+#include <algorithm>
+#include <chrono>
+#include <cinttypes> // for PRId64
+
 using namespace lt;
 
 TORRENT_TEST(seed_mode)
@@ -252,3 +257,102 @@ TORRENT_TEST(construct_paused_session)
 
 	sim.run();
 }
+
+#ifndef TORRENT_DISABLE_EXTENSIONS
+namespace {
+// a session plugin whose tick handler blocks the network thread
+struct slow_tick_plugin : lt::plugin
+{
+	feature_flags_t implemented_features() override { return tick_feature; }
+
+	void on_tick() override
+	{
+		// this measures real time, not simulated time, since we need to
+		// burn actual CPU cycles in the network thread
+		auto const end = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+		while (std::chrono::steady_clock::now() < end) ++m_spins;
+	}
+
+	std::int64_t m_spins = 0;
+};
+}
+
+// inject a slow handler into the network thread, and make sure the time is
+// attributed to its category
+TORRENT_TEST(slow_handler_is_reported)
+{
+	sim::default_config network_cfg;
+	sim::simulation sim{network_cfg};
+	sim::asio::io_context ios { sim, addr("50.0.0.1")};
+
+	lt::session_proxy zombie;
+
+	auto pack = settings();
+	pack.set_str(settings_pack::listen_interfaces, "0.0.0.0:0");
+	pack.set_int(settings_pack::tick_interval, 100);
+	pack.set_bool(settings_pack::profile_handlers, true);
+	pack.set_int(settings_pack::alert_mask, alert_category::stats);
+	auto ses = std::make_shared<lt::session>(pack, ios);
+
+	auto plugin = std::make_shared<slow_tick_plugin>();
+	ses->add_extension(plugin);
+
+	std::vector<std::int64_t> stats;
+	std::vector<handler_profile_alert::handler_time> top;
+	sim::timer t1(sim, lt::seconds(5), [&](boost::system::error_code const&)
+	{
+		ses->post_session_stats();
+	});
+
+	sim::timer t2(sim, lt::seconds(6), [&](boost::system::error_code const&)
+	{
+		std::vector<lt::alert*> alerts;
+		ses->pop_alerts(&alerts);
+		for (lt::alert* a : alerts)
+		{
+			if (auto const* sa = alert_cast<session_stats_alert>(a))
+				stats.assign(sa->counters().begin(), sa->counters().end());
+			if (auto const* pa = alert_cast<handler_profile_alert>(a))
+				top = pa->top_handlers;
+		}
+		zombie = ses->abort();
+		ses.reset();
+	});
+
+	sim.run();
+
+	TEST_CHECK(plugin->m_spins > 0);
+	TEST_CHECK(!stats.empty());
+	if (stats.empty()) return;
+
+	char const* categories[] = {"peer_write", "peer_read", "udp", "tick", "abort"
+		, "defer", "utp", "submit", "session_call", "torrent_tick"
+		, "auto_manage", "dht", "tracker"};
+
+	std::int64_t tick_time = 0;
+	std::int64_t max_other = 0;
+	for (char const* c : categories)
+	{
+		int const wall_idx = find_metric_idx("net.handler_wall_" + std::string(c));
+		int const cpu_idx = find_metric_idx("net.handler_cpu_" + std::string(c));
+		TEST_CHECK(wall_idx >= 0);
+		TEST_CHECK(cpu_idx >= 0);
+		if (wall_idx < 0 || cpu_idx < 0) continue;
+		std::printf("%-15s wall: %8" PRId64 " us cpu: %8" PRId64 " us\n"
+			, c, stats[std::size_t(wall_idx)], stats[std::size_t(cpu_idx)]);
+		if (std::string(c) == "tick") tick_time = stats[std::size_t(wall_idx)];
+		else max_other = std::max(max_other, stats[std::size_t(wall_idx)]);
+	}
+
+	// with a 100 ms tick interval, the plugin is called dozens of times
+	// before the stats are posted. Each call blocks for 20 ms
+	TEST_CHECK(tick_time >= 20000);
+	// the slow handler must be the top offender
+	TEST_CHECK(tick_time > max_other);
+
+	TEST_CHECK(!top.empty());
+	if (top.empty()) return;
+	TEST_EQUAL(std::string(top.front().category), "tick");
+	TEST_EQUAL(top.front().wall_time, tick_time);
+}
+#endif
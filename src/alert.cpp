@@ -111,10 +111,10 @@ namespace libtorrent {
 		std::shared_ptr<torrent> t = h.native_handle();
 		if (t)
 		{
-			std::string name_str = t->name();
+			std::string const& name_str = t->name();
 			if (!name_str.empty())
 			{
-				m_name_idx = alloc.copy_string(name_str);
+				m_name_idx = alloc.intern_string(name_str);
 			}
 			else
 			{
@@ -175,7 +175,7 @@ namespace libtorrent {
 		, torrent_handle const& h, tcp::endpoint const& ep, string_view u)
 		: torrent_alert(alloc, h)
 		, local_endpoint(ep)
-		, m_url_idx(alloc.copy_string(u))
+		, m_url_idx(alloc.intern_string(u))
 #if TORRENT_ABI_VERSION == 1
 		, url(u)
 #endif
@@ -1812,8 +1812,9 @@ namespace {
 	}
 
 	state_update_alert::state_update_alert(aux::stack_allocator&
-		, std::vector<torrent_status> st)
+		, std::vector<torrent_status> st, std::vector<status_flags_t> fields)
 		: status(std::move(st))
+		, queried_fields(std::move(fields))
 	{}
 
 	std::string state_update_alert::message() const
@@ -2347,7 +2348,7 @@ namespace {
 		, string_view u, error_code const& e)
 		: torrent_alert(alloc, h)
 		, error(e)
-		, m_url_idx(alloc.copy_string(u))
+		, m_url_idx(alloc.intern_string(u))
 		, m_msg_idx()
 #if TORRENT_ABI_VERSION == 1
 		, url(u)
@@ -2358,7 +2359,7 @@ namespace {
 	url_seed_alert::url_seed_alert(aux::stack_allocator& alloc, torrent_handle const& h
 		, string_view u, string_view m)
 		: torrent_alert(alloc, h)
-		, m_url_idx(alloc.copy_string(u))
+		, m_url_idx(alloc.intern_string(u))
 		, m_msg_idx(alloc.copy_string(m))
 #if TORRENT_ABI_VERSION == 1
 		, url(u)
@@ -3021,7 +3022,7 @@ namespace {
 		"picker_log", "session_error", "dht_live_nodes",
 		"session_stats_header", "dht_sample_infohashes",
 		"block_uploaded", "alerts_dropped", "socks5",
-		"file_prio", "oversized_file"
+		"file_prio", "oversized_file", "dht_crawl", "handler_profile"
 		}};
 
 		TORRENT_ASSERT(alert_type >= 0);
@@ -3093,6 +3094,75 @@ namespace {
 #endif
 	}
 
+	dht_crawl_alert::dht_crawl_alert(aux::stack_allocator& alloc
+		, std::vector<sha1_hash> const& infohashes
+		, std::int64_t const requests, std::int64_t const responses
+		, std::int64_t const unique, int const c)
+		: num_requests(requests)
+		, num_responses(responses)
+		, num_unique(unique)
+		, concurrency(c)
+		, m_alloc(alloc)
+		, m_num_infohashes(aux::numeric_cast<int>(infohashes.size()))
+	{
+		m_infohashes_idx = alloc.allocate(m_num_infohashes * 20);
+
+		char* ptr = alloc.ptr(m_infohashes_idx);
+		std::memcpy(ptr, infohashes.data(), infohashes.size() * 20);
+	}
+
+	std::string dht_crawl_alert::message() const
+	{
+#ifdef TORRENT_DISABLE_ALERT_MSG
+		return {};
+#else
+		char msg[200];
+		std::snprintf(msg, sizeof(msg)
+			, "dht crawl found %d info-hashes (total: %" PRId64 " unique, %" PRId64
+			" requests, %" PRId64 " responses, concurrency: %d)"
+			, m_num_infohashes, num_unique, num_requests, num_responses, concurrency);
+		return msg;
+#endif
+	}
+
+	int dht_crawl_alert::num_infohashes() const
+	{
+		return m_num_infohashes;
+	}
+
+	std::vector<sha1_hash> dht_crawl_alert::infohashes() const
+	{
+		aux::vector<sha1_hash> ret;
+		ret.resize(m_num_infohashes);
+
+		char const* ptr = m_alloc.get().ptr(m_infohashes_idx);
+		std::memcpy(ret.data(), ptr, ret.size() * 20);
+
+		return std::move(ret);
+	}
+
+	handler_profile_alert::handler_profile_alert(aux::stack_allocator&
+		, std::vector<handler_time> h)
+		: top_handlers(std::move(h))
+	{}
+
+	std::string handler_profile_alert::message() const
+	{
+#ifdef TORRENT_DISABLE_ALERT_MSG
+		return {};
+#else
+		std::string ret = "handler profile:";
+		char msg[100];
+		for (auto const& h : top_handlers)
+		{
+			std::snprintf(msg, sizeof(msg), " %s: %" PRId64 " us (cpu: %" PRId64 " us)"
+				, h.category, h.wall_time, h.cpu_time);
+			ret += msg;
+		}
+		return ret;
+#endif
+	}
+
 	// this will no longer be necessary in C++17
 	constexpr alert_category_t torrent_removed_alert::static_category;
 	constexpr alert_category_t read_piece_alert::static_category;
@@ -3186,6 +3256,8 @@ namespace {
 	constexpr alert_category_t socks5_alert::static_category;
 	constexpr alert_category_t file_prio_alert::static_category;
 	constexpr alert_category_t oversized_file_alert::static_category;
+	constexpr alert_category_t dht_crawl_alert::static_category;
+	constexpr alert_category_t handler_profile_alert::static_category;
 #if TORRENT_ABI_VERSION == 1
 	constexpr alert_category_t anonymous_mode_alert::static_category;
 	constexpr alert_category_t mmap_cache_alert::static_category;
@@ -37,6 +37,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/alert_manager.hpp"
 #include "libtorrent/alert_types.hpp"
 
+#include <thread> // for yield
+
 #ifndef TORRENT_DISABLE_EXTENSIONS
 #include "libtorrent/extensions.hpp"
 #include <memory> // for shared_ptr
@@ -48,13 +50,15 @@ namespace aux {
 	alert_manager::alert_manager(int const queue_limit, alert_category_t const alert_mask)
 		: m_alert_mask(alert_mask)
 		, m_queue_size_limit(queue_limit)
-	{}
+	{
+		for (auto& c : m_in_callback) c.store(0, std::memory_order_relaxed);
+	}
 
 	alert_manager::~alert_manager() = default;
 
 	alert* alert_manager::wait_for_alert(time_duration max_wait)
 	{
-		std::unique_lock<std::recursive_mutex> lock(m_mutex);
+		std::unique_lock<std::mutex> lock(m_mutex);
 
 		if (!m_alerts[m_generation].empty())
 			return m_alerts[m_generation].front();
@@ -67,7 +71,7 @@ namespace aux {
 		return nullptr;
 	}
 
-	void alert_manager::maybe_notify(alert* a)
+	void alert_manager::maybe_notify(alert* a, std::unique_lock<std::mutex>& lock)
 	{
 		if (m_alerts[m_generation].size() == 1)
 		{
@@ -83,16 +87,25 @@ namespace aux {
 		}
 
 #ifndef TORRENT_DISABLE_EXTENSIONS
+		if (m_ses_extensions.empty()) return;
+
+		// the alert must stay alive until the extensions are done with it,
+		// even if the client pops alerts in the meantime
+		std::atomic<int>& in_callback = m_in_callback[m_generation];
+		in_callback.fetch_add(1, std::memory_order_relaxed);
+		lock.unlock();
 		for (auto& e : m_ses_extensions)
 			e->on_alert(a);
+		in_callback.fetch_sub(1, std::memory_order_release);
 #else
 		TORRENT_UNUSED(a);
+		TORRENT_UNUSED(lock);
 #endif
 	}
 
 	void alert_manager::set_notify_function(std::function<void()> const& fun)
 	{
-		std::unique_lock<std::recursive_mutex> lock(m_mutex);
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_notify = fun;
 		if (!m_alerts[m_generation].empty())
 		{
@@ -107,39 +120,89 @@ namespace aux {
 	}
 #endif
 
+	int alert_manager::swap_buffers()
+	{
+		// the generation we're about to start posting to is still holding the
+		// alerts we handed out last time. Since only the consumer touches it,
+		// it can be cleared without holding m_mutex, not to block producers
+		// while running destructors. Extensions may still be looking at
+		// alerts in it though, wait for them to finish first
+		int const next_generation = (m_generation + 1) & 1;
+		while (m_in_callback[next_generation].load(std::memory_order_acquire) > 0)
+			std::this_thread::yield();
+		m_alerts[next_generation].clear();
+		m_allocations[next_generation].reset();
+
+		alert* dropped = nullptr;
+		int ret;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_alerts[m_generation].empty()) return -1;
+
+			if (m_dropped.any()) try
+			{
+				dropped = emplace_locked<alerts_dropped_alert>(m_dropped);
+				m_dropped.reset();
+			}
+			catch (std::bad_alloc const&) {}
+
+			// swap buffers
+			ret = m_generation;
+			m_generation = next_generation;
+		}
+
+#ifndef TORRENT_DISABLE_EXTENSIONS
+		// the generation we just swapped out is owned by the consumer now
+		if (dropped != nullptr)
+		{
+			for (auto& e : m_ses_extensions)
+				e->on_alert(dropped);
+		}
+#else
+		TORRENT_UNUSED(dropped);
+#endif
+		return ret;
+	}
+
 	void alert_manager::get_all(std::vector<alert*>& alerts)
 	{
-		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		std::lock_guard<std::mutex> consumer_lock(m_consumer_mutex);
 
-		if (m_alerts[m_generation].empty())
+		int const gen = swap_buffers();
+		if (gen < 0)
 		{
 			alerts.clear();
 			return;
 		}
 
-		if (m_dropped.any()) {
-			emplace_alert<alerts_dropped_alert>(m_dropped);
-			m_dropped.reset();
-		}
+		m_alerts[gen].get_pointers(alerts);
+	}
 
-		m_alerts[m_generation].get_pointers(alerts);
+	void alert_manager::get_all(std::function<void(alert*)> const& handler)
+	{
+		int gen;
+		{
+			std::lock_guard<std::mutex> consumer_lock(m_consumer_mutex);
+			gen = swap_buffers();
+		}
+		if (gen < 0) return;
 
-		// swap buffers
-		m_generation = (m_generation + 1) & 1;
-		// clear the one we will start writing to now
-		m_alerts[m_generation].clear();
-		m_allocations[m_generation].reset();
+		// the alerts are owned by the client until the next call to get_all(),
+		// so there's no need to hold any lock while calling the handler. This
+		// also lets the handler post new alerts
+		m_alerts[gen].for_each(handler);
 	}
 
 	bool alert_manager::pending() const
 	{
-		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		std::lock_guard<std::mutex> lock(m_mutex);
 		return !m_alerts[m_generation].empty();
 	}
 
 	int alert_manager::set_alert_queue_size_limit(int queue_size_limit_)
 	{
-		std::lock_guard<std::recursive_mutex> lock(m_mutex);
+		std::lock_guard<std::mutex> lock(m_mutex);
 
 		std::swap(m_queue_size_limit, queue_size_limit_);
 		return queue_size_limit_;
@@ -41,6 +41,7 @@ namespace aux {
 
 	bandwidth_channel::bandwidth_channel()
 		: tmp(0)
+		, round(0)
 		, distribute_quota(0)
 		, m_quota_left(0)
 		, m_limit(0)
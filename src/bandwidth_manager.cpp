@@ -147,13 +147,20 @@ namespace aux {
 		std::int64_t dt_milliseconds = total_milliseconds(dt);
 		if (dt_milliseconds > 3000) dt_milliseconds = 3000;
 
-		// for each bandwidth channel, call update_quota(dt)
-
-		std::vector<bandwidth_channel*> channels;
-
-		std::vector<bw_request> queue;
-
-		for (auto i = m_queue.begin(); i != m_queue.end();)
+		// channels are stamped with the round they were last reset in, to
+		// reset and accumulate their tmp counters in the same pass. The stamps
+		// are cleared again at the end of the pass, since a channel may outlive
+		// this bandwidth_manager and be picked up by another one
+		std::uint64_t const round = ++m_round;
+
+		TORRENT_ASSERT(m_channels.empty());
+		TORRENT_ASSERT(m_done.empty());
+
+		// remove disconnecting peers and sum up the priorities of the requests
+		// for each bandwidth channel. Requests are compacted in-place rather
+		// than erased one at a time
+		auto out = m_queue.begin();
+		for (auto i = m_queue.begin(); i != m_queue.end(); ++i)
 		{
 			if (i->peer->is_disconnecting())
 			{
@@ -168,35 +175,36 @@ namespace aux {
 				}
 
 				i->assigned = 0;
-				queue.push_back(std::move(*i));
-				i = m_queue.erase(i);
+				m_done.push_back(std::move(*i));
 				continue;
 			}
 			for (int j = 0; j < bw_request::max_bandwidth_channels && i->channel[j]; ++j)
 			{
 				bandwidth_channel* bwc = i->channel[j];
-				bwc->tmp = 0;
-			}
-			++i;
-		}
-
-		for (auto const& r : m_queue)
-		{
-			for (int j = 0; j < bw_request::max_bandwidth_channels && r.channel[j]; ++j)
-			{
-				bandwidth_channel* bwc = r.channel[j];
-				if (bwc->tmp == 0) channels.push_back(bwc);
-				TORRENT_ASSERT(INT_MAX - bwc->tmp > r.priority);
-				bwc->tmp += r.priority;
+				if (bwc->round != round)
+				{
+					bwc->round = round;
+					bwc->tmp = 0;
+					m_channels.push_back(bwc);
+				}
+				TORRENT_ASSERT(INT_MAX - bwc->tmp > i->priority);
+				bwc->tmp += i->priority;
 			}
+			if (out != i) *out = std::move(*i);
+			++out;
 		}
+		m_queue.erase(out, m_queue.end());
 
-		for (auto const& ch : channels)
+		// for each bandwidth channel, call update_quota(dt)
+		for (auto const& ch : m_channels)
 		{
 			ch->update_quota(int(dt_milliseconds));
+			ch->round = 0;
 		}
+		m_channels.clear();
 
-		for (auto i = m_queue.begin(); i != m_queue.end();)
+		out = m_queue.begin();
+		for (auto i = m_queue.begin(); i != m_queue.end(); ++i)
 		{
 			int a = i->assign_bandwidth();
 			if (i->assigned == i->request_size
@@ -204,21 +212,24 @@ namespace aux {
 			{
 				a += i->request_size - i->assigned;
 				TORRENT_ASSERT(i->assigned <= i->request_size);
-				queue.push_back(std::move(*i));
-				i = m_queue.erase(i);
+				m_done.push_back(std::move(*i));
 			}
 			else
 			{
-				++i;
+				if (out != i) *out = std::move(*i);
+				++out;
 			}
 			m_queued_bytes -= a;
 		}
+		m_queue.erase(out, m_queue.end());
 
-		while (!queue.empty())
+		// the callbacks may request more bandwidth, which adds to m_queue, but
+		// never touches m_done
+		while (!m_done.empty())
 		{
-			bw_request& bwr = queue.back();
+			bw_request& bwr = m_done.back();
 			bwr.peer->assign_bandwidth(m_channel, bwr.assigned);
-			queue.pop_back();
+			m_done.pop_back();
 		}
 	}
 }
@@ -793,8 +793,7 @@ namespace aux {
 	int bdecode(char const* start, char const* end, bdecode_node& ret
 		, error_code& ec, int* error_pos, int const depth_limit, int token_limit)
 	{
-		ret = bdecode({start, end - start}, ec, error_pos, depth_limit, token_limit);
-		return ec ? -1 : 0;
+		return bdecode({start, end - start}, ret, ec, error_pos, depth_limit, token_limit);
 	}
 
 	bdecode_node bdecode(span<char const> buffer, int depth_limit, int token_limit)
@@ -809,13 +808,25 @@ namespace aux {
 		, error_code& ec, int* error_pos, int depth_limit, int token_limit)
 	{
 		bdecode_node ret;
+		bdecode(buffer, ret, ec, error_pos, depth_limit, token_limit);
+		return ret;
+	}
+
+	int bdecode(span<char const> buffer, bdecode_node& ret
+		, error_code& ec, int* error_pos, int depth_limit, int token_limit)
+	{
+		// reset the node, but hang on to the token buffer's capacity, to
+		// avoid re-allocating it when decoding into the same node again
+		ret.clear();
+		ret.m_buffer = nullptr;
+		ret.m_buffer_size = 0;
 		ec.clear();
 
 		if (buffer.size() > bdecode_token::max_offset)
 		{
 			if (error_pos) *error_pos = 0;
 			ec = bdecode_errors::limit_exceeded;
-			return ret;
+			return -1;
 		}
 
 		// this is the stack of bdecode_token indices, into m_tokens.
@@ -1026,7 +1037,7 @@ done:
 		ret.m_buffer_size = int(start - orig_start);
 		ret.m_root_tokens = ret.m_tokens.data();
 
-		return ret;
+		return ec ? -1 : 0;
 	}
 
 	namespace {
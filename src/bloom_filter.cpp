@@ -34,44 +34,106 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/bloom_filter.hpp"
 #include "libtorrent/aux_/numeric_cast.hpp"
 
+#include <cstring> // for memcpy()
+
 namespace libtorrent {
 
+namespace {
+
+	// the two bits a key sets, out of len * 8
+	std::uint32_t bit_index(std::uint8_t const* k, int const which, int const len)
+	{
+		std::uint32_t const idx = std::uint32_t(k[which * 2])
+			| (std::uint32_t(k[which * 2 + 1]) << 8);
+		return idx % aux::numeric_cast<std::uint32_t>(len * 8);
+	}
+
+	int popcount(std::uint64_t const v)
+	{
+#if defined __GNUC__ || defined __clang__
+		return __builtin_popcountll(v);
+#else
+		// from:
+		// http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+		std::uint64_t c = v - ((v >> 1) & 0x5555555555555555ULL);
+		c = (c & 0x3333333333333333ULL) + ((c >> 2) & 0x3333333333333333ULL);
+		c = (c + (c >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return int((c * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+}
+
 	bool has_bits(std::uint8_t const* k, std::uint8_t const* bits, int const len)
 	{
-		std::uint32_t idx1 = std::uint32_t(k[0]) | (std::uint32_t(k[1]) << 8);
-		std::uint32_t idx2 = std::uint32_t(k[2]) | (std::uint32_t(k[3]) << 8);
-		idx1 %= aux::numeric_cast<std::uint32_t>(len * 8);
-		idx2 %= aux::numeric_cast<std::uint32_t>(len * 8);
+		std::uint32_t const idx1 = bit_index(k, 0, len);
+		std::uint32_t const idx2 = bit_index(k, 1, len);
 		return (bits[idx1 / 8] & (1 << (idx1 & 7))) != 0
 			&& (bits[idx2 / 8] & (1 << (idx2 & 7))) != 0;
 	}
 
 	void set_bits(std::uint8_t const* k, std::uint8_t* bits, int const len)
 	{
-		std::uint32_t idx1 = std::uint32_t(k[0]) | (std::uint32_t(k[1]) << 8);
-		std::uint32_t idx2 = std::uint32_t(k[2]) | (std::uint32_t(k[3]) << 8);
-		idx1 %= aux::numeric_cast<std::uint32_t>(len * 8);
-		idx2 %= aux::numeric_cast<std::uint32_t>(len * 8);
+		std::uint32_t const idx1 = bit_index(k, 0, len);
+		std::uint32_t const idx2 = bit_index(k, 1, len);
 		bits[idx1 / 8] |= (1 << (idx1 & 7));
 		bits[idx2 / 8] |= (1 << (idx2 & 7));
 	}
 
 	int count_zero_bits(std::uint8_t const* bits, int const len)
 	{
-		// number of bits _not_ set in a nibble
-		std::uint8_t bitcount[16] =
-		{
-			// 0000, 0001, 0010, 0011, 0100, 0101, 0110, 0111,
-			// 1000, 1001, 1010, 1011, 1100, 1101, 1110, 1111
-			4, 3, 3, 2, 3, 2, 2, 1,
-			3, 2, 2, 1, 2, 1, 1, 0
-		};
 		int ret = 0;
-		for (int i = 0; i < len; ++i)
+		int i = 0;
+		// the filters are small multiples of 8 bytes, count a word at a time
+		for (; i + 8 <= len; i += 8)
 		{
-			ret += bitcount[bits[i] & 0xf];
-			ret += bitcount[(bits[i] >> 4) & 0xf];
+			std::uint64_t w;
+			std::memcpy(&w, bits + i, 8);
+			ret += 64 - popcount(w);
 		}
+		for (; i < len; ++i)
+			ret += 8 - popcount(bits[i]);
 		return ret;
 	}
+
+	void merge_bits(std::uint8_t* bits, std::uint8_t const* other, int const len)
+	{
+		// a plain loop over words, for the compiler to vectorize
+		int i = 0;
+		for (; i + 8 <= len; i += 8)
+		{
+			std::uint64_t a;
+			std::uint64_t b;
+			std::memcpy(&a, bits + i, 8);
+			std::memcpy(&b, other + i, 8);
+			a |= b;
+			std::memcpy(bits + i, &a, 8);
+		}
+		for (; i < len; ++i)
+			bits[i] |= other[i];
+	}
+
+	void add_counts(std::uint8_t const* k, std::uint8_t* counters
+		, std::uint8_t* bits, int const len)
+	{
+		for (int which = 0; which < 2; ++which)
+		{
+			std::uint32_t const idx = bit_index(k, which, len);
+			if (counters[idx] < 0xff) ++counters[idx];
+			bits[idx / 8] |= (1 << (idx & 7));
+		}
+	}
+
+	void remove_counts(std::uint8_t const* k, std::uint8_t* counters
+		, std::uint8_t* bits, int const len)
+	{
+		for (int which = 0; which < 2; ++which)
+		{
+			std::uint32_t const idx = bit_index(k, which, len);
+			TORRENT_ASSERT(counters[idx] > 0);
+			// once saturated, we no longer know how many keys set the bit
+			if (counters[idx] == 0 || counters[idx] == 0xff) continue;
+			if (--counters[idx] == 0)
+				bits[idx / 8] &= std::uint8_t(~(1 << (idx & 7)));
+		}
+	}
 }
@@ -36,6 +36,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/disk_job_fence.hpp"
 #include "libtorrent/aux_/mmap_disk_job.hpp"
 #include "libtorrent/performance_counters.hpp"
+#include "libtorrent/aux_/trace.hpp"
 
 #define DEBUG_STORAGE 0
 
@@ -65,6 +66,7 @@ namespace aux {
 
 			// the fence can now be lowered
 			--m_has_fence;
+			trace_instant("disk", "fence_lowered", int(m_blocked_jobs.size()));
 
 			// now we need to post all jobs that have been queued up
 			// while this fence was up. However, if there's another fence
@@ -157,6 +159,7 @@ namespace aux {
 		}
 
 		m_blocked_jobs.push_back(j);
+		trace_instant("disk", "fence_blocked", int(m_blocked_jobs.size()));
 
 #if TORRENT_USE_ASSERTS
 		TORRENT_ASSERT(j->blocked == false);
@@ -193,6 +196,7 @@ namespace aux {
 		if (m_has_fence == 0 && m_outstanding_jobs == 0)
 		{
 			++m_has_fence;
+			trace_instant("disk", "fence_raised", 0);
 			DLOG(stderr, "[%p] raise_fence: need posting\n"
 				, static_cast<void*>(this));
 
@@ -206,6 +210,7 @@ namespace aux {
 		}
 
 		++m_has_fence;
+		trace_instant("disk", "fence_raised", m_outstanding_jobs);
 #if TORRENT_USE_ASSERTS
 		TORRENT_ASSERT(j->blocked == false);
 		j->blocked = true;
@@ -114,11 +114,24 @@ constexpr aux::path_index_t aux::file_entry::path_is_absolute;
 
 namespace {
 
+#if TORRENT_ABI_VERSION == 1
 	bool compare_file_offset(aux::file_entry const& lhs
 		, aux::file_entry const& rhs)
 	{
 		return lhs.offset < rhs.offset;
 	}
+#endif
+
+	// returns the first file starting after ``offset``. This compares against
+	// the offset directly, rather than constructing a file_entry to compare
+	// with
+	aux::vector<aux::file_entry, file_index_t>::const_iterator file_after_offset(
+		aux::vector<aux::file_entry, file_index_t> const& files
+		, std::uint64_t const offset)
+	{
+		return std::upper_bound(files.begin(), files.end(), offset
+			, [](std::uint64_t const o, aux::file_entry const& fe) { return o < fe.offset; });
+	}
 
 }
 
@@ -127,13 +140,10 @@ namespace {
 		TORRENT_ASSERT_PRECOND(index >= piece_index_t{} && index < end_piece());
 		TORRENT_ASSERT(max_file_offset / piece_length() > static_cast<int>(index));
 		// find the file iterator and file offset
-		aux::file_entry target;
-		TORRENT_ASSERT(max_file_offset / piece_length() > static_cast<int>(index));
-		target.offset = aux::numeric_cast<std::uint64_t>(std::int64_t(piece_length()) * static_cast<int>(index));
-		TORRENT_ASSERT(!compare_file_offset(target, m_files.front()));
+		auto const offset = aux::numeric_cast<std::uint64_t>(std::int64_t(piece_length()) * static_cast<int>(index));
+		TORRENT_ASSERT(offset >= m_files.front().offset);
 
-		auto const file_iter = std::upper_bound(
-			m_files.begin(), m_files.end(), target, compare_file_offset);
+		auto const file_iter = file_after_offset(m_files, offset);
 
 		TORRENT_ASSERT(file_iter != m_files.begin());
 		if (file_iter == m_files.end()) return piece_size(index);
@@ -141,7 +151,7 @@ namespace {
 		// this static cast is safe because the resulting value is capped by
 		// piece_length(), which fits in an int
 		return static_cast<int>(
-			std::min(static_cast<std::uint64_t>(piece_length()), file_iter->offset - target.offset));
+			std::min(static_cast<std::uint64_t>(piece_length()), file_iter->offset - offset));
 	}
 
 	int file_storage::blocks_in_piece2(piece_index_t const index) const
@@ -201,25 +211,144 @@ namespace {
 		if (set_name) e.set_name(leaf);
 	}
 
-	aux::path_index_t file_storage::get_or_add_path(string_view const path)
+	aux::path_index_t file_storage::get_or_add_path(string_view path)
 	{
-		// do we already have this path in the path list?
-		auto const p = std::find(m_paths.rbegin(), m_paths.rend(), path);
+		TORRENT_ASSERT(path.size() == 0 || path[0] != '/');
 
-		if (p == m_paths.rend())
+		// add each path element as a directory in the tree
+		aux::path_index_t ret = aux::file_entry::no_path;
+		while (!path.empty())
 		{
-			// no, we don't. add it
-			auto const ret = m_paths.end_index();
-			TORRENT_ASSERT(path.size() == 0 || path[0] != '/');
-			m_paths.emplace_back(path.data(), path.size());
-			return ret;
+			string_view name;
+			std::tie(name, path) = lsplit_path(path);
+			if (name.empty()) continue;
+			ret = get_or_add_dir(ret, name);
 		}
-		else
+
+		// the empty path is the root directory of the torrent itself. It's
+		// represented by a directory with an empty name
+		if (ret == aux::file_entry::no_path)
+			ret = get_or_add_dir(aux::file_entry::no_path, {});
+		return ret;
+	}
+
+	namespace {
+
+	std::size_t dir_hash(aux::path_index_t const parent, string_view const name)
+	{
+		// FNV-1a
+		std::uint32_t h = 2166136261u;
+		for (char const c : name)
+		{
+			h ^= static_cast<std::uint8_t>(c);
+			h *= 16777619u;
+		}
+		return std::size_t(h ^ (static_cast<std::uint32_t>(parent) * 2654435761u));
+	}
+
+	}
+
+	std::size_t file_storage::find_dir_slot(aux::path_index_t const parent
+		, string_view const name) const
+	{
+		TORRENT_ASSERT(!m_path_lookup.empty());
+		std::size_t const mask = m_path_lookup.size() - 1;
+		std::size_t slot = dir_hash(parent, name) & mask;
+		for (;;)
+		{
+			aux::path_index_t const idx = m_path_lookup[slot];
+			if (idx == aux::file_entry::no_path) return slot;
+			if (m_paths[idx].parent == parent && dir_name(idx) == name) return slot;
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	void file_storage::grow_path_lookup()
+	{
+		std::vector<aux::path_index_t> lookup(
+			std::max(std::size_t(16), m_path_lookup.size() * 2), aux::file_entry::no_path);
+		m_path_lookup.swap(lookup);
+		for (auto const i : m_paths.range())
+			m_path_lookup[find_dir_slot(m_paths[i].parent, dir_name(i))] = i;
+	}
+
+	aux::path_index_t file_storage::get_or_add_dir(aux::path_index_t const parent
+		, string_view const name)
+	{
+		// keep the load factor of the hash table below 1/2
+		if (std::size_t(m_paths.size()) * 2 >= m_path_lookup.size())
+			grow_path_lookup();
+
+		std::size_t const slot = find_dir_slot(parent, name);
+		if (m_path_lookup[slot] != aux::file_entry::no_path)
+			return m_path_lookup[slot];
+
+		auto const ret = m_paths.end_index();
+		m_paths.push_back({parent, aux::numeric_cast<std::uint32_t>(m_path_segments.size())
+			, aux::numeric_cast<std::uint32_t>(name.size())});
+		m_path_segments.append(name.data(), name.size());
+		m_path_lookup[slot] = ret;
+		return ret;
+	}
+
+	aux::path_index_t file_storage::find_path(string_view path) const
+	{
+		if (m_path_lookup.empty()) return aux::file_entry::no_path;
+
+		aux::path_index_t ret = aux::file_entry::no_path;
+		while (!path.empty())
 		{
-			// yes we do. use it
-			return aux::path_index_t{aux::numeric_cast<std::uint32_t>(
-				p.base() - m_paths.begin() - 1)};
+			string_view name;
+			std::tie(name, path) = lsplit_path(path);
+			if (name.empty()) continue;
+			std::size_t const slot = find_dir_slot(ret, name);
+			ret = m_path_lookup[slot];
+			if (ret == aux::file_entry::no_path) return ret;
 		}
+		return ret;
+	}
+
+	string_view file_storage::dir_name(aux::path_index_t const idx) const
+	{
+		aux::directory_entry const& d = m_paths[idx];
+		return string_view(m_path_segments).substr(d.name_offset, d.name_len);
+	}
+
+	template <typename Fun>
+	void file_storage::for_each_dir_name(aux::path_index_t const idx, Fun const& f) const
+	{
+		aux::path_index_t const parent = m_paths[idx].parent;
+		if (parent != aux::file_entry::no_path) for_each_dir_name(parent, f);
+		f(dir_name(idx));
+	}
+
+	void file_storage::append_dir_path(std::string& out, aux::path_index_t const idx) const
+	{
+		for_each_dir_name(idx, [&out](string_view const name) { append_path(out, name); });
+	}
+
+	std::size_t file_storage::dir_path_size(aux::path_index_t idx) const
+	{
+		std::size_t ret = 0;
+		for (; idx != aux::file_entry::no_path; idx = m_paths[idx].parent)
+			ret += m_paths[idx].name_len + 1;
+		return ret;
+	}
+
+	aux::vector<std::string, aux::path_index_t> file_storage::paths() const
+	{
+		aux::vector<std::string, aux::path_index_t> ret;
+		ret.reserve(m_paths.size());
+		for (auto const i : m_paths.range())
+		{
+			// parents always come before their children
+			aux::path_index_t const parent = m_paths[i].parent;
+			TORRENT_ASSERT(parent == aux::file_entry::no_path || parent < i);
+			ret.push_back(parent == aux::file_entry::no_path
+				? std::string() : ret[parent]);
+			append_path(ret.back(), dir_name(i));
+		}
+		return ret;
 	}
 
 #if TORRENT_ABI_VERSION == 1
@@ -429,12 +558,7 @@ namespace aux {
 		TORRENT_ASSERT_PRECOND(offset < m_total_size);
 		TORRENT_ASSERT(offset <= max_file_offset);
 		// find the file iterator and file offset
-		aux::file_entry target;
-		target.offset = aux::numeric_cast<std::uint64_t>(offset);
-		TORRENT_ASSERT(!compare_file_offset(target, m_files.front()));
-
-		auto file_iter = std::upper_bound(
-			m_files.begin(), m_files.end(), target, compare_file_offset);
+		auto file_iter = file_after_offset(m_files, aux::numeric_cast<std::uint64_t>(offset));
 
 		TORRENT_ASSERT(file_iter != m_files.begin());
 		--file_iter;
@@ -487,23 +611,21 @@ namespace aux {
 		if (m_files.empty()) return ret;
 
 		// find the file iterator and file offset
-		aux::file_entry target;
 		TORRENT_ASSERT(max_file_offset / m_piece_length > static_cast<int>(piece));
-		target.offset = aux::numeric_cast<std::uint64_t>(static_cast<int>(piece) * std::int64_t(m_piece_length) + offset);
-		TORRENT_ASSERT_PRECOND(std::int64_t(target.offset) <= m_total_size - size);
-		TORRENT_ASSERT(!compare_file_offset(target, m_files.front()));
+		auto const target_offset = aux::numeric_cast<std::uint64_t>(static_cast<int>(piece) * std::int64_t(m_piece_length) + offset);
+		TORRENT_ASSERT_PRECOND(std::int64_t(target_offset) <= m_total_size - size);
+		TORRENT_ASSERT(target_offset >= m_files.front().offset);
 
 		// in case the size is past the end, fix it up
-		if (std::int64_t(target.offset) > m_total_size - size)
-			size = m_total_size - std::int64_t(target.offset);
+		if (std::int64_t(target_offset) > m_total_size - size)
+			size = m_total_size - std::int64_t(target_offset);
 
-		auto file_iter = std::upper_bound(
-			m_files.begin(), m_files.end(), target, compare_file_offset);
+		auto file_iter = file_after_offset(m_files, target_offset);
 
 		TORRENT_ASSERT(file_iter != m_files.begin());
 		--file_iter;
 
-		std::int64_t file_offset = target.offset - file_iter->offset;
+		std::int64_t file_offset = target_offset - file_iter->offset;
 		for (; size > 0; file_offset -= file_iter->size, ++file_iter)
 		{
 			TORRENT_ASSERT(file_iter != m_files.end());
@@ -879,20 +1001,6 @@ namespace {
 				crc.process_byte(to_lower(c) & 0xff);
 		}
 
-		template <class CRC>
-		void process_path_lowercase(
-			std::unordered_set<std::uint32_t>& table
-			, CRC crc, string_view str)
-		{
-			if (str.empty()) return;
-			for (char const c : str)
-			{
-				if (c == TORRENT_SEPARATOR)
-					table.insert(crc.checksum());
-				crc.process_byte(to_lower(c) & 0xff);
-			}
-			table.insert(crc.checksum());
-		}
 	}
 
 	void file_storage::all_path_hashes(
@@ -907,8 +1015,15 @@ namespace {
 			crc.process_byte(TORRENT_SEPARATOR);
 		}
 
-		for (auto const& p : m_paths)
-			process_path_lowercase(table, crc, p);
+		// paths() includes every parent directory, so there's no need to
+		// insert the prefixes of each path
+		for (auto const& p : paths())
+		{
+			if (p.empty()) continue;
+			auto path_crc = crc;
+			process_string_lowercase(path_crc, p);
+			table.insert(path_crc.checksum());
+		}
 	}
 
 	std::uint32_t file_storage::file_path_hash(file_index_t const index
@@ -918,6 +1033,13 @@ namespace {
 		aux::file_entry const& fe = m_files[index];
 
 		boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> crc;
+		auto const process_dir_name = [&crc](string_view const name)
+		{
+			// files directly under the root directory have an empty path
+			if (name.empty()) return;
+			process_string_lowercase(crc, name);
+			crc.process_byte(TORRENT_SEPARATOR);
+		};
 
 		if (fe.path_index == aux::file_entry::path_is_absolute)
 		{
@@ -941,13 +1063,7 @@ namespace {
 				TORRENT_ASSERT(save_path[save_path.size() - 1] != TORRENT_SEPARATOR);
 				crc.process_byte(TORRENT_SEPARATOR);
 			}
-			std::string const& p = m_paths[fe.path_index];
-			if (!p.empty())
-			{
-				process_string_lowercase(crc, p);
-				TORRENT_ASSERT(p[p.size() - 1] != TORRENT_SEPARATOR);
-				crc.process_byte(TORRENT_SEPARATOR);
-			}
+			for_each_dir_name(fe.path_index, process_dir_name);
 			process_string_lowercase(crc, fe.filename());
 		}
 		else
@@ -963,14 +1079,7 @@ namespace {
 			TORRENT_ASSERT(m_name[m_name.size() - 1] != TORRENT_SEPARATOR);
 			crc.process_byte(TORRENT_SEPARATOR);
 
-			std::string const& p = m_paths[fe.path_index];
-			if (!p.empty())
-			{
-				process_string_lowercase(crc, p);
-				TORRENT_ASSERT(p.size() > 0);
-				TORRENT_ASSERT(p[p.size() - 1] != TORRENT_SEPARATOR);
-				crc.process_byte(TORRENT_SEPARATOR);
-			}
+			for_each_dir_name(fe.path_index, process_dir_name);
 			process_string_lowercase(crc, fe.filename());
 		}
 
@@ -996,21 +1105,18 @@ namespace {
 		}
 		else if (fe.no_root_dir)
 		{
-			std::string const& p = m_paths[fe.path_index];
-
-			ret.reserve(save_path.size() + p.size() + fe.filename().size() + 2);
+			ret.reserve(save_path.size() + dir_path_size(fe.path_index) + fe.filename().size() + 1);
 			ret.assign(save_path);
-			append_path(ret, p);
+			append_dir_path(ret, fe.path_index);
 			append_path(ret, fe.filename());
 		}
 		else
 		{
-			std::string const& p = m_paths[fe.path_index];
-
-			ret.reserve(save_path.size() + m_name.size() + p.size() + fe.filename().size() + 3);
+			ret.reserve(save_path.size() + m_name.size() + dir_path_size(fe.path_index)
+				+ fe.filename().size() + 2);
 			ret.assign(save_path);
 			append_path(ret, m_name);
-			append_path(ret, p);
+			append_dir_path(ret, fe.path_index);
 			append_path(ret, fe.filename());
 		}
 
@@ -1027,9 +1133,8 @@ namespace {
 			&& fe.path_index != aux::file_entry::no_path)
 		{
 			std::string ret;
-			std::string const& p = m_paths[fe.path_index];
-			ret.reserve(p.size() + fe.filename().size() + 2);
-			append_path(ret, p);
+			ret.reserve(dir_path_size(fe.path_index) + fe.filename().size());
+			append_dir_path(ret, fe.path_index);
 			append_path(ret, fe.filename());
 			return ret;
 		}
@@ -1199,6 +1304,8 @@ namespace {
 		swap(ti.m_symlinks, m_symlinks);
 		swap(ti.m_mtime, m_mtime);
 		swap(ti.m_paths, m_paths);
+		swap(ti.m_path_segments, m_path_segments);
+		swap(ti.m_path_lookup, m_path_lookup);
 		swap(ti.m_name, m_name);
 		swap(ti.m_total_size, m_total_size);
 		swap(ti.m_num_pieces, m_num_pieces);
@@ -1227,17 +1334,20 @@ namespace {
 		// TODO: this would be more efficient if m_paths was sorted first, such
 		// that a lower path index always meant sorted-before
 
+		// assemble the directory paths once, rather than for every comparison
+		auto const dir_paths = paths();
+
 		// sort files by path/name
 		std::sort(new_order.begin(), new_order.end()
-			, [this](file_index_t l, file_index_t r)
+			, [this, &dir_paths](file_index_t l, file_index_t r)
 		{
 			// assuming m_paths are unqiue!
 			auto const& lf = m_files[l];
 			auto const& rf = m_files[r];
 			if (lf.path_index != rf.path_index)
 			{
-				int const ret = path_compare(m_paths[lf.path_index], lf.filename()
-					, m_paths[rf.path_index], rf.filename());
+				int const ret = path_compare(dir_paths[lf.path_index], lf.filename()
+					, dir_paths[rf.path_index], rf.filename());
 				if (ret != 0) return ret < 0;
 			}
 			return lf.filename() < rf.filename();
@@ -1315,11 +1425,6 @@ namespace {
 		std::unordered_map<std::string, file_index_t> file_map;
 		bool file_map_initialized = false;
 
-		// lazily instantiated set of all valid directories a symlink may point to
-		// TODO: in C++17 this could be string_view
-		std::unordered_set<std::string> dir_map;
-		bool dir_map_initialized = false;
-
 		// symbolic links that points to directories
 		std::unordered_map<std::string, std::string> dir_links;
 
@@ -1368,17 +1473,10 @@ namespace {
 					continue;
 				}
 
-				// it may point to a directory that doesn't have any files (but only
-				// other directories), in which case it won't show up in m_paths
-				if (!dir_map_initialized)
-				{
-					for (auto const& p : m_paths)
-						for (string_view pv = p; !pv.empty(); pv = rsplit_path(pv).first)
-							dir_map.insert(pv.to_string());
-					dir_map_initialized = true;
-				}
-
-				if (dir_map.count(target))
+				// it may point to a directory. m_paths holds every directory in
+				// the torrent, including ones with no files (but only other
+				// directories) in them
+				if (find_path(target) != aux::file_entry::no_path)
 				{
 					// it points to a sub directory within the torrent, that's OK
 					m_symlinks[fe.symlink_index] = target;
@@ -1392,20 +1490,12 @@ namespace {
 			// well
 			if (fe.path_index < aux::file_entry::path_is_absolute)
 			{
-				std::string target = m_paths[fe.path_index];
+				std::string target;
+				append_dir_path(target, fe.path_index);
 				append_path(target, m_symlinks[fe.symlink_index]);
 				// if it points to a directory, that's OK
-				auto const it = std::find(m_paths.begin(), m_paths.end(), target);
-				if (it != m_paths.end())
+				if (find_path(target) != aux::file_entry::no_path)
 				{
-					m_symlinks[fe.symlink_index] = *it;
-					dir_links[internal_file_path(i)] = *it;
-					continue;
-				}
-
-				if (dir_map.count(target))
-				{
-					// it points to a sub directory within the torrent, that's OK
 					m_symlinks[fe.symlink_index] = target;
 					dir_links[internal_file_path(i)] = target;
 					continue;
@@ -1456,7 +1546,7 @@ namespace {
 				branch = lsplit_path(target, branch.size() + 1).first)
 			{
 				// this is a concrete directory
-				if (dir_map.count(branch.to_string())) continue;
+				if (find_path(branch) != aux::file_entry::no_path) continue;
 
 				auto const iter = dir_links.find(branch.to_string());
 				if (iter == dir_links.end()) goto failed;
@@ -1474,7 +1564,7 @@ namespace {
 			// the final (resolved) target must be a valid file
 			// or directory
 			if (file_map.count(target) == 0
-				&& dir_map.count(target) == 0) goto failed;
+				&& find_path(target) == aux::file_entry::no_path) goto failed;
 
 			// this is OK
 			continue;
@@ -0,0 +1,176 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/aux_/handler_timer.hpp"
+#include "libtorrent/performance_counters.hpp"
+#include "libtorrent/assert.hpp"
+
+#include <algorithm> // for max
+
+#ifdef TORRENT_WINDOWS
+#include "libtorrent/aux_/windows.hpp"
+#else
+#include <ctime> // for clock_gettime
+#endif
+
+namespace libtorrent { namespace aux {
+
+namespace {
+
+	struct thread_state
+	{
+		handler_times times;
+
+		// the innermost timer currently running on this thread
+		handler_timer* current = nullptr;
+
+		// set on threads whose times are never drained
+		bool excluded = false;
+
+		// counts top-level timers, to decide which ones sample CPU time
+		int sample_counter = 0;
+	};
+
+	thread_local thread_state t_state;
+
+	char const* const category_names[] = {"peer_write", "peer_read", "udp"
+		, "tick", "abort", "defer", "utp", "submit", "session_call"
+		, "torrent_tick", "auto_manage", "dht", "tracker"};
+
+	static_assert(sizeof(category_names) / sizeof(category_names[0])
+		== num_handler_categories, "category_names out of sync with handler_category");
+
+	std::int64_t nanoseconds(std::chrono::steady_clock::duration d)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+	}
+
+	static_assert(counters::handler_wall_tracker - counters::handler_wall_peer_write
+		== num_handler_categories - 1, "handler_wall_* counters out of sync with handler_category");
+	static_assert(counters::handler_cpu_tracker - counters::handler_cpu_peer_write
+		== num_handler_categories - 1, "handler_cpu_* counters out of sync with handler_category");
+}
+
+	std::atomic<bool> g_handler_timers_enabled{false};
+
+	void set_handler_timers_enabled(bool const e)
+	{
+		g_handler_timers_enabled.store(e, std::memory_order_relaxed);
+	}
+
+	char const* handler_category_name(handler_category const c)
+	{
+		TORRENT_ASSERT(c < handler_category::num_categories);
+		return category_names[static_cast<int>(c)];
+	}
+
+	std::int64_t thread_cpu_time()
+	{
+#ifdef TORRENT_WINDOWS
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+			return -1;
+		// FILETIME is in units of 100 nanoseconds
+		auto const to_int = [](FILETIME const& ft)
+		{ return (std::int64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+		return (to_int(kernel) + to_int(user)) * 100;
+#elif defined CLOCK_THREAD_CPUTIME_ID
+		timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return -1;
+		return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+		return -1;
+#endif
+	}
+
+	void handler_timer::start(handler_category const c)
+	{
+		TORRENT_ASSERT(c < handler_category::num_categories);
+		if (t_state.excluded) return;
+		m_parent = t_state.current;
+		m_start = std::chrono::steady_clock::now();
+		m_category = c;
+
+		// nested timers sample CPU time if and only if the top-level one does
+		bool const sample = m_parent == nullptr
+			? ++t_state.sample_counter % handler_cpu_sample_interval == 0
+			: m_parent->m_start_cpu >= 0;
+		m_start_cpu = sample ? thread_cpu_time() : -1;
+		t_state.current = this;
+	}
+
+	void handler_timer::stop()
+	{
+		TORRENT_ASSERT(t_state.current == this);
+		t_state.current = m_parent;
+
+		int const idx = static_cast<int>(m_category);
+		std::int64_t const wall = nanoseconds(std::chrono::steady_clock::now() - m_start);
+		t_state.times.wall[idx] += std::max(std::int64_t(0), wall - m_child_wall);
+		if (m_parent) m_parent->m_child_wall += wall;
+
+		if (m_start_cpu < 0) return;
+		std::int64_t const end_cpu = thread_cpu_time();
+		if (end_cpu < 0) return;
+		std::int64_t const cpu = end_cpu - m_start_cpu;
+		t_state.times.cpu[idx] += std::max(std::int64_t(0), cpu - m_child_cpu)
+			* handler_cpu_sample_interval;
+		if (m_parent) m_parent->m_child_cpu += cpu;
+	}
+
+	void drain_handler_times(counters& c)
+	{
+		handler_times& t = t_state.times;
+		for (int i = 0; i < num_handler_categories; ++i)
+		{
+			// only move whole microseconds, the remainder is kept until the
+			// next call, to not lose short handlers to rounding
+			std::int64_t const wall = t.wall[i] / 1000;
+			std::int64_t const cpu = t.cpu[i] / 1000;
+			t.wall[i] -= wall * 1000;
+			t.cpu[i] -= cpu * 1000;
+			if (wall > 0) c.inc_stats_counter(counters::handler_wall_peer_write + i, wall);
+			if (cpu > 0) c.inc_stats_counter(counters::handler_cpu_peer_write + i, cpu);
+		}
+	}
+
+	void exclude_thread_from_handler_timers()
+	{
+		t_state.excluded = true;
+	}
+
+	handler_times const& current_handler_times()
+	{
+		return t_state.times;
+	}
+}}
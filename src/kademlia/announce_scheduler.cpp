@@ -0,0 +1,111 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/kademlia/announce_scheduler.hpp"
+#include "libtorrent/assert.hpp"
+
+#include <algorithm> // for min, max
+
+namespace libtorrent { namespace dht {
+
+namespace {
+
+	// the budget saved up while idle is capped at this many seconds worth of
+	// packets, to bound the burst when announces arrive
+	constexpr int max_burst = 5;
+}
+
+	bool announce_scheduler::add(request r)
+	{
+		auto const i = m_queue.find(r.info_hash);
+		if (i != m_queue.end())
+		{
+			i->second = queued{r.port, r.flags, std::move(r.callback)};
+			return false;
+		}
+		m_queue.emplace(r.info_hash, queued{r.port, r.flags, std::move(r.callback)});
+		return true;
+	}
+
+	void announce_scheduler::pop(time_point const now, int const rate
+		, int const traversals, std::vector<request>& out)
+	{
+		TORRENT_ASSERT(rate > 0);
+		std::int64_t const max_budget = std::int64_t(rate) * max_burst * 1000;
+
+		// budget is in thousandths of packets, which makes the refill
+		// simply the rate times the milliseconds elapsed
+		std::int64_t const elapsed = std::min(total_milliseconds(now - m_last_refill)
+			, std::int64_t(max_burst) * 1000);
+		m_last_refill = now;
+		if (elapsed > 0)
+			m_budget = std::min(m_budget + elapsed * rate, max_budget);
+
+		std::int64_t const cost = std::int64_t(m_cost) * std::max(traversals, 1) * 1000 / 256;
+		while (m_budget > 0 && !m_queue.empty())
+		{
+			auto i = m_queue.lower_bound(m_cursor);
+			if (i == m_queue.end()) i = m_queue.begin();
+
+			out.push_back(request{i->first, i->second.port, i->second.flags
+				, std::move(i->second.callback)});
+			m_cursor = i->first;
+			m_queue.erase(i);
+			m_budget -= cost;
+		}
+	}
+
+	void announce_scheduler::pop_all(std::vector<request>& out)
+	{
+		for (auto& q : m_queue)
+		{
+			out.push_back(request{q.first, q.second.port, q.second.flags
+				, std::move(q.second.callback)});
+		}
+		m_queue.clear();
+	}
+
+	void announce_scheduler::traversal_done(int const packets)
+	{
+		// exponential moving average, with a weight of 1/8 for every sample
+		m_cost += (std::max(packets, 1) * 256 - m_cost) / 8;
+	}
+
+	time_duration announce_scheduler::next_release(int const rate) const
+	{
+		TORRENT_ASSERT(rate > 0);
+		if (m_budget > 0) return milliseconds(0);
+		// the time until the budget turns positive again
+		return milliseconds(-m_budget / rate + 1);
+	}
+} }
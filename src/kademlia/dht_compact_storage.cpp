@@ -0,0 +1,1020 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/kademlia/dht_storage.hpp"
+#include "libtorrent/settings_pack.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libtorrent/socket_io.hpp>
+#include <libtorrent/aux_/time.hpp>
+#include <libtorrent/config.hpp>
+#include <libtorrent/bloom_filter.hpp>
+#include <libtorrent/random.hpp>
+#include <libtorrent/aux_/vector.hpp>
+#include <libtorrent/aux_/ip_helpers.hpp> // for is_v4
+#include <libtorrent/bdecode.hpp>
+
+namespace libtorrent { namespace dht {
+namespace {
+
+	constexpr std::uint32_t invalid_index = 0xffffffff;
+
+	// announced peers are dropped once they're older than 1.5 announce
+	// intervals, like in the default storage
+	constexpr std::uint32_t peer_lifetime_minutes = 45;
+
+	// the number of one-minute buckets in the expiry wheel. It must be
+	// greater than peer_lifetime_minutes
+	constexpr std::uint32_t wheel_size = 64;
+	static_assert(wheel_size > peer_lifetime_minutes, "expiry wheel too small");
+
+	constexpr int sample_infohashes_interval_max = 21600;
+	constexpr int infohashes_sample_count_max = 20;
+
+	// a peer packed into its address bytes, port and a 16 bit stamp. The low
+	// 15 bits of the stamp are the minute the peer announced, the top bit is
+	// set for seeds
+	template <typename Bytes>
+	struct packed_peer
+	{
+		Bytes ip;
+		std::uint16_t port;
+		std::uint16_t stamp;
+
+		bool seed() const { return (stamp & 0x8000) != 0; }
+		std::uint32_t age(std::uint32_t const now) const
+		{ return (now - stamp) & 0x7fff; }
+	};
+
+	using peer4 = packed_peer<address_v4::bytes_type>;
+	using peer6 = packed_peer<address_v6::bytes_type>;
+	static_assert(sizeof(peer4) == 8, "unexpected padding in peer4");
+	static_assert(sizeof(peer6) == 20, "unexpected padding in peer6");
+
+	template <typename Bytes>
+	bool operator<(packed_peer<Bytes> const& lhs, packed_peer<Bytes> const& rhs)
+	{
+		return lhs.ip == rhs.ip ? lhs.port < rhs.port : lhs.ip < rhs.ip;
+	}
+
+	void pack_address(address const& a, peer4& p) { p.ip = a.to_v4().to_bytes(); }
+	void pack_address(address const& a, peer6& p) { p.ip = a.to_v6().to_bytes(); }
+	address unpack_address(peer4 const& p) { return address_v4(p.ip); }
+	address unpack_address(peer6 const& p) { return address_v6(p.ip); }
+
+	// the members every record stored in a record_table has
+	struct table_entry
+	{
+		sha1_hash key;
+		// the neighbours in the list ordered by last use. For records not
+		// in use, next links the free list
+		std::uint32_t prev = invalid_index;
+		std::uint32_t next = invalid_index;
+		bool in_use = false;
+	};
+
+	struct torrent_record : table_entry
+	{
+		// the minute the most recently added peer announced in. The torrent
+		// was added to this minute's bucket in the expiry wheel
+		std::uint32_t last_announce = invalid_index;
+		std::uint8_t name_len = 0;
+		std::unique_ptr<char[]> name;
+		// sorted by address and port
+		std::vector<peer4> peers4;
+		std::vector<peer6> peers6;
+	};
+
+	struct item_record : table_entry
+	{
+		// the minute of the most recent put
+		std::uint32_t last_seen = 0;
+		// number of IPs in the bloom filter
+		int num_announcers = 0;
+		// size of malloced space pointed to by value
+		int size = 0;
+		// the IPs we've seen putting this item
+		bloom_filter<128> ips;
+		std::unique_ptr<char[]> value;
+	};
+
+	struct mutable_record : item_record
+	{
+		signature sig{};
+		sequence_number seq{};
+		public_key pk{};
+		std::string salt;
+	};
+
+	// the bytes owned by a record, outside of the record itself
+	std::int64_t payload(torrent_record const& t)
+	{
+		return std::int64_t(t.peers4.capacity() * sizeof(peer4)
+			+ t.peers6.capacity() * sizeof(peer6)) + t.name_len;
+	}
+	std::int64_t payload(item_record const& i) { return i.size; }
+	std::int64_t payload(mutable_record const& i)
+	{ return std::int64_t(i.size) + std::int64_t(i.salt.size()); }
+
+	// records keyed by a 160 bit hash. The records live in a pool and are
+	// found through an open addressing index with linear probing. Erasing
+	// uses backward shift deletion, so the index never has tombstones. The
+	// records in use are also linked in a list ordered by last use, to find
+	// the least recently used one in constant time.
+	template <typename Record>
+	struct record_table
+	{
+		record_table()
+			: m_seed((std::uint64_t(random(0xffffffff)) << 32) | random(0xffffffff))
+		{}
+
+		std::uint32_t find(sha1_hash const& key) const
+		{
+			if (m_slots.empty()) return invalid_index;
+			std::uint32_t const h = hash_key(key);
+			std::uint32_t const mask = std::uint32_t(m_slots.size() - 1);
+			for (std::uint32_t i = h & mask;; i = (i + 1) & mask)
+			{
+				slot const& s = m_slots[i];
+				if (s.index == invalid_index) return invalid_index;
+				if (s.hash == h && m_records[s.index].key == key) return s.index;
+			}
+		}
+
+		// the key must not already be in the table. The new record is the
+		// most recently used one
+		std::uint32_t insert(sha1_hash const& key)
+		{
+			TORRENT_ASSERT(find(key) == invalid_index);
+			if (std::size_t(m_size + 1) * 2 > m_slots.size()) grow();
+
+			std::uint32_t idx;
+			if (m_free != invalid_index)
+			{
+				idx = m_free;
+				m_free = m_records[idx].next;
+			}
+			else
+			{
+				idx = std::uint32_t(m_records.size());
+				m_records.emplace_back();
+			}
+
+			Record& r = m_records[idx];
+			r.key = key;
+			r.in_use = true;
+			link_front(idx);
+			place(hash_key(key), idx);
+			++m_size;
+			return idx;
+		}
+
+		void erase(std::uint32_t const idx)
+		{
+			Record& r = m_records[idx];
+			TORRENT_ASSERT(r.in_use);
+			std::uint32_t const mask = std::uint32_t(m_slots.size() - 1);
+			std::uint32_t i = hash_key(r.key) & mask;
+			while (m_slots[i].index != idx) i = (i + 1) & mask;
+
+			// move back every following entry of the probe sequence that
+			// doesn't have its home slot between the hole and itself
+			for (std::uint32_t j = (i + 1) & mask; m_slots[j].index != invalid_index
+				; j = (j + 1) & mask)
+			{
+				std::uint32_t const home = m_slots[j].hash & mask;
+				if (((j - home) & mask) < ((j - i) & mask)) continue;
+				m_slots[i] = m_slots[j];
+				i = j;
+			}
+			m_slots[i] = slot{};
+
+			unlink(idx);
+			r = Record();
+			r.next = m_free;
+			m_free = idx;
+			--m_size;
+		}
+
+		// make the record the most recently used one
+		void touch(std::uint32_t const idx)
+		{
+			if (m_head == idx) return;
+			unlink(idx);
+			link_front(idx);
+		}
+
+		std::uint32_t oldest() const { return m_tail; }
+		std::uint32_t newest() const { return m_head; }
+
+		Record& operator[](std::uint32_t const idx) { return m_records[idx]; }
+		Record const& operator[](std::uint32_t const idx) const { return m_records[idx]; }
+
+		int size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		// the number of records in the pool, including the ones not in use
+		std::uint32_t pool_size() const { return std::uint32_t(m_records.size()); }
+
+		// the memory used by the index and the records in use
+		std::int64_t memory() const
+		{
+			return std::int64_t(m_slots.size() * sizeof(slot))
+				+ std::int64_t(m_size) * std::int64_t(sizeof(Record));
+		}
+
+	private:
+
+		struct slot
+		{
+			std::uint32_t hash = 0;
+			std::uint32_t index = invalid_index;
+		};
+
+		// the keys are chosen by other nodes, so mix in a seed to make it hard
+		// to pick keys that collide
+		std::uint32_t hash_key(sha1_hash const& key) const
+		{
+			std::uint64_t h = m_seed;
+			for (int i = 0; i < 5; ++i)
+			{
+				std::uint32_t w;
+				std::memcpy(&w, key.data() + i * 4, 4);
+				h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+			}
+			return std::uint32_t(h >> 32);
+		}
+
+		void place(std::uint32_t const h, std::uint32_t const idx)
+		{
+			std::uint32_t const mask = std::uint32_t(m_slots.size() - 1);
+			std::uint32_t i = h & mask;
+			while (m_slots[i].index != invalid_index) i = (i + 1) & mask;
+			m_slots[i].hash = h;
+			m_slots[i].index = idx;
+		}
+
+		void grow()
+		{
+			std::vector<slot> old(std::max(std::size_t(16), m_slots.size() * 2));
+			old.swap(m_slots);
+			for (slot const& s : old)
+				if (s.index != invalid_index) place(s.hash, s.index);
+		}
+
+		void link_front(std::uint32_t const idx)
+		{
+			Record& r = m_records[idx];
+			r.prev = invalid_index;
+			r.next = m_head;
+			if (m_head != invalid_index) m_records[m_head].prev = idx;
+			else m_tail = idx;
+			m_head = idx;
+		}
+
+		void unlink(std::uint32_t const idx)
+		{
+			Record& r = m_records[idx];
+			if (r.prev != invalid_index) m_records[r.prev].next = r.next;
+			else m_head = r.next;
+			if (r.next != invalid_index) m_records[r.next].prev = r.prev;
+			else m_tail = r.prev;
+			r.prev = invalid_index;
+			r.next = invalid_index;
+		}
+
+		std::vector<slot> m_slots;
+		std::vector<Record> m_records;
+		std::uint32_t m_free = invalid_index;
+		std::uint32_t m_head = invalid_index;
+		std::uint32_t m_tail = invalid_index;
+		int m_size = 0;
+		std::uint64_t const m_seed;
+	};
+
+	void set_value(item_record& item, span<char const> buf)
+	{
+		int const size = int(buf.size());
+		if (item.size != size)
+		{
+			item.value.reset(new char[std::size_t(size)]);
+			item.size = size;
+		}
+		std::copy(buf.begin(), buf.end(), item.value.get());
+	}
+
+	// returns true if the peer was added, false if it replaced an existing
+	// entry for the same endpoint or if the torrent is full
+	template <typename Peer>
+	bool add_peer(std::vector<Peer>& peers, tcp::endpoint const& endp
+		, std::uint32_t const now, bool const seed, int const max_peers)
+	{
+		Peer p;
+		pack_address(endp.address(), p);
+		p.port = endp.port();
+		p.stamp = std::uint16_t((now & 0x7fff) | (seed ? 0x8000 : 0));
+
+		auto const i = std::lower_bound(peers.begin(), peers.end(), p);
+		if (i != peers.end() && i->ip == p.ip && i->port == p.port)
+		{
+			*i = p;
+			return false;
+		}
+		// we're at capacity, drop the announce
+		if (int(peers.size()) >= max_peers) return false;
+		peers.insert(i, p);
+		return true;
+	}
+
+	// returns the number of peers removed
+	template <typename Peer>
+	int purge_peers(std::vector<Peer>& peers, std::uint32_t const now)
+	{
+		auto const new_end = std::remove_if(peers.begin(), peers.end()
+			, [=](Peer const& p) { return p.age(now) > peer_lifetime_minutes; });
+		int const removed = int(peers.end() - new_end);
+		peers.erase(new_end, peers.end());
+		// if we're using less than 1/4 of the capacity free up the excess
+		if (peers.capacity() / std::max(peers.size(), std::size_t(1)) >= 4U)
+			peers.shrink_to_fit();
+		return removed;
+	}
+
+	struct infohashes_sample
+	{
+		aux::vector<sha1_hash> samples;
+		time_point created = min_time();
+
+		int count() const { return int(samples.size()); }
+	};
+
+	class dht_compact_storage final : public dht_storage_interface
+	{
+	public:
+
+		explicit dht_compact_storage(settings_interface const& settings)
+			: m_settings(settings)
+			, m_epoch(aux::time_now() - minutes(peer_lifetime_minutes))
+		{
+			m_counters.reset();
+		}
+
+		~dht_compact_storage() override = default;
+
+		dht_compact_storage(dht_compact_storage const&) = delete;
+		dht_compact_storage& operator=(dht_compact_storage const&) = delete;
+
+#if TORRENT_ABI_VERSION == 1
+		size_t num_torrents() const override { return std::size_t(m_torrents.size()); }
+		size_t num_peers() const override { return std::size_t(m_counters.peers); }
+#endif
+
+		// eviction is by last use, the node IDs are not needed
+		void update_node_ids(std::vector<node_id> const&) override {}
+
+		bool get_peers(sha1_hash const& info_hash
+			, bool const noseed, bool const scrape, address const& requester
+			, entry& peers) const override
+		{
+			std::uint32_t const idx = m_torrents.find(info_hash);
+			if (idx == invalid_index) return false;
+
+			torrent_record const& t = m_torrents[idx];
+			if (t.name_len > 0) peers["n"] = std::string(t.name.get(), t.name_len);
+
+			return requester.is_v4()
+				? get_peers_impl(t.peers4, noseed, scrape, requester, peers)
+				: get_peers_impl(t.peers6, noseed, scrape, requester, peers);
+		}
+
+		void announce_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool const seed) override
+		{
+			std::uint32_t const now = now_minute();
+			expire_peers(now);
+			add_torrent_peer(info_hash, endp, name, seed, now);
+		}
+
+		void restore_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool const seed, time_duration const age) override
+		{
+			std::uint32_t const now = now_minute();
+			expire_peers(now);
+			std::int64_t const age_minutes = std::max(
+				std::int64_t(std::chrono::duration_cast<minutes>(age).count()), std::int64_t(0));
+			if (age_minutes > peer_lifetime_minutes) return;
+			// the wheel only has buckets from m_wheel_minute on. The clock
+			// starts at peer_lifetime_minutes, so this only clamps the age
+			// once peers from that long ago have been expired
+			std::uint32_t const minute = now - std::min(std::uint32_t(age_minutes)
+				, now - m_wheel_minute);
+			add_torrent_peer(info_hash, endp, name, seed, minute);
+		}
+
+		bool get_immutable_item(sha1_hash const& target
+			, entry& item) const override
+		{
+			std::uint32_t const idx = m_immutable_table.find(target);
+			if (idx == invalid_index) return false;
+
+			item_record const& f = m_immutable_table[idx];
+			error_code ec;
+			item["v"] = bdecode({f.value.get(), f.size}, ec);
+			return true;
+		}
+
+		void put_immutable_item(sha1_hash const& target
+			, span<char const> buf
+			, address const& addr) override
+		{
+			std::uint32_t idx = m_immutable_table.find(target);
+			if (idx == invalid_index)
+			{
+				int const max_items = m_settings.get_int(settings_pack::dht_max_dht_items);
+				if (max_items <= 0) return;
+				while (m_immutable_table.size() >= max_items)
+				{
+					erase_item(m_immutable_table, m_immutable_table.oldest());
+					m_counters.immutable_data -= 1;
+				}
+
+				idx = m_immutable_table.insert(target);
+				set_value(m_immutable_table[idx], buf);
+				m_payload += payload(m_immutable_table[idx]);
+				m_counters.immutable_data += 1;
+			}
+
+			touch_item(m_immutable_table, idx, addr);
+			enforce_memory_limit();
+		}
+
+		bool get_mutable_item_seq(sha1_hash const& target
+			, sequence_number& seq) const override
+		{
+			std::uint32_t const idx = m_mutable_table.find(target);
+			if (idx == invalid_index) return false;
+
+			seq = m_mutable_table[idx].seq;
+			return true;
+		}
+
+		bool get_mutable_item(sha1_hash const& target
+			, sequence_number const seq, bool const force_fill
+			, entry& item) const override
+		{
+			std::uint32_t const idx = m_mutable_table.find(target);
+			if (idx == invalid_index) return false;
+
+			mutable_record const& f = m_mutable_table[idx];
+			item["seq"] = f.seq.value;
+			if (force_fill || (sequence_number(0) <= seq && seq < f.seq))
+			{
+				error_code ec;
+				item["v"] = bdecode({f.value.get(), f.size}, ec);
+				item["sig"] = f.sig.bytes;
+				item["k"] = f.pk.bytes;
+			}
+			return true;
+		}
+
+		void put_mutable_item(sha1_hash const& target
+			, span<char const> buf
+			, signature const& sig
+			, sequence_number const seq
+			, public_key const& pk
+			, span<char const> salt
+			, address const& addr) override
+		{
+			std::uint32_t idx = m_mutable_table.find(target);
+			if (idx == invalid_index)
+			{
+				int const max_items = m_settings.get_int(settings_pack::dht_max_dht_items);
+				if (max_items <= 0) return;
+				while (m_mutable_table.size() >= max_items)
+				{
+					erase_item(m_mutable_table, m_mutable_table.oldest());
+					m_counters.mutable_data -= 1;
+				}
+
+				idx = m_mutable_table.insert(target);
+				mutable_record& item = m_mutable_table[idx];
+				set_value(item, buf);
+				item.seq = seq;
+				item.salt.assign(salt.begin(), salt.end());
+				item.sig = sig;
+				item.pk = pk;
+				m_payload += payload(item);
+				m_counters.mutable_data += 1;
+			}
+			else
+			{
+				mutable_record& item = m_mutable_table[idx];
+				if (item.seq < seq)
+				{
+					std::int64_t const before = payload(item);
+					set_value(item, buf);
+					item.seq = seq;
+					item.sig = sig;
+					m_payload += payload(item) - before;
+				}
+			}
+
+			touch_item(m_mutable_table, idx, addr);
+			enforce_memory_limit();
+		}
+
+		int get_infohashes_sample(entry& item) override
+		{
+			item["interval"] = aux::clamp(m_settings.get_int(settings_pack::dht_sample_infohashes_interval)
+				, 0, sample_infohashes_interval_max);
+			item["num"] = m_torrents.size();
+
+			refresh_infohashes_sample();
+
+			aux::vector<sha1_hash> const& samples = m_infohashes_sample.samples;
+			item["samples"] = span<char const>(
+				reinterpret_cast<char const*>(samples.data()), static_cast<std::ptrdiff_t>(samples.size()) * 20);
+
+			return m_infohashes_sample.count();
+		}
+
+		// peers are expired as the expiry wheel turns, this only has to visit
+		// the torrents announced to 45 minutes ago, and the items at the old
+		// end of the item lists
+		void tick() override
+		{
+			std::uint32_t const now = now_minute();
+			expire_peers(now);
+
+			if (0 == m_settings.get_int(settings_pack::dht_item_lifetime)) return;
+
+			// item lifetime must >= 120 minutes.
+			std::uint32_t const lifetime = std::max(std::uint32_t(120)
+				, std::uint32_t(m_settings.get_int(settings_pack::dht_item_lifetime) / 60));
+
+			while (!m_immutable_table.empty()
+				&& m_immutable_table[m_immutable_table.oldest()].last_seen + lifetime <= now)
+			{
+				erase_item(m_immutable_table, m_immutable_table.oldest());
+				m_counters.immutable_data -= 1;
+			}
+
+			while (!m_mutable_table.empty()
+				&& m_mutable_table[m_mutable_table.oldest()].last_seen + lifetime <= now)
+			{
+				erase_item(m_mutable_table, m_mutable_table.oldest());
+				m_counters.mutable_data -= 1;
+			}
+		}
+
+		dht_storage_counters counters() const override
+		{
+			return m_counters;
+		}
+
+		// the position is the kind of record to continue with, and the index
+		// in its pool. Pool indices are stable, records never move
+		void visit(dht_storage_visitor& v
+			, dht_storage_position& pos, int const count) const override
+		{
+			std::uint32_t const now = now_minute();
+			int visited = 0;
+
+			if (pos.kind == 0)
+			{
+				for (; pos.index < m_torrents.pool_size() && visited < count; ++pos.index)
+				{
+					torrent_record const& t = m_torrents[pos.index];
+					if (!t.in_use) continue;
+					v.torrent(t.key, {t.name.get(), t.name_len});
+					for (auto const& p : t.peers4)
+					{
+						v.peer(tcp::endpoint(unpack_address(p), p.port), p.seed()
+							, minutes(p.age(now)));
+					}
+					for (auto const& p : t.peers6)
+					{
+						v.peer(tcp::endpoint(unpack_address(p), p.port), p.seed()
+							, minutes(p.age(now)));
+					}
+					++visited;
+				}
+				if (pos.index < m_torrents.pool_size()) return;
+				pos.kind = 1;
+				pos.index = 0;
+			}
+
+			if (pos.kind == 1)
+			{
+				for (; pos.index < m_immutable_table.pool_size() && visited < count; ++pos.index)
+				{
+					item_record const& i = m_immutable_table[pos.index];
+					if (!i.in_use) continue;
+					v.immutable_item(i.key, {i.value.get(), i.size});
+					++visited;
+				}
+				if (pos.index < m_immutable_table.pool_size()) return;
+				pos.kind = 2;
+				pos.index = 0;
+			}
+
+			if (pos.kind == 2)
+			{
+				for (; pos.index < m_mutable_table.pool_size() && visited < count; ++pos.index)
+				{
+					mutable_record const& i = m_mutable_table[pos.index];
+					if (!i.in_use) continue;
+					v.mutable_item(i.key, {i.value.get(), i.size}
+						, i.sig, i.seq, i.pk, i.salt);
+					++visited;
+				}
+				if (pos.index < m_mutable_table.pool_size()) return;
+			}
+			pos.done = true;
+		}
+
+	private:
+		settings_interface const& m_settings;
+		dht_storage_counters m_counters;
+
+		// minutes are counted from here. It's peer_lifetime_minutes before the
+		// storage was created, to leave room for restoring older peers
+		time_point const m_epoch;
+
+		record_table<torrent_record> m_torrents;
+		record_table<item_record> m_immutable_table;
+		record_table<mutable_record> m_mutable_table;
+
+		// bucket m % wheel_size holds the torrents announced to in minute m.
+		// Once minute m is older than the peer lifetime, those torrents are
+		// purged. A torrent may be in several buckets, and an index may
+		// refer to a torrent that's been erased since (or a new torrent
+		// reusing the record), purging those is harmless
+		std::array<std::vector<std::uint32_t>, wheel_size> m_wheel;
+		// the next minute whose bucket has not been purged yet
+		std::uint32_t m_wheel_minute = 0;
+		std::int64_t m_wheel_entries = 0;
+
+		// the bytes owned by records, outside of the tables. Peer lists,
+		// names, item values and salts
+		std::int64_t m_payload = 0;
+
+		infohashes_sample m_infohashes_sample;
+
+		std::uint32_t now_minute() const
+		{
+			return std::uint32_t(std::chrono::duration_cast<minutes>(
+				aux::time_now() - m_epoch).count());
+		}
+
+		template <typename Peer>
+		bool get_peers_impl(std::vector<Peer> const& peersv
+			, bool const noseed, bool const scrape, address const& requester
+			, entry& peers) const
+		{
+			if (scrape)
+			{
+				bloom_filter<256> downloaders;
+				bloom_filter<256> seeds;
+
+				for (auto const& p : peersv)
+				{
+					sha1_hash const iphash = hash_address(unpack_address(p));
+					if (p.seed()) seeds.set(iphash);
+					else downloaders.set(iphash);
+				}
+
+				peers["BFpe"] = downloaders.to_string();
+				peers["BFsd"] = seeds.to_string();
+			}
+			else
+			{
+				int to_pick = m_settings.get_int(settings_pack::dht_max_peers_reply);
+				TORRENT_ASSERT(to_pick >= 0);
+				// if these are IPv6 peers their addresses are 4x the size of IPv4
+				// so reduce the max peers 4 fold to compensate
+				if (!peersv.empty() && !requester.is_v4())
+					to_pick /= 4;
+				entry::list_type& pe = peers["values"].list();
+
+				int candidates = int(std::count_if(peersv.begin(), peersv.end()
+					, [=](Peer const& e) { return !(noseed && e.seed()); }));
+
+				to_pick = std::min(to_pick, candidates);
+
+				for (auto iter = peersv.begin(); to_pick > 0; ++iter)
+				{
+					// if the node asking for peers is a seed, skip seeds from the
+					// peer list
+					if (noseed && iter->seed()) continue;
+
+					TORRENT_ASSERT(candidates >= to_pick);
+
+					// pick this peer with probability
+					// <peers left to pick> / <peers left in the set>
+					if (random(std::uint32_t(candidates--)) > std::uint32_t(to_pick))
+						continue;
+
+					pe.emplace_back();
+					std::string& str = pe.back().string();
+
+					str.resize(18);
+					std::string::iterator out = str.begin();
+					aux::write_endpoint(tcp::endpoint(unpack_address(*iter), iter->port), out);
+					str.resize(std::size_t(out - str.begin()));
+
+					--to_pick;
+				}
+			}
+
+			if (int(peersv.size()) < m_settings.get_int(settings_pack::dht_max_peers))
+				return false;
+
+			// we're at the max peers stored for this torrent
+			// only send a write token if the requester is already in the set
+			// only check for a match on IP because the peer may be announcing
+			// a different port than the one it is using to send DHT messages
+			Peer requester_entry{};
+			pack_address(requester, requester_entry);
+			auto const requester_iter = std::lower_bound(peersv.begin(), peersv.end()
+				, requester_entry);
+			return requester_iter == peersv.end()
+				|| requester_iter->ip != requester_entry.ip;
+		}
+
+		// stores a peer that announced in ``minute``, which must not be
+		// before m_wheel_minute
+		void add_torrent_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool const seed, std::uint32_t const minute)
+		{
+			TORRENT_ASSERT(minute >= m_wheel_minute);
+			std::uint32_t idx = m_torrents.find(info_hash);
+			if (idx == invalid_index)
+			{
+				// a new torrent always fits, by evicting the least recently
+				// announced one
+				int const max_torrents = m_settings.get_int(settings_pack::dht_max_torrents);
+				if (max_torrents <= 0) return;
+				while (m_torrents.size() >= max_torrents)
+					erase_torrent(m_torrents.oldest());
+
+				idx = m_torrents.insert(info_hash);
+				m_counters.torrents += 1;
+			}
+			else
+			{
+				m_torrents.touch(idx);
+			}
+
+			torrent_record& t = m_torrents[idx];
+			std::int64_t const before = payload(t);
+
+			// the peer announces a torrent name, and we don't have a name
+			// for this torrent. Store it.
+			if (!name.empty() && t.name_len == 0)
+			{
+				std::size_t const len = std::min(name.size(), std::size_t(100));
+				t.name.reset(new char[len]);
+				std::memcpy(t.name.get(), name.data(), len);
+				t.name_len = std::uint8_t(len);
+			}
+
+			int const max_peers = m_settings.get_int(settings_pack::dht_max_peers);
+			bool const added = aux::is_v4(endp)
+				? add_peer(t.peers4, endp, minute, seed, max_peers)
+				: add_peer(t.peers6, endp, minute, seed, max_peers);
+			if (added) m_counters.peers += 1;
+
+			// the torrent needs to be looked at when this minute's peers expire
+			if (t.last_announce != minute)
+			{
+				m_wheel[minute % wheel_size].push_back(idx);
+				++m_wheel_entries;
+				t.last_announce = minute;
+			}
+
+			m_payload += payload(t) - before;
+			enforce_memory_limit();
+		}
+
+		void expire_peers(std::uint32_t const now)
+		{
+			while (m_wheel_minute + peer_lifetime_minutes < now)
+			{
+				auto& bucket = m_wheel[m_wheel_minute % wheel_size];
+				for (std::uint32_t const idx : bucket)
+				{
+					if (idx >= m_torrents.pool_size() || !m_torrents[idx].in_use)
+						continue;
+					torrent_record& t = m_torrents[idx];
+					std::int64_t const before = payload(t);
+					m_counters.peers -= purge_peers(t.peers4, now);
+					m_counters.peers -= purge_peers(t.peers6, now);
+					m_payload += payload(t) - before;
+
+					// if there are no more peers, remove the entry altogether
+					if (t.peers4.empty() && t.peers6.empty())
+						erase_torrent(idx);
+				}
+				m_wheel_entries -= std::int64_t(bucket.size());
+				bucket.clear();
+				++m_wheel_minute;
+			}
+		}
+
+		void erase_torrent(std::uint32_t const idx)
+		{
+			torrent_record const& t = m_torrents[idx];
+			m_payload -= payload(t);
+			m_counters.peers -= std::int32_t(t.peers4.size() + t.peers6.size());
+			m_counters.torrents -= 1;
+			m_torrents.erase(idx);
+		}
+
+		template <typename Record>
+		void erase_item(record_table<Record>& table, std::uint32_t const idx)
+		{
+			m_payload -= payload(table[idx]);
+			table.erase(idx);
+		}
+
+		template <typename Record>
+		void touch_item(record_table<Record>& table, std::uint32_t const idx
+			, address const& addr)
+		{
+			table.touch(idx);
+			Record& f = table[idx];
+			f.last_seen = now_minute();
+
+			// maybe increase num_announcers if we haven't seen this IP before
+			sha1_hash const iphash = hash_address(addr);
+			if (!f.ips.find(iphash))
+			{
+				f.ips.set(iphash);
+				++f.num_announcers;
+			}
+		}
+
+		std::int64_t memory_used() const
+		{
+			return std::int64_t(sizeof(*this))
+				+ m_torrents.memory() + m_immutable_table.memory() + m_mutable_table.memory()
+				+ m_wheel_entries * std::int64_t(sizeof(std::uint32_t))
+				+ m_payload;
+		}
+
+		// evict the torrent or item that has gone the longest without an
+		// announce or put until we're within the memory limit
+		void enforce_memory_limit()
+		{
+			std::int64_t const limit = std::int64_t(
+				m_settings.get_int(settings_pack::dht_storage_memory_limit)) * 1024;
+			if (limit <= 0) return;
+
+			while (memory_used() > limit)
+			{
+				std::uint32_t const t = m_torrents.oldest();
+				std::uint32_t const i = m_immutable_table.oldest();
+				std::uint32_t const m = m_mutable_table.oldest();
+				std::uint32_t const t_last = t == invalid_index ? invalid_index
+					: m_torrents[t].last_announce;
+				std::uint32_t const i_last = i == invalid_index ? invalid_index
+					: m_immutable_table[i].last_seen;
+				std::uint32_t const m_last = m == invalid_index ? invalid_index
+					: m_mutable_table[m].last_seen;
+
+				if (t != invalid_index && t_last <= i_last && t_last <= m_last)
+				{
+					erase_torrent(t);
+				}
+				else if (i != invalid_index && i_last <= m_last)
+				{
+					erase_item(m_immutable_table, i);
+					m_counters.immutable_data -= 1;
+				}
+				else if (m != invalid_index)
+				{
+					erase_item(m_mutable_table, m);
+					m_counters.mutable_data -= 1;
+				}
+				else
+				{
+					break;
+				}
+			}
+		}
+
+		void refresh_infohashes_sample()
+		{
+			time_point const now = aux::time_now();
+			int const interval = aux::clamp(m_settings.get_int(settings_pack::dht_sample_infohashes_interval)
+				, 0, sample_infohashes_interval_max);
+
+			int const max_count = aux::clamp(m_settings.get_int(settings_pack::dht_max_infohashes_sample_count)
+				, 0, infohashes_sample_count_max);
+			int const count = std::min(max_count, m_torrents.size());
+
+			if (interval > 0
+				&& m_infohashes_sample.created + seconds(interval) > now
+				&& m_infohashes_sample.count() >= max_count)
+				return;
+
+			aux::vector<sha1_hash>& samples = m_infohashes_sample.samples;
+			samples.clear();
+			samples.reserve(count);
+
+			// with many torrents, pick random records from the pool rather
+			// than walking all of them. The pool may have unused records, so
+			// give up after a while and fall back to the walk
+			if (count * 4 <= m_torrents.size())
+			{
+				std::uint32_t const pool = m_torrents.pool_size();
+				for (int attempts = count * 8; attempts > 0 && samples.end_index() < count; --attempts)
+				{
+					std::uint32_t const idx = random(pool - 1);
+					if (!m_torrents[idx].in_use) continue;
+					sha1_hash const& ih = m_torrents[idx].key;
+					if (std::find(samples.begin(), samples.end(), ih) != samples.end()) continue;
+					samples.push_back(ih);
+				}
+				if (samples.end_index() == count)
+				{
+					m_infohashes_sample.created = now;
+					return;
+				}
+				samples.clear();
+			}
+
+			int to_pick = count;
+			int candidates = m_torrents.size();
+
+			for (std::uint32_t idx = m_torrents.newest(); idx != invalid_index
+				; idx = m_torrents[idx].next)
+			{
+				if (to_pick == 0)
+					break;
+
+				TORRENT_ASSERT(candidates >= to_pick);
+
+				// pick this key with probability
+				// <keys left to pick> / <keys left in the set>
+				if (random(std::uint32_t(candidates--)) > std::uint32_t(to_pick))
+					continue;
+
+				samples.push_back(m_torrents[idx].key);
+				--to_pick;
+			}
+
+			TORRENT_ASSERT(int(samples.size()) == count);
+			m_infohashes_sample.created = now;
+		}
+	};
+}
+
+std::unique_ptr<dht_storage_interface> dht_compact_storage_constructor(
+	settings_interface const& settings)
+{
+	return std::make_unique<dht_compact_storage>(settings);
+}
+
+} } // namespace libtorrent::dht
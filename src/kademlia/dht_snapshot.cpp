@@ -0,0 +1,298 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/kademlia/dht_snapshot.hpp"
+#include "libtorrent/io.hpp"
+#include "libtorrent/socket_io.hpp"
+#include "libtorrent/aux_/time.hpp"
+
+#include <algorithm>
+#include <cstring> // for memcmp
+#include <iterator>
+
+namespace libtorrent { namespace dht {
+
+namespace {
+
+	char const magic[4] = {'L', 'T', 'd', 's'};
+	constexpr std::uint8_t version = 2;
+	constexpr int header_size = 13;
+	constexpr int record_header_size = 5;
+
+	enum record_type : std::uint8_t
+	{
+		node_record = 1,
+		torrent_record = 2,
+		immutable_record = 3,
+		mutable_record = 4
+	};
+
+	// nodes not queried in this many seconds aren't restored
+	constexpr std::int64_t max_node_age = 2 * 60 * 60;
+
+	// peers announced this many seconds ago have expired, the default
+	// storage's peer lifetime
+	constexpr std::int64_t max_peer_age = 45 * 60;
+
+	template <typename Endpoint, typename OutIt>
+	void write_endpoint(Endpoint const& ep, OutIt& out)
+	{
+		aux::write_uint8(ep.address().is_v4() ? 4 : 6, out);
+		aux::write_endpoint(ep, out);
+	}
+
+	template <typename Endpoint>
+	bool read_endpoint(span<char const>& buf, Endpoint& ep)
+	{
+		if (buf.empty()) return false;
+		int const family = std::uint8_t(buf[0]);
+		int const size = family == 4 ? 6 : family == 6 ? 18 : -1;
+		if (size < 0 || buf.size() < size + 1) return false;
+		char const* ptr = buf.data() + 1;
+		ep = family == 4
+			? aux::read_v4_endpoint<Endpoint>(ptr)
+			: aux::read_v6_endpoint<Endpoint>(ptr);
+		buf = buf.subspan(size + 1);
+		return true;
+	}
+
+	bool read_node(span<char const> rec, std::int64_t const snapshot_age
+		, std::vector<node_entry>& nodes)
+	{
+		if (rec.size() < 27) return false;
+		node_id const id(rec.data());
+		char const* ptr = rec.data() + 20;
+		int const rtt = aux::read_uint16(ptr);
+		std::int64_t const age = aux::read_uint32(ptr) + snapshot_age;
+		std::uint8_t const timeouts = aux::read_uint8(ptr);
+		rec = rec.subspan(27);
+		udp::endpoint ep;
+		if (!read_endpoint(rec, ep)) return false;
+		if (age > max_node_age) return true;
+
+		node_entry e(id, ep, rtt, true);
+		e.last_queried = aux::time_now32() - seconds32(std::int32_t(age));
+		e.timeout_count = timeouts;
+		nodes.push_back(e);
+		return true;
+	}
+
+	bool read_torrent(span<char const> rec, std::int64_t const now
+		, dht_storage_interface& storage)
+	{
+		if (rec.size() < 21) return false;
+		sha1_hash const info_hash(rec.data());
+		int const name_len = std::uint8_t(rec[20]);
+		if (rec.size() < 21 + name_len) return false;
+		string_view const name(rec.data() + 21, std::size_t(name_len));
+		rec = rec.subspan(21 + name_len);
+		while (!rec.empty())
+		{
+			if (rec.size() < 5) return false;
+			char const* ptr = rec.data();
+			bool const seed = aux::read_uint8(ptr) != 0;
+			std::int64_t const age = std::max(now - std::int64_t(aux::read_uint32(ptr))
+				, std::int64_t(0));
+			rec = rec.subspan(5);
+			tcp::endpoint ep;
+			if (!read_endpoint(rec, ep)) return false;
+			if (age > max_peer_age) continue;
+			storage.restore_peer(info_hash, ep, name, seed, seconds(age));
+		}
+		return true;
+	}
+
+	bool read_mutable_item(span<char const> rec, dht_storage_interface& storage)
+	{
+		if (rec.size() < 125) return false;
+		sha1_hash const target(rec.data());
+		public_key const pk(rec.data() + 20);
+		signature const sig(rec.data() + 52);
+		char const* ptr = rec.data() + 116;
+		sequence_number const seq(aux::read_int64(ptr));
+		int const salt_len = aux::read_uint8(ptr);
+		if (rec.size() < 125 + salt_len) return false;
+		span<char const> const salt = rec.subspan(125, salt_len);
+		span<char const> const value = rec.subspan(125 + salt_len);
+		storage.put_mutable_item(target, value, sig, seq, pk, salt, address());
+		return true;
+	}
+} // anonymous namespace
+
+	void snapshot_writer::header()
+	{
+		flush();
+		m_out.append(magic, sizeof(magic));
+		auto out = std::back_inserter(m_out);
+		aux::write_uint8(version, out);
+		aux::write_int64(m_now, out);
+	}
+
+	void snapshot_writer::begin_record(std::uint8_t const type)
+	{
+		flush();
+		m_open = m_out.size();
+		auto out = std::back_inserter(m_out);
+		aux::write_uint8(type, out);
+		aux::write_uint32(0, out);
+	}
+
+	void snapshot_writer::flush()
+	{
+		if (m_open == std::string::npos) return;
+		std::uint32_t const size = std::uint32_t(m_out.size() - m_open - record_header_size);
+		char* ptr = &m_out[m_open + 1];
+		aux::write_uint32(size, ptr);
+		m_open = std::string::npos;
+	}
+
+	void snapshot_writer::node(node_entry const& n, time_point const now)
+	{
+		begin_record(node_record);
+		auto out = std::back_inserter(m_out);
+		std::copy(n.id.begin(), n.id.end(), out);
+		aux::write_uint16(n.rtt, out);
+		// nodes that were never queried are saved with the maximum age, and
+		// won't be restored
+		std::int64_t const age = n.last_queried == (time_point32::min)()
+			? 0xffffffff
+			: std::min(std::max(total_seconds(now - n.last_queried), std::int64_t(0))
+				, std::int64_t(0xffffffff));
+		aux::write_uint32(std::uint32_t(age), out);
+		aux::write_uint8(n.timeout_count, out);
+		write_endpoint(n.ep(), out);
+	}
+
+	void snapshot_writer::append(string_view const records)
+	{
+		flush();
+		m_out.append(records.data(), records.size());
+	}
+
+	void snapshot_writer::torrent(sha1_hash const& info_hash, string_view name)
+	{
+		begin_record(torrent_record);
+		name = name.substr(0, 0xff);
+		auto out = std::back_inserter(m_out);
+		std::copy(info_hash.begin(), info_hash.end(), out);
+		aux::write_uint8(name.size(), out);
+		m_out.append(name.data(), name.size());
+	}
+
+	void snapshot_writer::peer(tcp::endpoint const& ep, bool const seed
+		, time_duration const age)
+	{
+		TORRENT_ASSERT(m_open != std::string::npos);
+		auto out = std::back_inserter(m_out);
+		aux::write_uint8(seed ? 1 : 0, out);
+		aux::write_uint32(std::uint32_t(m_now - total_seconds(age)), out);
+		write_endpoint(ep, out);
+	}
+
+	void snapshot_writer::immutable_item(sha1_hash const& target
+		, span<char const> const value)
+	{
+		begin_record(immutable_record);
+		auto out = std::back_inserter(m_out);
+		std::copy(target.begin(), target.end(), out);
+		m_out.append(value.data(), std::size_t(value.size()));
+	}
+
+	void snapshot_writer::mutable_item(sha1_hash const& target
+		, span<char const> const value
+		, signature const& sig
+		, sequence_number const seq
+		, public_key const& pk
+		, span<char const> salt)
+	{
+		begin_record(mutable_record);
+		salt = salt.first(std::min(salt.size(), std::ptrdiff_t(0xff)));
+		auto out = std::back_inserter(m_out);
+		std::copy(target.begin(), target.end(), out);
+		std::copy(pk.bytes.begin(), pk.bytes.end(), out);
+		std::copy(sig.bytes.begin(), sig.bytes.end(), out);
+		aux::write_int64(seq.value, out);
+		aux::write_uint8(salt.size(), out);
+		m_out.append(salt.data(), std::size_t(salt.size()));
+		m_out.append(value.data(), std::size_t(value.size()));
+	}
+
+	bool read_snapshot(span<char const> buf, std::int64_t const now
+		, std::vector<node_entry>& nodes, dht_storage_interface& storage)
+	{
+		if (buf.size() < header_size
+			|| std::memcmp(buf.data(), magic, sizeof(magic)) != 0)
+			return false;
+
+		char const* ptr = buf.data() + sizeof(magic);
+		if (aux::read_uint8(ptr) != version) return false;
+		std::int64_t const snapshot_age = std::max(now - aux::read_int64(ptr)
+			, std::int64_t(0));
+		buf = buf.subspan(header_size);
+
+		while (!buf.empty())
+		{
+			if (buf.size() < record_header_size) return false;
+			ptr = buf.data();
+			std::uint8_t const type = aux::read_uint8(ptr);
+			std::uint32_t const size = aux::read_uint32(ptr);
+			if (std::size_t(buf.size() - record_header_size) < size) return false;
+			span<char const> const rec = buf.subspan(record_header_size, std::ptrdiff_t(size));
+			buf = buf.subspan(record_header_size + std::ptrdiff_t(size));
+
+			bool ok = true;
+			switch (type)
+			{
+				case node_record:
+					ok = read_node(rec, snapshot_age, nodes);
+					break;
+				case torrent_record:
+					ok = read_torrent(rec, now, storage);
+					break;
+				case immutable_record:
+					if (rec.size() < 20) return false;
+					storage.put_immutable_item(sha1_hash(rec.data())
+						, rec.subspan(20), address());
+					break;
+				case mutable_record:
+					ok = read_mutable_item(rec, storage);
+					break;
+				default:
+					// a record type from a later version, skip it
+					break;
+			}
+			if (!ok) return false;
+		}
+		return true;
+	}
+} }
@@ -98,6 +98,9 @@ namespace {
 		nodes.shrink_to_fit();
 		nodes6.clear();
 		nodes6.shrink_to_fit();
+
+		snapshot.clear();
+		snapshot.shrink_to_fit();
 	}
 
 	dht_state read_dht_state(bdecode_node const& e)
@@ -112,6 +115,7 @@ namespace {
 			ret.nodes = aux::read_endpoint_list<udp::endpoint>(nodes);
 		if (bdecode_node const nodes = e.dict_find_list("nodes6"))
 			ret.nodes6 = aux::read_endpoint_list<udp::endpoint>(nodes);
+		ret.snapshot = e.dict_find_string_value("snapshot").to_string();
 		return ret;
 	}
 
@@ -130,6 +134,7 @@ namespace {
 		if (!nodes.list().empty()) ret["nodes"] = nodes;
 		entry const nodes6 = save_nodes(state.nodes6);
 		if (!nodes6.list().empty()) ret["nodes6"] = nodes6;
+		if (!state.snapshot.empty()) ret["snapshot"] = state.snapshot;
 		return ret;
 	}
 }}
@@ -42,6 +42,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <utility>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 
@@ -76,12 +77,42 @@ namespace {
 			: lhs.addr.address() < rhs.addr.address();
 	}
 
+	// the BEP 33 scrape filters of one address family of a torrent. They're
+	// kept up to date as peers come and go, for torrents with enough peers
+	// that building them for every scrape would be expensive
+	struct scrape_filters
+	{
+		counting_bloom_filter<256> downloaders;
+		counting_bloom_filter<256> seeds;
+	};
+
+	// the number of peers (of one address family) a torrent needs to have its
+	// scrape filters maintained. They're dropped again when it falls below
+	// half of this
+	constexpr int scrape_filter_peers = 64;
+
+	void add_peer_to(scrape_filters& f, peer_entry const& p)
+	{
+		sha1_hash const iphash = hash_address(p.addr.address());
+		if (p.seed) f.seeds.add(iphash);
+		else f.downloaders.add(iphash);
+	}
+
+	void remove_peer_from(scrape_filters& f, peer_entry const& p)
+	{
+		sha1_hash const iphash = hash_address(p.addr.address());
+		if (p.seed) f.seeds.remove(iphash);
+		else f.downloaders.remove(iphash);
+	}
+
 	// this is a group. It contains a set of group members
 	struct torrent_entry
 	{
 		std::string name;
 		std::vector<peer_entry> peers4;
 		std::vector<peer_entry> peers6;
+		std::unique_ptr<scrape_filters> scrape4;
+		std::unique_ptr<scrape_filters> scrape6;
 	};
 
 	// TODO: 2 make this configurable in dht_settings
@@ -182,6 +213,11 @@ namespace {
 	constexpr int sample_infohashes_interval_max = 21600;
 	constexpr int infohashes_sample_count_max = 20;
 
+	// the positions filled in by visit() hold the map to continue with, and
+	// the key of the next entry in it. Looking the key up again with
+	// lower_bound() makes them survive changes to the maps
+	enum : int { visit_torrents, visit_immutable, visit_mutable };
+
 	struct infohashes_sample
 	{
 		aux::vector<sha1_hash> samples;
@@ -229,10 +265,16 @@ namespace {
 
 			torrent_entry const& v = i->second;
 			auto const& peersv = requester.is_v4() ? v.peers4 : v.peers6;
+			auto const& filters = requester.is_v4() ? v.scrape4 : v.scrape6;
 
 			if (!v.name.empty()) peers["n"] = v.name;
 
-			if (scrape)
+			if (scrape && filters)
+			{
+				peers["BFpe"] = filters->downloaders.to_string();
+				peers["BFsd"] = filters->seeds.to_string();
+			}
+			else if (scrape)
 			{
 				bloom_filter<256> downloaders;
 				bloom_filter<256> seeds;
@@ -307,52 +349,14 @@ namespace {
 			, tcp::endpoint const& endp
 			, string_view name, bool const seed) override
 		{
-			auto const ti = m_map.find(info_hash);
-			torrent_entry* v;
-			if (ti == m_map.end())
-			{
-				if (int(m_map.size()) >= m_settings.get_int(settings_pack::dht_max_torrents))
-				{
-					// we're at capacity, drop the announce
-					return;
-				}
-
-				m_counters.torrents += 1;
-				v = &m_map[info_hash];
-			}
-			else
-			{
-				v = &ti->second;
-			}
-
-			// the peer announces a torrent name, and we don't have a name
-			// for this torrent. Store it.
-			if (!name.empty() && v->name.empty())
-			{
-				v->name = name.substr(0, 100).to_string();
-			}
-
-			auto& peersv = aux::is_v4(endp) ? v->peers4 : v->peers6;
+			add_peer(info_hash, endp, name, seed, aux::time_now());
+		}
 
-			peer_entry peer;
-			peer.addr = endp;
-			peer.added = aux::time_now();
-			peer.seed = seed;
-			auto i = std::lower_bound(peersv.begin(), peersv.end(), peer);
-			if (i != peersv.end() && i->addr == endp)
-			{
-				*i = peer;
-			}
-			else if (int(peersv.size()) >= m_settings.get_int(settings_pack::dht_max_peers))
-			{
-				// we're at capacity, drop the announce
-				return;
-			}
-			else
-			{
-				peersv.insert(i, peer);
-				m_counters.peers += 1;
-			}
+		void restore_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool const seed, time_duration const age) override
+		{
+			add_peer(info_hash, endp, name, seed, aux::time_now() - age);
 		}
 
 		bool get_immutable_item(sha1_hash const& target
@@ -497,8 +501,8 @@ namespace {
 			for (auto i = m_map.begin(), end(m_map.end()); i != end;)
 			{
 				torrent_entry& t = i->second;
-				purge_peers(t.peers4);
-				purge_peers(t.peers6);
+				purge_peers(t.peers4, t.scrape4);
+				purge_peers(t.peers6, t.scrape6);
 
 				if (!t.peers4.empty() || !t.peers6.empty())
 				{
@@ -546,6 +550,65 @@ namespace {
 			return m_counters;
 		}
 
+		void visit(dht_storage_visitor& v
+			, dht_storage_position& pos, int const count) const override
+		{
+			int visited = 0;
+			time_point const now = aux::time_now();
+
+			if (pos.kind == visit_torrents)
+			{
+				auto i = m_map.lower_bound(pos.key);
+				for (; i != m_map.end() && visited < count; ++i, ++visited)
+				{
+					v.torrent(i->first, i->second.name);
+					for (auto const& p : i->second.peers4) v.peer(p.addr, p.seed, now - p.added);
+					for (auto const& p : i->second.peers6) v.peer(p.addr, p.seed, now - p.added);
+				}
+				if (i != m_map.end())
+				{
+					pos.key = i->first;
+					return;
+				}
+				pos.kind = visit_immutable;
+				pos.key.clear();
+			}
+
+			if (pos.kind == visit_immutable)
+			{
+				auto i = m_immutable_table.lower_bound(pos.key);
+				for (; i != m_immutable_table.end() && visited < count; ++i, ++visited)
+				{
+					v.immutable_item(i->first
+						, {i->second.value.get(), i->second.size});
+				}
+				if (i != m_immutable_table.end())
+				{
+					pos.key = i->first;
+					return;
+				}
+				pos.kind = visit_mutable;
+				pos.key.clear();
+			}
+
+			if (pos.kind == visit_mutable)
+			{
+				auto i = m_mutable_table.lower_bound(pos.key);
+				for (; i != m_mutable_table.end() && visited < count; ++i, ++visited)
+				{
+					dht_mutable_item const& item = i->second;
+					v.mutable_item(i->first, {item.value.get(), item.size}
+						, item.sig, item.seq, item.key, item.salt);
+				}
+				if (i != m_mutable_table.end())
+				{
+					pos.key = i->first;
+					return;
+				}
+			}
+			pos.done = true;
+		}
+
 	private:
 		settings_interface const& m_settings;
 		dht_storage_counters m_counters;
@@ -557,17 +620,90 @@ namespace {
 
 		infohashes_sample m_infohashes_sample;
 
-		void purge_peers(std::vector<peer_entry>& peers)
+		// stores a peer that announced at ``added``
+		void add_peer(sha1_hash const& info_hash
+			, tcp::endpoint const& endp
+			, string_view name, bool const seed, time_point const added)
+		{
+			auto const ti = m_map.find(info_hash);
+			torrent_entry* v;
+			if (ti == m_map.end())
+			{
+				if (int(m_map.size()) >= m_settings.get_int(settings_pack::dht_max_torrents))
+				{
+					// we're at capacity, drop the announce
+					return;
+				}
+
+				m_counters.torrents += 1;
+				v = &m_map[info_hash];
+			}
+			else
+			{
+				v = &ti->second;
+			}
+
+			// the peer announces a torrent name, and we don't have a name
+			// for this torrent. Store it.
+			if (!name.empty() && v->name.empty())
+			{
+				v->name = name.substr(0, 100).to_string();
+			}
+
+			auto& peersv = aux::is_v4(endp) ? v->peers4 : v->peers6;
+			auto& filters = aux::is_v4(endp) ? v->scrape4 : v->scrape6;
+
+			peer_entry peer;
+			peer.addr = endp;
+			peer.added = added;
+			peer.seed = seed;
+			auto i = std::lower_bound(peersv.begin(), peersv.end(), peer);
+			if (i != peersv.end() && i->addr == endp)
+			{
+				if (filters && i->seed != seed)
+				{
+					remove_peer_from(*filters, *i);
+					add_peer_to(*filters, peer);
+				}
+				*i = peer;
+			}
+			else if (int(peersv.size()) >= m_settings.get_int(settings_pack::dht_max_peers))
+			{
+				// we're at capacity, drop the announce
+				return;
+			}
+			else
+			{
+				peersv.insert(i, peer);
+				m_counters.peers += 1;
+
+				if (filters)
+				{
+					add_peer_to(*filters, peer);
+				}
+				else if (int(peersv.size()) >= scrape_filter_peers)
+				{
+					filters.reset(new scrape_filters);
+					for (auto const& p : peersv) add_peer_to(*filters, p);
+				}
+			}
+		}
+
+		void purge_peers(std::vector<peer_entry>& peers
+			, std::unique_ptr<scrape_filters>& filters)
 		{
 			auto now = aux::time_now();
 			auto new_end = std::remove_if(peers.begin(), peers.end()
-				, [=](peer_entry const& e)
+				, [&](peer_entry const& e)
 			{
-				return e.added + announce_interval * 3 / 2 < now;
+				if (e.added + announce_interval * 3 / 2 >= now) return false;
+				if (filters) remove_peer_from(*filters, e);
+				return true;
 			});
 
 			m_counters.peers -= std::int32_t(std::distance(new_end, peers.end()));
 			peers.erase(new_end, peers.end());
+			if (int(peers.size()) < scrape_filter_peers / 2) filters.reset();
 			// if we're using less than 1/4 of the capacity free up the excess
 			if (!peers.empty() && peers.capacity() / peers.size() >= 4U)
 				peers.shrink_to_fit();
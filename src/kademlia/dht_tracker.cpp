@@ -43,15 +43,18 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <libtorrent/kademlia/msg.hpp>
 #include <libtorrent/kademlia/dht_observer.hpp>
 #include <libtorrent/kademlia/dht_settings.hpp>
+#include <libtorrent/kademlia/dht_snapshot.hpp>
 
 #include <libtorrent/bencode.hpp>
-#include <libtorrent/version.hpp>
 #include <libtorrent/time.hpp>
 #include <libtorrent/performance_counters.hpp> // for counters
 #include <libtorrent/aux_/time.hpp>
 #include <libtorrent/session_status.hpp>
 #include <libtorrent/aux_/ip_helpers.hpp> // for is_v6
 
+#include <ctime> // for time
+#include <limits>
+
 #ifndef TORRENT_DISABLE_LOGGING
 #include <libtorrent/hex.hpp> // to_hex
 #endif
@@ -66,14 +69,23 @@ namespace libtorrent { namespace dht {
 	auto const key_refresh
 		= duration_cast<time_duration>(minutes(5));
 
+	// the number of torrents and items added to the storage snapshot every
+	// refresh_timeout() (every 5 seconds), when snapshots are enabled
+	constexpr int snapshot_slice = 10000;
+
+	// the crawler's info-hashes are passed on when there are this many, or
+	// once a second
+	constexpr int crawl_batch_size = 1000;
+
 	void add_dht_counters(node const& dht, counters& c)
 	{
-		int nodes, replacements, allocated_observers;
-		std::tie(nodes, replacements, allocated_observers) = dht.get_stats_counters();
+		int nodes, replacements, allocated_observers, transactions;
+		std::tie(nodes, replacements, allocated_observers, transactions) = dht.get_stats_counters();
 
 		c.inc_stats_counter(counters::dht_nodes, nodes);
 		c.inc_stats_counter(counters::dht_node_cache, replacements);
 		c.inc_stats_counter(counters::dht_allocated_observers, allocated_observers);
+		c.inc_stats_counter(counters::dht_transactions_in_flight, transactions);
 	}
 
 	std::vector<udp::endpoint> concat(std::vector<udp::endpoint> const& v1
@@ -96,13 +108,18 @@ namespace libtorrent { namespace dht {
 		, dht_storage_interface& storage
 		, dht_state&& state)
 		: m_counters(cnt)
-		, m_storage(storage)
+		, m_locked_storage(settings.get_int(settings_pack::dht_worker_threads) > 0
+			? std::make_unique<locked_dht_storage>(storage)
+			: std::unique_ptr<locked_dht_storage>())
+		, m_storage(m_locked_storage ? *m_locked_storage : storage)
 		, m_state(std::move(state))
 		, m_send_fun(std::move(send_fun))
 		, m_log(observer)
 		, m_key_refresh_timer(ios)
 		, m_refresh_timer(ios)
 		, m_settings(settings)
+		, m_announce_timer(ios)
+		, m_crawl_timer(ios)
 		, m_running(false)
 		, m_host_resolver(ios)
 		, m_send_quota(settings.get_int(settings_pack::dht_upload_rate_limit))
@@ -111,6 +128,21 @@ namespace libtorrent { namespace dht {
 	{
 		m_blocker.set_block_timer(m_settings.get_int(settings_pack::dht_block_timeout));
 		m_blocker.set_rate_limit(m_settings.get_int(settings_pack::dht_block_ratelimit));
+
+		if (!m_state.snapshot.empty())
+		{
+			// the storage is filled right away, the nodes are added as the
+			// sockets are opened
+			bool const ok = read_snapshot(m_state.snapshot, std::time(nullptr)
+				, m_snapshot_nodes, m_storage);
+#ifndef TORRENT_DISABLE_LOGGING
+			m_log->log(dht_logger::tracker, "restored snapshot%s: %d nodes %d torrents"
+				, ok ? "" : " (truncated)", int(m_snapshot_nodes.size())
+				, m_storage.counters().torrents);
+#else
+			TORRENT_UNUSED(ok);
+#endif
+		}
 	}
 
 	void dht_tracker::update_node_id(aux::listen_socket_handle const& s)
@@ -119,6 +151,7 @@ namespace libtorrent { namespace dht {
 		if (n != m_nodes.end())
 			n->second.dht.update_node_id();
 		update_storage_node_ids();
+		publish_nodes();
 	}
 
 	void dht_tracker::new_socket(aux::listen_socket_handle const& s)
@@ -135,7 +168,16 @@ namespace libtorrent { namespace dht {
 			, std::bind(&dht_tracker::get_node, this, _1, _2)
 			, m_storage));
 
+		// nodes of the other address family are rejected by the routing table
+		if (n.second)
+		{
+			for (auto const& e : m_snapshot_nodes)
+				n.first->second.dht.m_table.restore_node(e);
+			n.first->second.dht.set_signature_verifier(m_verifier.get());
+		}
+
 		update_storage_node_ids();
+		publish_nodes();
 
 #ifndef TORRENT_DISABLE_LOGGING
 		if (m_log->should_log(dht_logger::tracker))
@@ -169,6 +211,7 @@ namespace libtorrent { namespace dht {
 		m_nodes.erase(s);
 
 		update_storage_node_ids();
+		publish_nodes();
 	}
 
 	void dht_tracker::start(find_data::nodes_callback const& f)
@@ -195,6 +238,40 @@ namespace libtorrent { namespace dht {
 		m_refresh_timer.async_wait(std::bind(&dht_tracker::refresh_timeout, self(), _1));
 
 		m_state.clear();
+		m_snapshot_nodes.clear();
+		m_snapshot_nodes.shrink_to_fit();
+
+		int const threads = m_settings.get_int(settings_pack::dht_worker_threads);
+		if (m_locked_storage && threads > 0)
+		{
+			// the workers call this from their threads, whenever they have
+			// replies ready to be sent
+			std::weak_ptr<dht_tracker> weak_self = self();
+			io_context& ioc = m_ioc;
+			auto wake = [weak_self, &ioc] {
+				post(ioc, [weak_self] {
+					if (auto t = weak_self.lock()) t->drain_workers();
+				});
+			};
+			m_workers = std::make_unique<dht_worker_pool>(threads, m_settings
+				, m_counters, m_storage, m_log, this, std::move(wake));
+			publish_nodes();
+		}
+
+		int const verify_threads = m_settings.get_int(settings_pack::dht_verify_threads);
+		if (verify_threads > 0)
+		{
+			std::weak_ptr<dht_tracker> weak_self = self();
+			io_context& ioc = m_ioc;
+			auto wake = [weak_self, &ioc] {
+				post(ioc, [weak_self] {
+					if (auto t = weak_self.lock()) t->drain_verifier();
+				});
+			};
+			m_verifier = std::make_unique<signature_verifier>(verify_threads, std::move(wake));
+			for (auto& n : m_nodes)
+				n.second.dht.set_signature_verifier(m_verifier.get());
+		}
 	}
 
 	void dht_tracker::stop()
@@ -204,7 +281,22 @@ namespace libtorrent { namespace dht {
 		for (auto& n : m_nodes)
 			n.second.connection_timer.cancel();
 		m_refresh_timer.cancel();
+		m_announce_timer.cancel();
+		m_announces.clear();
+		stop_crawl();
 		m_host_resolver.cancel();
+		if (m_workers)
+		{
+			m_workers->stop();
+			m_workers.reset();
+		}
+		if (m_verifier)
+		{
+			for (auto& n : m_nodes)
+				n.second.dht.set_signature_verifier(nullptr);
+			m_verifier->stop();
+			m_verifier.reset();
+		}
 	}
 
 #if TORRENT_ABI_VERSION == 1
@@ -242,6 +334,8 @@ namespace libtorrent { namespace dht {
 		c.set_value(counters::dht_nodes, 0);
 		c.set_value(counters::dht_node_cache, 0);
 		c.set_value(counters::dht_allocated_observers, 0);
+		c.set_value(counters::dht_transactions_in_flight, 0);
+		c.set_value(counters::dht_announce_queue, m_announces.size());
 
 		for (auto& n : m_nodes)
 			add_dht_counters(n.second.dht, c);
@@ -273,10 +367,23 @@ namespace libtorrent { namespace dht {
 		for (auto& n : m_nodes)
 			n.second.dht.tick();
 
+		publish_nodes();
+
 		// periodically update the DOS blocker's settings from the dht_settings
 		m_blocker.set_block_timer(m_settings.get_int(settings_pack::dht_block_timeout));
 		m_blocker.set_rate_limit(m_settings.get_int(settings_pack::dht_block_ratelimit));
 
+		if (m_settings.get_bool(settings_pack::dht_save_snapshot))
+		{
+			update_storage_snapshot(snapshot_slice);
+		}
+		else if (!m_storage_snapshot.empty() || !m_next_snapshot.empty())
+		{
+			std::string().swap(m_storage_snapshot);
+			std::string().swap(m_next_snapshot);
+			m_snapshot_pos = dht_storage_position();
+		}
+
 		m_refresh_timer.expires_after(seconds(5));
 		ADD_OUTSTANDING_ASYNC("dht_tracker::refresh_timeout");
 		m_refresh_timer.async_wait(
@@ -295,6 +402,8 @@ namespace libtorrent { namespace dht {
 		for (auto& n : m_nodes)
 			n.second.dht.new_write_key();
 
+		publish_nodes();
+
 #ifndef TORRENT_DISABLE_LOGGING
 		m_log->log(dht_logger::tracker, "*** new write key*** %d nodes"
 			, int(m_nodes.size()));
@@ -309,6 +418,65 @@ namespace libtorrent { namespace dht {
 		m_storage.update_node_ids(ids);
 	}
 
+	void dht_tracker::publish_nodes()
+	{
+		if (!m_workers) return;
+
+		auto nodes = std::make_shared<std::vector<node_snapshot>>();
+		for (auto const& n : m_nodes)
+		{
+			node const& dht = n.second.dht;
+			nodes->emplace_back();
+			node_snapshot& ns = nodes->back();
+			ns.sock = n.first;
+			ns.nid = dht.nid();
+			ns.family_name = dht.protocol_family_name();
+			ns.nodes_key = dht.protocol_nodes_key();
+			ns.write_key = dht.write_key();
+			ns.bucket_size = dht.m_table.bucket_size();
+			dht.m_table.for_each_node([&ns](node_entry const& e)
+			{
+				if (e.confirmed()) ns.nodes.push_back(e);
+			}, nullptr);
+		}
+		m_workers->publish(std::move(nodes));
+	}
+
+	void dht_tracker::drain_workers()
+	{
+		if (!m_workers) return;
+
+		m_workers->take(m_finished);
+		for (auto& p : m_finished)
+		{
+			if (!p.reply)
+			{
+				incoming_message(p.sock, p.ep, p.buf);
+				continue;
+			}
+
+			auto const n = m_nodes.find(p.sock);
+			if (n == m_nodes.end()) continue;
+			if (p.heard) n->second.dht.m_table.heard_about(p.id, p.ep);
+			send_buffer(p.sock, p.buf, p.ep);
+		}
+		m_finished.clear();
+	}
+
+	void dht_tracker::drain_verifier()
+	{
+		if (!m_verifier) return;
+
+		m_verifier->take(m_verified);
+		for (auto& p : m_verified)
+		{
+			auto const n = m_nodes.find(p.sock);
+			if (n == m_nodes.end()) continue;
+			n->second.dht.put_verified(p);
+		}
+		m_verified.clear();
+	}
+
 	node* dht_tracker::get_node(node_id const& id, std::string const& family_name)
 	{
 		TORRENT_UNUSED(id);
@@ -333,8 +501,65 @@ namespace libtorrent { namespace dht {
 		, announce_flags_t const flags
 		, std::function<void(std::vector<tcp::endpoint> const&)> f)
 	{
+		m_counters.inc_stats_counter(counters::dht_announce_requests);
+
+		if (m_settings.get_int(settings_pack::dht_announce_rate_limit) <= 0)
+		{
+			start_announce({ih, listen_port, flags, std::move(f)});
+			return;
+		}
+
+		if (!m_announces.add({ih, listen_port, flags, std::move(f)}))
+			m_counters.inc_stats_counter(counters::dht_announce_merged);
+		release_announces();
+	}
+
+	void dht_tracker::release_announces()
+	{
+		int const rate = m_settings.get_int(settings_pack::dht_announce_rate_limit);
+		std::vector<announce_scheduler::request> ready;
+		// if the limit was lifted, release everything
+		if (rate <= 0) m_announces.pop_all(ready);
+		else m_announces.pop(aux::time_now(), rate, int(m_nodes.size()), ready);
+
+		for (auto& r : ready)
+			start_announce(std::move(r));
+
+		if (m_announces.empty() || m_announce_timer_armed) return;
+
+		// don't wake up more often than every 100 ms, that's plenty to spread
+		// the announces out
+		time_duration const d = std::max(m_announces.next_release(std::max(rate, 1))
+			, time_duration(milliseconds(100)));
+		ADD_OUTSTANDING_ASYNC("dht_tracker::announce_timeout");
+		m_announce_timer.expires_after(d);
+		m_announce_timer.async_wait(std::bind(&dht_tracker::announce_timeout, self(), _1));
+		m_announce_timer_armed = true;
+	}
+
+	void dht_tracker::announce_timeout(error_code const& e)
+	{
+		COMPLETE_ASYNC("dht_tracker::announce_timeout");
+		m_announce_timer_armed = false;
+		if (e || !m_running) return;
+		release_announces();
+	}
+
+	void dht_tracker::start_announce(announce_scheduler::request r)
+	{
+		std::weak_ptr<dht_tracker> self_weak = self();
 		for (auto& n : m_nodes)
-			n.second.dht.announce(ih, listen_port, flags, f);
+		{
+			n.second.dht.announce(r.info_hash, r.port, r.flags, r.callback
+				, [self_weak](int const packets)
+			{
+				auto t = self_weak.lock();
+				if (!t) return;
+				t->m_announces.traversal_done(packets);
+				t->m_counters.inc_stats_counter(counters::dht_announce_traversals);
+				t->m_counters.inc_stats_counter(counters::dht_announce_packets, packets);
+			});
+		}
 	}
 
 	void dht_tracker::sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
@@ -352,6 +577,105 @@ namespace libtorrent { namespace dht {
 		}
 	}
 
+	void dht_tracker::start_crawl(crawl_callback f)
+	{
+		m_crawl_callback = std::move(f);
+		if (m_crawler) return;
+
+		m_crawler = std::make_unique<infohash_crawler>();
+		crawl();
+
+		ADD_OUTSTANDING_ASYNC("dht_tracker::crawl_timeout");
+		m_crawl_timer.expires_after(seconds(1));
+		m_crawl_timer.async_wait(std::bind(&dht_tracker::crawl_timeout, self(), _1));
+	}
+
+	void dht_tracker::stop_crawl()
+	{
+		if (!m_crawler) return;
+		flush_crawl();
+		m_crawler.reset();
+		m_crawl_callback = nullptr;
+		m_crawl_timer.cancel();
+	}
+
+	void dht_tracker::crawl_timeout(error_code const& e)
+	{
+		COMPLETE_ASYNC("dht_tracker::crawl_timeout");
+		if (e || !m_crawler) return;
+
+		crawl();
+		flush_crawl();
+
+		ADD_OUTSTANDING_ASYNC("dht_tracker::crawl_timeout");
+		m_crawl_timer.expires_after(seconds(1));
+		m_crawl_timer.async_wait(std::bind(&dht_tracker::crawl_timeout, self(), _1));
+	}
+
+	void dht_tracker::crawl()
+	{
+		time_point32 const now = aux::time_now32();
+
+		// the crawl starts from the routing tables, and comes back to them
+		// whenever it runs out of nodes to ask
+		if (m_crawler->idle(now))
+		{
+			for (auto& n : m_nodes)
+			{
+				n.second.dht.m_table.for_each_node([&](node_entry const& e)
+					{ m_crawler->add_node(e.ep(), now); });
+			}
+		}
+
+		// the requests count towards the upload rate limit
+		if (!has_quota()) return;
+
+		std::vector<infohash_crawler::request> requests;
+		m_crawler->next_requests(now, requests);
+
+		std::weak_ptr<dht_tracker> self_weak = self();
+		for (auto const& r : requests)
+		{
+			udp::endpoint const ep = r.ep;
+			bool sent = false;
+			for (auto& n : m_nodes)
+			{
+				if (ep.protocol() != (n.first.get_external_address().is_v4() ? udp::v4() : udp::v6()))
+					continue;
+				sent = n.second.dht.sample_infohashes(ep, r.target
+					, [self_weak, ep](node_id const&, time_duration const interval
+						, int const num, std::vector<sha1_hash> samples
+						, std::vector<std::pair<sha1_hash, udp::endpoint>> nodes)
+				{
+					auto t = self_weak.lock();
+					if (!t || !t->m_crawler) return;
+					t->m_crawler->got_samples(ep, aux::time_now32(), interval, num, samples, nodes);
+					t->crawl();
+				}
+					, [self_weak, ep]
+				{
+					auto t = self_weak.lock();
+					if (!t || !t->m_crawler) return;
+					t->m_crawler->failed(ep, aux::time_now32());
+					t->crawl();
+				});
+				break;
+			}
+			if (!sent) m_crawler->failed(ep, now);
+		}
+
+		if (m_crawler->num_pending_infohashes() >= crawl_batch_size)
+			flush_crawl();
+	}
+
+	void dht_tracker::flush_crawl()
+	{
+		if (m_crawler->num_pending_infohashes() == 0) return;
+		std::vector<sha1_hash> found;
+		m_crawler->take_infohashes(found);
+		if (m_crawl_callback) m_crawl_callback(found, *m_crawler);
+	}
+
 	namespace {
 
 	struct get_immutable_item_ctx
@@ -541,6 +865,15 @@ namespace libtorrent { namespace dht {
 			return true;
 		}
 
+		if (m_workers && m_workers->post(s, ep, buf)) return true;
+
+		return incoming_message(s, ep, buf);
+	}
+
+	bool dht_tracker::incoming_message(aux::listen_socket_handle const& s
+		, udp::endpoint const& ep, span<char const> const buf)
+	{
+		int const buf_size = int(buf.size());
 		TORRENT_ASSERT(buf_size > 0);
 
 		int pos;
@@ -627,9 +960,36 @@ namespace {
 			auto nodes = save_nodes(n.second.dht);
 			ret.nodes.insert(ret.nodes.end(), nodes.begin(), nodes.end());
 		}
+
+		if (!m_settings.get_bool(settings_pack::dht_save_snapshot)) return ret;
+
+		snapshot_writer w(ret.snapshot, std::int64_t(std::time(nullptr)));
+		w.header();
+		time_point const now = aux::time_now();
+		for (auto& n : m_nodes)
+		{
+			n.second.dht.m_table.for_each_node([&w, now](node_entry const& e)
+				{ w.node(e, now); }, nullptr);
+		}
+		w.append(m_storage_snapshot);
+		w.flush();
 		return ret;
 	}
 
+	void dht_tracker::update_storage_snapshot(int const count)
+	{
+		snapshot_writer w(m_next_snapshot, std::int64_t(std::time(nullptr)));
+		m_storage.visit(w, m_snapshot_pos, count);
+		w.flush();
+		if (!m_snapshot_pos.done) return;
+
+		// the pass is complete. The next one starts with an empty buffer,
+		// rather than keeping the capacity of this one around
+		m_storage_snapshot.swap(m_next_snapshot);
+		std::string().swap(m_next_snapshot);
+		m_snapshot_pos = dht_storage_position();
+	}
+
 	void dht_tracker::add_node(udp::endpoint const& node)
 	{
 		for (auto& n : m_nodes)
@@ -644,6 +1004,7 @@ namespace {
 
 	bool dht_tracker::has_quota()
 	{
+		std::lock_guard<std::mutex> l(m_quota_mutex);
 		time_point const now = clock_type::now();
 		time_duration const delta = now - m_last_tick;
 		m_last_tick = now;
@@ -680,19 +1041,22 @@ namespace {
 	{
 		TORRENT_ASSERT(m_nodes.find(s) != m_nodes.end());
 
-		static_assert(lt::version_minor < 16, "version number not supported by DHT");
-		static_assert(lt::version_tiny < 16, "version number not supported by DHT");
-		static char const ver[] = {'L', 'T'
-			, lt::version_major, (lt::version_minor << 4) | lt::version_tiny};
-		e["v"] = std::string(ver, ver+ 4);
+		add_client_version(e);
 
 		m_send_buf.clear();
 		bencode(std::back_inserter(m_send_buf), e);
+		return send_buffer(s, m_send_buf, addr);
+	}
 
+	bool dht_tracker::send_buffer(aux::listen_socket_handle const& s
+		, span<char const> const buf, udp::endpoint const& addr)
+	{
 		// update the quota. We won't prevent the packet to be sent if we exceed
 		// the quota, we'll just (potentially) block the next incoming request.
-
-		m_send_quota -= int(m_send_buf.size());
+		{
+			std::lock_guard<std::mutex> l(m_quota_mutex);
+			m_send_quota -= int(buf.size());
+		}
 
 		error_code ec;
 		if (s.get_local_endpoint().protocol().family() != addr.protocol().family())
@@ -705,31 +1069,31 @@ namespace {
 					{ return v.first.get_local_endpoint().protocol().family() == addr.protocol().family(); });
 
 			if (n != m_nodes.end())
-				m_send_fun(n->first, addr, m_send_buf, ec, {});
+				m_send_fun(n->first, addr, buf, ec, {});
 			else
 				ec = boost::asio::error::address_family_not_supported;
 		}
 		else
 		{
-			m_send_fun(s, addr, m_send_buf, ec, {});
+			m_send_fun(s, addr, buf, ec, {});
 		}
 
 		if (ec)
 		{
 			m_counters.inc_stats_counter(counters::dht_messages_out_dropped);
 #ifndef TORRENT_DISABLE_LOGGING
-			m_log->log_packet(dht_logger::outgoing_message, m_send_buf, addr);
+			m_log->log_packet(dht_logger::outgoing_message, buf, addr);
 #endif
 			return false;
 		}
 
-		m_counters.inc_stats_counter(counters::dht_bytes_out, int(m_send_buf.size()));
+		m_counters.inc_stats_counter(counters::dht_bytes_out, int(buf.size()));
 		// account for IP and UDP overhead
 		m_counters.inc_stats_counter(counters::sent_ip_overhead_bytes
 			, aux::is_v6(addr) ? 48 : 28);
 		m_counters.inc_stats_counter(counters::dht_messages_out);
 #ifndef TORRENT_DISABLE_LOGGING
-		m_log->log_packet(dht_logger::outgoing_message, m_send_buf, addr);
+		m_log->log_packet(dht_logger::outgoing_message, buf, addr);
 #endif
 		return true;
 	}
@@ -0,0 +1,553 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/kademlia/dht_worker_pool.hpp"
+#include "libtorrent/kademlia/node.hpp" // for socket_manager, generate_write_token
+#include "libtorrent/kademlia/msg.hpp"
+#include "libtorrent/kademlia/dht_observer.hpp"
+
+#include "libtorrent/aux_/session_settings.hpp"
+#include "libtorrent/performance_counters.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
+#include "libtorrent/socket_io.hpp" // for endpoint_to_bytes, write_endpoint
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/version.hpp"
+
+#include <algorithm>
+
+namespace libtorrent {
+namespace dht {
+
+namespace {
+
+	// don't let the queue of packets waiting for a worker grow without
+	// bounds. Once it's full, the network thread answers queries itself
+	constexpr std::size_t max_queued_packets = 4096;
+
+	// generate an error response message
+	void incoming_error(entry& e, char const* msg, int error_code = 203)
+	{
+		e["y"] = "e";
+		entry::list_type& l = e["e"].list();
+		l.emplace_back(error_code);
+		l.emplace_back(msg);
+	}
+
+	bool ends_with(span<char const> buf, string_view const suffix)
+	{
+		return buf.size() >= std::ptrdiff_t(suffix.size())
+			&& std::equal(suffix.begin(), suffix.end(), buf.end() - std::ptrdiff_t(suffix.size()));
+	}
+
+	// the closest nodes to target, in the compact nodes format
+	entry closest_nodes(node_snapshot const& n, sha1_hash const& target
+		, std::vector<node_entry const*>& scratch)
+	{
+		scratch.clear();
+		for (auto const& e : n.nodes) scratch.push_back(&e);
+		auto const count = std::min(scratch.size(), std::size_t(n.bucket_size));
+		auto const last = scratch.begin() + std::ptrdiff_t(count);
+		std::partial_sort(scratch.begin(), last, scratch.end()
+			, [&](node_entry const* lhs, node_entry const* rhs)
+			{ return compare_ref(lhs->id, rhs->id, target); });
+
+		entry r;
+		std::back_insert_iterator<std::string> out(r.string());
+		for (auto i = scratch.begin(); i != last; ++i)
+		{
+			std::copy((*i)->id.begin(), (*i)->id.end(), out);
+			aux::write_endpoint((*i)->ep(), out);
+		}
+		return r;
+	}
+
+} // anonymous namespace
+
+	void add_client_version(entry& e)
+	{
+		static_assert(lt::version_minor < 16, "version number not supported by DHT");
+		static_assert(lt::version_tiny < 16, "version number not supported by DHT");
+		static char const ver[] = {'L', 'T'
+			, lt::version_major, (lt::version_minor << 4) | lt::version_tiny};
+		e["v"] = std::string(ver, ver+ 4);
+	}
+
+	locked_dht_storage::locked_dht_storage(dht_storage_interface& s)
+		: m_storage(s)
+	{}
+
+	size_t locked_dht_storage::num_torrents() const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.num_torrents();
+	}
+
+	size_t locked_dht_storage::num_peers() const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.num_peers();
+	}
+
+	void locked_dht_storage::update_node_ids(std::vector<node_id> const& ids)
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.update_node_ids(ids);
+	}
+
+	bool locked_dht_storage::get_peers(sha1_hash const& info_hash
+		, bool const noseed, bool const scrape, address const& requester
+		, entry& peers) const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.get_peers(info_hash, noseed, scrape, requester, peers);
+	}
+
+	void locked_dht_storage::announce_peer(sha1_hash const& info_hash
+		, tcp::endpoint const& endp
+		, string_view const name, bool const seed)
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.announce_peer(info_hash, endp, name, seed);
+	}
+
+	void locked_dht_storage::restore_peer(sha1_hash const& info_hash
+		, tcp::endpoint const& endp
+		, string_view const name, bool const seed, time_duration const age)
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.restore_peer(info_hash, endp, name, seed, age);
+	}
+
+	bool locked_dht_storage::get_immutable_item(sha1_hash const& target
+		, entry& item) const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.get_immutable_item(target, item);
+	}
+
+	void locked_dht_storage::put_immutable_item(sha1_hash const& target
+		, span<char const> buf
+		, address const& addr)
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.put_immutable_item(target, buf, addr);
+	}
+
+	bool locked_dht_storage::get_mutable_item_seq(sha1_hash const& target
+		, sequence_number& seq) const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.get_mutable_item_seq(target, seq);
+	}
+
+	bool locked_dht_storage::get_mutable_item(sha1_hash const& target
+		, sequence_number const seq, bool const force_fill
+		, entry& item) const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.get_mutable_item(target, seq, force_fill, item);
+	}
+
+	void locked_dht_storage::put_mutable_item(sha1_hash const& target
+		, span<char const> buf
+		, signature const& sig
+		, sequence_number const seq
+		, public_key const& pk
+		, span<char const> salt
+		, address const& addr)
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.put_mutable_item(target, buf, sig, seq, pk, salt, addr);
+	}
+
+	int locked_dht_storage::get_infohashes_sample(entry& item)
+	{
+		// the sample is cached and lazily refreshed, this may modify the
+		// storage
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.get_infohashes_sample(item);
+	}
+
+	void locked_dht_storage::tick()
+	{
+		std::lock_guard<std::shared_timed_mutex> l(m_mutex);
+		m_storage.tick();
+	}
+
+	dht_storage_counters locked_dht_storage::counters() const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		return m_storage.counters();
+	}
+
+	void locked_dht_storage::visit(dht_storage_visitor& v
+		, dht_storage_position& pos, int const count) const
+	{
+		std::shared_lock<std::shared_timed_mutex> l(m_mutex);
+		m_storage.visit(v, pos, count);
+	}
+
+	dht_worker_pool::dht_worker_pool(int const num_threads
+		, aux::session_settings const& settings
+		, counters& cnt
+		, dht_storage_interface& storage
+		, dht_observer* observer
+		, socket_manager* sock_man
+		, std::function<void()> wake)
+		: m_settings(settings)
+		, m_counters(cnt)
+		, m_storage(storage)
+		, m_observer(observer)
+		, m_sock_man(sock_man)
+		, m_wake(std::move(wake))
+	{
+		TORRENT_ASSERT(num_threads > 0);
+		for (int i = 0; i < num_threads; ++i)
+			m_threads.emplace_back(&dht_worker_pool::thread_fun, this);
+	}
+
+	dht_worker_pool::~dht_worker_pool()
+	{
+		stop();
+	}
+
+	void dht_worker_pool::stop()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_abort = true;
+			m_incoming.clear();
+		}
+		m_cond.notify_all();
+		for (auto& t : m_threads) t.join();
+		m_threads.clear();
+	}
+
+	bool dht_worker_pool::post(aux::listen_socket_handle const& s
+		, udp::endpoint const& ep, span<char const> buf)
+	{
+		// only queries are answered by the workers. Since bencoded
+		// dictionaries are sorted, and "y" is the last key of any DHT
+		// message, a query ends with "1:y1:qe". Anything else is left to the
+		// network thread without making a round-trip to a worker first
+		if (!ends_with(buf, "1:y1:qe")) return false;
+
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			if (m_abort || !m_nodes || m_incoming.size() >= max_queued_packets)
+				return false;
+			m_incoming.emplace_back();
+			packet& p = m_incoming.back();
+			p.sock = s;
+			p.ep = ep;
+			p.buf.assign(buf.begin(), buf.end());
+		}
+		m_cond.notify_one();
+		return true;
+	}
+
+	void dht_worker_pool::publish(std::shared_ptr<std::vector<node_snapshot> const> nodes)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		m_nodes = std::move(nodes);
+	}
+
+	void dht_worker_pool::take(std::vector<packet>& out)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		out.swap(m_outgoing);
+	}
+
+	void dht_worker_pool::thread_fun()
+	{
+		aux::exclude_thread_from_handler_timers();
+
+		// the bdecode_node and scratch space are kept across messages, to
+		// avoid re-allocating them
+		bdecode_node msg_node;
+		std::vector<node_entry const*> scratch;
+
+		std::unique_lock<std::mutex> l(m_mutex);
+		for (;;)
+		{
+			m_cond.wait(l, [this] { return m_abort || !m_incoming.empty(); });
+			if (m_abort) return;
+
+			packet p = std::move(m_incoming.front());
+			m_incoming.pop_front();
+			std::shared_ptr<std::vector<node_snapshot> const> const nodes = m_nodes;
+			l.unlock();
+
+			if (!handle(p, nodes.get(), msg_node, scratch))
+			{
+				p.reply = false;
+				p.heard = false;
+			}
+			else if (p.buf.empty())
+			{
+				// the query was dropped
+				l.lock();
+				continue;
+			}
+
+			l.lock();
+			bool const wake = m_outgoing.empty();
+			m_outgoing.emplace_back(std::move(p));
+			if (wake)
+			{
+				l.unlock();
+				m_wake();
+				l.lock();
+			}
+		}
+	}
+
+	bool dht_worker_pool::handle(packet& p, std::vector<node_snapshot> const* nodes
+		, bdecode_node& msg_node, std::vector<node_entry const*>& scratch)
+	{
+		if (nodes == nullptr) return false;
+		auto const n = std::find_if(nodes->begin(), nodes->end()
+			, [&](node_snapshot const& ns) { return ns.sock == p.sock; });
+		if (n == nodes->end()) return false;
+
+		// malformed messages are left to the network thread, to be counted
+		// and logged
+		int pos;
+		error_code err;
+		if (bdecode(p.buf.data(), p.buf.data() + p.buf.size(), msg_node, err, &pos, 10, 500) != 0
+			|| msg_node.type() != bdecode_node::dict_t)
+			return false;
+
+		// queries telling us our external address update the node, those
+		// are left to the network thread as well
+		if (msg_node.dict_find_string_value("y") != "q"
+			|| msg_node.dict_find("ip"))
+			return false;
+
+		string_view const query = msg_node.dict_find_string_value("q");
+		if (query != "ping"
+			&& query != "find_node"
+			&& query != "get_peers"
+			&& query != "sample_infohashes")
+			return false;
+
+#ifndef TORRENT_DISABLE_LOGGING
+		m_observer->log_packet(dht_logger::incoming_message, p.buf, p.ep);
+#endif
+
+		// When a DHT node enters the read-only state, it no longer
+		// responds to 'query' messages that it receives.
+		if (m_settings.get_bool(settings_pack::dht_read_only))
+		{
+			p.buf.clear();
+			return true;
+		}
+
+		if (!m_sock_man->has_quota())
+		{
+			m_counters.inc_stats_counter(counters::dht_messages_in_dropped);
+			p.buf.clear();
+			return true;
+		}
+
+		msg const m(msg_node, p.ep);
+		entry e;
+		incoming_request(*n, *nodes, m, e, p, scratch);
+		add_client_version(e);
+
+		p.buf.clear();
+		bencode(std::back_inserter(p.buf), e);
+		p.reply = true;
+		return true;
+	}
+
+	// this mirrors node::incoming_request(), for the subset of queries the
+	// workers answer
+	void dht_worker_pool::incoming_request(node_snapshot const& n
+		, std::vector<node_snapshot> const& nodes
+		, msg const& m, entry& e, packet& p
+		, std::vector<node_entry const*>& scratch)
+	{
+		e = entry(entry::dictionary_t);
+		e["y"] = "r";
+		e["t"] = m.message.dict_find_string_value("t").to_string();
+
+		static key_desc_t const top_desc[] = {
+			{"q", bdecode_node::string_t, 0, 0},
+			{"ro", bdecode_node::int_t, 0, key_desc_t::optional},
+			{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
+				{"id", bdecode_node::string_t, 20, key_desc_t::last_child},
+		};
+
+		bdecode_node top_level[4];
+		char error_string[200];
+		if (!verify_message(m.message, top_desc, top_level, error_string))
+		{
+			incoming_error(e, error_string);
+			return;
+		}
+
+		e["ip"] = endpoint_to_bytes(m.addr);
+
+		bdecode_node const arg_ent = top_level[2];
+		bool const read_only = top_level[1] && top_level[1].int_value() != 0;
+		node_id const id(top_level[3].string_ptr());
+
+		if (m_settings.get_bool(settings_pack::dht_enforce_node_id) && !verify_id(id, m.addr.address()))
+		{
+			incoming_error(e, "invalid node ID");
+			return;
+		}
+
+		if (!read_only)
+		{
+			p.heard = true;
+			p.id = id;
+		}
+
+		entry& reply = e["r"];
+		reply["id"] = n.nid.to_string();
+
+		// mirror back the other node's external port
+		reply["p"] = m.addr.port();
+
+		string_view const query = top_level[0].string_value();
+
+		if (query == "ping")
+		{
+			m_counters.inc_stats_counter(counters::dht_ping_in);
+		}
+		else if (query == "get_peers")
+		{
+			static key_desc_t const msg_desc[] = {
+				{"info_hash", bdecode_node::string_t, 20, 0},
+				{"noseed", bdecode_node::int_t, 0, key_desc_t::optional},
+				{"scrape", bdecode_node::int_t, 0, key_desc_t::optional},
+				{"want", bdecode_node::list_t, 0, key_desc_t::optional},
+			};
+
+			bdecode_node msg_keys[4];
+			if (!verify_message(arg_ent, msg_desc, msg_keys, error_string))
+			{
+				m_counters.inc_stats_counter(counters::dht_invalid_get_peers);
+				incoming_error(e, error_string);
+				return;
+			}
+
+			sha1_hash const info_hash(msg_keys[0].string_ptr());
+
+			m_counters.inc_stats_counter(counters::dht_get_peers_in);
+
+			// always return nodes as well as peers
+			write_nodes_entries(n, nodes, info_hash, msg_keys[3], reply, scratch);
+
+			bool const noseed = msg_keys[1] && msg_keys[1].int_value() != 0;
+			bool const scrape = msg_keys[2] && msg_keys[2].int_value() != 0;
+
+			if (m_observer) m_observer->get_peers(info_hash);
+			bool const full = m_storage.get_peers(info_hash, noseed, scrape
+				, m.addr.address(), reply);
+			if (!full) reply["token"] = generate_write_token(m.addr, info_hash, n.write_key);
+		}
+		else if (query == "find_node")
+		{
+			static key_desc_t const msg_desc[] = {
+				{"target", bdecode_node::string_t, 20, 0},
+				{"want", bdecode_node::list_t, 0, key_desc_t::optional},
+			};
+
+			bdecode_node msg_keys[2];
+			if (!verify_message(arg_ent, msg_desc, msg_keys, error_string))
+			{
+				m_counters.inc_stats_counter(counters::dht_invalid_find_node);
+				incoming_error(e, error_string);
+				return;
+			}
+
+			m_counters.inc_stats_counter(counters::dht_find_node_in);
+			sha1_hash const target(msg_keys[0].string_ptr());
+
+			write_nodes_entries(n, nodes, target, msg_keys[1], reply, scratch);
+		}
+		else
+		{
+			TORRENT_ASSERT(query == "sample_infohashes");
+			static key_desc_t const msg_desc[] = {
+				{"target", bdecode_node::string_t, 20, 0},
+				{"want", bdecode_node::list_t, 0, key_desc_t::optional},
+			};
+
+			bdecode_node msg_keys[2];
+			if (!verify_message(arg_ent, msg_desc, msg_keys, error_string))
+			{
+				m_counters.inc_stats_counter(counters::dht_invalid_sample_infohashes);
+				incoming_error(e, error_string);
+				return;
+			}
+
+			m_counters.inc_stats_counter(counters::dht_sample_infohashes_in);
+			sha1_hash const target(msg_keys[0].string_ptr());
+
+			m_storage.get_infohashes_sample(reply);
+
+			write_nodes_entries(n, nodes, target, msg_keys[1], reply, scratch);
+		}
+	}
+
+	void dht_worker_pool::write_nodes_entries(node_snapshot const& n
+		, std::vector<node_snapshot> const& nodes
+		, sha1_hash const& target, bdecode_node const& want, entry& r
+		, std::vector<node_entry const*>& scratch)
+	{
+		// if no wants entry was specified, include a nodes
+		// entry based on the protocol the request came in with
+		if (want.type() != bdecode_node::list_t)
+		{
+			r[n.nodes_key] = closest_nodes(n, target, scratch);
+			return;
+		}
+
+		for (int i = 0; i < want.list_size(); ++i)
+		{
+			bdecode_node wanted = want.list_at(i);
+			if (wanted.type() != bdecode_node::string_t)
+				continue;
+			auto const wanted_node = std::find_if(nodes.begin(), nodes.end()
+				, [&](node_snapshot const& ns) { return wanted.string_value() == ns.family_name; });
+			if (wanted_node == nodes.end()) continue;
+			r[wanted_node->nodes_key] = closest_nodes(*wanted_node, target, scratch);
+		}
+	}
+
+}
+}
@@ -0,0 +1,245 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "libtorrent/kademlia/infohash_crawler.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/assert.hpp"
+
+#include <algorithm> // for min, max
+#include <iterator> // for prev
+#include <cstring> // for memcpy
+
+namespace libtorrent { namespace dht {
+
+namespace {
+
+	// nodes are not asked more often than this, even if they say so, and
+	// no less often than the largest interval BEP 51 allows
+	constexpr seconds32 min_interval{60};
+	constexpr seconds32 max_interval{21600};
+
+	// each generation of the seen info-hashes is a bloom filter of 2^22 bits
+	// (512 kiB), holding up to 2^18 keys. With 4 bits per key, that's a false
+	// positive rate of about 0.25% when full
+	constexpr int seen_bits_log2 = 22;
+	constexpr std::size_t seen_words = (std::size_t(1) << seen_bits_log2) / 64;
+	constexpr int seen_capacity = (1 << seen_bits_log2) / 16;
+}
+
+	constexpr int infohash_crawler::max_nodes;
+	constexpr int infohash_crawler::min_window;
+	constexpr int infohash_crawler::max_window;
+
+	infohash_crawler::infohash_crawler()
+	{
+		// the bit positions are derived from the info-hash with a random
+		// key, to not let nodes pick info-hashes that mask others
+		aux::random_bytes({reinterpret_cast<char*>(m_seed), sizeof(m_seed)});
+	}
+
+	void infohash_crawler::add_node(udp::endpoint const& ep, time_point32 const now)
+	{
+		if (m_nodes.count(ep)) return;
+		if (int(m_nodes.size()) >= max_nodes)
+		{
+			// make room by evicting the node that would be asked last. Unless
+			// every node is due already, in which case the new one would only
+			// have to wait its turn as well
+			if (m_schedule.empty()) return;
+			auto const last = std::prev(m_schedule.end());
+			if (last->first <= now) return;
+			m_nodes.erase(last->second);
+			m_schedule.erase(last);
+		}
+		m_nodes.emplace(ep, crawl_node{});
+		schedule(ep, now);
+	}
+
+	void infohash_crawler::next_requests(time_point32 const now, std::vector<request>& out)
+	{
+		while (!m_schedule.empty() && m_schedule.begin()->first <= now)
+		{
+			if (m_outstanding >= m_window)
+			{
+				m_window_limited = true;
+				break;
+			}
+
+			udp::endpoint const ep = m_schedule.begin()->second;
+			m_schedule.erase(m_schedule.begin());
+
+			auto const i = m_nodes.find(ep);
+			TORRENT_ASSERT(i != m_nodes.end());
+			TORRENT_ASSERT(!i->second.pending);
+			i->second.pending = true;
+			++m_outstanding;
+			++m_requests;
+			out.push_back(request{ep, next_target()});
+		}
+	}
+
+	void infohash_crawler::got_samples(udp::endpoint const& ep, time_point32 const now
+		, time_duration const interval, int const num, std::vector<sha1_hash> const& samples
+		, std::vector<std::pair<sha1_hash, udp::endpoint>> const& nodes)
+	{
+		auto const i = m_nodes.find(ep);
+		if (i == m_nodes.end() || !i->second.pending) return;
+		i->second.pending = false;
+		--m_outstanding;
+		++m_responses;
+
+		for (auto const& ih : samples)
+		{
+			if (!insert_seen(ih)) continue;
+			m_found.push_back(ih);
+			++m_unique;
+		}
+
+		// if the node has more info-hashes than it returned, ask it for
+		// another sample once the interval has passed. Otherwise there's
+		// nothing more to get from it
+		if (num > int(samples.size()))
+		{
+			seconds32 const wait = std::min(std::max(
+				std::chrono::duration_cast<seconds32>(interval), min_interval), max_interval);
+			schedule(ep, now + wait);
+		}
+		else
+		{
+			m_nodes.erase(i);
+		}
+
+		for (auto const& n : nodes)
+			add_node(n.second, now);
+
+		completed(true);
+	}
+
+	void infohash_crawler::failed(udp::endpoint const& ep, time_point32 const now)
+	{
+		TORRENT_UNUSED(now);
+		auto const i = m_nodes.find(ep);
+		if (i == m_nodes.end() || !i->second.pending) return;
+		m_nodes.erase(i);
+		--m_outstanding;
+		completed(false);
+	}
+
+	void infohash_crawler::take_infohashes(std::vector<sha1_hash>& out)
+	{
+		out.insert(out.end(), m_found.begin(), m_found.end());
+		m_found.clear();
+	}
+
+	bool infohash_crawler::idle(time_point32 const now) const
+	{
+		return m_schedule.empty() || m_schedule.begin()->first > now;
+	}
+
+	void infohash_crawler::schedule(udp::endpoint const& ep, time_point32 const t)
+	{
+		TORRENT_ASSERT(m_nodes.count(ep) == 1);
+		m_schedule.emplace(t, ep);
+	}
+
+	void infohash_crawler::completed(bool const ok)
+	{
+		if (ok) ++m_round_ok;
+		else ++m_round_failed;
+		if (m_round_ok + m_round_failed < m_window) return;
+
+		// a window's worth of requests completed. Some of them always time
+		// out, as nodes leave the network, but most of them timing out
+		// suggests we're sending faster than the network (or our uplink)
+		// can take. Only grow the window if it was what held us back
+		if (m_round_failed > m_round_ok)
+			m_window = std::max(min_window, m_window - m_window / 4);
+		else if (m_window_limited)
+			m_window = std::min(max_window, m_window + 2);
+
+		m_round_ok = 0;
+		m_round_failed = 0;
+		m_window_limited = false;
+	}
+
+	sha1_hash infohash_crawler::next_target()
+	{
+		// the first 16 bits are the walk counter, bit-reversed. This visits
+		// the key space halves, then quarters and so on
+		std::uint16_t prefix = 0;
+		for (int i = 0; i < 16; ++i)
+			if (m_walk & (1 << i)) prefix |= std::uint16_t(1 << (15 - i));
+		++m_walk;
+
+		sha1_hash ret;
+		aux::random_bytes(ret);
+		ret[0] = std::uint8_t(prefix >> 8);
+		ret[1] = std::uint8_t(prefix & 0xff);
+		return ret;
+	}
+
+	bool infohash_crawler::insert_seen(sha1_hash const& ih)
+	{
+		std::uint32_t idx[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			std::uint32_t w;
+			std::memcpy(&w, ih.data() + i * 4, 4);
+			idx[i] = std::uint32_t(((w ^ m_seed[i]) * 0x9e3779b97f4a7c15ULL)
+				>> (64 - seen_bits_log2));
+		}
+
+		auto const has = [&idx](std::vector<std::uint64_t> const& bits)
+		{
+			if (bits.empty()) return false;
+			for (auto const b : idx)
+				if (((bits[b / 64] >> (b % 64)) & 1) == 0) return false;
+			return true;
+		};
+		if (has(m_seen[0]) || has(m_seen[1])) return false;
+
+		if (m_seen_count == seen_capacity)
+		{
+			// the previous generation is dropped, making room for a new one
+			m_current ^= 1;
+			m_seen[m_current].assign(seen_words, 0);
+			m_seen_count = 0;
+		}
+
+		auto& bits = m_seen[m_current];
+		if (bits.empty()) bits.resize(seen_words);
+		for (auto const b : idx)
+			bits[b / 64] |= std::uint64_t(1) << (b % 64);
+		++m_seen_count;
+		return true;
+	}
+}}
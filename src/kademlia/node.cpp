@@ -39,6 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/config.hpp"
 
 #include <utility>
+#include <algorithm>
 #include <cinttypes> // for PRId64 et.al.
 #include <functional>
 #include <tuple>
@@ -66,6 +67,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/kademlia/direct_request.hpp"
 #include "libtorrent/kademlia/io.hpp"
 #include "libtorrent/kademlia/dht_settings.hpp"
+#include "libtorrent/kademlia/signature_verifier.hpp"
 
 #include "libtorrent/kademlia/refresh.hpp"
 #include "libtorrent/kademlia/get_peers.hpp"
@@ -113,6 +115,34 @@ void incoming_error(entry& e, char const* msg, int error_code = 203)
 	l.emplace_back(msg);
 }
 
+// checks whether a mutable put of seq may replace the item stored at target.
+// If it may not, the error is written to e
+bool check_sequence_number(dht_storage_interface const& storage
+	, sha1_hash const& target, sequence_number const seq
+	, bool const has_cas, sequence_number const cas, entry& e)
+{
+	sequence_number item_seq;
+	if (!storage.get_mutable_item_seq(target, item_seq)) return true;
+
+	// this is the "cas" field in the put message
+	// if it was specified, we MUST make sure the current sequence
+	// number matches the expected value before replacing it
+	// this is critical for avoiding race conditions when multiple
+	// writers are accessing the same slot
+	if (has_cas && item_seq.value != cas.value)
+	{
+		incoming_error(e, "CAS mismatch", 301);
+		return false;
+	}
+
+	if (item_seq > seq)
+	{
+		incoming_error(e, "old sequence number", 302);
+		return false;
+	}
+	return true;
+}
+
 } // anonymous namespace
 
 node::node(aux::listen_socket_handle const& sock, socket_manager* sock_man
@@ -125,7 +155,7 @@ node::node(aux::listen_socket_handle const& sock, socket_manager* sock_man
 	: m_settings(settings)
 	, m_id(calculate_node_id(nid, sock))
 	, m_table(m_id, aux::is_v4(sock.get_local_endpoint()) ? udp::v4() : udp::v6(), 8, settings, observer)
-	, m_rpc(m_id, m_settings, m_table, sock, sock_man, observer)
+	, m_rpc(m_id, m_settings, m_table, sock, sock_man, cnt, observer)
 	, m_sock(sock)
 	, m_sock_man(sock_man)
 	, m_get_foreign_node(std::move(get_foreign_node))
@@ -202,15 +232,15 @@ bool node::verify_token(string_view token, sha1_hash const& info_hash
 	return std::equal(token.begin(), token.end(), reinterpret_cast<char*>(&h[0]));
 }
 
-std::string node::generate_token(udp::endpoint const& addr
-	, sha1_hash const& info_hash)
+std::string generate_write_token(udp::endpoint const& addr
+	, sha1_hash const& info_hash, std::array<char, 4> const& secret)
 {
 	std::string token;
 	token.resize(write_token_size);
 	hasher h;
 	std::string const address = addr.address().to_string();
 	h.update(address);
-	h.update(m_secret[0]);
+	h.update(secret);
 	h.update(info_hash);
 
 	sha1_hash const hash = h.final();
@@ -219,6 +249,12 @@ std::string node::generate_token(udp::endpoint const& addr
 	return token;
 }
 
+std::string node::generate_token(udp::endpoint const& addr
+	, sha1_hash const& info_hash)
+{
+	return generate_write_token(addr, info_hash, m_secret[0]);
+}
+
 void node::bootstrap(std::vector<udp::endpoint> const& nodes
 	, find_data::nodes_callback const& f)
 {
@@ -329,7 +365,10 @@ void node::incoming(aux::listen_socket_handle const& s, msg const& m)
 
 			entry e;
 			incoming_request(m, e);
-			m_sock_man->send_packet(m_sock, e, m.addr);
+			// a mutable put waiting for its signature to be checked is
+			// answered by put_verified()
+			if (e.type() != entry::undefined_t)
+				m_sock_man->send_packet(m_sock, e, m.addr);
 			break;
 		}
 		case 'e':
@@ -362,8 +401,20 @@ void node::incoming(aux::listen_socket_handle const& s, msg const& m)
 namespace {
 
 	void announce_fun(std::vector<std::pair<node_entry, std::string>> const& v
-		, node& node, int const listen_port, sha1_hash const& ih, announce_flags_t const flags)
+		, node& node, int const listen_port, sha1_hash const& ih, announce_flags_t const flags
+		, std::shared_ptr<std::weak_ptr<traversal_algorithm>> const& lookup
+		, std::function<void(int)> const& done)
 	{
+		node.add_nearby_nodes(v);
+
+		// the lookup's cost, to report once the announces are sent
+		int packets = int(v.size());
+		if (auto const ta = lookup->lock())
+		{
+			dht_lookup l;
+			ta->status(l);
+			packets += l.responses + l.timeouts + l.outstanding_requests;
+		}
 #ifndef TORRENT_DISABLE_LOGGING
 		auto logger = node.observer();
 		if (logger != nullptr && logger->should_log(dht_logger::node))
@@ -388,7 +439,7 @@ namespace {
 
 			auto o = node.m_rpc.allocate_observer<announce_observer>(algo
 				, p.first.ep(), p.first.id);
-			if (!o) return;
+			if (!o) break;
 #if TORRENT_USE_ASSERTS
 			o->m_in_constructor = false;
 #endif
@@ -404,6 +455,7 @@ namespace {
 			node.stats_counters().inc_stats_counter(counters::dht_announce_peer_out);
 			node.m_rpc.invoke(e, p.first.ep(), o);
 		}
+		if (done) done(packets);
 	}
 }
 
@@ -431,20 +483,50 @@ void node::get_peers(sha1_hash const& info_hash
 	, std::function<void(std::vector<tcp::endpoint> const&)> dcallback
 	, std::function<void(std::vector<std::pair<node_entry, std::string>> const&)> ncallback
 	, announce_flags_t const flags)
+{
+	make_get_peers(info_hash, std::move(dcallback), std::move(ncallback), flags)->start();
+}
+
+std::shared_ptr<dht::get_peers> node::make_get_peers(sha1_hash const& info_hash
+	, std::function<void(std::vector<tcp::endpoint> const&)> dcallback
+	, std::function<void(std::vector<std::pair<node_entry, std::string>> const&)> ncallback
+	, announce_flags_t const flags)
 {
 	// search for nodes with ids close to id or with peers
 	// for info-hash id. then send announce_peer to them.
 	bool const noseeds = bool(flags & announce::seed);
 
-	auto ta = m_settings.get_bool(settings_pack::dht_privacy_lookups)
-		? std::make_shared<dht::obfuscated_get_peers>(*this, info_hash, std::move(dcallback), std::move(ncallback), noseeds)
-		: std::make_shared<dht::get_peers>(*this, info_hash, std::move(dcallback), std::move(ncallback), noseeds);
+	if (m_settings.get_bool(settings_pack::dht_privacy_lookups))
+		return std::make_shared<dht::obfuscated_get_peers>(*this, info_hash, std::move(dcallback), std::move(ncallback), noseeds);
+	return std::make_shared<dht::get_peers>(*this, info_hash, std::move(dcallback), std::move(ncallback), noseeds);
+}
 
-	ta->start();
+void node::add_nearby_nodes(std::vector<std::pair<node_entry, std::string>> const& v)
+{
+	for (auto const& p : v)
+	{
+		if (int(m_nearby_nodes.size()) < max_nearby_nodes)
+		{
+			m_nearby_nodes.push_back(p.first);
+			continue;
+		}
+		m_nearby_nodes[std::size_t(m_nearby_cursor)] = p.first;
+		m_nearby_cursor = (m_nearby_cursor + 1) % max_nearby_nodes;
+	}
+}
+
+void node::nearby_node_failed(node_id const& id, udp::endpoint const& ep)
+{
+	auto const i = std::find_if(m_nearby_nodes.begin(), m_nearby_nodes.end()
+		, [&](node_entry const& n) { return n.id == id && n.ep() == ep; });
+	if (i == m_nearby_nodes.end()) return;
+	*i = m_nearby_nodes.back();
+	m_nearby_nodes.pop_back();
 }
 
 void node::announce(sha1_hash const& info_hash, int listen_port, announce_flags_t const flags
-	, std::function<void(std::vector<tcp::endpoint> const&)> f)
+	, std::function<void(std::vector<tcp::endpoint> const&)> f
+	, std::function<void(int)> done)
 {
 #ifndef TORRENT_DISABLE_LOGGING
 	if (m_observer != nullptr && m_observer->should_log(dht_logger::node))
@@ -461,9 +543,36 @@ void node::announce(sha1_hash const& info_hash, int listen_port, announce_flags_
 			, m_sock);
 	}
 
-	get_peers(info_hash, std::move(f)
-		, std::bind(&announce_fun, _1, std::ref(*this)
-		, listen_port, info_hash, flags), flags);
+	auto lookup = std::make_shared<std::weak_ptr<traversal_algorithm>>();
+	auto ncallback = std::bind(&announce_fun, _1, std::ref(*this)
+		, listen_port, info_hash, flags, lookup, std::move(done));
+
+	auto ta = make_get_peers(info_hash, std::move(f), std::move(ncallback), flags);
+	*lookup = ta;
+
+	if (m_settings.get_bool(settings_pack::dht_privacy_lookups))
+	{
+		ta->start();
+		return;
+	}
+
+	// start from the closest nodes in the routing table, as well as the
+	// closest ones found by recent announces. When announcing many torrents,
+	// those are often a lot closer to the info-hash than anything we have in
+	// our routing table
+	for (auto const& n : m_table.find_node(info_hash, routing_table::include_failed))
+		ta->add_entry(n.id, n.ep(), observer::flag_initial);
+
+	int const num_nearby = std::min(int(m_nearby_nodes.size()), m_table.bucket_size());
+	std::partial_sort(m_nearby_nodes.begin(), m_nearby_nodes.begin() + num_nearby
+		, m_nearby_nodes.end(), [&info_hash](node_entry const& lhs, node_entry const& rhs)
+		{ return compare_ref(lhs.id, rhs.id, info_hash); });
+	for (int i = 0; i < num_nearby; ++i)
+	{
+		node_entry const& n = m_nearby_nodes[std::size_t(i)];
+		ta->add_entry(n.id, n.ep(), observer::flag_initial);
+	}
+	ta->start();
 }
 
 void node::direct_request(udp::endpoint const& ep, entry& e
@@ -577,11 +686,12 @@ void node::put_item(public_key const& pk, std::string const& salt
 	ta->start();
 }
 
-void node::sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
+bool node::sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
 	, std::function<void(sha1_hash
 		, time_duration
 		, int, std::vector<sha1_hash>
-		, std::vector<std::pair<sha1_hash, udp::endpoint>>)> f)
+		, std::vector<std::pair<sha1_hash, udp::endpoint>>)> f
+	, std::function<void()> failed)
 {
 #ifndef TORRENT_DISABLE_LOGGING
 	if (m_observer != nullptr && m_observer->should_log(dht_logger::node))
@@ -592,10 +702,11 @@ void node::sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
 #endif
 
 	// not an actual traversal
-	auto ta = std::make_shared<dht::sample_infohashes>(*this, node_id(), std::move(f));
+	auto ta = std::make_shared<dht::sample_infohashes>(*this, node_id(), std::move(f)
+		, std::move(failed));
 
 	auto o = m_rpc.allocate_observer<sample_infohashes_observer>(ta, ep, node_id());
-	if (!o) return;
+	if (!o) return false;
 #if TORRENT_USE_ASSERTS
 	o->m_in_constructor = false;
 #endif
@@ -607,7 +718,7 @@ void node::sample_infohashes(udp::endpoint const& ep, sha1_hash const& target
 
 	stats_counters().inc_stats_counter(counters::dht_sample_infohashes_out);
 
-	m_rpc.invoke(e, ep, o);
+	return m_rpc.invoke(e, ep, o);
 }
 
 struct ping_observer : observer
@@ -742,11 +853,12 @@ dht_status node::status() const
 	return ret;
 }
 
-std::tuple<int, int, int> node::get_stats_counters() const
+std::tuple<int, int, int, int> node::get_stats_counters() const
 {
 	int nodes, replacements;
 	std::tie(nodes, replacements, std::ignore) = size();
-	return std::make_tuple(nodes, replacements, m_rpc.num_allocated_observers());
+	return std::make_tuple(nodes, replacements, m_rpc.num_allocated_observers()
+		, m_rpc.num_transactions());
 }
 
 #if TORRENT_ABI_VERSION == 1
@@ -1060,6 +1172,41 @@ void node::incoming_request(msg const& m, entry& e)
 				return;
 			}
 
+			bool const has_cas = bool(msg_keys[5]);
+			sequence_number const cas(has_cas ? msg_keys[5].int_value() : 0);
+
+			if (m_verifier != nullptr)
+			{
+				// don't spend time checking the signature of a put we'd
+				// reject anyway
+				if (!check_sequence_number(m_storage, target, seq, has_cas, cas, e))
+				{
+					m_counters.inc_stats_counter(counters::dht_invalid_put);
+					return;
+				}
+
+				dht::mutable_put p;
+				p.sock = m_sock;
+				p.ep = m.addr;
+				p.id = id;
+				p.target = target;
+				p.value.assign(buf.begin(), buf.end());
+				p.salt.assign(salt.begin(), salt.end());
+				p.seq = seq;
+				p.pk = pk;
+				p.sig = sig;
+				p.has_cas = has_cas;
+				p.cas = cas;
+				p.response = std::move(e);
+				if (m_verifier->post(std::move(p)))
+				{
+					e = entry();
+					return;
+				}
+				// the queue is full, verify it here
+				e = std::move(p.response);
+			}
+
 			// msg_keys[4] is the signature, msg_keys[3] is the public key
 			if (!verify_mutable_item(buf, salt, seq, pk, sig))
 			{
@@ -1070,36 +1217,14 @@ void node::incoming_request(msg const& m, entry& e)
 
 			TORRENT_ASSERT(signature::len == msg_keys[4].string_length());
 
-			sequence_number item_seq;
-			if (!m_storage.get_mutable_item_seq(target, item_seq))
+			if (!check_sequence_number(m_storage, target, seq, has_cas, cas, e))
 			{
-				m_storage.put_mutable_item(target, buf, sig, seq, pk, salt
-					, m.addr.address());
+				m_counters.inc_stats_counter(counters::dht_invalid_put);
+				return;
 			}
-			else
-			{
-				// this is the "cas" field in the put message
-				// if it was specified, we MUST make sure the current sequence
-				// number matches the expected value before replacing it
-				// this is critical for avoiding race conditions when multiple
-				// writers are accessing the same slot
-				if (msg_keys[5] && item_seq.value != msg_keys[5].int_value())
-				{
-					m_counters.inc_stats_counter(counters::dht_invalid_put);
-					incoming_error(e, "CAS mismatch", 301);
-					return;
-				}
 
-				if (item_seq > seq)
-				{
-					m_counters.inc_stats_counter(counters::dht_invalid_put);
-					incoming_error(e, "old sequence number", 302);
-					return;
-				}
-
-				m_storage.put_mutable_item(target, buf, sig, seq, pk, salt
-					, m.addr.address());
-			}
+			m_storage.put_mutable_item(target, buf, sig, seq, pk, salt
+				, m.addr.address());
 		}
 
 		m_table.node_seen(id, m.addr, 0xffff);
@@ -1198,6 +1323,28 @@ void node::incoming_request(msg const& m, entry& e)
 	}
 }
 
+void node::put_verified(mutable_put& p)
+{
+	entry& e = p.response;
+	if (!p.valid)
+	{
+		m_counters.inc_stats_counter(counters::dht_invalid_put);
+		incoming_error(e, "invalid signature", 206);
+	}
+	// the item may have changed while the signature was checked
+	else if (!check_sequence_number(m_storage, p.target, p.seq, p.has_cas, p.cas, e))
+	{
+		m_counters.inc_stats_counter(counters::dht_invalid_put);
+	}
+	else
+	{
+		m_storage.put_mutable_item(p.target, p.value, p.sig, p.seq, p.pk, p.salt
+			, p.ep.address());
+		m_table.node_seen(p.id, p.ep, 0xffff);
+	}
+	m_sock_man->send_packet(m_sock, e, p.ep);
+}
+
 // TODO: limit number of entries in the result
 void node::write_nodes_entries(sha1_hash const& info_hash
 	, bdecode_node const& want, entry& r)
@@ -33,14 +33,14 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "libtorrent/kademlia/node_entry.hpp"
-#include "libtorrent/aux_/time.hpp" // for aux::time_now()
+#include "libtorrent/aux_/time.hpp" // for aux::time_now32()
 
 namespace libtorrent { namespace dht {
 
 	node_entry::node_entry(node_id const& id_, udp::endpoint const& ep
 		, int roundtriptime
 		, bool pinged)
-		: last_queried(pinged ? aux::time_now() : min_time())
+		: last_queried(pinged ? aux::time_now32() : (time_point32::min)())
 		, id(id_)
 		, endpoint(ep)
 		, rtt(roundtriptime & 0xffff)
@@ -68,44 +68,108 @@ constexpr find_nodes_flags_t routing_table::include_failed;
 
 namespace {
 
-	template <typename T, typename K>
-	void erase_one(T& container, K const& key)
-	{
-		auto const i = container.find(key);
-		TORRENT_ASSERT(i != container.end());
-		container.erase(i);
-	}
-
 	bool verify_node_address(aux::session_settings const& settings
 		, node_id const& id, address const& addr)
 	{
 		// only when the node_id pass the verification, add it to routing table.
 		return !settings.get_bool(settings_pack::dht_enforce_node_id) || verify_id(id, addr);
 	}
+
+	// the first 64 bits of the ID as a native integer. The XOR of two
+	// prefixes orders nodes by XOR distance, down to the first 64 bits
+	std::uint64_t id_prefix(node_id const& id)
+	{
+		span<char const> v(id.data(), 8);
+		return aux::read_uint64(v);
+	}
 }
 
-void ip_set::insert(address const& addr)
+template <typename Bytes>
+void ip_table<Bytes>::grow()
 {
-	if (addr.is_v6())
-		m_ip6s.insert(addr.to_v6().to_bytes());
-	else
-		m_ip4s.insert(addr.to_v4().to_bytes());
+	std::vector<slot> old(std::max(m_slots.size() * 2, std::size_t(16)));
+	old.swap(m_slots);
+	for (auto const& s : old)
+	{
+		if (s.count == 0) continue;
+		m_slots[find_slot(s.ip)] = s;
+	}
+}
+
+template <typename Bytes>
+void ip_table<Bytes>::insert(Bytes const& ip)
+{
+	if ((m_used + 1) * 2 > m_slots.size()) grow();
+	auto& s = m_slots[find_slot(ip)];
+	if (s.count == 0)
+	{
+		s.ip = ip;
+		++m_used;
+	}
+	TORRENT_ASSERT(s.count < 0xffff);
+	++s.count;
+	++m_size;
 }
 
-bool ip_set::exists(address const& addr) const
+template <typename Bytes>
+void ip_table<Bytes>::erase(Bytes const& ip)
+{
+	TORRENT_ASSERT(!m_slots.empty());
+	if (m_slots.empty()) return;
+	std::size_t i = find_slot(ip);
+	TORRENT_ASSERT(m_slots[i].count != 0);
+	if (m_slots[i].count == 0) return;
+	--m_size;
+	if (--m_slots[i].count > 0) return;
+	--m_used;
+
+	// move the entries following the removed one back, unless that would
+	// move them in front of their home slot. This keeps every entry
+	// reachable from its home slot without leaving tombstones
+	std::size_t const mask = m_slots.size() - 1;
+	std::size_t j = i;
+	for (;;)
+	{
+		j = (j + 1) & mask;
+		if (m_slots[j].count == 0) break;
+		std::size_t const k = home(m_slots[j].ip);
+		bool const stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+		if (stays) continue;
+		m_slots[i] = m_slots[j];
+		i = j;
+	}
+	m_slots[i].count = 0;
+}
+
+template <typename Bytes>
+bool ip_table<Bytes>::operator==(ip_table const& rh) const
+{
+	if (m_size != rh.m_size || m_used != rh.m_used) return false;
+	for (auto const& s : m_slots)
+	{
+		if (s.count == 0) continue;
+		if (rh.m_slots[rh.find_slot(s.ip)].count != s.count) return false;
+	}
+	return true;
+}
+
+template struct ip_table<address_v4::bytes_type>;
+template struct ip_table<address_v6::bytes_type>;
+
+void ip_set::insert(address const& addr)
 {
 	if (addr.is_v6())
-		return m_ip6s.find(addr.to_v6().to_bytes()) != m_ip6s.end();
+		m_ip6s.insert(addr.to_v6().to_bytes());
 	else
-		return m_ip4s.find(addr.to_v4().to_bytes()) != m_ip4s.end();
+		m_ip4s.insert(addr.to_v4().to_bytes());
 }
 
 void ip_set::erase(address const& addr)
 {
 	if (addr.is_v6())
-		erase_one(m_ip6s, addr.to_v6().to_bytes());
+		m_ip6s.erase(addr.to_v6().to_bytes());
 	else
-		erase_one(m_ip4s, addr.to_v4().to_bytes());
+		m_ip4s.erase(addr.to_v4().to_bytes());
 }
 
 bool mostly_verified_nodes(bucket_t const& b)
@@ -406,7 +470,7 @@ node_entry const* routing_table::next_refresh()
 			TORRENT_ASSERT(m_id != n.id);
 			if (n.id == m_id) continue;
 
-			if (n.last_queried == min_time())
+			if (n.last_queried == (time_point32::min)())
 			{
 				candidate = &n;
 				goto out;
@@ -425,7 +489,7 @@ node_entry const* routing_table::next_refresh()
 			// check for an unpinged replacement
 			// node which may be eligible for the live bucket if confirmed
 			auto r = std::find_if(i->replacements.begin(), i->replacements.end()
-				, [](node_entry const& e) { return !e.pinged() && e.last_queried == min_time(); });
+				, [](node_entry const& e) { return !e.pinged() && e.last_queried == (time_point32::min)(); });
 			if (r != i->replacements.end())
 			{
 				candidate = &*r;
@@ -438,7 +502,7 @@ out:
 	// make sure we don't pick the same node again next time we want to refresh
 	// the routing table
 	if (candidate)
-		candidate->last_queried = aux::time_now();
+		candidate->last_queried = aux::time_now32();
 
 	return candidate;
 }
@@ -535,6 +599,7 @@ void routing_table::fill_from_replacements(table_t::iterator bucket)
 		if (j == rb.end()) break;
 		b.push_back(*j);
 		rb.erase(j);
+		m_index_dirty = true;
 	}
 }
 
@@ -544,11 +609,13 @@ void routing_table::prune_empty_bucket()
 		&& m_buckets.back().replacements.empty())
 	{
 		m_buckets.erase(m_buckets.end() - 1);
+		m_index_dirty = true;
 	}
 }
 
 void routing_table::remove_node(node_entry* n, bucket_t* b)
 {
+	m_index_dirty = true;
 	std::ptrdiff_t const idx = n - b->data();
 	TORRENT_ASSERT(idx >= 0);
 	TORRENT_ASSERT(idx < intptr_t(b->size()));
@@ -672,6 +739,7 @@ routing_table::add_node_status_t routing_table::add_node_impl(node_entry e)
 		{
 			// if the node ID is the same, just update the failcount
 			// and be done with it.
+			if (existing->timeout_count != 0) m_index_dirty = true;
 			existing->timeout_count = 0;
 			if (e.pinged())
 			{
@@ -717,11 +785,11 @@ routing_table::add_node_status_t routing_table::add_node_impl(node_entry e)
 			// when we detect possible malicious activity in a bucket,
 			// schedule the other nodes in the bucket to be pinged soon
 			// to clean out any other malicious nodes
-			auto const now = aux::time_now();
+			auto const now = aux::time_now32();
 			for (auto& node : existing_bucket->live_nodes)
 			{
 				if (node.last_queried + minutes(5) < now)
-					node.last_queried = min_time();
+					node.last_queried = (time_point32::min)();
 			}
 
 			prune_empty_bucket();
@@ -732,6 +800,8 @@ routing_table::add_node_status_t routing_table::add_node_impl(node_entry e)
 	// don't add ourself
 	if (e.id == m_id) return failed_to_add;
 
+	m_index_dirty = true;
+
 	auto const i = find_bucket(e.id);
 	bucket_t& b = i->live_nodes;
 	bucket_t& rb = i->replacements;
@@ -976,6 +1046,7 @@ void routing_table::split_bucket()
 void routing_table::update_node_id(node_id const& id)
 {
 	m_id = id;
+	m_index_dirty = true;
 
 	m_ips.clear();
 
@@ -1019,6 +1090,8 @@ void routing_table::node_failed(node_id const& nid, udp::endpoint const& ep)
 	INVARIANT_CHECK;
 #endif
 
+	m_index_dirty = true;
+
 	// if messages to ourself fails, ignore it
 	if (nid == m_id) return;
 
@@ -1098,6 +1171,11 @@ bool routing_table::node_seen(node_id const& id, udp::endpoint const& ep, int co
 	return verify_node_address(m_settings, id, ep.address()) && add_node(node_entry(id, ep, rtt, true));
 }
 
+bool routing_table::restore_node(node_entry const& e)
+{
+	return verify_node_address(m_settings, e.id, e.addr()) && add_node(e);
+}
+
 // fills the vector with the k nodes from our buckets that
 // are nearest to the given id.
 std::vector<node_entry> routing_table::find_node(node_id const& target
@@ -1105,86 +1183,99 @@ std::vector<node_entry> routing_table::find_node(node_id const& target
 {
 	std::vector<node_entry> l;
 	if (count == 0) count = m_bucket_size;
+	l.reserve(aux::numeric_cast<std::size_t>(count));
 
-	auto const i = find_bucket(target);
-	int const bucket_index = int(std::distance(m_buckets.begin(), i));
-	int const bucket_size_limit = bucket_limit(bucket_index);
+	// find_bucket() creates the first bucket if the table is empty, so it
+	// must run before the index is brought up to date
+	int const bucket_index = int(std::distance(m_buckets.begin(), find_bucket(target)));
+	int const num_buckets = int(m_buckets.size());
+	if (m_index_dirty || int(m_index.bucket_start.size()) != num_buckets + 1)
+		build_index();
 
-	l.reserve(aux::numeric_cast<std::size_t>(bucket_size_limit));
+	auto const& start = m_index.bucket_start;
 
-	table_t::iterator j = i;
+	// the nodes in the target's bucket are the closest to it. The ones in
+	// the buckets closer to us all have the same number of leading zeros in
+	// their distance to the target, and are next. Then each bucket further
+	// away from us has one fewer leading zero than the previous. Within
+	// those groups, nodes are ordered by their actual distance
+	closest_in_range(target, start[bucket_index], start[bucket_index + 1]
+		, options, count, l);
 
-	int unsorted_start_idx = 0;
-	for (; j != m_buckets.end() && int(l.size()) < count; ++j)
+	if (int(l.size()) < count && bucket_index + 1 < num_buckets)
 	{
-		bucket_t const& b = j->live_nodes;
-		if (options & include_failed)
-		{
-			std::copy(b.begin(), b.end(), std::back_inserter(l));
-		}
-		else
-		{
-			std::remove_copy_if(b.begin(), b.end(), std::back_inserter(l)
-				, [](node_entry const& ne) { return !ne.confirmed(); });
-		}
-
-		if (int(l.size()) == count) return l;
+		closest_in_range(target, start[bucket_index + 1], start[num_buckets]
+			, options, count, l);
+	}
 
-		if (int(l.size()) > count)
-		{
-			// sort the nodes by how close they are to the target
-			std::sort(l.begin() + unsorted_start_idx, l.end()
-				, [&target](node_entry const& lhs, node_entry const& rhs)
-				{ return compare_ref(lhs.id, rhs.id, target); });
+	for (int i = bucket_index - 1; i >= 0 && int(l.size()) < count; --i)
+		closest_in_range(target, start[i], start[i + 1], options, count, l);
 
-			l.resize(aux::numeric_cast<std::size_t>(count));
-			return l;
-		}
-		unsorted_start_idx = int(l.size());
-	}
+	TORRENT_ASSERT(int(l.size()) <= count);
+	return l;
+}
 
-	// if we still don't have enough nodes, copy nodes
-	// further away from us
+void routing_table::closest_in_range(node_id const& target
+	, std::uint32_t const first, std::uint32_t const last
+	, find_nodes_flags_t const options, int const count
+	, std::vector<node_entry>& l)
+{
+	if (first == last) return;
 
-	if (i == m_buckets.begin())
-		return l;
+	// this loop is trivial to vectorize
+	std::uint64_t const t = id_prefix(target);
+	std::uint64_t const* prefix = m_index.prefix.data() + first;
+	m_distance.resize(last - first);
+	for (std::size_t i = 0; i < m_distance.size(); ++i)
+		m_distance[i] = prefix[i] ^ t;
 
-	j = i;
+	m_candidates.clear();
+	for (std::uint32_t i = first; i < last; ++i)
+	{
+		if (!(options & include_failed) && !m_index.confirmed[i]) continue;
+		m_candidates.push_back(i);
+	}
 
-	unsorted_start_idx = int(l.size());
-	do
+	auto const cmp = [&](std::uint32_t const lhs, std::uint32_t const rhs)
 	{
-		--j;
-		bucket_t const& b = j->live_nodes;
+		std::uint64_t const dl = m_distance[lhs - first];
+		std::uint64_t const dr = m_distance[rhs - first];
+		if (dl != dr) return dl < dr;
+		return compare_ref(m_index.ids[lhs], m_index.ids[rhs], target);
+	};
+
+	auto const want = std::min(m_candidates.size()
+		, aux::numeric_cast<std::size_t>(count) - l.size());
+	auto const end = m_candidates.begin() + std::ptrdiff_t(want);
+	std::partial_sort(m_candidates.begin(), end, m_candidates.end(), cmp);
+
+	for (auto i = m_candidates.begin(); i != end; ++i)
+		l.push_back(*m_index.entries[*i]);
+}
 
-		if (options & include_failed)
-		{
-			std::copy(b.begin(), b.end(), std::back_inserter(l));
-		}
-		else
-		{
-			std::remove_copy_if(b.begin(), b.end(), std::back_inserter(l)
-				, [](node_entry const& ne) { return !ne.confirmed(); });
-		}
+void routing_table::build_index()
+{
+	m_index_dirty = false;
 
-		if (int(l.size()) == count) return l;
+	packed_index& ix = m_index;
+	ix.bucket_start.clear();
+	ix.prefix.clear();
+	ix.ids.clear();
+	ix.confirmed.clear();
+	ix.entries.clear();
 
-		if (int(l.size()) > count)
+	for (auto const& b : m_buckets)
+	{
+		ix.bucket_start.push_back(std::uint32_t(ix.ids.size()));
+		for (auto const& n : b.live_nodes)
 		{
-			// sort the nodes by how close they are to the target
-			std::sort(l.begin() + unsorted_start_idx, l.end()
-				, [&target](node_entry const& lhs, node_entry const& rhs)
-				{ return compare_ref(lhs.id, rhs.id, target); });
-
-			l.resize(aux::numeric_cast<std::size_t>(count));
-			return l;
+			ix.prefix.push_back(id_prefix(n.id));
+			ix.ids.push_back(n.id);
+			ix.confirmed.push_back(n.confirmed());
+			ix.entries.push_back(&n);
 		}
-		unsorted_start_idx = int(l.size());
 	}
-	while (j != m_buckets.begin() && int(l.size()) < count);
-
-	TORRENT_ASSERT(int(l.size()) <= count);
-	return l;
+	ix.bucket_start.push_back(std::uint32_t(ix.ids.size()));
 }
 
 #if TORRENT_USE_INVARIANT_CHECKS
@@ -1231,7 +1322,7 @@ void routing_table::log_node_failed(node_id const& nid, node_entry const& ne) co
 			, aux::to_hex(nid).c_str(), print_endpoint(ne.ep()).c_str()
 			, ne.fail_count()
 			, int(ne.pinged())
-			, int(total_seconds(aux::time_now() - ne.first_seen)));
+			, int(total_seconds(aux::time_now32() - ne.first_seen)));
 	}
 }
 #endif
@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <libtorrent/kademlia/get_item.hpp>
 #include <libtorrent/kademlia/sample_infohashes.hpp>
 #include <libtorrent/aux_/session_settings.hpp>
+#include <libtorrent/performance_counters.hpp>
 
 #include <libtorrent/socket_io.hpp> // for print_endpoint
 #include <libtorrent/aux_/time.hpp> // for aux::time_now
@@ -57,14 +58,12 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <libtorrent/aux_/ip_helpers.hpp> // for is_v6
 
 #include <type_traits>
-#include <functional>
+#include <algorithm> // for min, max
 
 #ifndef TORRENT_DISABLE_LOGGING
 #include <cinttypes> // for PRId64 et.al.
 #endif
 
-using namespace std::placeholders;
-
 namespace libtorrent { namespace dht {
 
 // TODO: 3 move this into it's own .cpp file
@@ -159,13 +158,28 @@ using observer_storage = aux::aligned_union<1
 	, null_observer
 	, traversal_observer>::type;
 
+namespace {
+
+	constexpr auto short_timeout = seconds(1);
+	constexpr auto timeout = seconds(15);
+
+	// the timer wheel must span more than the full timeout
+	constexpr auto timer_resolution = milliseconds(100);
+}
+
+constexpr int rpc_manager::wheel_size;
+
 rpc_manager::rpc_manager(node_id const& our_id
 	, aux::session_settings const& settings
 	, routing_table& table
 	, aux::listen_socket_handle sock
 	, socket_manager* sock_man
+	, counters& cnt
 	, dht_logger* log)
-	: m_pool_allocator(sizeof(observer_storage), 10)
+	// observers are allocated in blocks growing from 64 up to 1024 of them,
+	// for big traversals to not hit the heap for every request
+	: m_pool_allocator(sizeof(observer_storage), 64, 1024)
+	, m_wheel_time(aux::time_now())
 	, m_sock(std::move(sock))
 	, m_sock_man(sock_man)
 #ifndef TORRENT_DISABLE_LOGGING
@@ -173,6 +187,7 @@ rpc_manager::rpc_manager(node_id const& our_id
 #endif
 	, m_settings(settings)
 	, m_table(table)
+	, m_counters(cnt)
 	, m_our_id(our_id)
 	, m_allocated_observers(0)
 	, m_destructing(false)
@@ -189,13 +204,12 @@ rpc_manager::~rpc_manager()
 
 	for (auto const& t : m_transactions)
 	{
-		t.second->abort();
+		if (t.o) t.o->abort();
 	}
 }
 
 void* rpc_manager::allocate_observer()
 {
-	m_pool_allocator.set_next_size(10);
 	void* ret = m_pool_allocator.malloc();
 	if (ret != nullptr) ++m_allocated_observers;
 	return ret;
@@ -217,13 +231,69 @@ size_t rpc_manager::allocation_size() const
 #if TORRENT_USE_INVARIANT_CHECKS
 void rpc_manager::check_invariant() const
 {
+	int num_transactions = 0;
 	for (auto const& t : m_transactions)
 	{
-		TORRENT_ASSERT(t.second);
+		if (t.o) ++num_transactions;
 	}
+	TORRENT_ASSERT(num_transactions == m_num_transactions);
+	TORRENT_ASSERT(num_transactions + int(m_free_slots.size()) == int(m_transactions.size()));
 }
 #endif
 
+rpc_manager::transaction* rpc_manager::find_transaction(std::uint16_t const slot
+	, std::uint16_t const tag)
+{
+	if (slot >= m_transactions.size()) return nullptr;
+	transaction& t = m_transactions[slot];
+	if (!t.o || t.tag != tag) return nullptr;
+	return &t;
+}
+
+rpc_manager::transaction* rpc_manager::add_transaction(observer_ptr o)
+{
+	if (m_free_slots.empty() && !grow_transactions()) return nullptr;
+
+	std::uint16_t const slot = m_free_slots.front();
+	m_free_slots.pop_front();
+
+	transaction& t = m_transactions[slot];
+	t.o = std::move(o);
+	t.serial = m_next_serial++;
+	t.tag = std::uint16_t(random(0xffff));
+	++m_num_transactions;
+	return &t;
+}
+
+void rpc_manager::remove_transaction(transaction& t)
+{
+	t.o.reset();
+	m_free_slots.push_back(std::uint16_t(&t - m_transactions.data()));
+	--m_num_transactions;
+}
+
+bool rpc_manager::grow_transactions()
+{
+	std::size_t const size = m_transactions.size();
+	if (size > 0xffff) return false;
+
+	// slots never move, the new ones are appended
+	std::size_t const new_size = size == 0 ? 16 : size * 2;
+	m_transactions.resize(new_size);
+	for (std::size_t i = size; i < new_size; ++i)
+		m_free_slots.push_back(std::uint16_t(i));
+	return true;
+}
+
+void rpc_manager::schedule_timeout(transaction const& t, time_point const due)
+{
+	auto const ticks = std::max(std::int64_t((due - m_wheel_time) / timer_resolution)
+		, std::int64_t(0));
+	int const bucket = int(std::min(ticks, std::int64_t(wheel_size - 1)));
+	m_wheel[(m_wheel_pos + bucket) % wheel_size].push_back({t.serial
+		, std::uint16_t(&t - m_transactions.data())});
+}
+
 void rpc_manager::unreachable(udp::endpoint const& ep)
 {
 #ifndef TORRENT_DISABLE_LOGGING
@@ -234,16 +304,15 @@ void rpc_manager::unreachable(udp::endpoint const& ep)
 	}
 #endif
 
-	for (auto i = m_transactions.begin(); i != m_transactions.end();)
+	for (auto& t : m_transactions)
 	{
-		TORRENT_ASSERT(i->second);
-		if (i->second->target_ep() != ep) { ++i; continue; }
-		observer_ptr o = i->second;
+		if (!t.o || t.o->target_ep() != ep) continue;
+		observer_ptr o = std::move(t.o);
 #ifndef TORRENT_DISABLE_LOGGING
-		m_log->log(dht_logger::rpc_manager, "[%u] found transaction [ tid: %d ]"
-			, o->algorithm()->id(), i->first);
+		m_log->log(dht_logger::rpc_manager, "[%u] found transaction [ slot: %d ]"
+			, o->algorithm()->id(), int(&t - m_transactions.data()));
 #endif
-		i = m_transactions.erase(i);
+		remove_transaction(t);
 		o->timeout();
 		break;
 	}
@@ -265,17 +334,19 @@ bool rpc_manager::incoming(msg const& m, node_id* id)
 	auto transaction_id = m.message.dict_find_string_value("t");
 	if (transaction_id.empty()) return false;
 
-	auto ptr = transaction_id.begin();
-	std::uint16_t const tid = transaction_id.size() != 2 ? std::uint64_t(0xffff) : aux::read_uint16(ptr);
-
 	observer_ptr o;
-	auto range = m_transactions.equal_range(tid);
-	for (auto i = range.first; i != range.second; ++i)
+	transaction* t = nullptr;
+	if (transaction_id.size() == 4)
 	{
-		if (m.addr.address() != i->second->target_addr()) continue;
-		o = i->second;
-		i = m_transactions.erase(i);
-		break;
+		auto ptr = transaction_id.begin();
+		std::uint16_t const slot = aux::read_uint16(ptr);
+		std::uint16_t const tag = aux::read_uint16(ptr);
+		t = find_transaction(slot, tag);
+	}
+	if (t != nullptr && m.addr.address() == t->o->target_addr())
+	{
+		o = std::move(t->o);
+		remove_transaction(*t);
 	}
 
 	if (!o)
@@ -385,40 +456,55 @@ bool rpc_manager::incoming(msg const& m, node_id* id)
 	return m_table.node_seen(*id, m.addr, rtt);
 }
 
-time_duration rpc_manager::tick()
+time_duration rpc_manager::tick(time_point const now)
 {
 	INVARIANT_CHECK;
 
-	constexpr auto short_timeout = seconds(1);
-	constexpr auto timeout = seconds(15);
-
-	// look for observers that have timed out
-
-	if (m_transactions.empty()) return short_timeout;
-
-	std::vector<observer_ptr> timeouts;
-	std::vector<observer_ptr> short_timeouts;
+	if (m_num_transactions == 0)
+	{
+		// the wheel may only hold entries of completed transactions
+		for (auto& b : m_wheel) b.clear();
+		m_wheel_time = now;
+		return short_timeout;
+	}
 
-	time_duration ret = short_timeout;
-	time_point now = aux::time_now();
+	// collect the entries of all buckets that have passed. If we've fallen
+	// more than a full turn behind, every entry is looked at once
+	for (int steps = 0; m_wheel_time + timer_resolution <= now; ++steps)
+	{
+		if (steps == wheel_size)
+		{
+			m_wheel_time = now;
+			break;
+		}
+		auto& b = m_wheel[m_wheel_pos];
+		m_due.insert(m_due.end(), b.begin(), b.end());
+		b.clear();
+		m_wheel_pos = (m_wheel_pos + 1) % wheel_size;
+		m_wheel_time += timer_resolution;
+	}
 
-	for (auto i = m_transactions.begin(); i != m_transactions.end();)
+	for (auto const& e : m_due)
 	{
-		observer_ptr o = i->second;
+		transaction* const t = &m_transactions[e.slot];
+		if (!t->o || t->serial != e.serial) continue;
 
-		time_duration diff = now - o->sent();
+		observer_ptr const& o = t->o;
+		time_duration const diff = now - o->sent();
 		if (diff >= timeout)
 		{
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_log->should_log(dht_logger::rpc_manager))
 			{
-				m_log->log(dht_logger::rpc_manager, "[%u] timing out transaction id: %d from: %s"
-					, o->algorithm()->id(), i->first
+				m_log->log(dht_logger::rpc_manager, "[%u] timing out transaction [ slot: %d ] from: %s"
+					, o->algorithm()->id(), int(e.slot)
 					, print_endpoint(o->target_ep()).c_str());
 			}
 #endif
-			i = m_transactions.erase(i);
-			timeouts.push_back(o);
+			m_counters.add_histogram_sample(counters::dht_timeout_latency
+				, total_microseconds(diff - timeout));
+			m_timeouts.push_back(std::move(t->o));
+			remove_transaction(*t);
 			continue;
 		}
 
@@ -429,23 +515,38 @@ time_duration rpc_manager::tick()
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_log->should_log(dht_logger::rpc_manager))
 			{
-				m_log->log(dht_logger::rpc_manager, "[%u] short-timing out transaction id: %d from: %s"
-					, o->algorithm()->id(), i->first
+				m_log->log(dht_logger::rpc_manager, "[%u] short-timing out transaction [ slot: %d ] from: %s"
+					, o->algorithm()->id(), int(e.slot)
 					, print_endpoint(o->target_ep()).c_str());
 			}
 #endif
-			++i;
-
-			short_timeouts.push_back(o);
+			m_counters.add_histogram_sample(counters::dht_timeout_latency
+				, total_microseconds(diff - short_timeout));
+			m_short_timeouts.push_back(o);
+			schedule_timeout(*t, o->sent() + timeout);
 			continue;
 		}
 
-		ret = std::min(duration_cast<time_duration>(timeout - diff), ret);
-		++i;
+		schedule_timeout(*t, o->sent()
+			+ (o->has_short_timeout() ? timeout : short_timeout));
 	}
+	m_due.clear();
 
-	std::for_each(timeouts.begin(), timeouts.end(), std::bind(&observer::timeout, _1));
-	std::for_each(short_timeouts.begin(), short_timeouts.end(), std::bind(&observer::short_timeout, _1));
+	// wake up when the next bucket with entries is due. Requests sent in the
+	// meantime need their short timeout checked no later than short_timeout
+	time_duration ret = short_timeout;
+	int const horizon = int(short_timeout / timer_resolution);
+	for (int i = 0; i < horizon; ++i)
+	{
+		if (m_wheel[(m_wheel_pos + i) % wheel_size].empty()) continue;
+		ret = m_wheel_time + timer_resolution * (i + 1) - now;
+		break;
+	}
+
+	for (auto const& o : m_timeouts) o->timeout();
+	m_timeouts.clear();
+	for (auto const& o : m_short_timeouts) o->short_timeout();
+	m_short_timeouts.clear();
 
 	return std::max(ret, duration_cast<time_duration>(milliseconds(200)));
 }
@@ -466,11 +567,14 @@ bool rpc_manager::invoke(entry& e, udp::endpoint const& target_addr
 	entry& a = e["a"];
 	add_our_id(a);
 
+	transaction* t = add_transaction(o);
+	if (t == nullptr) return false;
+
 	std::string transaction_id;
-	transaction_id.resize(2);
+	transaction_id.resize(4);
 	char* out = &transaction_id[0];
-	std::uint16_t const tid = std::uint16_t(random(0xffff));
-	aux::write_uint16(tid, out);
+	aux::write_uint16(std::uint16_t(t - m_transactions.data()), out);
+	aux::write_uint16(t->tag, out);
 	e["t"] = transaction_id;
 
 	// When a DHT node enters the read-only state, in each outgoing query message,
@@ -496,12 +600,13 @@ bool rpc_manager::invoke(entry& e, udp::endpoint const& target_addr
 
 	if (m_sock_man->send_packet(m_sock, e, target_addr))
 	{
-		m_transactions.emplace(tid, o);
+		schedule_timeout(*t, o->sent() + short_timeout);
 #if TORRENT_USE_ASSERTS
 		o->m_was_sent = true;
 #endif
 		return true;
 	}
+	remove_transaction(*t);
 	return false;
 }
 
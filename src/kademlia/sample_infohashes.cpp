@@ -45,9 +45,11 @@ namespace libtorrent { namespace dht
 
 sample_infohashes::sample_infohashes(node& dht_node
 	, node_id const& target
-	, data_callback dcallback)
+	, data_callback dcallback
+	, failed_callback fcallback)
 	: traversal_algorithm(dht_node, target)
-	, m_data_callback(std::move(dcallback)) {}
+	, m_data_callback(std::move(dcallback))
+	, m_failed_callback(std::move(fcallback)) {}
 
 char const* sample_infohashes::name() const { return "sample_infohashes"; }
 
@@ -60,10 +62,23 @@ void sample_infohashes::got_samples(sha1_hash const& nid
 	{
 		m_data_callback(nid, interval, num, std::move(samples), std::move(nodes));
 		m_data_callback = nullptr;
+		m_failed_callback = nullptr;
 		done();
 	}
 }
 
+void sample_infohashes::request_failed()
+{
+	if (!m_data_callback) return;
+	m_data_callback = nullptr;
+	if (m_failed_callback)
+	{
+		auto f = std::move(m_failed_callback);
+		m_failed_callback = nullptr;
+		f();
+	}
+}
+
 sample_infohashes_observer::sample_infohashes_observer(
 	std::shared_ptr<traversal_algorithm> algorithm
 	, udp::endpoint const& ep, node_id const& id)
@@ -158,4 +173,11 @@ void sample_infohashes_observer::reply(msg const& m)
 	flags |= flag_done;
 }
 
+void sample_infohashes_observer::timeout()
+{
+	if (flags & flag_done) return;
+	static_cast<sample_infohashes*>(algorithm())->request_failed();
+	traversal_observer::timeout();
+}
+
 }} // namespace libtorrent::dht
@@ -0,0 +1,138 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/kademlia/signature_verifier.hpp"
+#include "libtorrent/kademlia/item.hpp" // for verify_mutable_item
+#include "libtorrent/aux_/handler_timer.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace libtorrent {
+namespace dht {
+
+namespace {
+
+	// don't let the queue of puts waiting for a worker grow without bounds.
+	// Once it's full, the network thread verifies puts itself
+	constexpr std::size_t max_queued_puts = 4096;
+
+	// the most puts a worker takes at a time. Taking them in batches
+	// amortizes the locking and waking of the network thread, while still
+	// spreading a burst across the workers
+	constexpr std::size_t batch_size = 32;
+}
+
+	signature_verifier::signature_verifier(int const num_threads
+		, std::function<void()> wake)
+		: m_wake(std::move(wake))
+		, m_num_threads(num_threads)
+	{
+		TORRENT_ASSERT(num_threads > 0);
+		for (int i = 0; i < num_threads; ++i)
+			m_threads.emplace_back(&signature_verifier::thread_fun, this);
+	}
+
+	signature_verifier::~signature_verifier()
+	{
+		stop();
+	}
+
+	void signature_verifier::stop()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			m_abort = true;
+			m_incoming.clear();
+		}
+		m_cond.notify_all();
+		for (auto& t : m_threads) t.join();
+		m_threads.clear();
+	}
+
+	bool signature_verifier::post(mutable_put&& p)
+	{
+		{
+			std::lock_guard<std::mutex> l(m_mutex);
+			if (m_abort || m_incoming.size() >= max_queued_puts)
+				return false;
+			m_incoming.emplace_back(std::move(p));
+		}
+		m_cond.notify_one();
+		return true;
+	}
+
+	void signature_verifier::take(std::vector<mutable_put>& out)
+	{
+		std::lock_guard<std::mutex> l(m_mutex);
+		out.swap(m_outgoing);
+	}
+
+	void signature_verifier::thread_fun()
+	{
+		aux::exclude_thread_from_handler_timers();
+
+		std::vector<mutable_put> batch;
+
+		std::unique_lock<std::mutex> l(m_mutex);
+		for (;;)
+		{
+			m_cond.wait(l, [this] { return m_abort || !m_incoming.empty(); });
+			if (m_abort) return;
+
+			// leave the rest of a burst to the other workers
+			std::size_t const n = std::min(batch_size
+				, (m_incoming.size() + std::size_t(m_num_threads) - 1) / std::size_t(m_num_threads));
+			batch.assign(std::make_move_iterator(m_incoming.begin())
+				, std::make_move_iterator(m_incoming.begin() + std::ptrdiff_t(n)));
+			m_incoming.erase(m_incoming.begin(), m_incoming.begin() + std::ptrdiff_t(n));
+			l.unlock();
+
+			for (auto& p : batch)
+				p.valid = verify_mutable_item(p.value, p.salt, p.seq, p.pk, p.sig);
+
+			l.lock();
+			bool const wake = m_outgoing.empty();
+			m_outgoing.insert(m_outgoing.end(), std::make_move_iterator(batch.begin())
+				, std::make_move_iterator(batch.end()));
+			batch.clear();
+			if (wake)
+			{
+				l.unlock();
+				m_wake();
+				l.lock();
+			}
+		}
+	}
+}
+}
@@ -341,7 +341,11 @@ void traversal_algorithm::failed(observer_ptr o, traversal_flags_t const flags)
 	// don't tell the routing table about
 	// node ids that we just generated ourself
 	if (!(o->flags & observer::flag_no_id))
+	{
 		m_node.m_table.node_failed(o->id(), o->target_ep());
+		if (!(flags & short_timeout))
+			m_node.nearby_node_failed(o->id(), o->target_ep());
+	}
 
 	if (m_results.empty()) return;
 
@@ -47,6 +47,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/torrent_info.hpp"
 #include "libtorrent/aux_/disk_buffer_pool.hpp"
 #include "libtorrent/aux_/mmap_disk_job.hpp"
+#include "libtorrent/aux_/trace.hpp"
 #include "libtorrent/performance_counters.hpp"
 #include "libtorrent/debug.hpp"
 #include "libtorrent/units.hpp"
@@ -526,6 +527,20 @@ TORRENT_EXPORT std::unique_ptr<disk_interface> mmap_disk_io_constructor(
 		}
 	}
 
+	char const* job_name(aux::job_action_t const job)
+	{
+		static char const* const job_names[] =
+		{
+			"read", "write", "hash", "hash2", "move_storage", "release_files"
+			, "delete_files", "check_fastresume", "rename_file", "stop_torrent"
+			, "file_priority", "clear_piece", "partial_read"
+		};
+		static_assert(sizeof(job_names) / sizeof(job_names[0])
+			== static_cast<std::size_t>(aux::job_action_t::num_job_ids)
+			, "job_names out of sync with job_action_t");
+		return job_names[static_cast<std::size_t>(job)];
+	}
+
 	namespace {
 
 	typedef status_t (mmap_disk_io::*disk_io_fun_t)(aux::mmap_disk_job* j);
@@ -574,6 +589,9 @@ TORRENT_EXPORT std::unique_ptr<disk_interface> mmap_disk_io_constructor(
 
 		m_stats_counters.inc_stats_counter(counters::num_running_disk_jobs, 1);
 
+		time_point const start_time = clock_type::now();
+		aux::trace_scope trace("disk", job_name(j->action), static_cast<int>(j->piece));
+
 		// call disk function
 		// TODO: in the future, propagate exceptions back to the handlers
 		status_t ret = status_t::no_error;
@@ -607,6 +625,27 @@ TORRENT_EXPORT std::unique_ptr<disk_interface> mmap_disk_io_constructor(
 
 		m_stats_counters.inc_stats_counter(counters::num_running_disk_jobs, -1);
 
+		int histogram;
+		switch (j->action)
+		{
+			case aux::job_action_t::read:
+			case aux::job_action_t::partial_read:
+				histogram = counters::disk_read_latency;
+				break;
+			case aux::job_action_t::write:
+				histogram = counters::disk_write_latency;
+				break;
+			case aux::job_action_t::hash:
+			case aux::job_action_t::hash2:
+				histogram = counters::disk_hash_latency;
+				break;
+			default:
+				histogram = counters::disk_other_latency;
+				break;
+		}
+		m_stats_counters.add_histogram_sample(histogram
+			, total_microseconds(clock_type::now() - start_time));
+
 		j->ret = ret;
 
 		completed_jobs.push_back(j);
@@ -1393,6 +1432,7 @@ TORRENT_EXPORT std::unique_ptr<disk_interface> mmap_disk_io_constructor(
 	void mmap_disk_io::add_job(aux::mmap_disk_job* j, bool const user_add)
 	{
 		TORRENT_ASSERT(m_magic == 0x1337);
+		aux::trace_instant("disk", "enqueue", static_cast<int>(j->action));
 
 		TORRENT_ASSERT(!j->storage || j->storage->files().is_valid());
 		TORRENT_ASSERT(j->next == nullptr);
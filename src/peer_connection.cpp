@@ -78,6 +78,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/array.hpp"
 #include "libtorrent/aux_/set_socket_buffer.hpp"
 #include "libtorrent/aux_/set_traffic_class.hpp"
+#include "libtorrent/aux_/trace.hpp"
 
 #if TORRENT_USE_ASSERTS
 #include <set>
@@ -2585,6 +2586,7 @@ namespace libtorrent {
 			TORRENT_ASSERT(r.length > 0);
 
 			m_requests.push_back(r);
+			m_request_times.push_back(clock_type::now());
 
 			if (t->alerts().should_post<incoming_request_alert>())
 			{
@@ -2606,6 +2608,7 @@ namespace libtorrent {
 			peer_request const& r = *i;
 			if (r.piece != index) continue;
 			write_reject_request(r);
+			m_request_times.erase(m_request_times.begin() + (i - m_requests.begin()));
 			i = m_requests.erase(i);
 
 			if (m_requests.empty())
@@ -2898,6 +2901,8 @@ namespace libtorrent {
 			if (m_disconnecting) return;
 
 			m_request_time.add_sample(int(total_milliseconds(now - m_requested.get(m_connect))));
+			m_counters.add_histogram_sample(counters::download_request_latency
+				, total_microseconds(now - m_requested.get(m_connect)));
 #ifndef TORRENT_DISABLE_LOGGING
 			if (should_log(peer_log_alert::info))
 			{
@@ -2977,6 +2982,8 @@ namespace libtorrent {
 		}
 
 		m_request_time.add_sample(int(total_milliseconds(now - m_requested.get(m_connect))));
+		m_counters.add_histogram_sample(counters::download_request_latency
+			, total_microseconds(now - m_requested.get(m_connect)));
 #ifndef TORRENT_DISABLE_LOGGING
 		if (should_log(peer_log_alert::info))
 		{
@@ -3255,6 +3262,7 @@ namespace libtorrent {
 		if (i != m_requests.end())
 		{
 			m_counters.inc_stats_counter(counters::cancelled_piece_requests);
+			m_request_times.erase(m_request_times.begin() + (i - m_requests.begin()));
 			m_requests.erase(i);
 
 			if (m_requests.empty())
@@ -3812,6 +3820,7 @@ namespace libtorrent {
 			peer_request const& r = *i;
 			m_counters.inc_stats_counter(counters::choked_piece_requests);
 			write_reject_request(r);
+			m_request_times.erase(m_request_times.begin() + (i - m_requests.begin()));
 			i = m_requests.erase(i);
 
 			if (m_requests.empty())
@@ -5232,6 +5241,7 @@ namespace libtorrent {
 			for (peer_request const& r : m_requests)
 				write_reject_request(r);
 			m_requests.clear();
+			m_request_times.clear();
 			return;
 		}
 
@@ -5323,11 +5333,13 @@ namespace libtorrent {
 				TORRENT_ASSERT(r.piece < t->torrent_file().end_piece());
 
 				m_disk_thread.async_read(t->storage(), r
-					, [conn = self(), r](disk_buffer_holder buf, storage_error const& ec)
-					{ conn->wrap(&peer_connection::on_disk_read_complete, std::move(buf), ec, r, clock_type::now()); });
+					, [conn = self(), r, issue_time = clock_type::now(), request_time = m_request_times[i]]
+					(disk_buffer_holder buf, storage_error const& ec)
+					{ conn->wrap(&peer_connection::on_disk_read_complete, std::move(buf), ec, r, issue_time, request_time); });
 			}
 			m_last_sent_payload.set(m_connect, clock_type::now());
 			m_requests.erase(m_requests.begin() + i);
+			m_request_times.erase(m_request_times.begin() + i);
 
 			if (m_requests.empty())
 				m_counters.inc_stats_counter(counters::num_peers_up_requests, -1);
@@ -5499,7 +5511,8 @@ namespace libtorrent {
 
 	void peer_connection::on_disk_read_complete(disk_buffer_holder buffer
 		, storage_error const& error
-		, peer_request const& r, time_point const issue_time)
+		, peer_request const& r, time_point const issue_time
+		, time_point const request_time)
 	{
 		TORRENT_ASSERT(is_single_thread());
 		TORRENT_ASSERT(r.length >= 0);
@@ -5582,6 +5595,8 @@ namespace libtorrent {
 			t->add_suggest_piece(r.piece);
 		}
 		write_piece(r, std::move(buffer));
+		m_counters.add_histogram_sample(counters::upload_request_latency
+			, total_microseconds(clock_type::now() - request_time));
 	}
 
 	void peer_connection::assign_bandwidth(int const channel, int const amount)
@@ -6024,6 +6039,7 @@ namespace libtorrent {
 	{
 		TORRENT_ASSERT(is_single_thread());
 		COMPLETE_ASYNC("peer_connection::on_receive_data");
+		aux::trace_scope trace("net", "socket_read", std::int64_t(bytes_transferred));
 
 #ifndef TORRENT_DISABLE_LOGGING
 		if (should_log(peer_log_alert::incoming))
@@ -6356,6 +6372,7 @@ namespace libtorrent {
 		, std::size_t const bytes_transferred)
 	{
 		TORRENT_ASSERT(is_single_thread());
+		aux::trace_scope trace("net", "socket_write", std::int64_t(bytes_transferred));
 		m_counters.inc_stats_counter(counters::on_write_counter);
 		m_ses.sent_buffer(int(bytes_transferred));
 
@@ -6552,6 +6569,7 @@ namespace libtorrent {
 			TORRENT_ASSERT(m_outstanding_bytes == outstanding_bytes);
 		}
 
+		TORRENT_ASSERT(m_requests.size() == m_request_times.size());
 		for (auto const& r : m_requests)
 		{
 			TORRENT_ASSERT(r.piece >= piece_index_t(0));
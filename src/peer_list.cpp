@@ -36,6 +36,7 @@ POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <functional>
+#include <limits>
 
 #include "libtorrent/peer_connection.hpp"
 #include "libtorrent/web_peer_connection.hpp"
@@ -533,6 +534,11 @@ namespace libtorrent {
 
 		int max_peerlist_size = state->max_peerlist_size;
 
+		// if we get to look at every peer, and none of them can be connected
+		// to yet, we can tell the torrent when to try again
+		bool const visit_all = int(m_peers.size()) <= 300;
+		int next_connect = std::numeric_limits<int>::max();
+
 		// TODO: 2 it would be nice if there was a way to iterate over these
 		// torrent_peer objects in the order they are allocated in the pool
 		// instead. It would probably be more efficient
@@ -577,7 +583,11 @@ namespace libtorrent {
 			if (pe.last_connected
 				&& session_time - pe.last_connected <
 				(int(pe.failcount) + 1) * state->min_reconnect_time)
+			{
+				next_connect = std::min(next_connect, pe.last_connected
+					+ (int(pe.failcount) + 1) * state->min_reconnect_time);
 				continue;
+			}
 
 			// compare peer returns true if lhs is better than rhs. In this
 			// case, it returns true if the current candidate is better than
@@ -600,6 +610,10 @@ namespace libtorrent {
 		{
 			erase_peer(m_peers.begin() + erase_candidate, state);
 		}
+
+		if (peers.empty() && visit_all
+			&& next_connect != std::numeric_limits<int>::max())
+			state->next_connect = next_connect;
 	}
 
 	bool peer_list::new_connection(peer_connection_interface& c, int session_time
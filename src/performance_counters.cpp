@@ -34,16 +34,38 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/performance_counters.hpp"
 #include "libtorrent/assert.hpp"
 #include <cstring> // for memset
+#include <algorithm> // for min
 
 namespace libtorrent {
 
+#ifdef ATOMIC_LLONG_LOCK_FREE
+namespace {
+
+	// each thread is assigned a shard the first time it touches any counters
+	// object. Threads are spread out round-robin across the shards
+	int thread_shard()
+	{
+		static std::atomic<int> next_shard{0};
+		thread_local int const shard
+			= next_shard.fetch_add(1, std::memory_order_relaxed) % counters::num_shards;
+		return shard;
+	}
+}
+#endif
+
+	constexpr int counters::num_shards;
+	constexpr int counters::num_histogram_buckets;
+
 	// TODO: move stats_counter_t out of counters
 	// TODO: should bittorrent keep-alive messages have a counter too?
 	// TODO: It would be nice if this could be an internal type. default_disk_constructor depends on it now
 	counters::counters() TORRENT_COUNTER_NOEXCEPT
 	{
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		for (auto& counter : m_stats_counter)
+		for (auto& s : m_shards)
+			for (auto& counter : s.counter)
+				counter.store(0, std::memory_order_relaxed);
+		for (auto& counter : m_gauges)
 			counter.store(0, std::memory_order_relaxed);
 #else
 		m_stats_counter.fill(0);
@@ -53,9 +75,14 @@ namespace libtorrent {
 	counters::counters(counters const& c) TORRENT_COUNTER_NOEXCEPT
 	{
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		for (int i = 0; i < m_stats_counter.end_index(); ++i)
-			m_stats_counter[i].store(
-				c.m_stats_counter[i].load(std::memory_order_relaxed)
+		for (int s = 0; s < num_shards; ++s)
+			for (int i = 0; i < num_stats_counters; ++i)
+				m_shards[s].counter[i].store(
+					c.m_shards[s].counter[i].load(std::memory_order_relaxed)
+						, std::memory_order_relaxed);
+		for (int i = 0; i < m_gauges.end_index(); ++i)
+			m_gauges[i].store(
+				c.m_gauges[i].load(std::memory_order_relaxed)
 					, std::memory_order_relaxed);
 #else
 		std::lock_guard<std::mutex> l(c.m_mutex);
@@ -67,9 +94,14 @@ namespace libtorrent {
 	{
 		if (&c == this) return *this;
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		for (int i = 0; i < m_stats_counter.end_index(); ++i)
-			m_stats_counter[i].store(
-				c.m_stats_counter[i].load(std::memory_order_relaxed)
+		for (int s = 0; s < num_shards; ++s)
+			for (int i = 0; i < num_stats_counters; ++i)
+				m_shards[s].counter[i].store(
+					c.m_shards[s].counter[i].load(std::memory_order_relaxed)
+						, std::memory_order_relaxed);
+		for (int i = 0; i < m_gauges.end_index(); ++i)
+			m_gauges[i].store(
+				c.m_gauges[i].load(std::memory_order_relaxed)
 					, std::memory_order_relaxed);
 #else
 		std::lock_guard<std::mutex> l(m_mutex);
@@ -85,7 +117,13 @@ namespace libtorrent {
 		TORRENT_ASSERT(i < num_counters);
 
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		return m_stats_counter[i].load(std::memory_order_relaxed);
+		if (i >= num_stats_counters)
+			return m_gauges[i - num_stats_counters].load(std::memory_order_relaxed);
+
+		std::int64_t ret = 0;
+		for (auto const& s : m_shards)
+			ret += s.counter[i].load(std::memory_order_relaxed);
+		return ret;
 #else
 		std::lock_guard<std::mutex> l(m_mutex);
 		return m_stats_counter[i];
@@ -104,7 +142,10 @@ namespace libtorrent {
 		TORRENT_ASSERT(c < num_counters);
 
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		std::int64_t pv = m_stats_counter[c].fetch_add(value, std::memory_order_relaxed);
+		std::atomic<std::int64_t>& counter = c >= num_stats_counters
+			? m_gauges[c - num_stats_counters]
+			: m_shards[thread_shard()].counter[c];
+		std::int64_t pv = counter.fetch_add(value, std::memory_order_relaxed);
 		TORRENT_ASSERT(pv + value >= 0);
 		return pv + value;
 #else
@@ -124,10 +165,11 @@ namespace libtorrent {
 		TORRENT_ASSERT(ratio <= 100);
 
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		std::int64_t current = m_stats_counter[c].load(std::memory_order_relaxed);
+		std::atomic<std::int64_t>& counter = m_gauges[c - num_stats_counters];
+		std::int64_t current = counter.load(std::memory_order_relaxed);
 		std::int64_t new_value = (current * (100 - ratio) + value * ratio) / 100;
 
-		while (!m_stats_counter[c].compare_exchange_weak(current, new_value
+		while (!counter.compare_exchange_weak(current, new_value
 			, std::memory_order_relaxed))
 		{
 			new_value = (current * (100 - ratio) + value * ratio) / 100;
@@ -145,7 +187,16 @@ namespace libtorrent {
 		TORRENT_ASSERT(c < num_counters);
 
 #ifdef ATOMIC_LLONG_LOCK_FREE
-		m_stats_counter[c].store(value);
+		if (c >= num_stats_counters)
+		{
+			m_gauges[c - num_stats_counters].store(value);
+			return;
+		}
+
+		// the whole value goes in the calling thread's shard
+		int const own = thread_shard();
+		for (int s = 0; s < num_shards; ++s)
+			m_shards[s].counter[c].store(s == own ? value : 0);
 #else
 		std::lock_guard<std::mutex> l(m_mutex);
 
@@ -157,4 +208,39 @@ namespace libtorrent {
 #endif
 	}
 
+	void counters::add_histogram_sample(int const h, std::int64_t const value) TORRENT_COUNTER_NOEXCEPT
+	{
+		TORRENT_ASSERT(is_histogram(h));
+		inc_stats_counter(h + histogram_bucket(value));
+	}
+
+	bool counters::is_histogram(int const c) noexcept
+	{
+		return c >= disk_read_latency && c < num_stats_counters
+			&& (c - disk_read_latency) % num_histogram_buckets == 0;
+	}
+
+	int counters::histogram_bucket(std::int64_t const value) noexcept
+	{
+		if (value < 4) return value < 0 ? 0 : int(value);
+
+		// the index of the most significant bit
+		int exp = 2;
+		while (exp < 62 && (value >> (exp + 1)) != 0) ++exp;
+
+		// the two bits below the most significant one select the linear
+		// sub-bucket
+		int const sub = int((value >> (exp - 2)) & 3);
+		return std::min(4 * (exp - 1) + sub, num_histogram_buckets - 1);
+	}
+
+	std::int64_t counters::histogram_bucket_lower_bound(int const bucket) noexcept
+	{
+		TORRENT_ASSERT(bucket >= 0);
+		TORRENT_ASSERT(bucket < num_histogram_buckets);
+		if (bucket < 4) return bucket;
+		int const exp = bucket / 4 + 1;
+		int const sub = bucket % 4;
+		return (std::int64_t(4 + sub)) << (exp - 2);
+	}
 }
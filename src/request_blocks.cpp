@@ -39,6 +39,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/request_blocks.hpp"
 #include "libtorrent/aux_/alert_manager.hpp"
 #include "libtorrent/aux_/has_block.hpp"
+#include "libtorrent/aux_/trace.hpp"
 
 #include <vector>
 
@@ -177,10 +178,12 @@ namespace libtorrent {
 		// the last argument is if we should prefer whole pieces
 		// for this peer. If we're downloading one piece in 20 seconds
 		// then use this mode.
+		aux::trace_scope trace("picker", "request_a_block");
 		picker_flags_t const flags = p.pick_pieces(*bits, interesting_pieces
 			, num_requests, prefer_contiguous_blocks, c.peer_info_struct()
 			, c.picker_options(), suggested, t.num_peers()
 			, ses.stats_counters());
+		trace.arg(int(interesting_pieces.size()));
 
 #ifndef TORRENT_DISABLE_LOGGING
 		if (t.alerts().should_post<picker_log_alert>()
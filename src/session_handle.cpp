@@ -35,6 +35,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/session_handle.hpp"
 #include "libtorrent/aux_/session_impl.hpp"
 #include "libtorrent/aux_/session_call.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
 #include "libtorrent/aux_/throw.hpp"
 #include "libtorrent/aux_/path.hpp"
 #include "libtorrent/torrent.hpp"
@@ -42,6 +43,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/peer_class.hpp"
 #include "libtorrent/peer_class_type_filter.hpp"
 #include "libtorrent/aux_/scope_end.hpp"
+#include "libtorrent/aux_/trace.hpp"
 
 #if TORRENT_ABI_VERSION == 1
 #include "libtorrent/read_resume_data.hpp"
@@ -85,6 +87,7 @@ namespace libtorrent {
 	constexpr remove_flags_t session_handle::delete_partfile;
 
 	constexpr reopen_network_flags_t session_handle::reopen_map_ports;
+	constexpr torrent_updates_flags_t session_handle::changed_fields_only;
 
 	template <typename Fun, typename... Args>
 	void session_handle::async_call(Fun f, Args&&... a) const
@@ -93,6 +96,7 @@ namespace libtorrent {
 		if (!s) aux::throw_ex<system_error>(errors::invalid_session_handle);
 		dispatch(s->get_context(), [=]() mutable
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -123,6 +127,7 @@ namespace libtorrent {
 		std::exception_ptr ex;
 		dispatch(s->get_context(), [=, &done, &ex]() mutable
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -155,6 +160,7 @@ namespace libtorrent {
 		std::exception_ptr ex;
 		dispatch(s->get_context(), [=, &r, &done, &ex]() mutable
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -221,7 +227,14 @@ namespace libtorrent {
 
 	void session_handle::post_torrent_updates(status_flags_t const flags)
 	{
-		async_call(&session_impl::post_torrent_updates, flags);
+		async_call(&session_impl::post_torrent_updates, flags
+			, torrent_updates_flags_t{});
+	}
+
+	void session_handle::post_torrent_updates(status_flags_t const flags
+		, torrent_updates_flags_t const updates_flags)
+	{
+		async_call(&session_impl::post_torrent_updates, flags, updates_flags);
 	}
 
 	void session_handle::post_session_stats()
@@ -229,6 +242,13 @@ namespace libtorrent {
 		async_call(&session_impl::post_session_stats);
 	}
 
+	std::string session_handle::dump_trace() const
+	{
+		// the trace buffers are process-wide and safe to read from any
+		// thread, there's no need to involve the network thread
+		return aux::dump_trace();
+	}
+
 	void session_handle::post_dht_stats()
 	{
 		async_call(&session_impl::post_dht_stats);
@@ -728,6 +748,20 @@ namespace {
 #endif
 	}
 
+	void session_handle::dht_start_crawl()
+	{
+#ifndef TORRENT_DISABLE_DHT
+		async_call(&session_impl::dht_start_crawl);
+#endif
+	}
+
+	void session_handle::dht_stop_crawl()
+	{
+#ifndef TORRENT_DISABLE_DHT
+		async_call(&session_impl::dht_stop_crawl);
+#endif
+	}
+
 	void session_handle::dht_direct_request(udp::endpoint const& ep, entry const& e
 		, client_data_t userdata)
 	{
@@ -1173,6 +1207,13 @@ namespace {
 		s->pop_alerts(alerts);
 	}
 
+	void session_handle::pop_alerts(std::function<void(alert*)> const& handler)
+	{
+		std::shared_ptr<session_impl> s = m_impl.lock();
+		if (!s) aux::throw_ex<system_error>(errors::invalid_session_handle);
+		s->pop_alerts(handler);
+	}
+
 	alert* session_handle::wait_for_alert(time_duration max_wait)
 	{
 		std::shared_ptr<session_impl> s = m_impl.lock();
@@ -107,6 +107,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/ffs.hpp"
 #include "libtorrent/aux_/array.hpp"
 #include "libtorrent/aux_/set_traffic_class.hpp"
+#include "libtorrent/aux_/trace.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
 
 #ifndef TORRENT_DISABLE_LOGGING
 
@@ -1052,6 +1054,11 @@ bool ssl_server_name_callback(ssl::stream_handle_type stream_handle, std::string
 
 		m_close_file_timer.cancel();
 
+		// tracing is process-wide. Don't leave it recording after the session
+		// that enabled it is gone
+		if (m_settings.get_bool(settings_pack::enable_tracing))
+			aux::set_trace_enabled(false);
+
 		// abort the main thread
 		m_abort = true;
 		error_code ec;
@@ -2584,12 +2591,14 @@ namespace {
 						&& buf.back() == 'e'
 						&& listen_socket)
 					{
+						aux::handler_timer timer(aux::handler_category::dht);
 						handled = m_dht->incoming_packet(listen_socket, packet.from, buf);
 					}
 #endif
 
 					if (!handled)
 					{
+						aux::handler_timer timer(aux::handler_category::tracker);
 						m_tracker_manager.incoming_packet(packet.from, buf);
 					}
 				}
@@ -3391,17 +3400,31 @@ namespace {
 			std::abort();
 		}
 
+		// how late the timer fired is a measure of how busy the network
+		// thread is
+		if (!e) m_stats_counters.add_histogram_sample(counters::event_loop_lag
+			, std::max(std::int64_t(0), total_microseconds(now - m_timer.expiry())));
+
 		ADD_OUTSTANDING_ASYNC("session_impl::on_tick");
 		milliseconds const tick_interval(m_abort ? 100 : m_settings.get_int(settings_pack::tick_interval));
 		m_timer.expires_at(now + tick_interval);
 		m_timer.async_wait(aux::make_handler([this](error_code const& err)
 		{ wrap(&session_impl::on_tick, err); }, m_tick_handler_storage, *this));
 
-		m_download_rate.update_quotas(now - m_last_tick);
-		m_upload_rate.update_quotas(now - m_last_tick);
+		time_duration const tick_dt = now - m_last_tick;
+		m_download_rate.update_quotas(tick_dt);
+		m_upload_rate.update_quotas(tick_dt);
 
 		m_last_tick = now;
 
+		// --------------------------------------------------------------
+		// connect new peers
+		// --------------------------------------------------------------
+
+		// connection attempts are paced every tick, rather than made in a
+		// burst once per second
+		try_connect_more_peers(tick_dt);
+
 		m_utp_socket_manager.tick(now);
 #ifdef TORRENT_SSL_PEERS
 		m_ssl_utp_socket_manager.tick(now);
@@ -3623,20 +3646,17 @@ namespace {
 			}
 		}
 
-		// --------------------------------------------------------------
-		// connect new peers
-		// --------------------------------------------------------------
-
-		try_connect_more_peers();
-
 		// --------------------------------------------------------------
 		// unchoke set calculations
 		// --------------------------------------------------------------
+		std::vector<std::shared_ptr<peer_connection>> unchoke_candidates;
+		bool have_unchoke_candidates = false;
 		m_unchoke_time_scaler--;
 		if (m_unchoke_time_scaler <= 0 && !m_connections.empty())
 		{
 			m_unchoke_time_scaler = settings().get_int(settings_pack::unchoke_interval);
-			recalculate_unchoke_slots();
+			recalculate_unchoke_slots(&unchoke_candidates);
+			have_unchoke_candidates = true;
 		}
 
 		// --------------------------------------------------------------
@@ -3647,7 +3667,8 @@ namespace {
 		{
 			m_optimistic_unchoke_time_scaler
 				= settings().get_int(settings_pack::optimistic_unchoke_interval);
-			recalculate_optimistic_unchoke_slots();
+			recalculate_optimistic_unchoke_slots(have_unchoke_candidates
+				? &unchoke_candidates : nullptr);
 		}
 
 		// --------------------------------------------------------------
@@ -3720,6 +3741,24 @@ namespace {
 		m_prio_torrents.emplace_back(t, 10);
 	}
 
+namespace {
+	struct deferred_connect_later
+	{
+		template <typename T>
+		bool operator()(T const& lhs, T const& rhs) const
+		{ return lhs.first > rhs.first; }
+	};
+}
+
+	void session_impl::defer_connect(std::weak_ptr<torrent> t, std::uint16_t const until)
+	{
+		// this is when session_time() reaches ``until``
+		time_point const wake = m_created + seconds(std::max(int(until) - 1, 0));
+		m_deferred_connects.emplace_back(wake, std::move(t));
+		std::push_heap(m_deferred_connects.begin(), m_deferred_connects.end()
+			, deferred_connect_later());
+	}
+
 #ifndef TORRENT_DISABLE_DHT
 
 	void session_impl::add_dht_node(udp::endpoint const& n)
@@ -3814,12 +3853,31 @@ namespace {
 		}
 		if (m_torrents.empty()) return;
 
-		if (m_next_dht_torrent >= m_torrents.size())
-			m_next_dht_torrent = 0;
-		m_torrents[m_next_dht_torrent]->dht_announce();
-		// TODO: 2 make a list for torrents that want to be announced on the DHT so we
-		// don't have to loop over all torrents, just to find the ones that want to announce
-		++m_next_dht_torrent;
+		// the timer fires at most once per second. With more torrents than
+		// seconds in the announce interval, and a DHT packet budget (see
+		// settings_pack::dht_announce_rate_limit) to spread the announces
+		// out, announce a batch of them every time, to still get around to
+		// all of them within the interval. Without a budget, stick to one
+		// announce per tick, to not flood the DHT
+		int batch = 1;
+		if (m_settings.get_int(settings_pack::dht_announce_rate_limit) > 0)
+		{
+			int const num_torrents = int(m_torrents.size());
+			int const interval = std::max(m_settings.get_int(settings_pack::dht_announce_interval), 1);
+			int const delay = std::max(interval / num_torrents, 1);
+			batch = std::min(std::max(int((std::int64_t(num_torrents) * delay
+				+ interval - 1) / interval), 1), num_torrents);
+		}
+
+		for (int i = 0; i < batch; ++i)
+		{
+			if (m_next_dht_torrent >= m_torrents.size())
+				m_next_dht_torrent = 0;
+			m_torrents[m_next_dht_torrent]->dht_announce();
+			// TODO: 2 make a list for torrents that want to be announced on the DHT so we
+			// don't have to loop over all torrents, just to find the ones that want to announce
+			++m_next_dht_torrent;
+		}
 		if (m_next_dht_torrent >= m_torrents.size())
 			m_next_dht_torrent = 0;
 	}
@@ -3937,6 +3995,7 @@ namespace {
 	void session_impl::recalculate_auto_managed_torrents()
 	{
 		INVARIANT_CHECK;
+		aux::handler_timer timer(aux::handler_category::auto_manage);
 
 		m_last_auto_manage = time_now();
 		m_need_auto_manage = false;
@@ -3970,20 +4029,28 @@ namespace {
 			// of checking torrents we allow. The rest of the list is still used to
 			// make sure the remaining torrents are paused, but their order is not
 			// relevant
-			std::partial_sort(checking.begin(), checking.begin() +
-				std::min(checking_limit, int(checking.size())), checking.end()
+			aux::select_top(checking.begin(), checking.end(), checking_limit
 				, [](torrent const* lhs, torrent const* rhs)
 				{ return lhs->sequence_number() < rhs->sequence_number(); });
 
-			std::partial_sort(downloaders.begin(), downloaders.begin() +
-				std::min(hard_limit, int(downloaders.size())), downloaders.end()
+			aux::select_top(downloaders.begin(), downloaders.end(), hard_limit
 				, [](torrent const* lhs, torrent const* rhs)
 				{ return lhs->sequence_number() < rhs->sequence_number(); });
 
-			std::partial_sort(seeds.begin(), seeds.begin() +
-				std::min(hard_limit, int(seeds.size())), seeds.end()
-				, [this](torrent const* lhs, torrent const* rhs)
-				{ return lhs->seed_rank(m_settings) > rhs->seed_rank(m_settings); });
+			// computing the seed rank is not trivial, so compute it once per
+			// torrent rather than in every comparison
+			m_seed_ranks.clear();
+			m_seed_ranks.reserve(seeds.size());
+			for (torrent* t : seeds)
+				m_seed_ranks.emplace_back(t->seed_rank(m_settings), t);
+
+			aux::select_top(m_seed_ranks.begin(), m_seed_ranks.end(), hard_limit
+				, [](std::pair<int, torrent*> const& lhs, std::pair<int, torrent*> const& rhs)
+				{ return lhs.first > rhs.first; });
+
+			std::transform(m_seed_ranks.begin(), m_seed_ranks.end(), seeds.begin()
+				, [](std::pair<int, torrent*> const& e) { return e.second; });
+			m_seed_ranks.clear();
 		}
 
 		auto_manage_checking_torrents(checking, checking_limit);
@@ -4072,7 +4139,8 @@ namespace {
 		};
 	}
 
-	void session_impl::recalculate_optimistic_unchoke_slots()
+	void session_impl::recalculate_optimistic_unchoke_slots(
+		std::vector<std::shared_ptr<peer_connection>> const* const candidates)
 	{
 		INVARIANT_CHECK;
 
@@ -4090,20 +4158,13 @@ namespace {
 		// choke them when we've found new optimistic unchoke candidates.
 		std::vector<torrent_peer*> prev_opt_unchoke;
 
-		// TODO: 3 it would probably make sense to have a separate list of peers
-		// that are eligible for optimistic unchoke, similar to the torrents
-		// perhaps this could even iterate over the pool allocators of
-		// torrent_peer objects. It could probably be done in a single pass and
-		// collect the n best candidates. maybe just a queue of peers would make
-		// even more sense, just pick the next peer in the queue for unchoking. It
-		// would be O(1).
-		for (auto& i : m_connections)
+		auto collect = [&](std::shared_ptr<peer_connection> const& i)
 		{
 			peer_connection* const p = i.get();
 			TORRENT_ASSERT(p);
 			torrent_peer* pi = p->peer_info_struct();
-			if (!pi) continue;
-			if (pi->web_seed) continue;
+			if (!pi) return;
+			if (pi->web_seed) return;
 
 			if (pi->optimistically_unchoked)
 			{
@@ -4111,11 +4172,11 @@ namespace {
 			}
 
 			torrent const* t = p->associated_torrent().lock().get();
-			if (!t) continue;
+			if (!t) return;
 
 			// TODO: 3 peers should know whether their torrent is paused or not,
 			// instead of having to ask it over and over again
-			if (t->is_paused()) continue;
+			if (t->is_paused()) return;
 
 			if (!p->is_connecting()
 				&& !p->is_disconnecting()
@@ -4127,6 +4188,17 @@ namespace {
 			{
 				opt_unchoke.emplace_back(&i);
 			}
+		};
+
+		// if the regular unchoke ran this tick, it has already narrowed down the
+		// peers we need to look at. Otherwise we have to scan all of them
+		if (candidates)
+		{
+			for (auto const& i : *candidates) collect(i);
+		}
+		else
+		{
+			for (auto const& i : m_connections) collect(i);
 		}
 
 		// find the peers that has been waiting the longest to be optimistically
@@ -4213,16 +4285,37 @@ namespace {
 		}
 	}
 
-	void session_impl::try_connect_more_peers()
+	void session_impl::try_connect_more_peers(time_duration const dt)
 	{
 		if (m_abort) return;
 
+		int const connection_speed = m_settings.get_int(settings_pack::connection_speed);
+
+		// accrue connection attempts for the time that passed since the last
+		// tick. Never save up more than one second worth of attempts
+		m_connect_credit = std::min(m_connect_credit
+			+ std::int64_t(connection_speed) * std::max(total_milliseconds(dt), std::int64_t(0))
+			, std::int64_t(connection_speed) * 1000);
+
+		// put the torrents whose reconnect timeouts have passed back on the
+		// want-peers lists. A torrent may have been deferred again since, in
+		// which case update_want_peers() leaves it off
+		time_point const now = aux::time_now();
+		while (!m_deferred_connects.empty() && m_deferred_connects.front().first <= now)
+		{
+			std::pop_heap(m_deferred_connects.begin(), m_deferred_connects.end()
+				, deferred_connect_later());
+			std::shared_ptr<torrent> const t = m_deferred_connects.back().second.lock();
+			m_deferred_connects.pop_back();
+			if (t) t->update_want_peers();
+		}
+
 		if (num_connections() >= m_settings.get_int(settings_pack::connections_limit))
 			return;
 
 		// this is the maximum number of connections we will
 		// attempt this tick
-		int max_connections = m_settings.get_int(settings_pack::connection_speed);
+		int max_connections = int(m_connect_credit / 1000);
 
 		// this loop will "hand out" connection_speed to the torrents, in a round
 		// robin fashion, so that every torrent is equally likely to connect to a
@@ -4234,16 +4327,10 @@ namespace {
 		// quota for this tick
 		if (m_boost_connections > 0)
 		{
-			if (m_boost_connections > max_connections)
-			{
-				m_boost_connections -= max_connections;
-				max_connections = 0;
-			}
-			else
-			{
-				max_connections -= m_boost_connections;
-				m_boost_connections = 0;
-			}
+			int const boost = std::min(m_boost_connections, max_connections);
+			m_boost_connections -= boost;
+			max_connections -= boost;
+			m_connect_credit -= std::int64_t(boost) * 1000;
 		}
 
 		// zero connections speeds are allowed, we just won't make any connections
@@ -4271,6 +4358,7 @@ namespace {
 		// if we don't have any connection attempt quota, return
 		if (max_connections <= 0) return;
 
+		int connects = 0;
 		int steps_since_last_connect = 0;
 		int const num_torrents = int(want_peers_finished.size() + want_peers_download.size());
 		for (;;)
@@ -4323,6 +4411,7 @@ namespace {
 			if (t->try_connect_peer())
 			{
 				--max_connections;
+				++connects;
 				steps_since_last_connect = 0;
 				m_stats_counters.inc_stats_counter(counters::connection_attempts);
 			}
@@ -4330,7 +4419,7 @@ namespace {
 			++steps_since_last_connect;
 
 			// if there are no more free connection slots, abort
-			if (max_connections == 0) return;
+			if (max_connections == 0) break;
 			// there are no more torrents that want peers
 			if (want_peers_download.empty() && want_peers_finished.empty()) break;
 			// if we have gone a whole loop without
@@ -4339,9 +4428,12 @@ namespace {
 			// maintain the global limit on number of connections
 			if (num_connections() >= m_settings.get_int(settings_pack::connections_limit)) break;
 		}
+
+		m_connect_credit -= std::int64_t(connects) * 1000;
 	}
 
-	void session_impl::recalculate_unchoke_slots()
+	void session_impl::recalculate_unchoke_slots(
+		std::vector<std::shared_ptr<peer_connection>>* const candidates)
 	{
 		TORRENT_ASSERT(is_single_thread());
 
@@ -4373,6 +4465,10 @@ namespace {
 			if (p->ignore_unchoke_slots() || t == nullptr || pi == nullptr
 				|| pi->web_seed || t->is_paused())
 			{
+				// the optimistic unchoke pass needs to know about these, to
+				// choke them
+				if (candidates && pi && pi->optimistically_unchoked)
+					candidates->push_back(p);
 				p->reset_choke_counters();
 				continue;
 			}
@@ -4385,6 +4481,8 @@ namespace {
 				// already, make sure to choke it.
 				if (p->is_choked())
 				{
+					if (candidates && pi->optimistically_unchoked)
+						candidates->push_back(p);
 					p->reset_choke_counters();
 					continue;
 				}
@@ -4403,6 +4501,7 @@ namespace {
 			}
 
 			peers.push_back(p.get());
+			if (candidates) candidates->push_back(std::move(p));
 		}
 
 		int const allowed_upload_slots = unchoke_sort(peers
@@ -4705,7 +4804,8 @@ namespace {
 		}
 	}
 
-	void session_impl::post_torrent_updates(status_flags_t const flags)
+	void session_impl::post_torrent_updates(status_flags_t const flags
+		, torrent_updates_flags_t const updates_flags)
 	{
 		INVARIANT_CHECK;
 
@@ -4718,8 +4818,11 @@ namespace {
 		m_posting_torrent_updates = true;
 #endif
 
+		bool const changed_only = bool(updates_flags & session_handle::changed_fields_only);
 		std::vector<torrent_status> status;
+		std::vector<status_flags_t> fields;
 		status.reserve(state_updates.size());
+		fields.reserve(state_updates.size());
 
 		// TODO: it might be a nice feature here to limit the number of torrents
 		// to send in a single update. By just posting the first n torrents, they
@@ -4735,16 +4838,35 @@ namespace {
 			// the torrent to be loaded. Loading a torrent, and evicting another
 			// one will lead to calling state_updated(), which screws with
 			// this list while we're working on it, and break things
-			t->status(&status.back(), flags);
+			fields.push_back(changed_only ? t->unsent_status_fields(flags) : flags);
+			t->status(&status.back(), fields.back());
 			t->clear_in_state_update();
 		}
-		state_updates.clear();
 
 #if TORRENT_USE_ASSERTS
 		m_posting_torrent_updates = false;
 #endif
 
-		m_alerts.emplace_alert<state_update_alert>(std::move(status));
+		std::vector<status_flags_t> sent;
+		if (changed_only) sent = fields;
+
+		if (!m_alerts.emplace_alert<state_update_alert>(std::move(status), std::move(fields)))
+		{
+			// the alert queue is full. Post these torrents again next time
+			std::vector<torrent*> retry;
+			retry.swap(state_updates);
+			for (auto* t : retry) t->state_updated();
+			return;
+		}
+
+		// the fields are only considered sent once the alert made it into the
+		// queue
+		if (changed_only)
+		{
+			for (std::size_t i = 0; i < state_updates.size(); ++i)
+				state_updates[i]->status_fields_sent(sent[i]);
+		}
+		state_updates.clear();
 	}
 
 	void session_impl::post_session_stats()
@@ -4755,6 +4877,7 @@ namespace {
 			m_alerts.emplace_alert<session_stats_header_alert>();
 		}
 		m_disk_thread->update_stats_counters(m_stats_counters);
+		aux::drain_handler_times(m_stats_counters);
 
 #ifndef TORRENT_DISABLE_DHT
 		if (m_dht)
@@ -4772,6 +4895,29 @@ namespace {
 			, m_download_rate.queued_bytes());
 
 		m_alerts.emplace_alert<session_stats_alert>(m_stats_counters);
+
+		if (m_settings.get_bool(settings_pack::profile_handlers)
+			&& m_alerts.should_post<handler_profile_alert>())
+		{
+			std::vector<handler_profile_alert::handler_time> top;
+			for (int i = 0; i < num_handler_categories; ++i)
+			{
+				std::int64_t const wall = m_stats_counters[counters::handler_wall_peer_write + i];
+				std::int64_t const cpu = m_stats_counters[counters::handler_cpu_peer_write + i];
+				handler_profile_alert::handler_time const h{
+					handler_category_name(static_cast<handler_category>(i))
+					, wall - m_reported_handler_times.wall[i]
+					, cpu - m_reported_handler_times.cpu[i]};
+				m_reported_handler_times.wall[i] = wall;
+				m_reported_handler_times.cpu[i] = cpu;
+				if (h.wall_time > 0 || h.cpu_time > 0) top.push_back(h);
+			}
+			std::sort(top.begin(), top.end()
+				, [](handler_profile_alert::handler_time const& lhs
+					, handler_profile_alert::handler_time const& rhs)
+				{ return lhs.wall_time > rhs.wall_time; });
+			m_alerts.emplace_alert<handler_profile_alert>(std::move(top));
+		}
 	}
 
 	void session_impl::post_dht_stats()
@@ -5372,6 +5518,16 @@ namespace {
 			stop_ip_notifier();
 	}
 
+	void session_impl::update_tracing()
+	{
+		aux::set_trace_enabled(m_settings.get_bool(settings_pack::enable_tracing));
+	}
+
+	void session_impl::update_profile_handlers()
+	{
+		aux::set_handler_timers_enabled(m_settings.get_bool(settings_pack::profile_handlers));
+	}
+
 	void session_impl::update_upnp()
 	{
 		if (m_settings.get_bool(settings_pack::enable_upnp))
@@ -6175,6 +6331,24 @@ namespace {
 		});
 	}
 
+	void session_impl::dht_start_crawl()
+	{
+		if (!m_dht) return;
+		m_dht->start_crawl([this](std::vector<sha1_hash> const& infohashes
+			, dht::infohash_crawler const& c)
+		{
+			if (!m_alerts.should_post<dht_crawl_alert>()) return;
+			m_alerts.emplace_alert<dht_crawl_alert>(infohashes, c.num_requests()
+				, c.num_responses(), c.num_unique(), c.window());
+		});
+	}
+
+	void session_impl::dht_stop_crawl()
+	{
+		if (!m_dht) return;
+		m_dht->stop_crawl();
+	}
+
 	void session_impl::dht_direct_request(udp::endpoint const& ep, entry& e, client_data_t userdata)
 	{
 		if (!m_dht) return;
@@ -6687,6 +6861,11 @@ namespace {
 		m_alerts.get_all(*alerts);
 	}
 
+	void session_impl::pop_alerts(std::function<void(alert*)> const& handler)
+	{
+		m_alerts.get_all(handler);
+	}
+
 #if TORRENT_ABI_VERSION == 1
 	void session_impl::update_rate_limit_utp()
 	{
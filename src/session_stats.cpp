@@ -38,6 +38,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/performance_counters.hpp" // for counters
 
 #include <cstring>
+#include <string>
 #include <algorithm>
 
 namespace libtorrent {
@@ -55,8 +56,14 @@ namespace {
 		int value_index;
 	};
 
+	// every histogram has a single metric, covering all of its buckets
+	constexpr int num_histograms = (counters::num_stats_counters
+		- counters::disk_read_latency) / counters::num_histogram_buckets;
+	constexpr int num_metrics = counters::num_counters
+		- num_histograms * (counters::num_histogram_buckets - 1);
+
 #define METRIC(category, name) { #category "." #name, counters:: name },
-	aux::array<stats_metric_impl, counters::num_counters> const metrics
+	aux::array<stats_metric_impl, num_metrics> const metrics
 	({{
 		// ``error_peers`` is the total number of peer disconnects
 		// caused by an error (not initiated by this client) and
@@ -129,6 +136,7 @@ namespace {
 		METRIC(peer, boost_connection_attempts)
 		METRIC(peer, missed_connection_attempts)
 		METRIC(peer, no_peer_connection_attempts)
+		METRIC(peer, deferred_connection_attempts)
 		METRIC(peer, incoming_connections)
 
 		// the number of peer connections for each kind of socket.
@@ -420,6 +428,13 @@ namespace {
 		// the number of RPC observers currently allocated
 		METRIC(dht, dht_allocated_observers)
 
+		// the number of requests sent by our DHT nodes we're waiting for a
+		// reply to
+		METRIC(dht, dht_transactions_in_flight)
+
+		// the number of info-hashes waiting to be announced to the DHT
+		METRIC(dht, dht_announce_queue)
+
 		// the total number of DHT messages sent and received
 		METRIC(dht, dht_messages_in)
 		METRIC(dht, dht_messages_out)
@@ -467,6 +482,20 @@ namespace {
 		METRIC(dht, dht_invalid_get)
 		METRIC(dht, dht_invalid_sample_infohashes)
 
+		// ``dht_announce_requests`` is the number of DHT announces requested
+		// by torrents, and ``dht_announce_merged`` the ones merged with an
+		// earlier request for the same info-hash that was still waiting for
+		// packet budget (see settings_pack::dht_announce_rate_limit). The
+		// fraction of announces actually carried out is one minus their
+		// ratio. ``dht_announce_traversals`` is the number of completed
+		// announce lookups (one per DHT node and announce) and
+		// ``dht_announce_packets`` the requests they sent, including the
+		// ``announce_peer`` messages.
+		METRIC(dht, dht_announce_requests)
+		METRIC(dht, dht_announce_merged)
+		METRIC(dht, dht_announce_traversals)
+		METRIC(dht, dht_announce_packets)
+
 		// The number of times a lost packet has been interpreted as congestion,
 		// cutting the congestion window in half. Some lost packets are not
 		// interpreted as congestion, notably MTU-probes
@@ -563,6 +592,76 @@ namespace {
 		METRIC(sock_bufs, socket_recv_size19)
 		METRIC(sock_bufs, socket_recv_size20)
 
+		// the time the network thread has spent in handlers of each
+		// category, in microseconds. Time spent in nested handlers is only
+		// attributed to the innermost one. ``handler_wall_*`` is wall-clock
+		// time and ``handler_cpu_*`` is CPU time, which is sampled and
+		// extrapolated. Comparing these counters between two snapshots
+		// reveals which kind of handler is keeping the network thread busy.
+		// ``peer_read`` and ``peer_write`` are socket handlers for peer
+		// connections, ``udp`` and ``utp`` handle incoming UDP packets (other
+		// than DHT traffic, which is under ``dht``). ``session_call`` covers
+		// calls made through session_handle and torrent_handle,
+		// ``torrent_tick`` is the per-torrent work done every second and
+		// ``auto_manage`` is the recalculation of the auto-managed queue.
+		METRIC(net, handler_wall_peer_write)
+		METRIC(net, handler_wall_peer_read)
+		METRIC(net, handler_wall_udp)
+		METRIC(net, handler_wall_tick)
+		METRIC(net, handler_wall_abort)
+		METRIC(net, handler_wall_defer)
+		METRIC(net, handler_wall_utp)
+		METRIC(net, handler_wall_submit)
+		METRIC(net, handler_wall_session_call)
+		METRIC(net, handler_wall_torrent_tick)
+		METRIC(net, handler_wall_auto_manage)
+		METRIC(net, handler_wall_dht)
+		METRIC(net, handler_wall_tracker)
+
+		METRIC(net, handler_cpu_peer_write)
+		METRIC(net, handler_cpu_peer_read)
+		METRIC(net, handler_cpu_udp)
+		METRIC(net, handler_cpu_tick)
+		METRIC(net, handler_cpu_abort)
+		METRIC(net, handler_cpu_defer)
+		METRIC(net, handler_cpu_utp)
+		METRIC(net, handler_cpu_submit)
+		METRIC(net, handler_cpu_session_call)
+		METRIC(net, handler_cpu_torrent_tick)
+		METRIC(net, handler_cpu_auto_manage)
+		METRIC(net, handler_cpu_dht)
+		METRIC(net, handler_cpu_tracker)
+
+		// latency histograms, in microseconds. Each occupies
+		// ``counters::num_histogram_buckets`` consecutive values, starting
+		// at its value index. They are listed by session_stats_histograms().
+		// session_stats_metrics() lists every bucket as a counter of its own,
+		// named after the histogram and the lower bound of the bucket, e.g.
+		// ``disk.disk_read_latency.1024``.
+
+		// the time it takes to perform disk jobs in the disk threads, split
+		// by reads, writes, hashing and all other jobs
+		METRIC(disk, disk_read_latency)
+		METRIC(disk, disk_write_latency)
+		METRIC(disk, disk_hash_latency)
+		METRIC(disk, disk_other_latency)
+
+		// the delay of the network thread's tick timer firing, compared to
+		// when it was scheduled. This indicates how long handlers on the
+		// network thread are blocking it
+		METRIC(ses, event_loop_lag)
+
+		// the time from receiving a request until the piece is queued on
+		// the socket (upload), and the time it takes for peers to respond to
+		// our requests (download)
+		METRIC(peer, upload_request_latency)
+		METRIC(peer, download_request_latency)
+
+		// how late DHT request timeouts are detected, compared to when
+		// they're due. This covers both the short timeout, when more
+		// requests are issued in place of the slow one, and giving up on it
+		METRIC(dht, dht_timeout_latency)
+
 		// if the outstanding tracker announce limit is reached, tracker
 		// announces are queued, to be issued when an announce slot opens up.
 		// this measure the number of tracker announces currently in the
@@ -571,29 +670,83 @@ namespace {
 		// ... more
 	}});
 #undef METRIC
+
+	// the names of the histogram buckets, in value index order
+	std::vector<std::string> const& bucket_names()
+	{
+		static std::vector<std::string> const names = []
+		{
+			std::vector<std::string> ret;
+			for (auto const& m : metrics)
+			{
+				if (!counters::is_histogram(m.value_index)) continue;
+				for (int i = 0; i < counters::num_histogram_buckets; ++i)
+				{
+					ret.push_back(std::string(m.name) + '.'
+						+ std::to_string(counters::histogram_bucket_lower_bound(i)));
+				}
+			}
+			return ret;
+		}();
+		return names;
+	}
 	} // anonymous namespace
 
 	std::vector<stats_metric> session_stats_metrics()
 	{
+		std::vector<std::string> const& buckets = bucket_names();
 		aux::vector<stats_metric> stats;
-		stats.resize(metrics.size());
-		for (int i = 0; i < metrics.end_index(); ++i)
+		stats.resize(counters::num_counters);
+		int idx = 0;
+		std::size_t bucket = 0;
+		for (auto const& m : metrics)
 		{
-			stats[i].name = metrics[i].name;
-			stats[i].value_index = metrics[i].value_index;
-			stats[i].type = metrics[i].value_index >= counters::num_stats_counters
+			if (counters::is_histogram(m.value_index))
+			{
+				for (int i = 0; i < counters::num_histogram_buckets; ++i, ++idx, ++bucket)
+				{
+					stats[idx].name = buckets[bucket].c_str();
+					stats[idx].value_index = m.value_index + i;
+					stats[idx].type = metric_type_t::counter;
+				}
+				continue;
+			}
+			stats[idx].name = m.name;
+			stats[idx].value_index = m.value_index;
+			stats[idx].type = m.value_index >= counters::num_stats_counters
 				? metric_type_t::gauge : metric_type_t::counter;
+			++idx;
 		}
+		TORRENT_ASSERT(idx == counters::num_counters);
 		return std::move(stats);
 	}
 
+	std::vector<stats_metric> session_stats_histograms()
+	{
+		std::vector<stats_metric> ret;
+		for (auto const& m : metrics)
+		{
+			if (!counters::is_histogram(m.value_index)) continue;
+			stats_metric h;
+			h.name = m.name;
+			h.value_index = m.value_index;
+			h.type = metric_type_t::histogram;
+			ret.push_back(h);
+		}
+		return ret;
+	}
+
 	int find_metric_idx(string_view name)
 	{
 		auto const i = std::find_if(std::begin(metrics), std::end(metrics)
 			, [name](stats_metric_impl const& metr)
 			{ return metr.name == name; });
 
-		if (i == std::end(metrics)) return -1;
-		return i->value_index;
+		if (i != std::end(metrics)) return i->value_index;
+
+		// the individual histogram buckets
+		for (auto const& m : session_stats_metrics())
+			if (m.name == name) return m.value_index;
+		return -1;
 	}
 }
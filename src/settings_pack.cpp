@@ -239,6 +239,9 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		SET(allow_idna, false, nullptr),
 		SET(enable_set_file_valid_data, false, nullptr),
 		SET(socks5_udp_send_local_ep, false, nullptr),
+		SET(enable_tracing, false, &session_impl::update_tracing),
+		SET(dht_save_snapshot, false, nullptr),
+		SET(profile_handlers, false, &session_impl::update_profile_handlers),
 	}});
 
 	CONSTEXPR_SETTINGS
@@ -396,6 +399,10 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		SET(dht_max_infohashes_sample_count, 20, nullptr),
 		SET(max_piece_count, 0x200000, nullptr),
 		SET(metadata_token_limit, 2500000, nullptr),
+		SET(dht_storage_memory_limit, 0, nullptr),
+		SET(dht_worker_threads, 0, nullptr),
+		SET(dht_announce_rate_limit, 0, nullptr),
+		SET(dht_verify_threads, 0, nullptr),
 	}});
 
 #undef SET
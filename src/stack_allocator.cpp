@@ -55,6 +55,30 @@ namespace aux {
 		return allocation_slot(ret);
 	}
 
+	allocation_slot stack_allocator::intern_string(string_view str)
+	{
+		// FNV-1a
+		std::uint32_t hash = 2166136261u;
+		for (char const c : str)
+		{
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 16777619u;
+		}
+
+		interned_entry& e = m_interned[hash % interned_size];
+		if (e.slot.val() >= 0
+			&& e.hash == hash
+			&& e.length == int(str.size())
+			&& std::memcmp(&m_storage[e.slot.val()], str.data(), str.size()) == 0)
+			return e.slot;
+
+		allocation_slot const ret = copy_string(str);
+		e.hash = hash;
+		e.length = int(str.size());
+		e.slot = ret;
+		return ret;
+	}
+
 	allocation_slot stack_allocator::format_string(char const* fmt, va_list v)
 	{
 		int const pos = int(m_storage.size());
@@ -132,11 +156,13 @@ namespace aux {
 	void stack_allocator::swap(stack_allocator& rhs)
 	{
 		m_storage.swap(rhs.m_storage);
+		m_interned.swap(rhs.m_interned);
 	}
 
 	void stack_allocator::reset()
 	{
 		m_storage.clear();
+		m_interned.fill(interned_entry{});
 	}
 }
 }
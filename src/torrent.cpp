@@ -120,6 +120,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "libtorrent/aux_/torrent_impl.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
 
 using namespace std::placeholders;
 
@@ -510,6 +511,7 @@ bool is_downloading_state(int const st)
 		m_num_verified = 0;
 		m_verified.clear();
 		m_verifying.clear();
+		status_fields_changed(torrent_handle::query_verified_pieces);
 
 		set_need_save_resume();
 	}
@@ -519,6 +521,7 @@ bool is_downloading_state(int const st)
 		TORRENT_ASSERT(!m_verified.get_bit(piece));
 		++m_num_verified;
 		m_verified.set_bit(piece);
+		status_fields_changed(torrent_handle::query_verified_pieces);
 	}
 
 	void torrent::start()
@@ -1212,6 +1215,7 @@ bool is_downloading_state(int const st)
 			m_file_progress.init(*pp, m_torrent_file->files());
 
 		m_picker = std::move(pp);
+		status_fields_changed(torrent_handle::query_pieces);
 
 		update_gauge();
 
@@ -1419,11 +1423,12 @@ bool is_downloading_state(int const st)
 		return r;
 	}
 
-	std::string torrent::name() const
+	std::string const& torrent::name() const
 	{
+		static std::string const empty;
 		if (valid_metadata()) return m_torrent_file->name();
 		if (m_name) return *m_name;
-		return "";
+		return empty;
 	}
 
 #ifndef TORRENT_DISABLE_EXTENSIONS
@@ -1725,6 +1730,12 @@ bool is_downloading_state(int const st)
 		debug_log("init torrent: %s", torrent_file().name().c_str());
 #endif
 
+		// the metadata, and everything derived from it, may be new
+		status_fields_changed(torrent_handle::query_pieces
+			| torrent_handle::query_verified_pieces
+			| torrent_handle::query_torrent_file
+			| torrent_handle::query_name);
+
 		TORRENT_ASSERT(valid_metadata());
 		TORRENT_ASSERT(m_torrent_file->num_files() > 0);
 		TORRENT_ASSERT(m_torrent_file->total_size() >= 0);
@@ -2184,6 +2195,7 @@ bool is_downloading_state(int const st)
 					if (has_picker() && m_picker->have_piece(piece))
 					{
 						m_picker->we_dont_have(piece);
+						status_fields_changed(torrent_handle::query_pieces);
 						update_gauge();
 					}
 
@@ -2261,6 +2273,7 @@ bool is_downloading_state(int const st)
 
 		// forget that we have any pieces
 		m_have_all = false;
+		status_fields_changed(torrent_handle::query_pieces);
 
 // removing the piece picker will clear the user priorities
 // instead, just clear which pieces we have
@@ -3353,6 +3366,7 @@ namespace {
 		, struct tracker_response const& resp)
 	{
 		TORRENT_ASSERT(is_single_thread());
+		aux::handler_timer timer(aux::handler_category::tracker);
 
 		INVARIANT_CHECK;
 		TORRENT_ASSERT(!(r.kind & tracker_request::scrape_request));
@@ -3469,7 +3483,11 @@ namespace {
 					torrent_state st = get_peer_list_state();
 					need_peer_list();
 					if (m_peer_list->add_i2p_peer(i.hostname.c_str (), peer_info::tracker, {}, &st))
+					{
+						m_next_connect_attempt = 0;
+						update_want_peers();
 						state_updated();
+					}
 					peers_erased(st.erased);
 				}
 			}
@@ -3718,7 +3736,11 @@ namespace {
 		need_peer_list();
 		torrent_state st = get_peer_list_state();
 		if (m_peer_list->add_i2p_peer(dest, peer_info::tracker, {}, &st))
+		{
+			m_next_connect_attempt = 0;
+			update_want_peers();
 			state_updated();
+		}
 		peers_erased(st.erased);
 	}
 	catch (...) { handle_exception(); }
@@ -4039,6 +4061,7 @@ namespace {
 		TORRENT_ASSERT(!has_picker() || m_picker->has_piece_passed(index));
 
 		inc_stats_counter(counters::num_have_pieces);
+		status_fields_changed(torrent_handle::query_pieces);
 
 		// at this point, we have the piece for sure. It has been
 		// successfully written to disk. We may announce it to peers
@@ -6050,6 +6073,7 @@ namespace {
 				torrent_state st = get_peer_list_state();
 				m_peer_list->connection_closed(*p, m_ses.session_time(), &st);
 				peers_erased(st.erased);
+				m_next_connect_attempt = 0;
 			}
 		}
 
@@ -7952,6 +7976,10 @@ namespace {
 		if (!m_peer_list || m_peer_list->num_connect_candidates() == 0)
 			return false;
 
+		// if all of them are waiting for their reconnect timeout, the session
+		// puts us back on the want-peers lists when the first one expires
+		if (connect_deferred(m_ses.session_time())) return false;
+
 		// if the user disabled outgoing connections for seeding torrents,
 		// don't make any
 		if (!settings().get_bool(settings_pack::seeding_outgoing_connections)
@@ -8237,6 +8265,7 @@ namespace {
 				m_file_progress.clear();
 			}
 			m_have_all = true;
+			status_fields_changed(torrent_handle::query_pieces);
 		}
 		update_gauge();
 	}
@@ -8492,6 +8521,7 @@ namespace {
 			std::string const& path = save_path;
 #endif
 			m_save_path = complete(path);
+			status_fields_changed(torrent_handle::query_save_path);
 			return;
 		}
 
@@ -8519,6 +8549,7 @@ namespace {
 
 			m_save_path = save_path;
 #endif
+			status_fields_changed(torrent_handle::query_save_path);
 			set_need_save_resume();
 		}
 	}
@@ -8535,6 +8566,7 @@ namespace {
 			if (alerts().should_post<storage_moved_alert>())
 				alerts().emplace_alert<storage_moved_alert>(get_handle(), path, m_save_path);
 			m_save_path = path;
+			status_fields_changed(torrent_handle::query_save_path);
 			set_need_save_resume();
 			if (status == status_t::need_full_check)
 				force_recheck();
@@ -9104,6 +9136,7 @@ namespace {
 	// currently representable by the session_time)
 	void torrent::step_session_time(int const seconds)
 	{
+		m_next_connect_attempt = clamped_subtract_u16(m_next_connect_attempt, seconds);
 		if (m_peer_list)
 		{
 			for (auto pe : *m_peer_list)
@@ -9880,6 +9913,7 @@ namespace {
 	{
 		TORRENT_ASSERT(want_tick());
 		TORRENT_ASSERT(is_single_thread());
+		aux::handler_timer timer(aux::handler_category::torrent_tick);
 		INVARIANT_CHECK;
 
 		auto self = shared_from_this();
@@ -10909,6 +10943,19 @@ namespace {
 		if (p == nullptr)
 		{
 			m_stats_counters.inc_stats_counter(counters::no_peer_connection_attempts);
+			// if all candidates are waiting for their reconnect timeout, don't
+			// bother looking again until the first one expires. Never defer
+			// for longer than the min reconnect time, in case we miss an event
+			// that introduces new candidates. The session puts us back on the
+			// want-peers lists then
+			if (st.next_connect > 0)
+			{
+				int const now = m_ses.session_time();
+				m_next_connect_attempt = std::uint16_t(std::min({st.next_connect
+					, now + st.min_reconnect_time, 0xffff}));
+				m_ses.defer_connect(shared_from_this(), m_next_connect_attempt);
+				m_stats_counters.inc_stats_counter(counters::deferred_connection_attempts);
+			}
 			update_want_peers();
 			return false;
 		}
@@ -11001,6 +11048,7 @@ namespace {
 
 		if (p)
 		{
+			m_next_connect_attempt = 0;
 			state_updated();
 #ifndef TORRENT_DISABLE_EXTENSIONS
 			notify_extension_add_peer(adr, source
@@ -11049,6 +11097,8 @@ namespace {
 
 		need_peer_list();
 		m_peer_list->set_seed(p, s);
+		m_next_connect_attempt = 0;
+		update_want_peers();
 		update_auto_sequential();
 	}
 
@@ -11056,6 +11106,7 @@ namespace {
 	{
 		need_peer_list();
 		m_peer_list->set_failcount(p, 0);
+		m_next_connect_attempt = 0;
 		update_want_peers();
 	}
 
@@ -11377,6 +11428,10 @@ namespace {
 
 		if (int(m_state) == s) return;
 
+		// whether we're finished or not affects which peers we want to connect
+		// to
+		m_next_connect_attempt = 0;
+
 		if (m_ses.alerts().should_post<state_changed_alert>())
 		{
 			m_ses.alerts().emplace_alert<state_changed_alert>(get_handle()
@@ -11472,6 +11527,22 @@ namespace {
 		m_links[aux::session_interface::torrent_state_updates].insert(list, this);
 	}
 
+	status_flags_t torrent::unsent_status_fields(status_flags_t const flags) const
+	{
+		return flags & ~m_sent_status_fields;
+	}
+
+	void torrent::status_fields_sent(status_flags_t const f)
+	{
+		status_flags_t const expensive_fields = torrent_handle::query_pieces
+			| torrent_handle::query_verified_pieces
+			| torrent_handle::query_torrent_file
+			| torrent_handle::query_name
+			| torrent_handle::query_save_path;
+
+		m_sent_status_fields |= f & expensive_fields;
+	}
+
 	void torrent::status(torrent_status* st, status_flags_t const flags)
 	{
 		INVARIANT_CHECK;
@@ -49,6 +49,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/entry.hpp"
 #include "libtorrent/aux_/session_impl.hpp"
 #include "libtorrent/aux_/session_call.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
 #include "libtorrent/aux_/throw.hpp"
 #include "libtorrent/aux_/invariant_check.hpp"
 #include "libtorrent/utf8.hpp"
@@ -118,6 +119,7 @@ namespace libtorrent {
 		auto& ses = static_cast<session_impl&>(t->session());
 		dispatch(ses.get_context(), [=,&ses] ()
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -150,6 +152,7 @@ namespace libtorrent {
 		std::exception_ptr ex;
 		dispatch(ses.get_context(), [=,&done,&ses,&ex] ()
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -186,6 +189,7 @@ namespace libtorrent {
 		std::exception_ptr ex;
 		dispatch(ses.get_context(), [=,&r,&done,&ses,&ex] ()
 		{
+			aux::handler_timer timer(aux::handler_category::session_call);
 #ifndef BOOST_NO_EXCEPTIONS
 			try {
 #endif
@@ -55,6 +55,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/hex.hpp" // to_hex
 #include "libtorrent/aux_/numeric_cast.hpp"
 #include "libtorrent/aux_/file_pointer.hpp"
+#include "libtorrent/aux_/mmap.hpp"
 #include "libtorrent/disk_interface.hpp" // for default_block_size
 #include "libtorrent/span.hpp"
 
@@ -715,6 +716,44 @@ namespace {
 		return 0;
 	}
 
+#if !defined BOOST_NO_EXCEPTIONS \
+	&& (TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE)
+	// returns nullptr for empty files, which can't be mapped
+	std::shared_ptr<aux::file_view const> map_torrent_file(std::string const& filename
+		, int const max_buffer_size, error_code& ec)
+	{
+		try
+		{
+			aux::file_handle f(filename, 0, aux::open_mode::read_only
+				| aux::open_mode::random_access);
+			std::int64_t const size = f.get_size();
+			if (size > max_buffer_size)
+			{
+				ec = errors::metadata_too_large;
+				return {};
+			}
+			if (size == 0) return {};
+
+			auto mapping = std::make_shared<aux::file_mapping>(std::move(f)
+				, aux::open_mode::read_only | aux::open_mode::random_access, size
+#if TORRENT_HAVE_MAP_VIEW_OF_FILE
+				, std::make_shared<std::mutex>()
+#endif
+				);
+			return std::make_shared<aux::file_view const>(mapping->view());
+		}
+		catch (storage_error const& e)
+		{
+			ec = e.ec;
+		}
+		catch (system_error const& e)
+		{
+			ec = e.code();
+		}
+		return {};
+	}
+#endif
+
 } // anonymous namespace
 
 	web_seed_entry::web_seed_entry(std::string url_, type_t type_
@@ -771,7 +810,6 @@ namespace {
 	struct name_entry
 	{
 		file_index_t idx;
-		int length;
 	};
 }
 
@@ -783,11 +821,12 @@ namespace {
 		// or, if the file_index is negative, maps into the paths vector
 		std::unordered_multimap<std::uint32_t, name_entry> files;
 
-		std::vector<std::string> const& paths = m_files.paths();
+		std::vector<std::string> const paths = m_files.paths();
 		files.reserve(paths.size() + aux::numeric_cast<std::size_t>(m_files.num_files()));
 
 		// insert all directories first, to make sure no files
-		// are allowed to collied with them
+		// are allowed to collied with them. paths() includes every parent
+		// directory, so only whole paths need to be inserted
 		{
 			boost::crc_optimal<32, 0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true> crc;
 			if (!m_files.name().empty())
@@ -799,15 +838,8 @@ namespace {
 			{
 				auto local_crc = crc;
 				if (!path.empty()) local_crc.process_byte(TORRENT_SEPARATOR);
-				int count = 0;
-				for (char const c : path)
-				{
-					if (c == TORRENT_SEPARATOR)
-						files.insert({local_crc.checksum(), {path_index, count}});
-					local_crc.process_byte(to_lower(c) & 0xff);
-					++count;
-				}
-				files.insert({local_crc.checksum(), {path_index, int(path.size())}});
+				process_string_lowercase(local_crc, path);
+				files.insert({local_crc.checksum(), {path_index}});
 				--path_index;
 			}
 		}
@@ -824,14 +856,14 @@ namespace {
 			auto const match = std::find_if(range.first, range.second, [&](std::pair<std::uint32_t, name_entry> const& o)
 			{
 				std::string const other_name = o.second.idx < file_index_t{}
-					? combine_path(m_files.name(), paths[std::size_t(-static_cast<int>(o.second.idx)-1)].substr(0, std::size_t(o.second.length)))
+					? combine_path(m_files.name(), paths[std::size_t(-static_cast<int>(o.second.idx)-1)])
 					: m_files.file_path(o.second.idx);
 				return string_equal_no_case(other_name, m_files.file_path(i));
 			});
 
 			if (match == range.second)
 			{
-				files.insert({hash, {i, 0}});
+				files.insert({hash, {i}});
 				continue;
 			}
 
@@ -860,7 +892,7 @@ namespace {
 				std::uint32_t const new_hash = crc.checksum();
 				if (files.find(new_hash) == files.end())
 				{
-					files.insert({new_hash, {i, 0}});
+					files.insert({new_hash, {i}});
 					break;
 				}
 				++num_collisions;
@@ -960,8 +992,29 @@ namespace {
 	torrent_info::torrent_info(std::string const& filename
 		, load_torrent_limits const& cfg)
 	{
-		std::vector<char> buf;
 		error_code ec;
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+		if (cfg.map_file)
+		{
+			m_file_view = map_torrent_file(filename, cfg.max_buffer_size, ec);
+			if (ec) aux::throw_ex<system_error>(ec);
+		}
+
+		if (m_file_view)
+		{
+			bdecode_node e = bdecode(m_file_view->range(), ec, nullptr
+				, cfg.max_decode_depth, cfg.max_decode_tokens);
+			if (ec) aux::throw_ex<system_error>(ec);
+
+			if (!parse_torrent_file(e, ec, cfg.max_pieces))
+				aux::throw_ex<system_error>(ec);
+
+			INVARIANT_CHECK;
+			return;
+		}
+#endif
+
+		std::vector<char> buf;
 		int ret = load_file(filename, buf, ec, cfg.max_buffer_size);
 		if (ret < 0) aux::throw_ex<system_error>(ec);
 
@@ -1033,7 +1086,12 @@ namespace {
 	// internal
 	void torrent_info::set_piece_layers(aux::vector<aux::vector<char>, file_index_t> pl)
 	{
-		m_piece_layers = pl;
+		auto storage = std::make_shared<aux::vector<aux::vector<char>, file_index_t>>(std::move(pl));
+		m_piece_layers.clear();
+		m_piece_layers.reserve(storage->size());
+		for (auto const& layer : *storage)
+			m_piece_layers.emplace_back(layer);
+		m_piece_layer_storage = std::move(storage);
 		m_flags |= v2_has_piece_hashes;
 	}
 
@@ -1117,10 +1175,21 @@ namespace {
 			return false;
 		}
 
-		// copy the info section
 		m_info_section_size = int(section.size());
-		m_info_section.reset(new char[aux::numeric_cast<std::size_t>(m_info_section_size)]);
-		std::memcpy(m_info_section.get(), section.data(), aux::numeric_cast<std::size_t>(m_info_section_size));
+		if (in_file_view(section))
+		{
+			// refer to the info section in the memory mapped file. The deleter
+			// keeps the mapping alive for as long as the buffer is referenced
+			std::shared_ptr<aux::file_view const> view = m_file_view;
+			m_info_section = boost::shared_array<char>(const_cast<char*>(section.data())
+				, [view](char*) {});
+		}
+		else
+		{
+			// copy the info section
+			m_info_section.reset(new char[aux::numeric_cast<std::size_t>(m_info_section_size)]);
+			std::memcpy(m_info_section.get(), section.data(), aux::numeric_cast<std::size_t>(m_info_section_size));
+		}
 
 		// this is the offset from the start of the torrent file buffer to the
 		// info-dictionary (within the torrent file).
@@ -1419,14 +1488,18 @@ namespace {
 
 	bool torrent_info::parse_piece_layers(bdecode_node const& e, error_code& ec)
 	{
-		std::map<sha256_hash, string_view> piece_layers;
-
 		if (e.type() != bdecode_node::dict_t)
 		{
 			ec = errors::torrent_missing_piece_layer;
 			return false;
 		}
 
+		// a sorted vector rather than a map, to avoid one allocation per
+		// file for torrents with many files
+		using layer_t = std::pair<sha256_hash, string_view>;
+		std::vector<layer_t> piece_layers;
+		piece_layers.reserve(std::size_t(e.dict_size()));
+
 		for (int i = 0; i < e.dict_size(); ++i)
 		{
 			auto const f = e.dict_at(i);
@@ -1438,18 +1511,27 @@ namespace {
 				return false;
 			}
 
-			piece_layers.emplace(sha256_hash(f.first), f.second.string_value());
+			piece_layers.emplace_back(sha256_hash(f.first), f.second.string_value());
 		}
 
-		m_piece_layers.resize(orig_files().num_files());
+		// stable, so that the first of any duplicate keys is the one used
+		std::stable_sort(piece_layers.begin(), piece_layers.end()
+			, [](layer_t const& lhs, layer_t const& rhs) { return lhs.first < rhs.first; });
+
+		aux::vector<span<char const>, file_index_t> layers;
+		layers.resize(orig_files().num_files());
+		std::size_t total_size = 0;
+		bool all_mapped = true;
 
 		for (file_index_t i : orig_files().file_range())
 		{
 			if (orig_files().file_size(i) <= orig_files().piece_length())
 				continue;
 
-			auto const piece_layer = piece_layers.find(orig_files().root(i));
-			if (piece_layer == piece_layers.end()) continue;
+			sha256_hash const root = orig_files().root(i);
+			auto const piece_layer = std::lower_bound(piece_layers.begin(), piece_layers.end()
+				, root, [](layer_t const& lhs, sha256_hash const& rhs) { return lhs.first < rhs; });
+			if (piece_layer == piece_layers.end() || piece_layer->first != root) continue;
 
 			int const num_pieces = orig_files().file_num_pieces(i);
 
@@ -1466,13 +1548,49 @@ namespace {
 				return false;
 			}
 
-			m_piece_layers[i].assign(hashes.begin(), hashes.end());
+			layers[i] = {hashes.data(), static_cast<std::ptrdiff_t>(hashes.size())};
+			total_size += hashes.size();
+			if (!in_file_view(layers[i])) all_mapped = false;
 		}
 
+		if (all_mapped && m_file_view)
+		{
+			// the hashes can be referenced in the memory mapped file
+			m_piece_layer_storage = m_file_view;
+		}
+		else
+		{
+			// copy all piece layers into a single buffer
+			auto storage = std::make_shared<std::vector<char>>(total_size);
+			char* ptr = storage->data();
+			for (auto& l : layers)
+			{
+				if (l.empty()) continue;
+				std::memcpy(ptr, l.data(), std::size_t(l.size()));
+				l = {ptr, l.size()};
+				ptr += l.size();
+			}
+			m_piece_layer_storage = std::move(storage);
+		}
+		m_piece_layers = std::move(layers);
+
 		m_flags |= v2_has_piece_hashes;
 		return true;
 	}
 
+	bool torrent_info::in_file_view(span<char const> buf) const
+	{
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+		if (!m_file_view) return false;
+		span<char const> const range = m_file_view->range();
+		return buf.data() >= range.data()
+			&& buf.data() + buf.size() <= range.data() + range.size();
+#else
+		TORRENT_UNUSED(buf);
+		return false;
+#endif
+	}
+
 	span<char const> torrent_info::piece_layer(file_index_t f) const
 	{
 		TORRENT_ASSERT_PRECOND(f >= file_index_t(0));
@@ -1492,6 +1610,7 @@ namespace {
 	{
 		m_piece_layers.clear();
 		m_piece_layers.shrink_to_fit();
+		m_piece_layer_storage.reset();
 
 		m_flags &= ~v2_has_piece_hashes;
 	}
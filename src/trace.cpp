@@ -0,0 +1,244 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/aux_/trace.hpp"
+#include "libtorrent/assert.hpp"
+
+#include <cinttypes> // for PRId64
+#include <cstdio> // for snprintf
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace libtorrent { namespace aux {
+
+	std::atomic<bool> g_trace_enabled{false};
+
+namespace {
+
+	// number of events kept per thread. Must be a power of 2
+	constexpr std::uint64_t trace_buffer_size = 1 << 15;
+
+	// all fields are atomics, to allow dump_trace() to read the buffer while
+	// the owning thread keeps writing to it. Relaxed stores are plain stores
+	// on common architectures.
+	struct trace_entry
+	{
+		std::atomic<char const*> category;
+		std::atomic<char const*> name;
+		std::atomic<std::int64_t> start;
+		std::atomic<std::int64_t> duration;
+		std::atomic<std::int64_t> arg;
+	};
+
+	struct trace_buffer
+	{
+		explicit trace_buffer(int const t)
+			: tid(t)
+			, entries(new trace_entry[trace_buffer_size])
+		{}
+
+		// the thread ID reported in the trace
+		int const tid;
+
+		// the total number of events ever written to this buffer. Only the
+		// owning thread writes to it
+		std::atomic<std::uint64_t> head{0};
+
+		// events before this index have been cleared
+		std::atomic<std::uint64_t> cleared{0};
+
+		std::unique_ptr<trace_entry[]> entries;
+	};
+
+	struct trace_registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<trace_buffer>> buffers;
+
+		// buffers whose thread has exited, and can be picked up by new threads
+		std::vector<trace_buffer*> free_list;
+	};
+
+	trace_registry& registry()
+	{
+		static trace_registry r;
+		return r;
+	}
+
+	// returns the buffer to the registry when the thread exits
+	struct thread_buffer
+	{
+		thread_buffer() = default;
+		thread_buffer(thread_buffer const&) = delete;
+		thread_buffer& operator=(thread_buffer const&) = delete;
+		~thread_buffer()
+		{
+			if (buf == nullptr) return;
+			trace_registry& r = registry();
+			std::lock_guard<std::mutex> l(r.mutex);
+			r.free_list.push_back(buf);
+		}
+		trace_buffer* buf = nullptr;
+	};
+
+	thread_local thread_buffer t_buffer;
+
+	trace_buffer* claim_buffer()
+	{
+		trace_registry& r = registry();
+		std::lock_guard<std::mutex> l(r.mutex);
+		if (!r.free_list.empty())
+		{
+			trace_buffer* ret = r.free_list.back();
+			r.free_list.pop_back();
+			return ret;
+		}
+		r.buffers.emplace_back(new trace_buffer(int(r.buffers.size()) + 1));
+		return r.buffers.back().get();
+	}
+
+	struct event
+	{
+		char const* category;
+		char const* name;
+		std::int64_t start;
+		std::int64_t duration;
+		std::int64_t arg;
+	};
+
+	void append_event(std::string& out, int const tid, event const& e)
+	{
+		// timestamps are in microseconds, with nanosecond precision
+		char buf[400];
+		int const len = std::snprintf(buf, sizeof(buf)
+			, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%" PRId64 ".%03d"
+			, out.empty() ? "" : ",\n"
+			, e.name, e.category, e.duration > 0 ? "X" : "i"
+			, e.start / 1000, int(e.start % 1000));
+		out.append(buf, std::size_t(std::min(len, int(sizeof(buf)) - 1)));
+
+		if (e.duration > 0)
+			out.append(buf, std::size_t(std::snprintf(buf, sizeof(buf)
+				, ",\"dur\":%" PRId64 ".%03d", e.duration / 1000, int(e.duration % 1000))));
+		else
+			out += ",\"s\":\"t\"";
+
+		out.append(buf, std::size_t(std::snprintf(buf, sizeof(buf)
+			, ",\"pid\":1,\"tid\":%d,\"args\":{\"arg\":%" PRId64 "}}", tid, e.arg)));
+	}
+}
+
+	void set_trace_enabled(bool const e)
+	{
+		g_trace_enabled.store(e, std::memory_order_relaxed);
+	}
+
+	void trace_event(char const* category, char const* name
+		, std::int64_t const start, std::int64_t const duration, std::int64_t const arg)
+	{
+		TORRENT_ASSERT(duration >= 0);
+		trace_buffer* b = t_buffer.buf;
+		if (b == nullptr)
+		{
+			b = claim_buffer();
+			t_buffer.buf = b;
+		}
+
+		std::uint64_t const idx = b->head.load(std::memory_order_relaxed);
+
+		// this orders the store to head, of the previous event, before the
+		// stores to the entry we're about to overwrite. If a reader observes
+		// any of the new values, it is also guaranteed to see the head
+		// pointing past the previous event, and know the entry may be torn
+		std::atomic_thread_fence(std::memory_order_release);
+
+		trace_entry& e = b->entries[idx & (trace_buffer_size - 1)];
+		e.category.store(category, std::memory_order_relaxed);
+		e.name.store(name, std::memory_order_relaxed);
+		e.start.store(start, std::memory_order_relaxed);
+		e.duration.store(duration, std::memory_order_relaxed);
+		e.arg.store(arg, std::memory_order_relaxed);
+		b->head.store(idx + 1, std::memory_order_release);
+	}
+
+	std::string dump_trace()
+	{
+		std::string ret = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		std::string events;
+		std::vector<event> copy;
+
+		trace_registry& r = registry();
+		std::lock_guard<std::mutex> l(r.mutex);
+		for (auto const& b : r.buffers)
+		{
+			std::uint64_t const head = b->head.load(std::memory_order_acquire);
+			std::uint64_t const first = std::max(b->cleared.load(std::memory_order_relaxed)
+				, head > trace_buffer_size ? head - trace_buffer_size : 0);
+
+			copy.clear();
+			for (std::uint64_t i = first; i < head; ++i)
+			{
+				trace_entry const& e = b->entries[i & (trace_buffer_size - 1)];
+				copy.push_back({e.category.load(std::memory_order_relaxed)
+					, e.name.load(std::memory_order_relaxed)
+					, e.start.load(std::memory_order_relaxed)
+					, e.duration.load(std::memory_order_relaxed)
+					, e.arg.load(std::memory_order_relaxed)});
+			}
+
+			// the owning thread may have wrapped around and overwritten the
+			// oldest entries while we were copying them. The entry at index
+			// head2 - size may be in the process of being overwritten
+			std::atomic_thread_fence(std::memory_order_acquire);
+			std::uint64_t const head2 = b->head.load(std::memory_order_relaxed);
+			std::uint64_t const valid = head2 + 1 > trace_buffer_size
+				? head2 + 1 - trace_buffer_size : 0;
+
+			for (std::uint64_t i = std::max(first, valid); i < head; ++i)
+				append_event(events, b->tid, copy[std::size_t(i - first)]);
+		}
+
+		ret += events;
+		ret += "\n]}\n";
+		return ret;
+	}
+
+	void clear_trace()
+	{
+		trace_registry& r = registry();
+		std::lock_guard<std::mutex> l(r.mutex);
+		for (auto const& b : r.buffers)
+			b->cleared.store(b->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}}
@@ -43,6 +43,8 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <functional>
 #include <thread>
+#include <atomic>
+#include <algorithm>
 
 using namespace lt;
 
@@ -334,6 +336,115 @@ TORRENT_TEST(alerts_dropped_alert)
 	TEST_CHECK(a->dropped_alerts[torrent_finished_alert::alert_type] == true);
 }
 
+TORRENT_TEST(get_all_handler)
+{
+	aux::alert_manager mgr(100, alert_category::all);
+
+	for (int i = 0; i < 5; ++i)
+		mgr.emplace_alert<piece_finished_alert>(torrent_handle(), piece_index_t(i));
+
+	std::vector<alert*> alerts;
+	mgr.get_all([&](alert* a) { alerts.push_back(a); });
+
+	TEST_EQUAL(alerts.size(), 5);
+	for (int i = 0; i < 5; ++i)
+	{
+		auto* pf = alert_cast<piece_finished_alert>(alerts[std::size_t(i)]);
+		TEST_CHECK(pf);
+		TEST_EQUAL(pf->piece_index, piece_index_t(i));
+	}
+
+	// alerts posted from the handler end up in the next batch
+	mgr.emplace_alert<torrent_finished_alert>(torrent_handle());
+	int count = 0;
+	mgr.get_all([&](alert*) {
+		++count;
+		mgr.emplace_alert<torrent_finished_alert>(torrent_handle());
+	});
+	TEST_EQUAL(count, 1);
+
+	count = 0;
+	mgr.get_all([&](alert*) { ++count; });
+	TEST_EQUAL(count, 1);
+
+	// nothing left
+	mgr.get_all([&](alert*) { ++count; });
+	TEST_EQUAL(count, 1);
+}
+
+#ifndef TORRENT_DISABLE_EXTENSIONS
+struct count_plugin : lt::plugin
+{
+	void on_alert(alert const*) override { ++count; }
+	std::atomic<int> count{0};
+};
+#endif
+
+// alerts posted concurrently by multiple threads, while being consumed, are
+// all delivered exactly once
+TORRENT_TEST(concurrent_producers)
+{
+	int const num_producers = 4;
+	int const alerts_per_producer = 5000;
+	int const total = num_producers * alerts_per_producer;
+	aux::alert_manager mgr(total, alert_category::all);
+#ifndef TORRENT_DISABLE_EXTENSIONS
+	auto pl = std::make_shared<count_plugin>();
+	mgr.add_extension(pl);
+#endif
+
+	std::atomic<int> producers_done{0};
+	std::vector<std::thread> producers;
+	for (int p = 0; p < num_producers; ++p)
+	{
+		producers.emplace_back([&mgr, &producers_done, p] {
+			for (int i = 0; i < alerts_per_producer; ++i)
+			{
+				mgr.emplace_alert<piece_finished_alert>(torrent_handle()
+					, piece_index_t(p * alerts_per_producer + i));
+			}
+			++producers_done;
+		});
+	}
+
+	std::vector<int> received(std::size_t(total), 0);
+	std::vector<alert*> alerts;
+	bool use_handler = false;
+	for (;;)
+	{
+		bool const done = producers_done == num_producers;
+		int batch = 0;
+		auto const record = [&](alert* a)
+		{
+			auto* pf = alert_cast<piece_finished_alert>(a);
+			TEST_CHECK(pf);
+			if (pf == nullptr) return;
+			++received[std::size_t(static_cast<int>(pf->piece_index))];
+			++batch;
+		};
+		// alternate between the two ways of consuming alerts
+		if (use_handler)
+		{
+			mgr.get_all(record);
+		}
+		else
+		{
+			mgr.get_all(alerts);
+			for (auto* a : alerts) record(a);
+		}
+		use_handler = !use_handler;
+		if (done && batch == 0) break;
+	}
+
+	for (auto& t : producers) t.join();
+
+	TEST_CHECK(std::all_of(received.begin(), received.end()
+		, [](int const n) { return n == 1; }));
+#ifndef TORRENT_DISABLE_EXTENSIONS
+	TEST_EQUAL(pl->count.load(), total);
+#endif
+}
+
 #ifndef TORRENT_DISABLE_EXTENSIONS
 struct post_plugin : lt::plugin
 {
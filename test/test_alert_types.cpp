@@ -183,10 +183,12 @@ TORRENT_TEST(alerts_types)
 	TEST_ALERT_TYPE(socks5_alert, 96, alert_priority::normal, alert_category::error);
 	TEST_ALERT_TYPE(file_prio_alert, 97, alert_priority::normal, alert_category::storage);
 	TEST_ALERT_TYPE(oversized_file_alert, 98, alert_priority::normal, alert_category::storage);
+	TEST_ALERT_TYPE(dht_crawl_alert, 99, alert_priority::normal, alert_category::dht_operation);
+	TEST_ALERT_TYPE(handler_profile_alert, 100, alert_priority::normal, alert_category::stats);
 
 #undef TEST_ALERT_TYPE
 
-	TEST_EQUAL(num_alert_types, 99);
+	TEST_EQUAL(num_alert_types, 101);
 	TEST_EQUAL(num_alert_types, count_alert_types);
 }
 
@@ -335,6 +337,49 @@ TORRENT_TEST(dht_sample_infohashes_alert)
 	TEST_CHECK(nv == nodes);
 }
 
+TORRENT_TEST(dht_crawl_alert)
+{
+	aux::alert_manager mgr(1, dht_crawl_alert::static_category);
+
+	TEST_EQUAL(mgr.should_post<dht_crawl_alert>(), true);
+
+	std::vector<sha1_hash> const v = {rand_hash(), rand_hash(), rand_hash()};
+	mgr.emplace_alert<dht_crawl_alert>(v, 100, 80, 1234, 16);
+
+	auto const* a = alert_cast<dht_crawl_alert>(mgr.wait_for_alert(seconds(0)));
+	TEST_CHECK(a != nullptr);
+
+	TEST_EQUAL(a->num_infohashes(), 3);
+	TEST_CHECK(a->infohashes() == v);
+	TEST_EQUAL(a->num_requests, 100);
+	TEST_EQUAL(a->num_responses, 80);
+	TEST_EQUAL(a->num_unique, 1234);
+	TEST_EQUAL(a->concurrency, 16);
+}
+
+TORRENT_TEST(handler_profile_alert)
+{
+	aux::alert_manager mgr(1, handler_profile_alert::static_category);
+
+	TEST_EQUAL(mgr.should_post<handler_profile_alert>(), true);
+
+	std::vector<handler_profile_alert::handler_time> v = {{"tick", 2000, 1500}
+		, {"dht", 100, 50}};
+	mgr.emplace_alert<handler_profile_alert>(v);
+
+	auto const* a = alert_cast<handler_profile_alert>(mgr.wait_for_alert(seconds(0)));
+	TEST_CHECK(a != nullptr);
+
+	TEST_EQUAL(a->top_handlers.size(), 2);
+	TEST_EQUAL(a->top_handlers[0].category, "tick"_sv);
+	TEST_EQUAL(a->top_handlers[0].wall_time, 2000);
+	TEST_EQUAL(a->top_handlers[0].cpu_time, 1500);
+	TEST_EQUAL(a->top_handlers[1].category, "dht"_sv);
+#ifndef TORRENT_DISABLE_ALERT_MSG
+	TEST_EQUAL(a->message(), "handler profile: tick: 2000 us (cpu: 1500 us) dht: 100 us (cpu: 50 us)");
+#endif
+}
+
 #ifndef TORRENT_DISABLE_ALERT_MSG
 TORRENT_TEST(performance_warning)
 {
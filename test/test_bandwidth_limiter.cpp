@@ -458,6 +458,63 @@ void test_no_starvation(int limit)
 	TEST_CHECK(close_to(p->m_quota / sample_time, float(limit) / 200 / num_peers, 5));
 }
 
+// Jain's fairness index. 1 means all connections got the same share, 1/n means
+// a single connection got everything
+float fairness(connections_t const& v)
+{
+	double sum = 0.;
+	double sum_sq = 0.;
+	for (auto const& p : v)
+	{
+		double const q = double(p->m_quota);
+		sum += q;
+		sum_sq += q * q;
+	}
+	if (sum_sq == 0.) return 0.f;
+	return float(sum * sum / (double(v.size()) * sum_sq));
+}
+
+void test_many_torrents(int num_torrents, int peers_per_torrent, int global_limit)
+{
+	aux::bandwidth_manager manager(0);
+	global_bwc.throttle(global_limit);
+
+	std::vector<aux::bandwidth_channel> torrents(static_cast<std::size_t>(num_torrents));
+	connections_t v;
+	for (auto& t : torrents)
+	{
+		// every torrent is limited to more than its fair share, to make the
+		// global limit the bottleneck
+		t.throttle(global_limit / num_torrents * 2);
+		spawn_connections(v, manager, t, peers_per_torrent, "p");
+	}
+
+	run_test(v, manager);
+
+	float sum = 0.f;
+	for (auto const& p : v) sum += p->m_quota;
+	sum /= sample_time;
+
+	TEST_CHECK(close_to(sum, float(global_limit), global_limit * 0.05f));
+	TEST_CHECK(fairness(v) > 0.9f);
+
+	// every torrent gets roughly its fair share of the global limit, and no
+	// connection is starved
+	float const torrent_share = float(global_limit) / float(num_torrents);
+	for (int t = 0; t < num_torrents; ++t)
+	{
+		float torrent_sum = 0.f;
+		for (int i = 0; i < peers_per_torrent; ++i)
+		{
+			auto const& p = v[std::size_t(t * peers_per_torrent + i)];
+			TEST_CHECK(p->m_quota > 0);
+			torrent_sum += p->m_quota;
+		}
+		torrent_sum /= sample_time;
+		TEST_CHECK(close_to(torrent_sum, torrent_share, torrent_share * 0.5f));
+	}
+}
+
 } // anonymous namespace
 
 TORRENT_TEST(equal_connection)
@@ -517,3 +574,11 @@ TORRENT_TEST(no_starvation)
 {
 	test_no_starvation(40000);
 }
+
+TORRENT_TEST(many_torrents)
+{
+	test_many_torrents(   10,  10,   1000000);
+	test_many_torrents(  100,  10,  10000000);
+	test_many_torrents(  100, 100, 100000000);
+	test_many_torrents( 1000,  10, 100000000);
+}
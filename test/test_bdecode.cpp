@@ -1365,3 +1365,74 @@ TORRENT_TEST(dict_at_node)
 	TEST_EQUAL(e.dict_at_node(1).first.string_offset(), 13);
 	TEST_EQUAL(e.dict_at_node(1).second.string_offset(), 19);
 }
+
+TORRENT_TEST(decode_into_existing_node)
+{
+	char const b1[] = "d3:fooli1ei2ei3ee3:bar4:teste";
+	char const b2[] = "l3:abci42ee";
+	error_code ec;
+	bdecode_node e;
+
+	TEST_EQUAL(bdecode(b1, e, ec), 0);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(e.type(), bdecode_node::dict_t);
+	TEST_EQUAL(e.dict_find_list("foo").list_size(), 3);
+	TEST_EQUAL(e.dict_find_string_value("bar"), "test");
+	auto const* const storage = e.token_storage();
+	std::size_t const capacity = e.token_capacity();
+
+	// decoding a smaller message into the same node replaces the whole tree,
+	// reusing the token storage, without reallocating or shrinking it
+	TEST_EQUAL(bdecode(b2, e, ec), 0);
+	TEST_CHECK(!ec);
+	TEST_CHECK(e.token_storage() == storage);
+	TEST_EQUAL(e.token_capacity(), capacity);
+	TEST_EQUAL(e.type(), bdecode_node::list_t);
+	TEST_EQUAL(e.list_size(), 2);
+	TEST_EQUAL(e.list_string_value_at(0), "abc");
+	TEST_EQUAL(e.list_int_value_at(1), 42);
+	TEST_EQUAL(e.data_section().size(), int(sizeof(b2) - 1));
+
+	// and a larger one again
+	TEST_EQUAL(bdecode(b1, e, ec), 0);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(e.dict_size(), 2);
+	TEST_EQUAL(e.dict_find_string_value("bar"), "test");
+}
+
+TORRENT_TEST(decode_into_existing_node_error)
+{
+	char const b1[] = "d3:foo3:bare";
+	char const b2[] = "d3:fooi1";
+	error_code ec;
+	bdecode_node e;
+
+	TEST_EQUAL(bdecode(b1, e, ec), 0);
+	TEST_CHECK(!ec);
+
+	int pos = 0;
+	TEST_EQUAL(bdecode(b2, e, ec, &pos), -1);
+	TEST_CHECK(ec);
+	// the partially decoded tree is still valid
+	TEST_EQUAL(e.type(), bdecode_node::dict_t);
+
+	TEST_EQUAL(bdecode(b1, e, ec), 0);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(e.dict_find_string_value("foo"), "bar");
+}
+
+TORRENT_TEST(decode_into_existing_node_copy)
+{
+	char const b[] = "l3:abci42ee";
+	error_code ec;
+	bdecode_node e;
+	TEST_EQUAL(bdecode(b, e, ec), 0);
+
+	// a copy of the decoded node owns its own tokens, so decoding into the
+	// original again does not affect it
+	bdecode_node const copy = e;
+	TEST_EQUAL(bdecode("i1e", e, ec), 0);
+	TEST_EQUAL(e.int_value(), 1);
+	TEST_EQUAL(copy.list_size(), 2);
+	TEST_EQUAL(copy.list_string_value_at(0), "abc");
+}
@@ -123,6 +123,78 @@ void test_to_from_string()
 	TEST_EQUAL(memcmp(compare, bits_out.c_str(), 4), 0);
 }
 
+void test_merge()
+{
+	bloom_filter<32> a;
+	bloom_filter<32> b;
+	sha1_hash const k1 = hasher("test1", 5).final();
+	sha1_hash const k2 = hasher("test2", 5).final();
+	a.set(k1);
+	b.set(k2);
+
+	a.merge(b);
+	TEST_CHECK(a.find(k1));
+	TEST_CHECK(a.find(k2));
+	TEST_CHECK(!b.find(k1));
+
+	// merging a filter with 3 bytes past the last whole word
+	std::uint8_t bits[11] = {0x01, 0, 0, 0, 0, 0, 0, 0x80, 0, 0, 0x01};
+	std::uint8_t const other[11] = {0x02, 0, 0, 0, 0, 0, 0, 0, 0x10, 0, 0x80};
+	merge_bits(bits, other, 11);
+	std::uint8_t const compare[11] = {0x03, 0, 0, 0, 0, 0, 0, 0x80, 0x10, 0, 0x81};
+	TEST_EQUAL(memcmp(compare, bits, 11), 0);
+	TEST_EQUAL(count_zero_bits(bits, 11), 88 - 6);
+}
+
+void test_size()
+{
+	bloom_filter<256> filter;
+	TEST_CHECK(filter.size() < 1.f);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		sha1_hash const k = hasher(reinterpret_cast<char const*>(&i), sizeof(i)).final();
+		filter.set(k);
+	}
+	TEST_CHECK(filter.size() > 90.f);
+	TEST_CHECK(filter.size() < 110.f);
+
+	filter.clear();
+	TEST_CHECK(filter.size() < 1.f);
+}
+
+void test_counting()
+{
+	counting_bloom_filter<32> filter;
+	bloom_filter<32> plain;
+	sha1_hash const k1 = hasher("test1", 5).final();
+	sha1_hash const k2 = hasher("test2", 5).final();
+
+	filter.add(k1);
+	filter.add(k2);
+	filter.add(k2);
+	plain.set(k1);
+	plain.set(k2);
+	TEST_CHECK(filter.find(k1));
+	TEST_CHECK(filter.find(k2));
+	TEST_EQUAL(filter.to_string(), plain.to_string());
+
+	filter.remove(k1);
+	TEST_CHECK(!filter.find(k1));
+	TEST_CHECK(filter.find(k2));
+
+	filter.remove(k2);
+	TEST_CHECK(filter.find(k2));
+	filter.remove(k2);
+	TEST_CHECK(!filter.find(k2));
+	TEST_EQUAL(filter.to_string(), bloom_filter<32>().to_string());
+
+	// once a counter saturates, its bit stays set
+	for (int i = 0; i < 300; ++i) filter.add(k1);
+	for (int i = 0; i < 300; ++i) filter.remove(k1);
+	TEST_CHECK(filter.find(k1));
+}
+
 } // anonymous namespace
 
 TORRENT_TEST(bloom_filter)
@@ -131,7 +203,7 @@ TORRENT_TEST(bloom_filter)
 	test_set_bits();
 	test_count_zeroes();
 	test_to_from_string();
-
-	// TODO: test size()
-	// TODO: test clear()
+	test_merge();
+	test_size();
+	test_counting();
 }
@@ -0,0 +1,340 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/choker.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/aux_/time.hpp"
+#include "libtorrent/aux_/unchoke_compare.hpp"
+
+#include <random>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+using namespace lt;
+
+namespace {
+
+std::mt19937 rng(0x1337);
+
+std::vector<int> random_ints(int const n)
+{
+	std::vector<int> ret(static_cast<std::size_t>(n));
+	std::uniform_int_distribution<int> d(0, n / 2);
+	for (auto& v : ret) v = d(rng);
+	return ret;
+}
+
+// stand-ins for torrent and peer_connection, exposing the state the unchoke
+// comparators look at
+struct fake_torrent_info
+{
+	int piece_length() const { return 0x4000; }
+	std::int64_t total_size() const { return 0x4000 * 1000; }
+};
+
+struct fake_torrent
+{
+	fake_torrent_info const& torrent_file() const { return m_info; }
+	fake_torrent_info m_info;
+};
+
+struct fake_stat
+{
+	std::int64_t total_payload_upload() const { return uploaded; }
+	std::int64_t uploaded;
+};
+
+struct fake_peer
+{
+	enum channels { upload_channel, download_channel };
+
+	int get_priority(int) const { return priority; }
+	std::int64_t downloaded_in_last_round() const { return downloaded; }
+	std::int64_t uploaded_in_last_round() const { return uploaded; }
+	std::int64_t uploaded_since_unchoked() const { return since_unchoked; }
+	bool is_choked() const { return choked; }
+	time_point time_of_last_unchoke() const { return last_unchoke; }
+	int num_have_pieces() const { return have_pieces; }
+	fake_stat const& statistics() const { return stats; }
+	std::weak_ptr<fake_torrent> associated_torrent() const { return t; }
+
+	std::shared_ptr<fake_torrent> t;
+	int priority;
+	std::int64_t downloaded;
+	std::int64_t uploaded;
+	std::int64_t since_unchoked;
+	int have_pieces;
+	fake_stat stats;
+	time_point last_unchoke;
+	bool choked;
+};
+
+std::shared_ptr<fake_torrent> const torrent = std::make_shared<fake_torrent>();
+
+fake_peer make_peer()
+{
+	return {torrent, 1, 0, 0, 0, 0, {0}, aux::time_now(), true};
+}
+
+std::vector<fake_peer> make_peers(int const n)
+{
+	// the values are drawn from narrow ranges to produce ties, to exercise
+	// the tie-breakers as well
+	std::uniform_int_distribution<int> prio(1, 3);
+	std::uniform_int_distribution<std::int64_t> rate(0, 20);
+	std::uniform_int_distribution<int> pieces(0, 1000);
+	std::uniform_int_distribution<int> time(0, 300);
+	time_point const now = aux::time_now();
+	std::vector<fake_peer> ret;
+	ret.reserve(std::size_t(n));
+	for (int i = 0; i < n; ++i)
+	{
+		fake_peer p = make_peer();
+		p.priority = prio(rng);
+		p.downloaded = rate(rng) * 1000;
+		p.uploaded = rate(rng) * 1000;
+		p.since_unchoked = rate(rng) * 0x10000;
+		p.have_pieces = pieces(rng);
+		p.stats.uploaded = p.uploaded;
+		p.last_unchoke = now - seconds(time(rng));
+		p.choked = (i % 3) == 0;
+		ret.push_back(p);
+	}
+	return ret;
+}
+
+// make sure select_top() picks the same peers, in the same order, as sorting
+// all of them would
+template <typename Cmp>
+void check_select(int const slots, Cmp cmp)
+{
+	for (int const num_peers : {0, 1, 10, 100, 1000})
+	{
+		std::vector<fake_peer> const storage = make_peers(num_peers);
+		std::vector<fake_peer const*> peers;
+		for (auto const& p : storage) peers.push_back(&p);
+		std::vector<fake_peer const*> peers2 = peers;
+
+		std::sort(peers.begin(), peers.end(), cmp);
+		aux::select_top(peers2.begin(), peers2.end(), slots, cmp);
+
+		for (int i = 0; i < std::min(slots, num_peers); ++i)
+		{
+			auto const* lhs = peers[std::size_t(i)];
+			auto const* rhs = peers2[std::size_t(i)];
+			TEST_CHECK(!cmp(lhs, rhs) && !cmp(rhs, lhs));
+		}
+	}
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(select_top)
+{
+	for (int const size : {0, 1, 2, 10, 100, 1000})
+	{
+		for (int const n : {0, 1, 5, 50, 2000})
+		{
+			std::vector<int> v = random_ints(size);
+			std::vector<int> sorted = v;
+			std::sort(sorted.begin(), sorted.end());
+
+			aux::select_top(v.begin(), v.end(), n, std::less<int>());
+			int const valid = std::min(n, size);
+			TEST_CHECK(std::equal(v.begin(), v.begin() + valid, sorted.begin()));
+			std::sort(v.begin(), v.end());
+			TEST_CHECK(v == sorted);
+		}
+	}
+}
+
+TORRENT_TEST(ranked_walk)
+{
+	for (int const size : {0, 1, 2, 10, 100, 1000})
+	{
+		std::vector<int> v = random_ints(size);
+		std::vector<int> sorted = v;
+		std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+
+		std::vector<int> visited;
+		int const limit = size / 3;
+		int const ret = aux::ranked_walk(v.begin(), v.end(), std::greater<int>()
+			, [&](int const i)
+			{
+				if (int(visited.size()) == limit) return false;
+				visited.push_back(i);
+				return true;
+			});
+		TEST_EQUAL(ret, limit);
+		TEST_CHECK(std::equal(visited.begin(), visited.end(), sorted.begin()));
+	}
+}
+
+TORRENT_TEST(ranked_walk_all)
+{
+	std::vector<int> v = random_ints(500);
+	std::vector<int> sorted = v;
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<int> visited;
+	int const ret = aux::ranked_walk(v.begin(), v.end(), std::less<int>()
+		, [&](int const i) { visited.push_back(i); return true; });
+	TEST_EQUAL(ret, 500);
+	TEST_CHECK(visited == sorted);
+}
+
+TORRENT_TEST(unchoke_compare_priority)
+{
+	fake_peer a = make_peer();
+	fake_peer b = make_peer();
+	a.priority = 2;
+	b.uploaded = 10000;
+	b.downloaded = 10000;
+	TEST_CHECK(aux::unchoke_compare_fastest_upload(&a, &b));
+	TEST_CHECK(!aux::unchoke_compare_fastest_upload(&b, &a));
+	TEST_CHECK(aux::unchoke_compare_anti_leech(&a, &b));
+	TEST_CHECK(aux::unchoke_compare_rr(&a, &b, 20));
+
+	// with equal priority, the peer that sent us the most wins
+	b.priority = 2;
+	TEST_CHECK(aux::unchoke_compare_fastest_upload(&b, &a));
+	TEST_CHECK(aux::unchoke_compare_rr(&b, &a, 20));
+}
+
+TORRENT_TEST(unchoke_compare_round_robin)
+{
+	time_point const now = aux::time_now();
+	fake_peer a = make_peer();
+	fake_peer b = make_peer();
+
+	// an unchoked peer that has used up its quota for more than a minute
+	// yields its slot, even though we upload faster to it
+	a.choked = false;
+	a.uploaded = 100000;
+	a.since_unchoked = 0x4000 * 21;
+	a.last_unchoke = now - minutes(2);
+	b.last_unchoke = now - minutes(5);
+	TEST_CHECK(aux::unchoke_compare_rr(&b, &a, 20));
+	TEST_CHECK(!aux::unchoke_compare_rr(&a, &b, 20));
+
+	// but not before the minute has passed
+	a.last_unchoke = now - seconds(30);
+	TEST_CHECK(aux::unchoke_compare_rr(&a, &b, 20));
+
+	// the upload rate of choked peers is ignored, the one that has waited
+	// the longest is preferred
+	a.choked = true;
+	TEST_CHECK(aux::unchoke_compare_rr(&b, &a, 20));
+}
+
+TORRENT_TEST(unchoke_compare_anti_leech)
+{
+	fake_peer a = make_peer();
+	fake_peer b = make_peer();
+	fake_peer c = make_peer();
+	a.have_pieces = 10;
+	b.have_pieces = 500;
+	c.have_pieces = 990;
+	TEST_CHECK(aux::unchoke_compare_anti_leech(&a, &b));
+	TEST_CHECK(aux::unchoke_compare_anti_leech(&c, &b));
+	TEST_CHECK(aux::anti_leech_score(&b) < aux::anti_leech_score(&a));
+	TEST_CHECK(aux::anti_leech_score(&b) < aux::anti_leech_score(&c));
+}
+
+TORRENT_TEST(upload_rate_compare)
+{
+	fake_peer a = make_peer();
+	fake_peer b = make_peer();
+	a.uploaded = 1000;
+	b.uploaded = 600;
+	TEST_CHECK(aux::upload_rate_compare(&a, &b));
+	b.priority = 2;
+	TEST_CHECK(aux::upload_rate_compare(&b, &a));
+}
+
+TORRENT_TEST(select_top_round_robin)
+{
+	check_select(8, [](fake_peer const* lhs, fake_peer const* rhs)
+		{ return aux::unchoke_compare_rr(lhs, rhs, 20); });
+}
+
+TORRENT_TEST(select_top_fastest_upload)
+{
+	check_select(8, &aux::unchoke_compare_fastest_upload<fake_peer>);
+}
+
+TORRENT_TEST(select_top_anti_leech)
+{
+	check_select(8, &aux::unchoke_compare_anti_leech<fake_peer>);
+}
+
+TORRENT_TEST(ranked_walk_upload_rate)
+{
+	std::vector<fake_peer> const storage = make_peers(1000);
+	std::vector<fake_peer const*> peers;
+	for (auto const& p : storage) peers.push_back(&p);
+	std::vector<fake_peer const*> peers2 = peers;
+
+	// the rate based choker stops at the first peer below the threshold
+	std::sort(peers.begin(), peers.end(), &aux::upload_rate_compare<fake_peer>);
+	std::int64_t threshold = 1000;
+	int slots = 0;
+	for (auto const* p : peers)
+	{
+		if (p->uploaded * p->priority < threshold) break;
+		++slots;
+		threshold += 100;
+	}
+
+	threshold = 1000;
+	std::vector<fake_peer const*> visited;
+	int const slots2 = aux::ranked_walk(peers2.begin(), peers2.end()
+		, &aux::upload_rate_compare<fake_peer>
+		, [&](fake_peer const* p)
+		{
+			if (p->uploaded * p->priority < threshold) return false;
+			threshold += 100;
+			visited.push_back(p);
+			return true;
+		});
+	TEST_EQUAL(slots, slots2);
+	TEST_CHECK(slots > 0);
+	for (int i = 0; i < slots; ++i)
+	{
+		auto const* lhs = peers[std::size_t(i)];
+		auto const* rhs = visited[std::size_t(i)];
+		TEST_EQUAL(lhs->uploaded * lhs->priority, rhs->uploaded * rhs->priority);
+	}
+}
@@ -0,0 +1,136 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/performance_counters.hpp"
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+using namespace lt;
+
+TORRENT_TEST(counters_increment)
+{
+	counters c;
+	TEST_EQUAL(c[counters::piece_requests], 0);
+	c.inc_stats_counter(counters::piece_requests);
+	c.inc_stats_counter(counters::piece_requests, 10);
+	TEST_EQUAL(c[counters::piece_requests], 11);
+
+	// gauges return the new value
+	TEST_EQUAL(c.inc_stats_counter(counters::queued_write_bytes, 100), 100);
+	TEST_EQUAL(c.inc_stats_counter(counters::queued_write_bytes, -40), 60);
+	TEST_EQUAL(c[counters::queued_write_bytes], 60);
+
+	c.set_value(counters::piece_requests, 5);
+	TEST_EQUAL(c[counters::piece_requests], 5);
+
+	c.set_value(counters::num_checking_torrents, 3);
+	c.blend_stats_counter(counters::num_checking_torrents, 13, 50);
+	TEST_EQUAL(c[counters::num_checking_torrents], 8);
+
+	counters copy(c);
+	TEST_EQUAL(copy[counters::piece_requests], 5);
+	TEST_EQUAL(copy[counters::queued_write_bytes], 60);
+	TEST_EQUAL(copy[counters::num_checking_torrents], 8);
+}
+
+TORRENT_TEST(counters_threads)
+{
+	counters c;
+	int const num_threads = 8;
+	int const increments = 10000;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads.emplace_back([&] {
+			for (int i = 0; i < increments; ++i)
+			{
+				c.inc_stats_counter(counters::num_blocks_written);
+				c.inc_stats_counter(counters::num_incoming_have);
+				c.inc_stats_counter(counters::queued_write_bytes, 2);
+				c.inc_stats_counter(counters::queued_write_bytes, -1);
+			}
+		});
+	}
+	for (auto& t : threads) t.join();
+
+	TEST_EQUAL(c[counters::num_blocks_written], num_threads * increments);
+	TEST_EQUAL(c[counters::num_incoming_have], num_threads * increments);
+	TEST_EQUAL(c[counters::queued_write_bytes], num_threads * increments);
+}
+
+TORRENT_TEST(histogram_buckets)
+{
+	TEST_EQUAL(counters::histogram_bucket(-1), 0);
+	TEST_EQUAL(counters::histogram_bucket(0), 0);
+	TEST_EQUAL(counters::histogram_bucket(3), 3);
+	TEST_EQUAL(counters::histogram_bucket(4), 4);
+	TEST_EQUAL(counters::histogram_bucket(7), 7);
+	TEST_EQUAL(counters::histogram_bucket(8), 8);
+	TEST_EQUAL(counters::histogram_bucket(9), 8);
+	TEST_EQUAL(counters::histogram_bucket(10), 9);
+	TEST_EQUAL(counters::histogram_bucket(15), 11);
+	TEST_EQUAL(counters::histogram_bucket(16), 12);
+	TEST_EQUAL(counters::histogram_bucket(std::int64_t(1) << 40)
+		, counters::num_histogram_buckets - 1);
+
+	// every bucket's lower bound falls in that bucket, and the value right
+	// below it in the previous one
+	for (int b = 1; b < counters::num_histogram_buckets; ++b)
+	{
+		std::int64_t const lower = counters::histogram_bucket_lower_bound(b);
+		TEST_EQUAL(counters::histogram_bucket(lower), b);
+		TEST_EQUAL(counters::histogram_bucket(lower - 1), b - 1);
+	}
+}
+
+TORRENT_TEST(histogram_samples)
+{
+	counters c;
+	TEST_CHECK(counters::is_histogram(counters::disk_read_latency));
+	TEST_CHECK(counters::is_histogram(counters::download_request_latency));
+	TEST_CHECK(!counters::is_histogram(counters::disk_read_latency + 1));
+	TEST_CHECK(!counters::is_histogram(counters::piece_requests));
+
+	c.add_histogram_sample(counters::disk_write_latency, 5);
+	c.add_histogram_sample(counters::disk_write_latency, 5);
+	c.add_histogram_sample(counters::disk_write_latency, 1000);
+
+	TEST_EQUAL(c[counters::disk_write_latency + counters::histogram_bucket(5)], 2);
+	TEST_EQUAL(c[counters::disk_write_latency + counters::histogram_bucket(1000)], 1);
+	// the neighboring histograms are untouched
+	TEST_EQUAL(c[counters::disk_read_latency + counters::histogram_bucket(5)], 0);
+	TEST_EQUAL(c[counters::disk_hash_latency + counters::histogram_bucket(5)], 0);
+}
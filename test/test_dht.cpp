@@ -62,6 +62,10 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/kademlia/item.hpp"
 #include "libtorrent/kademlia/dht_observer.hpp"
 #include "libtorrent/kademlia/dht_tracker.hpp"
+#include "libtorrent/kademlia/dht_worker_pool.hpp"
+#include "libtorrent/kademlia/announce_scheduler.hpp"
+#include "libtorrent/kademlia/infohash_crawler.hpp"
+#include "libtorrent/kademlia/signature_verifier.hpp"
 
 #include <numeric>
 #include <cstdarg>
@@ -69,6 +73,10 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <iomanip>
 #include <cstdio> // for vsnprintf
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <thread>
 
 #include "setup_transfer.hpp"
 
@@ -617,7 +625,7 @@ dht::key_desc_t const peer1_desc[] = {
 
 dht::key_desc_t const get_item_desc[] = {
 	{"y", bdecode_node::string_t, 1, 0},
-	{"t", bdecode_node::string_t, 2, 0},
+	{"t", bdecode_node::string_t, 4, 0},
 	{"q", bdecode_node::string_t, 3, 0},
 	{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 		{"id", bdecode_node::string_t, 20, 0},
@@ -626,7 +634,7 @@ dht::key_desc_t const get_item_desc[] = {
 
 dht::key_desc_t const put_mutable_item_desc[] = {
 	{"y", bdecode_node::string_t, 1, 0},
-	{"t", bdecode_node::string_t, 2, 0},
+	{"t", bdecode_node::string_t, 4, 0},
 	{"q", bdecode_node::string_t, 3, 0},
 	{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 		{"id", bdecode_node::string_t, 20, 0},
@@ -640,7 +648,7 @@ dht::key_desc_t const put_mutable_item_desc[] = {
 
 dht::key_desc_t const sample_infohashes_desc[] = {
 	{"y", bdecode_node::string_t, 1, 0},
-	{"t", bdecode_node::string_t, 2, 0},
+	{"t", bdecode_node::string_t, 4, 0},
 	{"q", bdecode_node::string_t, 17, 0},
 	{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 		{"id", bdecode_node::string_t, 20, 0},
@@ -709,7 +717,7 @@ void print_state(std::ostream& os, routing_table const& table)
 				<< " ping: " << j->pinged()
 				<< " dist: " << distance_exp(table.id(), j->id);
 
-			if (j->last_queried == min_time())
+			if (j->last_queried == (time_point32::min)())
 				os << " query:    ";
 			else
 				os << " query: " << std::setw(3) << total_seconds(now - j->last_queried);
@@ -1735,6 +1743,58 @@ TORRENT_TEST(routing_table_v6)
 		test_routing_table(rand_v6);
 }
 
+TORRENT_TEST(routing_table_find_node)
+{
+	init_rand_address();
+
+	dht_test_setup t(udp::endpoint(rand_v4(), 20));
+	aux::session_settings s;
+	s.set_bool(settings_pack::dht_restrict_routing_ips, false);
+	int const bucket_size = 8;
+	dht::routing_table table(generate_random_id(), udp::v4(), bucket_size, s, &t.observer);
+
+	// fill the table up, with some nodes we've only heard about and some
+	// that have failed, which find_node() should skip
+	std::vector<std::pair<node_id, udp::endpoint>> added;
+	for (int i = 0; i < 10000; ++i)
+	{
+		auto const ep = rand_udp_ep(rand_v4);
+		node_id const id = generate_random_id();
+		if ((i % 4) == 0)
+		{
+			table.heard_about(id, ep);
+		}
+		else
+		{
+			table.node_seen(id, ep, 10);
+			added.emplace_back(id, ep);
+		}
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		auto const& n = added[std::size_t(i) * added.size() / 100];
+		table.node_failed(n.first, n.second);
+	}
+
+	std::vector<node_entry> nodes;
+	table.for_each_node([&nodes](node_entry const& e)
+		{ if (e.confirmed()) nodes.push_back(e); }, nullptr);
+	TEST_CHECK(int(nodes.size()) > bucket_size * 10);
+
+	// the returned nodes are exactly the closest ones, closest first
+	for (int r = 0; r < 100; ++r)
+	{
+		node_id const target = generate_random_id();
+		std::vector<node_entry> const found = table.find_node(target, {}, bucket_size);
+		std::partial_sort(nodes.begin(), nodes.begin() + bucket_size, nodes.end()
+			, [&target](node_entry const& lhs, node_entry const& rhs)
+			{ return compare_ref(lhs.id, rhs.id, target); });
+		TEST_EQUAL(int(found.size()), bucket_size);
+		for (int i = 0; i < std::min(bucket_size, int(found.size())); ++i)
+			TEST_CHECK(found[std::size_t(i)].id == nodes[std::size_t(i)].id);
+	}
+}
+
 namespace {
 
 void test_bootstrap(address(&rand_addr)())
@@ -1745,7 +1805,7 @@ void test_bootstrap(address(&rand_addr)())
 
 	dht::key_desc_t const find_node_desc[] = {
 		{"y", bdecode_node::string_t, 1, 0},
-		{"t", bdecode_node::string_t, 2, 0},
+		{"t", bdecode_node::string_t, 4, 0},
 		{"q", bdecode_node::string_t, 9, 0},
 		{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 			{"id", bdecode_node::string_t, 20, 0},
@@ -1848,7 +1908,7 @@ void test_bootstrap_want(address(&rand_addr)())
 
 	dht::key_desc_t const find_node_desc[] = {
 		{"y", bdecode_node::string_t, 1, 0},
-		{"t", bdecode_node::string_t, 2, 0},
+		{"t", bdecode_node::string_t, 4, 0},
 		{"q", bdecode_node::string_t, 9, 0},
 		{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 			{"id", bdecode_node::string_t, 20, 0},
@@ -1920,7 +1980,7 @@ void test_short_nodes(address(&rand_addr)())
 
 	dht::key_desc_t const find_node_desc[] = {
 		{ "y", bdecode_node::string_t, 1, 0 },
-		{ "t", bdecode_node::string_t, 2, 0 },
+		{ "t", bdecode_node::string_t, 4, 0 },
 		{ "q", bdecode_node::string_t, 9, 0 },
 		{ "a", bdecode_node::dict_t, 0, key_desc_t::parse_children },
 		{ "id", bdecode_node::string_t, 20, 0 },
@@ -2007,7 +2067,7 @@ void test_get_peers(address(&rand_addr)())
 
 	dht::key_desc_t const get_peers_desc[] = {
 		{"y", bdecode_node::string_t, 1, 0},
-		{"t", bdecode_node::string_t, 2, 0},
+		{"t", bdecode_node::string_t, 4, 0},
 		{"q", bdecode_node::string_t, 9, 0},
 		{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 			{"id", bdecode_node::string_t, 20, 0},
@@ -2301,7 +2361,7 @@ TORRENT_TEST(immutable_put)
 
 	dht::key_desc_t const put_immutable_item_desc[] = {
 		{"y", bdecode_node::string_t, 1, 0},
-		{"t", bdecode_node::string_t, 2, 0},
+		{"t", bdecode_node::string_t, 4, 0},
 		{"q", bdecode_node::string_t, 3, 0},
 		{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
 			{"id", bdecode_node::string_t, 20, 0},
@@ -3191,7 +3251,7 @@ TORRENT_TEST(read_only_node)
 
 	dht::key_desc_t const get_item_desc_ro[] = {
 		{"y", bdecode_node::string_t, 1, 0},
-		{"t", bdecode_node::string_t, 2, 0},
+		{"t", bdecode_node::string_t, 4, 0},
 		{"q", bdecode_node::string_t, 3, 0},
 		{"ro", bdecode_node::int_t, 4, key_desc_t::optional},
 		{"a", bdecode_node::dict_t, 0, key_desc_t::parse_children},
@@ -3349,7 +3409,7 @@ TORRENT_TEST(rpc_invalid_error_msg)
 	counters cnt;
 
 	dht::routing_table table(node_id(), udp::v4(), 8, sett, &observer);
-	dht::rpc_manager rpc(node_id(), sett, table, ls, &s, &observer);
+	dht::rpc_manager rpc(node_id(), sett, table, ls, &s, cnt, &observer);
 	std::unique_ptr<dht_storage_interface> dht_storage(dht_default_storage_constructor(sett));
 	dht_storage->update_node_ids({node_id(nullptr)});
 	dht::node node(ls, &s, sett, node_id(nullptr), &observer, cnt, get_foreign_node_stub, *dht_storage);
@@ -3404,6 +3464,110 @@ TORRENT_TEST(rpc_invalid_error_msg)
 }
 #endif
 
+TORRENT_TEST(rpc_transaction_table)
+{
+	dht_test_setup t(udp::endpoint(rand_v4(), 20));
+	dht::rpc_manager& rpc = t.dht_node.m_rpc;
+
+	g_sent_packets.clear();
+	auto algo = std::make_shared<dht::traversal_algorithm>(t.dht_node, node_id());
+
+	// enough requests for the table to grow a few times while transactions
+	// are outstanding
+	int const num_requests = 1000;
+	for (int i = 0; i < num_requests; ++i)
+	{
+		udp::endpoint const ep(address_v4(addr4("10.0.0.0").to_uint() + std::uint32_t(i)), 6881);
+		auto o = rpc.allocate_observer<null_observer>(algo, ep, node_id());
+#if TORRENT_USE_ASSERTS
+		o->m_in_constructor = false;
+#endif
+		entry req;
+		req["q"] = "ping";
+		TEST_CHECK(rpc.invoke(req, ep, o));
+	}
+	TEST_EQUAL(rpc.num_transactions(), num_requests);
+	TEST_EQUAL(int(g_sent_packets.size()), num_requests);
+
+	std::set<std::string> tids;
+	for (auto& p : g_sent_packets)
+		tids.insert(p.second["t"].string());
+	TEST_EQUAL(int(tids.size()), num_requests);
+
+	auto reply = [&](udp::endpoint const& ep, std::string const& tid)
+	{
+		entry e;
+		e["y"] = "r";
+		e["t"] = tid;
+		e["r"]["id"] = generate_next().to_string();
+		char msg_buf[1500];
+		int const size = bencode(msg_buf, e);
+
+		bdecode_node decoded;
+		error_code ec;
+		bdecode(msg_buf, msg_buf + size, decoded, ec);
+		TEST_CHECK(!ec);
+
+		node_id nid;
+		rpc.incoming(dht::msg(decoded, ep), &nid);
+	};
+
+	// a reply from a different address than the request was sent to is
+	// ignored
+	reply(udp::endpoint(addr4("192.168.0.1"), 6881), g_sent_packets.front().second["t"].string());
+	TEST_EQUAL(rpc.num_transactions(), num_requests);
+
+	// answer every other request. Some of these were sent before the table
+	// grew
+	int i = 0;
+	for (auto& p : g_sent_packets)
+	{
+		if (i++ % 2 == 0) reply(p.first, p.second["t"].string());
+	}
+	TEST_EQUAL(rpc.num_transactions(), num_requests / 2);
+
+	// a second reply to the same request doesn't match anything
+	reply(g_sent_packets.front().first, g_sent_packets.front().second["t"].string());
+	TEST_EQUAL(rpc.num_transactions(), num_requests / 2);
+
+	// a reply with the right slot but the wrong tag doesn't match
+	{
+		std::string tid = g_sent_packets.back().second["t"].string();
+		tid[3] = char(tid[3] ^ 1);
+		reply(g_sent_packets.back().first, tid);
+		TEST_EQUAL(rpc.num_transactions(), num_requests / 2);
+	}
+
+	// the remaining requests hit the short timeout, but are still waiting
+	// for a reply
+	rpc.tick(clock_type::now() + milliseconds(1100));
+	TEST_EQUAL(rpc.num_transactions(), num_requests / 2);
+
+	std::int64_t timeouts = 0;
+	for (int b = 0; b < counters::num_histogram_buckets; ++b)
+		timeouts += t.cnt[counters::dht_timeout_latency + b];
+	TEST_EQUAL(timeouts, num_requests / 2);
+
+	// free slots are reused in the order they were freed. The ones that were
+	// never used come first, not the ones just freed by the replies
+	g_sent_packets.clear();
+	{
+		udp::endpoint const ep(addr4("10.1.0.0"), 6881);
+		auto o = rpc.allocate_observer<null_observer>(algo, ep, node_id());
+#if TORRENT_USE_ASSERTS
+		o->m_in_constructor = false;
+#endif
+		entry req;
+		req["q"] = "ping";
+		TEST_CHECK(rpc.invoke(req, ep, o));
+	}
+	TEST_EQUAL(g_sent_packets.size(), 1);
+	std::string const tid = g_sent_packets.front().second["t"].string();
+	TEST_EQUAL(tid.size(), 4);
+	char const* ptr = tid.data();
+	TEST_CHECK(aux::read_uint16(ptr) >= num_requests);
+}
+
 // test bucket distribution
 TORRENT_TEST(node_id_bucket_distribution)
 {
@@ -3855,6 +4019,55 @@ TORRENT_TEST(classify_prefix)
 	TEST_EQUAL(int(classify_prefix(12, true, 16, to_hash("cdcfcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"))), 15);
 }
 
+TORRENT_TEST(ip_set)
+{
+	ip_set ips;
+	TEST_CHECK(!ips.exists(addr4("10.0.0.1")));
+
+	// the same address may be inserted multiple times, and is removed once
+	// per insert
+	ips.insert(addr4("10.0.0.1"));
+	ips.insert(addr4("10.0.0.1"));
+	ips.insert(addr6("2001::1"));
+	TEST_EQUAL(ips.size(), 3);
+	ips.erase(addr4("10.0.0.1"));
+	TEST_CHECK(ips.exists(addr4("10.0.0.1")));
+	ips.erase(addr4("10.0.0.1"));
+	TEST_CHECK(!ips.exists(addr4("10.0.0.1")));
+	TEST_CHECK(ips.exists(addr6("2001::1")));
+
+	// grow the table, and erase every other address. The remaining ones must
+	// still be found after their neighbors were shifted back
+	std::vector<address> addrs;
+	for (int i = 0; i < 1000; ++i)
+	{
+		addrs.push_back(rand_v4());
+		addrs.push_back(rand_v6());
+		ips.insert(addrs[addrs.size() - 2]);
+		ips.insert(addrs.back());
+	}
+	for (std::size_t i = 0; i < addrs.size(); i += 2)
+		ips.erase(addrs[i]);
+	for (std::size_t i = 0; i < addrs.size(); ++i)
+	{
+		// random addresses may repeat
+		if (std::count(addrs.begin(), addrs.end(), addrs[i]) > 1) continue;
+		TEST_EQUAL(ips.exists(addrs[i]), i % 2 == 1);
+	}
+
+	ip_set copy;
+	copy.insert(addr6("2001::1"));
+	for (std::size_t i = 1; i < addrs.size(); i += 2)
+		copy.insert(addrs[i]);
+	TEST_CHECK(copy == ips);
+	copy.erase(addr6("2001::1"));
+	TEST_CHECK(!(copy == ips));
+
+	ips.clear();
+	TEST_EQUAL(ips.size(), 0);
+	TEST_CHECK(!ips.exists(addrs[1]));
+}
+
 namespace {
 node_entry n(ip_set* ips, char const* nid, bool verified = true, int rtt = 0, int failed = 0)
 {
@@ -4076,6 +4289,389 @@ TORRENT_TEST(rate_limit_accrue_limit)
 	});
 }
 
+namespace {
+
+std::vector<char> encode_query(char const* q, msg_args const& args)
+{
+	entry e;
+	e["q"] = q;
+	e["t"] = "10";
+	e["y"] = "q";
+	e["a"] = args.a;
+	e["a"].dict().insert(std::make_pair("id", generate_next().to_string()));
+	std::vector<char> ret;
+	bencode(std::back_inserter(ret), e);
+	return ret;
+}
+
+}
+
+TORRENT_TEST(worker_pool_get_peers)
+{
+	dht_test_setup t(udp::endpoint(rand_v4(), 20));
+
+	sha1_hash const info_hash("01010101010101010101");
+	tcp::endpoint const peer(rand_v4(), 6881);
+	t.dht_storage->announce_peer(info_hash, peer, "", false);
+
+	auto nodes = std::make_shared<std::vector<node_snapshot>>(1);
+	node_snapshot& ns = nodes->front();
+	ns.sock = t.ls;
+	ns.nid = t.dht_node.nid();
+	ns.family_name = t.dht_node.protocol_family_name();
+	ns.nodes_key = t.dht_node.protocol_nodes_key();
+	ns.write_key = t.dht_node.write_key();
+	ns.bucket_size = 8;
+	for (int i = 0; i < 20; ++i)
+		ns.nodes.emplace_back(generate_next(), udp::endpoint(rand_v4(), 6881), 10, true);
+	// a node with the info-hash as its ID is the closest one
+	ns.nodes.emplace_back(info_hash, udp::endpoint(rand_v4(), 6881), 10, true);
+
+	std::mutex m;
+	std::condition_variable cond;
+	bool woken = false;
+	dht_worker_pool pool(2, t.sett, t.cnt, *t.dht_storage, &t.observer, &t.s
+		, [&] {
+			std::lock_guard<std::mutex> l(m);
+			woken = true;
+			cond.notify_all();
+		});
+	pool.publish(nodes);
+
+	// replies and malformed messages are left to the network thread
+	std::vector<char> const response = encode_query("get_peers"
+		, msg_args().info_hash("01010101010101010101"));
+	std::string reply_msg(response.begin(), response.end());
+	reply_msg.replace(reply_msg.size() - 4, 3, "1:r");
+	TEST_CHECK(!pool.post(t.ls, t.source, reply_msg));
+
+	TEST_CHECK(pool.post(t.ls, t.source, encode_query("get_peers"
+		, msg_args().info_hash("01010101010101010101"))));
+	// announce_peer modifies the storage, it's bounced back to the network
+	// thread
+	TEST_CHECK(pool.post(t.ls, t.source, encode_query("announce_peer"
+		, msg_args().info_hash("01010101010101010101").port(1234).token("abcd"))));
+
+	std::vector<dht_worker_pool::packet> out;
+	time_point const deadline = clock_type::now() + seconds(10);
+	while (out.size() < 2 && clock_type::now() < deadline)
+	{
+		std::vector<dht_worker_pool::packet> tmp;
+		std::unique_lock<std::mutex> l(m);
+		cond.wait_for(l, milliseconds(100), [&] { return woken; });
+		woken = false;
+		l.unlock();
+		pool.take(tmp);
+		for (auto& p : tmp) out.emplace_back(std::move(p));
+	}
+	pool.stop();
+
+	TEST_EQUAL(out.size(), 2);
+	for (auto const& p : out)
+	{
+		TEST_CHECK(p.sock == aux::listen_socket_handle(t.ls));
+		TEST_CHECK(p.ep == t.source);
+		if (!p.reply)
+		{
+			TEST_CHECK(!p.heard);
+			continue;
+		}
+
+		TEST_CHECK(p.heard);
+		bdecode_node response_node;
+		error_code ec;
+		bdecode(p.buf.data(), p.buf.data() + p.buf.size(), response_node, ec);
+		TEST_CHECK(!ec);
+
+		bdecode_node peer1_keys[4];
+		TEST_CHECK(dht::verify_message(response_node, peer1_desc, peer1_keys, t.error_string));
+		TEST_EQUAL(peer1_keys[2].string_value(), t.dht_node.generate_token(t.source, info_hash));
+		TEST_EQUAL(node_id(peer1_keys[3].string_ptr()), t.dht_node.nid());
+
+		bdecode_node const r = response_node.dict_find_dict("r");
+		bdecode_node const values = r.dict_find_list("values");
+		TEST_CHECK(values && values.list_size() == 1);
+		if (values && values.list_size() == 1)
+			TEST_CHECK(aux::read_v4_endpoint<tcp::endpoint>(values.list_at(0).string_ptr()) == peer);
+
+		// the 8 closest nodes, the first one being the node with the
+		// info-hash as its ID
+		string_view const compact_nodes = r.dict_find_string_value("nodes");
+		TEST_EQUAL(compact_nodes.size(), 8 * 26);
+		TEST_CHECK(compact_nodes.substr(0, 20) == info_hash.to_string());
+		TEST_CHECK(!response_node.dict_find_string_value("v").empty());
+	}
+}
+
+TORRENT_TEST(signature_verifier_put)
+{
+	dht_test_setup t(udp::endpoint(rand_v4(), 20));
+	g_sent_packets.clear();
+
+	std::mutex m;
+	std::condition_variable cond;
+	bool woken = false;
+	signature_verifier verifier(2, [&] {
+		std::lock_guard<std::mutex> l(m);
+		woken = true;
+		cond.notify_all();
+	});
+	t.dht_node.set_signature_verifier(&verifier);
+
+	// waits for the verifier and completes the puts it returns
+	auto complete_puts = [&](int const num)
+	{
+		int done = 0;
+		time_point const deadline = clock_type::now() + seconds(10);
+		while (done < num && clock_type::now() < deadline)
+		{
+			std::unique_lock<std::mutex> l(m);
+			cond.wait_for(l, milliseconds(100), [&] { return woken; });
+			woken = false;
+			l.unlock();
+			std::vector<mutable_put> out;
+			verifier.take(out);
+			for (auto& p : out) t.dht_node.put_verified(p);
+			done += int(out.size());
+		}
+		TEST_EQUAL(done, num);
+	};
+
+	public_key pk;
+	secret_key sk;
+	get_test_keypair(pk, sk);
+	sha1_hash const target = item_target_id({}, pk);
+	std::string const token = t.dht_node.generate_token(t.source, target);
+
+	entry const value(5);
+	char buffer[100];
+	span<char const> const itemv(buffer, bencode(buffer, value));
+
+	// the response is sent once the signature has been checked
+	signature sig = sign_mutable_item(itemv, {}, sequence_number(2), pk, sk);
+	bdecode_node response;
+	send_dht_request(t.dht_node, "put", t.source, &response
+		, msg_args().token(token).value(value).key(pk).sig(sig).seq(sequence_number(2))
+		, "10", false);
+	complete_puts(1);
+
+	auto const i = find_packet(t.source);
+	TEST_CHECK(i != g_sent_packets.end());
+	if (i != g_sent_packets.end())
+	{
+		node_from_entry(i->second, response);
+		g_sent_packets.erase(i);
+		TEST_EQUAL(response.dict_find_string_value("y"), "r");
+		TEST_EQUAL(response.dict_find_string_value("t"), "10");
+	}
+	sequence_number seq;
+	TEST_CHECK(t.dht_storage->get_mutable_item_seq(target, seq));
+	TEST_EQUAL(seq.value, 2);
+
+	// a broken signature is rejected once it's been checked
+	sig = sign_mutable_item(itemv, {}, sequence_number(3), pk, sk);
+	sig.bytes[2] ^= 0xaa;
+	send_dht_request(t.dht_node, "put", t.source, &response
+		, msg_args().token(token).value(value).key(pk).sig(sig).seq(sequence_number(3))
+		, "11", false);
+	complete_puts(1);
+
+	auto const j = find_packet(t.source);
+	TEST_CHECK(j != g_sent_packets.end());
+	if (j != g_sent_packets.end())
+	{
+		node_from_entry(j->second, response);
+		g_sent_packets.erase(j);
+		bdecode_node err_keys[2];
+		TEST_CHECK(verify_message(response, err_desc, err_keys, t.error_string));
+		TEST_EQUAL(err_keys[0].string_value(), "e");
+		TEST_EQUAL(err_keys[1].list_int_value_at(0), 206);
+	}
+	TEST_CHECK(t.dht_storage->get_mutable_item_seq(target, seq));
+	TEST_EQUAL(seq.value, 2);
+
+	// a put with an old sequence number is rejected without checking its
+	// signature
+	sig = sign_mutable_item(itemv, {}, sequence_number(1), pk, sk);
+	send_dht_request(t.dht_node, "put", t.source, &response
+		, msg_args().token(token).value(value).key(pk).sig(sig).seq(sequence_number(1)));
+	bdecode_node err_keys[2];
+	TEST_CHECK(verify_message(response, err_desc, err_keys, t.error_string));
+	TEST_EQUAL(err_keys[1].list_int_value_at(0), 302);
+
+	verifier.stop();
+	t.dht_node.set_signature_verifier(nullptr);
+}
+
+TORRENT_TEST(announce_scheduler)
+{
+	using lt::dht::announce_scheduler;
+	announce_scheduler s;
+
+	auto const key = [](int const i) {
+		sha1_hash h;
+		h[0] = std::uint8_t(i * 16);
+		return h;
+	};
+
+	for (int i = 1; i < 10; ++i)
+		TEST_CHECK(s.add({key(i), 6881, {}, {}}));
+	// announcing the same info-hash again replaces the queued one
+	TEST_CHECK(!s.add({key(3), 6882, {}, {}}));
+	TEST_EQUAL(s.size(), 9);
+
+	// an idle scheduler has 5 seconds worth of budget saved up. At 40
+	// packets per second and the initial estimate of 40 packets per
+	// announce, that's 5 announces
+	time_point const start = clock_type::now();
+	std::vector<announce_scheduler::request> out;
+	s.pop(start, 40, 1, out);
+	TEST_EQUAL(out.size(), 5);
+	for (int i = 0; i < int(out.size()); ++i)
+		TEST_CHECK(out[std::size_t(i)].info_hash == key(i + 1));
+	TEST_EQUAL(out[2].port, 6882);
+	TEST_CHECK(s.next_release(40) > milliseconds(0));
+
+	// no time has passed, nothing more is released
+	out.clear();
+	s.pop(start, 40, 1, out);
+	TEST_CHECK(out.empty());
+
+	// one second buys one more announce, continuing where we left off
+	s.pop(start + seconds(1), 40, 1, out);
+	TEST_EQUAL(out.size(), 1);
+	TEST_CHECK(out[0].info_hash == key(6));
+
+	// the sweep wraps around to the start of the key space
+	TEST_CHECK(s.add({key(0), 6881, {}, {}}));
+	out.clear();
+	s.pop(start + seconds(10), 40, 1, out);
+	TEST_EQUAL(out.size(), 4);
+	TEST_CHECK(out[0].info_hash == key(7));
+	TEST_CHECK(out[2].info_hash == key(9));
+	TEST_CHECK(out[3].info_hash == key(0));
+	TEST_CHECK(s.empty());
+
+	// the cost estimate follows the reported traversals
+	for (int i = 0; i < 50; ++i) s.traversal_done(10);
+	TEST_EQUAL(s.packets_per_traversal(), 10);
+}
+
+TORRENT_TEST(infohash_crawler)
+{
+	using lt::dht::infohash_crawler;
+	infohash_crawler c;
+	time_point32 const now = aux::time_now32();
+
+	auto const ep = [](int const i) {
+		return udp::endpoint(address_v4(std::uint32_t(0x0a000000 + i)), 6881);
+	};
+	auto const ih = [](int const i) {
+		sha1_hash h;
+		h[0] = std::uint8_t(i);
+		return h;
+	};
+
+	for (int i = 0; i < 10; ++i) c.add_node(ep(i), now);
+	c.add_node(ep(0), now);
+	TEST_EQUAL(c.num_nodes(), 10);
+
+	// the window starts out small
+	std::vector<infohash_crawler::request> out;
+	c.next_requests(now, out);
+	TEST_EQUAL(int(out.size()), infohash_crawler::min_window);
+	TEST_EQUAL(c.outstanding(), infohash_crawler::min_window);
+	// consecutive targets are spread over the key space
+	TEST_EQUAL(out[0].target[0], 0);
+	TEST_EQUAL(out[1].target[0], 0x80);
+	TEST_EQUAL(out[2].target[0], 0x40);
+	TEST_EQUAL(out[3].target[0], 0xc0);
+
+	std::vector<sha1_hash> found;
+	c.got_samples(out[0].ep, now, seconds(600), 10, {ih(1), ih(2), ih(3)}, {});
+	c.take_infohashes(found);
+	TEST_EQUAL(found.size(), 3);
+
+	// info-hashes are only reported once
+	found.clear();
+	c.got_samples(out[1].ep, now, seconds(600), 10, {ih(1), ih(4)}, {});
+	TEST_EQUAL(c.num_pending_infohashes(), 1);
+	c.take_infohashes(found);
+	TEST_EQUAL(found.size(), 1);
+	TEST_CHECK(found[0] == ih(4));
+	TEST_EQUAL(c.num_unique(), 4);
+
+	// this node returned everything it has, and this one failed. Both are
+	// forgotten right away
+	c.got_samples(out[3].ep, now, seconds(600), 1, {ih(5)}, {});
+	c.failed(out[2].ep, now);
+	TEST_EQUAL(c.num_requests(), 4);
+	TEST_EQUAL(c.num_responses(), 3);
+	TEST_EQUAL(c.num_nodes(), 8);
+
+	// the window was full, and most requests succeeded. It grows
+	TEST_EQUAL(c.window(), infohash_crawler::min_window + 2);
+
+	std::vector<infohash_crawler::request> out2;
+	c.next_requests(now, out2);
+	TEST_EQUAL(out2.size(), 6);
+	for (auto const& r : out2)
+		for (auto const& prev : out)
+			TEST_CHECK(r.ep != prev.ep);
+
+	// the nodes that responded aren't asked again before their interval
+	TEST_CHECK(c.idle(now + seconds32(599)));
+	TEST_CHECK(!c.idle(now + seconds32(600)));
+
+	// most requests failing shrinks the window
+	for (auto const& r : out2) c.failed(r.ep, now);
+	TEST_EQUAL(c.outstanding(), 0);
+	TEST_EQUAL(c.window(), 5);
+	TEST_EQUAL(c.num_nodes(), 2);
+
+	// only the nodes with more info-hashes are asked again
+	out.clear();
+	c.next_requests(now + seconds32(600), out);
+	TEST_EQUAL(out.size(), 2);
+
+	// the nodes returned in responses are queried too
+	c.got_samples(out[0].ep, now, seconds(600), 10, {}, {{ih(0), ep(100)}});
+	TEST_EQUAL(c.num_nodes(), 3);
+	TEST_CHECK(!c.idle(now));
+
+	// the number of nodes is bounded
+	for (int i = 0; i < infohash_crawler::max_nodes * 2; ++i)
+		c.add_node(ep(1000 + i), now);
+	TEST_EQUAL(c.num_nodes(), infohash_crawler::max_nodes);
+
+	// once full, a new node replaces the one that would be asked last, as
+	// long as that one isn't due yet
+	infohash_crawler c2;
+	c2.add_node(ep(0), now + seconds32(60));
+	for (int i = 1; i < infohash_crawler::max_nodes; ++i)
+		c2.add_node(ep(i), now);
+	c2.add_node(ep(infohash_crawler::max_nodes), now);
+	c2.add_node(ep(infohash_crawler::max_nodes + 1), now);
+	TEST_EQUAL(c2.num_nodes(), infohash_crawler::max_nodes);
+
+	int due = 0;
+	bool asked_evicted = false;
+	for (;;)
+	{
+		out.clear();
+		c2.next_requests(now, out);
+		if (out.empty()) break;
+		for (auto const& r : out)
+		{
+			if (r.ep == ep(0)) asked_evicted = true;
+			c2.failed(r.ep, now);
+		}
+		due += int(out.size());
+	}
+	TEST_EQUAL(due, infohash_crawler::max_nodes);
+	TEST_CHECK(!asked_evicted);
+	TEST_EQUAL(c2.num_nodes(), 0);
+}
 
 // TODO: test obfuscated_get_peers
 
@@ -42,12 +42,15 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/random.hpp"
 #include "libtorrent/kademlia/ed25519.hpp"
 #include "libtorrent/hex.hpp" // from_hex
+#include "libtorrent/bloom_filter.hpp"
 
 #include "libtorrent/kademlia/dht_storage.hpp"
 #include "libtorrent/kademlia/node_id.hpp"
 #include "libtorrent/kademlia/routing_table.hpp"
 #include "libtorrent/kademlia/item.hpp"
 #include "libtorrent/kademlia/dht_observer.hpp"
+#include "libtorrent/kademlia/dht_snapshot.hpp"
+#include "libtorrent/aux_/time.hpp"
 
 #include <numeric>
 
@@ -89,6 +92,24 @@ namespace
 
 		return s;
 	}
+
+	std::unique_ptr<dht_storage_interface> create_compact_dht_storage(
+		settings_interface const& sett)
+	{
+		std::unique_ptr<dht_storage_interface> s(dht_compact_storage_constructor(sett));
+		TEST_CHECK(s != nullptr);
+
+		s->update_node_ids({to_hash("0000000000000000000000000000000000000200")});
+
+		return s;
+	}
+
+	bool has_torrent(dht_storage_interface const& s, sha1_hash const& ih)
+	{
+		entry peers;
+		s.get_peers(ih, false, false, address(), peers);
+		return peers.find_key("values") != nullptr;
+	}
 }
 
 sha1_hash const n1 = to_hash("5fbfbff10c5d6a4ec8a88e4c6ab4c28b95eee401");
@@ -284,6 +305,65 @@ TORRENT_TEST(peer_limit)
 	TEST_EQUAL(cnt.peers, 42);
 }
 
+namespace {
+
+	// the scrape filters returned for n1 must match the announced peers,
+	// whether the storage builds them on demand or maintains them
+	void test_scrape(dht_storage_constructor_type const& constructor)
+	{
+		auto sett = test_settings();
+		sett.set_int(settings_pack::dht_max_peers, 500);
+		std::unique_ptr<dht_storage_interface> s(constructor(sett));
+		s->update_node_ids({to_hash("0000000000000000000000000000000000000200")});
+
+		std::vector<bool> seed(300);
+		auto check_filters = [&](int const num_peers)
+		{
+			bloom_filter<256> downloaders;
+			bloom_filter<256> seeds;
+			for (int i = 0; i < num_peers; ++i)
+			{
+				sha1_hash const iphash = hash_address(address_v4(std::uint32_t(0x0a000000 + i)));
+				if (seed[std::size_t(i)]) seeds.set(iphash);
+				else downloaders.set(iphash);
+			}
+
+			entry peers;
+			s->get_peers(n1, false, true, addr("124.31.75.21"), peers);
+			TEST_EQUAL(peers["BFpe"].string(), downloaders.to_string());
+			TEST_EQUAL(peers["BFsd"].string(), seeds.to_string());
+		};
+
+		for (int i = 0; i < 300; ++i)
+		{
+			seed[std::size_t(i)] = (i % 3) == 0;
+			s->announce_peer(n1, tcp::endpoint(address_v4(std::uint32_t(0x0a000000 + i)), 6881)
+				, "torrent_name", seed[std::size_t(i)]);
+			if (i == 9 || i == 99) check_filters(i + 1);
+		}
+		check_filters(300);
+
+		// peers changing from downloader to seed, and back
+		for (int i = 0; i < 300; i += 2)
+		{
+			seed[std::size_t(i)] = !seed[std::size_t(i)];
+			s->announce_peer(n1, tcp::endpoint(address_v4(std::uint32_t(0x0a000000 + i)), 6881)
+				, "torrent_name", seed[std::size_t(i)]);
+		}
+		check_filters(300);
+	}
+}
+
+TORRENT_TEST(scrape_filters)
+{
+	test_scrape(dht_default_storage_constructor);
+}
+
+TORRENT_TEST(compact_scrape_filters)
+{
+	test_scrape(dht_compact_storage_constructor);
+}
+
 TORRENT_TEST(torrent_limit)
 {
 	auto sett = test_settings();
@@ -506,6 +586,313 @@ TORRENT_TEST(infohashes_sample_dist)
 	std::printf("infohashes set size: %d\n", int(infohash_set.size()));
 	TEST_CHECK(infohash_set.size() > 500);
 }
+
+TORRENT_TEST(compact_announce_peer)
+{
+	auto const sett = test_settings();
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	entry peers;
+	s->get_peers(n1, false, false, address(), peers);
+	TEST_CHECK(peers["n"].string().empty());
+	TEST_CHECK(peers["values"].list().empty());
+
+	s->announce_peer(n1, ep("124.31.75.21", 1), "torrent_name", false);
+	s->announce_peer(n1, ep("124.31.75.22", 1), "other_name", true);
+	s->announce_peer(n1, ep("124.31.75.22", 1), "", true);
+	s->announce_peer(n1, ep("2000::1", 1), "", false);
+
+	peers = entry();
+	s->get_peers(n1, false, false, address(), peers);
+	TEST_EQUAL(peers["n"].string(), "torrent_name");
+	TEST_EQUAL(peers["values"].list().size(), 2);
+
+	// seeds are left out when the requester is a seed
+	peers = entry();
+	s->get_peers(n1, true, false, address(), peers);
+	TEST_EQUAL(peers["values"].list().size(), 1);
+	TEST_EQUAL(aux::read_v4_endpoint<tcp::endpoint>(
+		peers["values"].list().front().string().begin()), ep("124.31.75.21", 1));
+
+	peers = entry();
+	s->get_peers(n1, false, false, address_v6(), peers);
+	TEST_EQUAL(peers["values"].list().size(), 1);
+
+	peers = entry();
+	s->get_peers(n1, false, true, address(), peers);
+	TEST_EQUAL(peers["BFpe"].string().size(), 256);
+	TEST_EQUAL(peers["BFsd"].string().size(), 256);
+
+	TEST_EQUAL(s->counters().torrents, 1);
+	TEST_EQUAL(s->counters().peers, 3);
+}
+
+TORRENT_TEST(compact_torrent_limit)
+{
+	// at the limit, the least recently announced torrent is evicted to make
+	// room for a new one
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_torrents, 2000);
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	std::vector<sha1_hash> hashes;
+	for (int i = 0; i < 5000; ++i)
+	{
+		hashes.push_back(rand_hash());
+		s->announce_peer(hashes.back(), {rand_v4(), std::uint16_t(lt::random(0xffff))}
+			, "", false);
+		TEST_CHECK(s->counters().torrents <= 2000);
+	}
+	TEST_EQUAL(s->counters().torrents, 2000);
+	TEST_EQUAL(s->counters().peers, 2000);
+
+	int found = 0;
+	for (int i = 0; i < 3000; ++i)
+		if (has_torrent(*s, hashes[std::size_t(i)])) ++found;
+	TEST_EQUAL(found, 0);
+
+	found = 0;
+	for (int i = 3000; i < 5000; ++i)
+		if (has_torrent(*s, hashes[std::size_t(i)])) ++found;
+	TEST_EQUAL(found, 2000);
+
+	// announcing to a torrent makes it the most recently used one
+	s->announce_peer(hashes[3000], ep("124.31.75.21", 1), "", false);
+	s->announce_peer(rand_hash(), ep("124.31.75.21", 1), "", false);
+	TEST_CHECK(has_torrent(*s, hashes[3000]));
+	TEST_CHECK(!has_torrent(*s, hashes[3001]));
+	TEST_EQUAL(s->counters().torrents, 2000);
+	TEST_EQUAL(s->counters().peers, 2001);
+}
+
+TORRENT_TEST(compact_peer_limit)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_peers, 42);
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	for (int i = 0; i < 200; ++i)
+	{
+		s->announce_peer(n1, {rand_v4(), std::uint16_t(lt::random(0xffff))}
+			, "torrent_name", false);
+		TEST_CHECK(s->counters().peers <= 42);
+	}
+	TEST_EQUAL(s->counters().peers, 42);
+
+	// a full torrent only hands out write tokens to peers already in it
+	entry peers;
+	TEST_CHECK(s->get_peers(n1, false, false, addr("124.31.75.21"), peers));
+}
+
+TORRENT_TEST(compact_item_limit)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_dht_items, 42);
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	public_key pk;
+	signature sig;
+	std::vector<sha1_hash> targets;
+	for (int i = 0; i < 200; ++i)
+	{
+		targets.push_back(rand_hash());
+		s->put_immutable_item(targets.back(), {"123", 3}, rand_v4());
+		s->put_mutable_item(targets.back(), {"123", 3}, sig, sequence_number(1)
+			, pk, {"salt", 4}, rand_v4());
+		TEST_CHECK(s->counters().immutable_data <= 42);
+		TEST_CHECK(s->counters().mutable_data <= 42);
+	}
+	TEST_EQUAL(s->counters().immutable_data, 42);
+	TEST_EQUAL(s->counters().mutable_data, 42);
+
+	entry item;
+	TEST_CHECK(!s->get_immutable_item(targets.front(), item));
+	TEST_CHECK(s->get_immutable_item(targets.back(), item));
+
+	// a newer sequence number replaces the value
+	s->put_mutable_item(targets.back(), {"4:test", 6}, sig, sequence_number(2)
+		, pk, {"salt", 4}, rand_v4());
+	item = entry();
+	TEST_CHECK(s->get_mutable_item(targets.back(), sequence_number(1), false, item));
+	TEST_EQUAL(item["seq"].integer(), 2);
+	TEST_EQUAL(item["v"].string(), "test");
+}
+
+TORRENT_TEST(compact_memory_limit)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_torrents, 100000);
+	sett.set_int(settings_pack::dht_storage_memory_limit, 256);
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	sha1_hash last;
+	for (int i = 0; i < 10000; ++i)
+	{
+		last = rand_hash();
+		s->announce_peer(last, {rand_v4(), std::uint16_t(lt::random(0xffff))}
+			, "torrent_name", false);
+	}
+	// a torrent with a single peer takes about 160 bytes. Make sure the limit
+	// is neither exceeded nor left mostly unused
+	TEST_CHECK(s->counters().torrents > 1200);
+	TEST_CHECK(s->counters().torrents < 2200);
+	TEST_CHECK(has_torrent(*s, last));
+}
+
+TORRENT_TEST(compact_infohashes_sample_dist)
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_torrents, 1000);
+	sett.set_int(settings_pack::dht_sample_infohashes_interval, 0);
+	sett.set_int(settings_pack::dht_max_infohashes_sample_count, 20);
+	std::unique_ptr<dht_storage_interface> s(create_compact_dht_storage(sett));
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		s->announce_peer(rand_hash(), tcp::endpoint(rand_v4(), std::uint16_t(i))
+			, "torrent_name", false);
+	}
+
+	std::set<sha1_hash> infohash_set;
+	for (int i = 0; i < 100; ++i)
+	{
+		entry item;
+		int const r = s->get_infohashes_sample(item);
+		TEST_EQUAL(r, 20);
+		TEST_EQUAL(item["num"].integer(), 1000);
+		std::string const samples = item["samples"].string();
+		TEST_EQUAL(samples.size(), 20 * 20);
+
+		std::set<sha1_hash> sample;
+		for (std::size_t k = 0; k < samples.size(); k += 20)
+			sample.insert(sha1_hash(samples.substr(k, 20)));
+		TEST_EQUAL(sample.size(), 20);
+		infohash_set.insert(sample.begin(), sample.end());
+	}
+	// 100 uniform samples of 20 out of 1000 are expected to cover about
+	// 1000 * (1 - e^-2) = 865 of them
+	TEST_CHECK(infohash_set.size() > 750);
+	TEST_CHECK(infohash_set.size() <= 1000);
+}
+namespace {
+
+void test_snapshot(std::unique_ptr<dht_storage_interface> (*create)(settings_interface const&))
+{
+	auto sett = test_settings();
+	sett.set_int(settings_pack::dht_max_torrents, 100);
+	sett.set_int(settings_pack::dht_max_dht_items, 100);
+	std::unique_ptr<dht_storage_interface> s(create(sett));
+
+	for (int i = 0; i < 50; ++i)
+	{
+		s->announce_peer(rand_hash(), tcp::endpoint(rand_v4(), std::uint16_t(i + 1))
+			, "", i % 2 == 0);
+	}
+	s->announce_peer(n1, tcp::endpoint(addr("124.31.75.21"), 1), "torrent_name", false);
+	s->announce_peer(n1, tcp::endpoint(addr("2001::1"), 2), "torrent_name", true);
+	s->put_immutable_item(n2, {"3:abc", 5}, addr("124.31.75.21"));
+	public_key pk;
+	pk.bytes.fill('k');
+	signature sig;
+	sig.bytes.fill('s');
+	s->put_mutable_item(n3, {"i5e", 3}, sig, sequence_number(7), pk
+		, {"salt", 4}, addr("124.31.75.21"));
+
+	// the DHT writes the storage part a slice at a time
+	std::string records;
+	snapshot_writer storage_writer(records, 1000000);
+	dht_storage_position pos;
+	int slices = 0;
+	do
+	{
+		s->visit(storage_writer, pos, 7);
+		++slices;
+	} while (!pos.done);
+	storage_writer.flush();
+	TEST_EQUAL(slices, 8);
+
+	std::string snapshot;
+	snapshot_writer w(snapshot, 1000000);
+	w.header();
+	node_entry const live(to_hash("5fbfbff10c5d6a4ec8a88e4c6ab4c28b95eee405")
+		, udp::endpoint(addr("124.31.75.21"), 1), 50, true);
+	w.node(live, aux::time_now());
+	// a node we never heard from isn't restored
+	w.node(node_entry(n4, udp::endpoint(addr("124.31.75.22"), 1)), aux::time_now());
+	w.append(records);
+	w.flush();
+
+	std::unique_ptr<dht_storage_interface> restored(create(sett));
+	std::vector<node_entry> nodes;
+	TEST_CHECK(read_snapshot(snapshot, 1000000 + 60, nodes, *restored));
+
+	TEST_EQUAL(nodes.size(), 1);
+	TEST_CHECK(nodes[0].id == live.id);
+	TEST_CHECK(nodes[0].ep() == live.ep());
+	TEST_EQUAL(nodes[0].rtt, 50);
+	TEST_CHECK(nodes[0].pinged());
+	TEST_CHECK(nodes[0].last_queried < aux::time_now() - seconds(59));
+
+	TEST_EQUAL(restored->counters().torrents, 51);
+	TEST_EQUAL(restored->counters().peers, 52);
+	entry peers;
+	restored->get_peers(n1, false, false, addr("2001::2"), peers);
+	TEST_EQUAL(peers["n"].string(), "torrent_name");
+	TEST_EQUAL(peers["values"].list().size(), 1);
+
+	entry item;
+	TEST_CHECK(restored->get_immutable_item(n2, item));
+	TEST_EQUAL(item["v"].string(), "abc");
+	item = entry();
+	TEST_CHECK(restored->get_mutable_item(n3, sequence_number(0), true, item));
+	TEST_EQUAL(item["seq"].integer(), 7);
+	TEST_EQUAL(item["v"].integer(), 5);
+	TEST_CHECK(item["k"].string() == std::string(32, 'k'));
+
+	// restored peers keep their age. Saved again, they announced at the
+	// time of the first snapshot, and expire 45 minutes after it
+	std::string resaved;
+	snapshot_writer w2(resaved, 1000000 + 60);
+	w2.header();
+	dht_storage_position pos2;
+	restored->visit(w2, pos2, 1000);
+	w2.flush();
+	TEST_CHECK(pos2.done);
+	std::unique_ptr<dht_storage_interface> restored2(create(sett));
+	nodes.clear();
+	TEST_CHECK(read_snapshot(resaved, 1000000 + 44 * 60, nodes, *restored2));
+	TEST_EQUAL(restored2->counters().peers, 52);
+	restored2 = create(sett);
+	TEST_CHECK(read_snapshot(resaved, 1000000 + 45 * 60 + 30, nodes, *restored2));
+	TEST_EQUAL(restored2->counters().peers, 0);
+
+	// peers in a snapshot older than their lifetime aren't restored
+	restored = create(sett);
+	nodes.clear();
+	TEST_CHECK(read_snapshot(snapshot, 1000000 + 60 * 60, nodes, *restored));
+	TEST_EQUAL(restored->counters().torrents, 0);
+	TEST_EQUAL(restored->counters().immutable_data, 1);
+
+	// a truncated snapshot restores what's before the cut
+	restored = create(sett);
+	nodes.clear();
+	TEST_CHECK(!read_snapshot({snapshot.data(), 100}, 1000000, nodes, *restored));
+	TEST_EQUAL(nodes.size(), 1);
+	TEST_CHECK(!read_snapshot({"LTds", 4}, 1000000, nodes, *restored));
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(snapshot)
+{
+	test_snapshot(&create_default_dht_storage);
+}
+
+TORRENT_TEST(compact_snapshot)
+{
+	test_snapshot(&create_compact_dht_storage);
+}
+
 #else
 TORRENT_TEST(dummy) {}
 #endif
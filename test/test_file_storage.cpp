@@ -1184,5 +1184,87 @@ TORRENT_TEST(size_on_disk_explicit_pads)
 	TEST_CHECK(aux::size_on_disk(fs) < fs.total_size());
 }
 
+TORRENT_TEST(directory_tree)
+{
+	file_storage fs;
+	fs.set_piece_length(0x4000);
+	fs.add_file(combine_path("test", combine_path("a", combine_path("b", "1"))), 10);
+	fs.add_file(combine_path("test", combine_path("a", combine_path("c", "2"))), 10);
+	fs.add_file(combine_path("test", combine_path("a", "3")), 10);
+	fs.add_file(combine_path("test", "4"), 10);
+
+	// every parent directory is part of the tree, and shared between files
+	auto const paths = fs.paths();
+	TEST_EQUAL(paths.size(), 4);
+	TEST_EQUAL(paths[0_path], "a");
+	TEST_EQUAL(paths[1_path], combine_path("a", "b"));
+	TEST_EQUAL(paths[2_path], combine_path("a", "c"));
+	TEST_EQUAL(paths[3_path], "");
+
+	TEST_EQUAL(fs.file_path(0_file), combine_path("test", combine_path("a", combine_path("b", "1"))));
+	TEST_EQUAL(fs.file_path(1_file), combine_path("test", combine_path("a", combine_path("c", "2"))));
+	TEST_EQUAL(fs.file_path(2_file), combine_path("test", combine_path("a", "3")));
+	TEST_EQUAL(fs.file_path(3_file), combine_path("test", "4"));
+
+	// renaming a file into a new directory extends the tree
+	fs.rename_file(3_file, combine_path("test", combine_path("a", combine_path("d", "4"))));
+	TEST_EQUAL(fs.paths().size(), 5);
+	TEST_EQUAL(fs.file_path(3_file), combine_path("test", combine_path("a", combine_path("d", "4"))));
+
+	// copies have their own tree
+	file_storage fs2 = fs;
+	fs2.rename_file(0_file, combine_path("test", combine_path("e", "1")));
+	TEST_EQUAL(fs2.paths().size(), 6);
+	TEST_EQUAL(fs.paths().size(), 5);
+	TEST_EQUAL(fs2.file_path(0_file), combine_path("test", combine_path("e", "1")));
+	TEST_EQUAL(fs.file_path(0_file), combine_path("test", combine_path("a", combine_path("b", "1"))));
+}
+
+TORRENT_TEST(deep_directory_tree)
+{
+	// a dataset-like layout, with long directory names repeated across many
+	// files
+	file_storage fs;
+	fs.set_piece_length(0x4000);
+	int const num_files = 10000;
+	for (int i = 0; i < num_files; ++i)
+	{
+		fs.add_file("dataset/training-images-high-resolution/split-" + std::to_string(i % 10)
+			+ "/category-" + std::to_string(i % 1000)
+			+ "/subject-" + std::to_string(i % 5000)
+			+ "/image-" + std::to_string(i) + ".jpg", 0x3000);
+	}
+
+	// each directory only stores its own path segment, which is shorter
+	// than the full paths
+	auto const paths = fs.paths();
+	std::size_t full_paths = 0;
+	std::size_t segments = 0;
+	for (auto const& p : paths)
+	{
+		full_paths += p.size();
+		segments += lt::rsplit_path(p).second.size();
+	}
+	TEST_CHECK(segments < full_paths);
+
+	// every file's parent directory, and every parent of it
+	TEST_EQUAL(int(paths.size()), 1 + 10 + 1000 + 5000);
+
+	for (int i = 0; i < num_files; i += 997)
+	{
+		std::int64_t const offset = std::int64_t(i) * 0x3000 + i % 0x3000;
+		TEST_EQUAL(fs.file_index_at_offset(offset), file_index_t{i});
+	}
+
+	TEST_EQUAL(fs.file_path(file_index_t{2345}), combine_path("dataset"
+		, combine_path("training-images-high-resolution"
+		, combine_path("split-5", combine_path("category-345"
+		, combine_path("subject-2345", "image-2345.jpg"))))));
+	TEST_EQUAL(fs.file_path(file_index_t{9999}), combine_path("dataset"
+		, combine_path("training-images-high-resolution"
+		, combine_path("split-9", combine_path("category-999"
+		, combine_path("subject-4999", "image-9999.jpg"))))));
+}
+
 // TODO: test file attributes
 // TODO: test symlinks
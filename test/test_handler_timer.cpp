@@ -0,0 +1,141 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "test.hpp"
+#include "libtorrent/aux_/handler_timer.hpp"
+#include "libtorrent/performance_counters.hpp"
+
+#include <chrono>
+#include <thread>
+
+using namespace lt;
+
+namespace {
+
+void sleep_ms(int const ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+}
+
+TORRENT_TEST(disabled_timers_are_not_counted)
+{
+	aux::set_handler_timers_enabled(false);
+	counters c;
+	aux::drain_handler_times(c);
+
+	{
+		aux::handler_timer t(aux::handler_category::tick);
+		sleep_ms(10);
+	}
+
+	counters cnt;
+	aux::drain_handler_times(cnt);
+	TEST_EQUAL(cnt[counters::handler_wall_tick], 0);
+	TEST_EQUAL(cnt[counters::handler_cpu_tick], 0);
+}
+
+TORRENT_TEST(nested_timers_are_exclusive)
+{
+	aux::set_handler_timers_enabled(true);
+	counters c;
+	aux::drain_handler_times(c);
+	counters cnt;
+
+	{
+		aux::handler_timer outer(aux::handler_category::tick);
+		sleep_ms(10);
+		{
+			aux::handler_timer inner(aux::handler_category::torrent_tick);
+			sleep_ms(50);
+		}
+	}
+	aux::drain_handler_times(cnt);
+
+	std::int64_t const tick = cnt[counters::handler_wall_tick];
+	std::int64_t const torrent_tick = cnt[counters::handler_wall_torrent_tick];
+
+	TEST_CHECK(torrent_tick >= 50000);
+	TEST_CHECK(tick >= 10000);
+	// the time of the inner timer is not attributed to the outer one
+	TEST_CHECK(tick < 50000);
+
+	// draining resets the accumulators
+	counters cnt2;
+	aux::drain_handler_times(cnt2);
+	TEST_EQUAL(cnt2[counters::handler_wall_tick], 0);
+	TEST_EQUAL(cnt2[counters::handler_wall_torrent_tick], 0);
+}
+
+TORRENT_TEST(cpu_time_is_sampled)
+{
+	if (aux::thread_cpu_time() < 0) return;
+
+	aux::set_handler_timers_enabled(true);
+	counters c;
+	aux::drain_handler_times(c);
+
+	// only one in handler_cpu_sample_interval top-level timers samples CPU
+	// time, make sure at least one does
+	for (int i = 0; i < aux::handler_cpu_sample_interval; ++i)
+	{
+		aux::handler_timer t(aux::handler_category::dht);
+		auto const end = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+		while (std::chrono::steady_clock::now() < end);
+	}
+
+	counters cnt;
+	aux::drain_handler_times(cnt);
+	TEST_CHECK(cnt[counters::handler_wall_dht] >= 2000 * aux::handler_cpu_sample_interval);
+	TEST_CHECK(cnt[counters::handler_cpu_dht] > 0);
+}
+
+TORRENT_TEST(excluded_threads_are_not_counted)
+{
+	aux::set_handler_timers_enabled(true);
+
+	// worker threads are never drained by the session, their time would
+	// pile up without being reported
+	std::int64_t wall = -1;
+	std::thread worker([&wall] {
+		aux::exclude_thread_from_handler_timers();
+		{
+			aux::handler_timer t(aux::handler_category::dht);
+			sleep_ms(10);
+		}
+		wall = aux::current_handler_times().wall[static_cast<int>(aux::handler_category::dht)];
+	});
+	worker.join();
+	TEST_EQUAL(wall, 0);
+}
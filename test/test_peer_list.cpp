@@ -965,6 +965,34 @@ TORRENT_TEST(new_peer_size_limit)
 		, 5);
 }
 
+// when all connect candidates are waiting for their reconnect timeout, the
+// peer list reports when the first one expires
+TORRENT_TEST(next_connect_deadline)
+{
+	torrent_state st = init_state();
+	st.min_reconnect_time = 60;
+	mock_torrent t(&st);
+	peer_list p(allocator);
+	t.m_p = &p;
+
+	torrent_peer* peer1 = add_peer(p, st, ep("10.0.0.1", 8080));
+	torrent_peer* peer2 = add_peer(p, st, ep("10.0.0.2", 8080));
+	TEST_CHECK(peer1);
+	TEST_CHECK(peer2);
+	peer1->last_connected = 100;
+	peer2->last_connected = 90;
+	p.inc_failcount(peer2);
+
+	st.next_connect = 0;
+	TEST_CHECK(p.connect_one_peer(110, &st) == nullptr);
+	// peer1 may be connected to at 100 + 60, peer2 at 90 + 2 * 60
+	TEST_EQUAL(st.next_connect, 160);
+
+	st.next_connect = 0;
+	TEST_CHECK(p.connect_one_peer(160, &st) == peer1);
+	TEST_EQUAL(st.next_connect, 0);
+}
+
 // TODO: test erasing peers
 // TODO: test update_peer_port with allow_multiple_connections_per_ip and without
 // TODO: test add i2p peers
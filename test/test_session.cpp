@@ -41,6 +41,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "setup_transfer.hpp"
 #include "libtorrent/alert_types.hpp"
 #include "libtorrent/session_stats.hpp"
+#include "libtorrent/aux_/trace.hpp"
 #include "libtorrent/performance_counters.hpp"
 #include "libtorrent/bdecode.hpp"
 #include "libtorrent/bencode.hpp"
@@ -244,6 +245,25 @@ TORRENT_TEST(session_stats)
 		TEST_EQUAL(stats[std::size_t(i)].value_index, i);
 	}
 
+	// histograms are listed separately, their buckets are listed as
+	// counters
+	std::vector<stats_metric> const histograms = session_stats_histograms();
+	TEST_CHECK(!histograms.empty());
+	for (auto const& h : histograms)
+	{
+		TEST_CHECK(h.type == metric_type_t::histogram);
+		TEST_CHECK(lt::counters::is_histogram(h.value_index));
+		for (int i = 0; i < lt::counters::num_histogram_buckets; ++i)
+			TEST_CHECK(stats[std::size_t(h.value_index + i)].type == metric_type_t::counter);
+	}
+
+	TEST_EQUAL(lt::find_metric_idx("disk.disk_read_latency")
+		, lt::counters::disk_read_latency);
+	TEST_EQUAL(stats[std::size_t(lt::counters::disk_read_latency + 4)].name
+		, std::string("disk.disk_read_latency.4"));
+	TEST_EQUAL(lt::find_metric_idx("disk.disk_read_latency.4")
+		, lt::counters::disk_read_latency + 4);
+
 	TEST_EQUAL(lt::find_metric_idx("peer.incoming_connections")
 		, lt::counters::incoming_connections);
 
@@ -336,6 +356,21 @@ TORRENT_TEST(session_shutdown)
 	lt::session ses(pack);
 }
 
+TORRENT_TEST(tracing_stops_with_session)
+{
+	{
+		settings_pack p = settings();
+		p.set_bool(settings_pack::enable_tracing, true);
+		lt::session ses(p);
+		// the settings are applied on the network thread. Wait for that
+		ses.get_settings();
+		TEST_CHECK(aux::trace_enabled());
+	}
+	// tracing is process-wide, the session that enabled it turns it off when
+	// it's destructed
+	TEST_CHECK(!aux::trace_enabled());
+}
+
 TORRENT_TEST(save_state_fingerprint)
 {
 	lt::session_proxy p1;
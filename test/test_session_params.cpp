@@ -186,6 +186,7 @@ dht::dht_state test_state()
 		ret.nodes.push_back(rand_udp_ep(rand_v4));
 	for (int i = 0; i < 50; ++i)
 		ret.nodes.push_back(rand_udp_ep(rand_v6));
+	ret.snapshot = std::string("LTds\x01\0binary", 12);
 	return ret;
 }
 
@@ -213,6 +214,7 @@ bool operator==(dht::dht_state const& lhs, dht::dht_state const& rhs)
 	return lhs.nids == rhs.nids
 		&& lhs.nodes == rhs.nodes
 		&& lhs.nodes6 == rhs.nodes6
+		&& lhs.snapshot == rhs.snapshot
 		;
 }
 
@@ -140,3 +140,73 @@ TORRENT_TEST(format_string)
 
 	TEST_EQUAL(a.ptr(idx), "10"_sv);
 }
+
+TORRENT_TEST(intern_string)
+{
+	stack_allocator a;
+	allocation_slot const idx1 = a.intern_string("testing");
+	allocation_slot const idx2 = a.intern_string("foobar");
+	allocation_slot const idx3 = a.intern_string(std::string("testing"));
+	allocation_slot const idx4 = a.intern_string("testing2");
+
+	TEST_CHECK(idx1 == idx3);
+	TEST_CHECK(idx1 != idx2);
+	TEST_CHECK(idx1 != idx4);
+	TEST_CHECK(a.ptr(idx1) == "testing"_sv);
+	TEST_CHECK(a.ptr(idx2) == "foobar"_sv);
+	TEST_CHECK(a.ptr(idx4) == "testing2"_sv);
+
+	// copy_string() never de-duplicates
+	TEST_CHECK(a.copy_string("testing") != idx1);
+}
+
+TORRENT_TEST(intern_string_reset)
+{
+	stack_allocator a;
+	a.intern_string("foo");
+	a.reset();
+
+	// the previous interned copy was released by reset()
+	a.copy_string("bar");
+	allocation_slot const idx = a.intern_string("foo");
+	TEST_CHECK(a.ptr(idx) == "foo"_sv);
+}
+
+TORRENT_TEST(intern_string_swap)
+{
+	stack_allocator a1;
+	stack_allocator a2;
+	allocation_slot const idx1 = a1.intern_string("foo");
+	a2.copy_string("a longer string");
+
+	a1.swap(a2);
+	// a2 now holds the storage (and interned strings) of a1
+	TEST_CHECK(a2.intern_string("foo") == idx1);
+	allocation_slot const idx2 = a1.intern_string("foo");
+	TEST_CHECK(a1.ptr(idx2) == "foo"_sv);
+	TEST_CHECK(a2.ptr(idx1) == "foo"_sv);
+}
+
+TORRENT_TEST(intern_string_bytes_per_alert)
+{
+	// simulate the name of a single torrent being attached to a batch of
+	// alerts, the way torrent_alert does
+	std::string const name = "ubuntu-20.04.1-desktop-amd64.iso";
+	int const num_alerts = 1000;
+
+	stack_allocator copied;
+	allocation_slot const start1 = copied.allocate(1);
+	for (int i = 0; i < num_alerts; ++i) copied.copy_string(name);
+	allocation_slot const end1 = copied.allocate(1);
+	auto const copied_bytes = copied.ptr(end1) - copied.ptr(start1) - 1;
+
+	stack_allocator interned;
+	allocation_slot const start2 = interned.allocate(1);
+	for (int i = 0; i < num_alerts; ++i) interned.intern_string(name);
+	allocation_slot const end2 = interned.allocate(1);
+	auto const interned_bytes = interned.ptr(end2) - interned.ptr(start2) - 1;
+
+	TEST_CHECK(interned_bytes < copied_bytes);
+	TEST_EQUAL(copied_bytes, num_alerts * int(name.size() + 1));
+	TEST_EQUAL(interned_bytes, int(name.size() + 1));
+}
@@ -703,6 +703,111 @@ TORRENT_TEST(test_move_storage_no_metadata)
 	TEST_EQUAL(h.status().save_path, complete("save_path_1"));
 }
 
+namespace {
+state_update_alert const* post_updates(lt::session& ses, status_flags_t const flags
+	, torrent_updates_flags_t const updates_flags = session_handle::changed_fields_only)
+{
+	ses.post_torrent_updates(flags, updates_flags);
+	return alert_cast<state_update_alert>(
+		wait_for_alert(ses, state_update_alert::alert_type, "ses"));
+}
+}
+
+TORRENT_TEST(post_torrent_updates_changed_fields)
+{
+	lt::session ses(settings());
+	add_torrent_params p = parse_magnet_uri("magnet:?xt=urn:btih:abababababababababababababababababababab&dn=foobar");
+	p.save_path = "save_path";
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	status_flags_t const flags = torrent_handle::query_name
+		| torrent_handle::query_save_path;
+
+	// the first update includes everything we asked for
+	h.set_max_uploads(4);
+	state_update_alert const* a = post_updates(ses, flags);
+	TEST_CHECK(a != nullptr);
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_EQUAL(a->status[0].name, "foobar");
+	TEST_EQUAL(a->status[0].save_path, complete("save_path"));
+	TEST_CHECK(a->queried_fields[0] & torrent_handle::query_name);
+	TEST_CHECK(a->queried_fields[0] & torrent_handle::query_save_path);
+	TEST_EQUAL(a->status[0].uploads_limit, 4);
+
+	// the name and save path haven't changed, so they're left out
+	h.set_max_uploads(5);
+	a = post_updates(ses, flags);
+	TEST_CHECK(a != nullptr);
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_CHECK(a->status[0].name.empty());
+	TEST_CHECK(a->status[0].save_path.empty());
+	TEST_CHECK(!(a->queried_fields[0] & torrent_handle::query_name));
+	TEST_CHECK(!(a->queried_fields[0] & torrent_handle::query_save_path));
+	TEST_EQUAL(a->status[0].uploads_limit, 5);
+
+	// moving the storage changes the save path, but not the name
+	h.move_storage("save_path_1");
+	h.set_max_uploads(6);
+	a = post_updates(ses, flags);
+	TEST_CHECK(a != nullptr);
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_CHECK(a->status[0].name.empty());
+	TEST_EQUAL(a->status[0].save_path, complete("save_path_1"));
+	TEST_CHECK(a->queried_fields[0] & torrent_handle::query_save_path);
+
+	// without changed_fields_only, everything is included again
+	h.set_max_uploads(7);
+	a = post_updates(ses, torrent_handle::query_name, {});
+	TEST_CHECK(a != nullptr);
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_EQUAL(a->status[0].name, "foobar");
+
+	// and so it is when asking for all fields
+	h.set_max_uploads(8);
+	ses.post_torrent_updates();
+	a = alert_cast<state_update_alert>(
+		wait_for_alert(ses, state_update_alert::alert_type, "ses"));
+	TEST_CHECK(a != nullptr);
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_EQUAL(a->status[0].name, "foobar");
+	TEST_EQUAL(a->status[0].save_path, complete("save_path_1"));
+	TEST_CHECK(a->queried_fields[0] == status_flags_t::all());
+}
+
+TORRENT_TEST(post_torrent_updates_dropped)
+{
+	settings_pack pack = settings();
+	pack.set_int(settings_pack::alert_queue_size, 1);
+	lt::session ses(pack);
+	add_torrent_params p = parse_magnet_uri("magnet:?xt=urn:btih:abababababababababababababababababababab&dn=foobar");
+	p.save_path = "save_path";
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	status_flags_t const flags = torrent_handle::query_name;
+
+	// fill up the alert queue, so the state update is dropped
+	h.set_max_uploads(4);
+	for (int i = 0; i < 5; ++i)
+		ses.post_session_stats();
+	ses.post_torrent_updates(flags, session_handle::changed_fields_only);
+	// a synchronous call, to make sure the network thread is done posting
+	ses.get_torrents();
+
+	std::vector<alert*> alerts;
+	ses.pop_alerts(&alerts);
+	for (auto const* a : alerts)
+		TEST_CHECK(alert_cast<state_update_alert>(a) == nullptr);
+
+	// the torrent and its name are still posted in the next update
+	state_update_alert const* a = post_updates(ses, flags);
+	TEST_CHECK(a != nullptr);
+	if (a == nullptr) return;
+	TEST_EQUAL(a->status.size(), 1);
+	TEST_EQUAL(a->status[0].name, "foobar");
+	TEST_CHECK(a->queried_fields[0] & torrent_handle::query_name);
+	TEST_EQUAL(a->status[0].uploads_limit, 4);
+}
+
 TORRENT_TEST(test_have_piece_no_metadata)
 {
 	lt::session ses(settings());
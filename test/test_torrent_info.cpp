@@ -1036,6 +1036,72 @@ TORRENT_TEST(parse_torrents)
 	}
 }
 
+TORRENT_TEST(parse_torrents_mapped)
+{
+	std::string const root_dir = parent_path(current_working_directory());
+	lt::load_torrent_limits cfg;
+	cfg.map_file = true;
+	for (auto const& t : test_torrents)
+	{
+		std::string const filename = combine_path(combine_path(root_dir, "test_torrents")
+			, t.file);
+		error_code ec;
+		torrent_info const ti(filename, ec);
+		TEST_CHECK(!ec);
+		std::unique_ptr<torrent_info> mapped(new torrent_info(filename, cfg));
+
+		// copies share the mapping, and must stay valid when the original
+		// goes away
+		torrent_info const copy = *mapped;
+		mapped.reset();
+
+		TEST_CHECK(copy.info_hashes() == ti.info_hashes());
+		TEST_CHECK(copy.info_section().size() == ti.info_section().size());
+		TEST_CHECK(std::equal(copy.info_section().begin(), copy.info_section().end()
+			, ti.info_section().begin()));
+		TEST_EQUAL(copy.num_files(), ti.num_files());
+		TEST_EQUAL(copy.v2_piece_hashes_verified(), ti.v2_piece_hashes_verified());
+		for (file_index_t const i : ti.files().file_range())
+		{
+			TEST_EQUAL(copy.files().file_path(i), ti.files().file_path(i));
+			span<char const> const l1 = copy.piece_layer(i);
+			span<char const> const l2 = ti.piece_layer(i);
+			TEST_CHECK(l1.size() == l2.size());
+			TEST_CHECK(std::equal(l1.begin(), l1.end(), l2.begin()));
+		}
+		for (piece_index_t const p : ti.piece_range())
+		{
+			if (!ti.v1()) break;
+			TEST_EQUAL(copy.hash_for_piece(p), ti.hash_for_piece(p));
+		}
+	}
+}
+
+TORRENT_TEST(set_piece_layers)
+{
+	std::string const root_dir = parent_path(current_working_directory());
+	torrent_info ti(combine_path(combine_path(root_dir, "test_torrents")
+		, "v2_multiple_files.torrent"));
+
+	aux::vector<aux::vector<char>, file_index_t> layers;
+	for (file_index_t const i : ti.files().file_range())
+	{
+		span<char const> const l = ti.piece_layer(i);
+		layers.emplace_back(l.begin(), l.end());
+	}
+	ti.free_piece_layers();
+	TEST_EQUAL(ti.v2_piece_hashes_verified(), false);
+
+	ti.set_piece_layers(layers);
+	TEST_EQUAL(ti.v2_piece_hashes_verified(), true);
+	for (file_index_t const i : ti.files().file_range())
+	{
+		span<char const> const l = ti.piece_layer(i);
+		TEST_CHECK(l.size() == int(layers[i].size()));
+		TEST_CHECK(std::equal(l.begin(), l.end(), layers[i].begin()));
+	}
+}
+
 TORRENT_TEST(parse_invalid_torrents)
 {
 	std::string const root_dir = parent_path(current_working_directory());
@@ -1116,6 +1182,14 @@ std::vector<lt::aux::vector<file_t, lt::file_index_t>> const test_cases
 		{"test/filler-1", 0x4000, {}, "test/filler-1"},
 		{"test/filler-2", 0x4000, {}, "test/filler-2"},
 	},
+	{
+		// directories that only hold other directories count too, regardless
+		// of case
+		{"test/x/y/z/1", 0x4000, {}, "test/x/y/z/1"},
+		{"test/X/Y", 0x4000, {}, "test/X/Y.1"},
+		{"test/x", 0x4000, {}, "test/x.1"},
+		{"test/filler", 0x4000, {}, "test/filler"},
+	},
 	{
 		// pad files are allowed to collide, as long as they have the same size
 		{"test/.pad/1234", 0x4000, file_storage::flag_pad_file, "test/.pad/1234"},
@@ -0,0 +1,154 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "test.hpp"
+#include "libtorrent/aux_/trace.hpp"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+
+using namespace lt;
+
+namespace {
+
+int count_events(std::string const& trace, char const* name = nullptr)
+{
+	std::string const needle = name == nullptr
+		? std::string("\"ph\":")
+		: "\"name\":\"" + std::string(name) + "\"";
+	int ret = 0;
+	for (auto pos = trace.find(needle); pos != std::string::npos
+		; pos = trace.find(needle, pos + 1))
+		++ret;
+	return ret;
+}
+
+struct enable_tracing
+{
+	enable_tracing()
+	{
+		aux::clear_trace();
+		aux::set_trace_enabled(true);
+	}
+	~enable_tracing() { aux::set_trace_enabled(false); }
+};
+
+}
+
+TORRENT_TEST(disabled)
+{
+	aux::set_trace_enabled(false);
+	aux::clear_trace();
+	aux::trace_instant("test", "instant");
+	{
+		aux::trace_scope s("test", "scope");
+	}
+	TEST_EQUAL(count_events(aux::dump_trace()), 0);
+}
+
+TORRENT_TEST(instant_and_scope)
+{
+	enable_tracing e;
+	aux::trace_instant("test", "instant", 42);
+	{
+		aux::trace_scope s("test", "scope");
+		s.arg(1337);
+	}
+
+	std::string const trace = aux::dump_trace();
+	TEST_EQUAL(count_events(trace), 2);
+	TEST_EQUAL(count_events(trace, "instant"), 1);
+	TEST_EQUAL(count_events(trace, "scope"), 1);
+	TEST_CHECK(trace.find("\"ph\":\"i\"") != std::string::npos);
+	TEST_CHECK(trace.find("\"ph\":\"X\"") != std::string::npos);
+	TEST_CHECK(trace.find("\"arg\":42}") != std::string::npos);
+	TEST_CHECK(trace.find("\"arg\":1337}") != std::string::npos);
+	TEST_CHECK(trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+
+	// dumping doesn't clear the trace
+	TEST_EQUAL(count_events(aux::dump_trace()), 2);
+
+	aux::clear_trace();
+	TEST_EQUAL(count_events(aux::dump_trace()), 0);
+}
+
+TORRENT_TEST(multiple_threads)
+{
+	enable_tracing e;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([] {
+			for (int i = 0; i < 1000; ++i)
+				aux::trace_instant("test", "thread", i);
+		});
+	}
+	for (auto& t : threads) t.join();
+
+	TEST_EQUAL(count_events(aux::dump_trace(), "thread"), 4000);
+}
+
+TORRENT_TEST(wrap_around)
+{
+	enable_tracing e;
+	for (int i = 0; i < 100000; ++i)
+		aux::trace_instant("test", "wrap", i);
+
+	// only the most recent events are kept
+	std::string const trace = aux::dump_trace();
+	int const num = count_events(trace, "wrap");
+	TEST_CHECK(num > 0);
+	TEST_CHECK(num < 100000);
+	TEST_CHECK(trace.find("\"arg\":99999}") != std::string::npos);
+	TEST_CHECK(trace.find("\"arg\":0}") == std::string::npos);
+}
+
+TORRENT_TEST(concurrent_dump)
+{
+	enable_tracing e;
+	std::atomic<bool> done{false};
+	std::thread writer([&] {
+		int i = 0;
+		while (!done) aux::trace_instant("test", "concurrent", i++);
+	});
+
+	for (int i = 0; i < 20; ++i)
+	{
+		std::string const trace = aux::dump_trace();
+		TEST_CHECK(trace.find("\n]}\n") == trace.size() - 4);
+	}
+	done = true;
+	writer.join();
+}
@@ -1,78 +1,129 @@
 #!/usr/bin/env python3
 # vim: tabstop=8 expandtab shiftwidth=4 softtabstop=4
 
+# floods a local DHT node with queries and reports how many requests per
+# second it answers. The node's settings_pack::dht_block_ratelimit must be
+# raised above the flood rate, or it will block us after a few seconds.
+#
+# usage: dht_flood.py <port> [--query get_peers] [--count 100000]
+#        [--window 1000] [--random-ids]
+
+import argparse
+import os
 import socket
-import sys
-from types import StringType, IntType, LongType, DictType, ListType, TupleType
-import random
-
-port = int(sys.argv[1])
-
-# from BitTorrent 4.3.0
-
-
-def encode_bencached(x, r):
-    r.append(x.bencoded)
-
-
-def encode_int(x, r):
-    r.extend(('i', str(x), 'e'))
-
-
-def encode_string(x, r):
-    r.extend((str(len(x)), ':', x))
-
-
-def encode_list(x, r):
-    r.append('l')
-    for i in x:
-        encode_func[type(i)](i, r)
-    r.append('e')
-
-
-def encode_dict(x, r):
-    r.append('d')
-    ilist = sorted(x.items())
-    for k, v in ilist:
-        r.extend((str(len(k)), ':', k))
-        encode_func[type(v)](v, r)
-    r.append('e')
-
-
-encode_func = {}
-encode_func[IntType] = encode_int
-encode_func[LongType] = encode_int
-encode_func[StringType] = encode_string
-encode_func[ListType] = encode_list
-encode_func[TupleType] = encode_list
-encode_func[DictType] = encode_dict
+import threading
+import time
+
+
+def encode(x, r):
+    if isinstance(x, int):
+        r.extend((b'i', str(x).encode(), b'e'))
+    elif isinstance(x, (bytes, str)):
+        if isinstance(x, str):
+            x = x.encode()
+        r.extend((str(len(x)).encode(), b':', x))
+    elif isinstance(x, (list, tuple)):
+        r.append(b'l')
+        for i in x:
+            encode(i, r)
+        r.append(b'e')
+    elif isinstance(x, dict):
+        r.append(b'd')
+        for k, v in sorted((k.encode() if isinstance(k, str) else k, v)
+                           for k, v in x.items()):
+            encode(k, r)
+            encode(v, r)
+        r.append(b'e')
+    else:
+        raise TypeError('cannot bencode %r' % type(x))
 
 
 def bencode(x):
     r = []
-    encode_func[type(x)](x, r)
-    return ''.join(r)
-
-
-def send_dht_message(msg):
-    s.sendto(bencode(msg), 0, ('127.0.0.1', port))
+    encode(x, r)
+    return b''.join(r)
 
 
 def random_key():
-    ret = ''
-    for i in range(0, 20):
-        ret += chr(random.randint(0, 255))
-    return ret
-
-
-s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-node_id = '1' * 20
-query = 'get_peers'
-
-print('test random info-hashes')
-for i in range(1, 30000):
-    send_dht_message({'a': {'id': node_id, 'info_hash': random_key()}, 'q': query, 'y': 'q', 't': '%d' % i})
-
-print('test random peer-ids')
-for i in range(1, 30000):
-    send_dht_message({'a': {'id': random_key(), 'info_hash': random_key()}, 'q': query, 'y': 'q', 't': '%d' % i})
+    return os.urandom(20)
+
+
+def make_query(query, tid, random_ids):
+    node_id = random_key() if random_ids else b'1' * 20
+    args = {'id': node_id}
+    if query == 'get_peers':
+        args['info_hash'] = random_key()
+    elif query in ('find_node', 'sample_infohashes'):
+        args['target'] = random_key()
+    return bencode({'a': args, 'q': query, 'y': 'q', 't': tid.to_bytes(4, 'big')})
+
+
+def main():
+    p = argparse.ArgumentParser()
+    p.add_argument('port', type=int)
+    p.add_argument('--host', default='127.0.0.1')
+    p.add_argument('--query', default='get_peers',
+                   choices=['ping', 'find_node', 'get_peers', 'sample_infohashes'])
+    p.add_argument('--count', type=int, default=100000,
+                   help='number of queries to send')
+    p.add_argument('--window', type=int, default=1000,
+                   help='number of queries sent back-to-back before waiting for replies')
+    p.add_argument('--random-ids', action='store_true',
+                   help='use a new node ID for every query')
+    args = p.parse_args()
+
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+    s.settimeout(1)
+
+    replies = 0
+    lock = threading.Condition()
+    done = False
+
+    def receive():
+        nonlocal replies
+        while not done:
+            try:
+                s.recvfrom(1500)
+            except socket.timeout:
+                continue
+            with lock:
+                replies += 1
+                lock.notify()
+
+    t = threading.Thread(target=receive)
+    t.start()
+
+    dest = (args.host, args.port)
+    start = time.monotonic()
+    sent = 0
+    while sent < args.count:
+        for i in range(min(args.window, args.count - sent)):
+            s.sendto(make_query(args.query, sent, args.random_ids), dest)
+            sent += 1
+
+        # wait for the batch to be answered. Queries the node dropped are
+        # given up on once it's been quiet for a moment
+        with lock:
+            while replies < sent:
+                before = replies
+                lock.wait(0.05)
+                if replies == before:
+                    break
+
+    # wait for the stragglers
+    deadline = time.monotonic() + 2
+    with lock:
+        while replies < args.count and time.monotonic() < deadline:
+            lock.wait(0.1)
+        received = replies
+    elapsed = time.monotonic() - start
+    done = True
+    t.join()
+
+    print('%s: sent %d queries, received %d replies in %.2f s: %.0f requests/s'
+          % (args.query, args.count, received, elapsed, received / elapsed))
+
+
+if __name__ == '__main__':
+    main()
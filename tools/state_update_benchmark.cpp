@@ -0,0 +1,183 @@
+/*
+
+Copyright (c) 2026, agent
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "libtorrent/session.hpp"
+#include "libtorrent/session_params.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/add_torrent_params.hpp"
+#include "libtorrent/alert_types.hpp"
+#include "libtorrent/torrent_info.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/disabled_disk_io.hpp"
+#include "libtorrent/random.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/time.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+// this tool measures the cost of posting state_update_alerts for N torrents
+// that all changed since the last update. It reports the number of heap
+// allocations and the latency of a round-trip, both with the full set of
+// status fields and with session_handle::changed_fields_only
+
+namespace {
+
+std::atomic<std::int64_t> g_allocations{0};
+
+}
+
+void* operator new(std::size_t const size)
+{
+	++g_allocations;
+	void* ret = std::malloc(size == 0 ? 1 : size);
+	if (ret == nullptr) throw std::bad_alloc();
+	return ret;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+[[noreturn]] void usage()
+{
+	std::cerr << "USAGE: state_update_benchmark [num-torrents]\n";
+	std::exit(1);
+}
+
+std::shared_ptr<lt::torrent_info> make_torrent(int const idx)
+{
+	lt::file_storage fs;
+	fs.add_file("state_update/" + std::to_string(idx), 64 * 0x4000);
+	lt::create_torrent t(fs, 0x4000);
+	for (lt::piece_index_t i(0); i < fs.end_piece(); ++i)
+	{
+		lt::sha1_hash h;
+		lt::aux::random_bytes(h);
+		t.set_hash(i, h);
+	}
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<lt::torrent_info>(buf, lt::from_span);
+}
+
+void run_round(lt::session& ses, std::vector<lt::torrent_handle> const& torrents
+	, int const round, lt::status_flags_t const flags
+	, lt::torrent_updates_flags_t const updates_flags, char const* label)
+{
+	// touch every torrent, to have them all included in the next update
+	for (auto const& h : torrents) h.set_max_uploads(10 + (round & 1));
+	ses.is_paused();
+
+	std::int64_t const allocs_before = g_allocations;
+	auto const start = lt::clock_type::now();
+	ses.post_torrent_updates(flags, updates_flags);
+
+	std::size_t num_status = 0;
+	while (num_status == 0)
+	{
+		ses.wait_for_alert(lt::seconds(10));
+		std::vector<lt::alert*> alerts;
+		ses.pop_alerts(&alerts);
+		for (lt::alert* a : alerts)
+		{
+			if (auto const* su = lt::alert_cast<lt::state_update_alert>(a))
+				num_status = su->status.size();
+		}
+	}
+	auto const elapsed = lt::clock_type::now() - start;
+	std::int64_t const allocs = g_allocations - allocs_before;
+
+	std::cout << label << " torrents: " << num_status
+		<< " allocations: " << allocs
+		<< " latency: " << lt::total_microseconds(elapsed) << " us\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char const* argv[]) try
+{
+	int num_torrents = 10000;
+	if (argc > 2) usage();
+	if (argc == 2)
+	{
+		num_torrents = std::atoi(argv[1]);
+		if (num_torrents <= 0) usage();
+	}
+
+	lt::session_params p;
+	p.disk_io_constructor = lt::disabled_disk_io_constructor;
+	lt::settings_pack& pack = p.settings;
+	pack.set_bool(lt::settings_pack::enable_dht, false);
+	pack.set_bool(lt::settings_pack::enable_lsd, false);
+	pack.set_bool(lt::settings_pack::enable_upnp, false);
+	pack.set_bool(lt::settings_pack::enable_natpmp, false);
+	pack.set_str(lt::settings_pack::listen_interfaces, "127.0.0.1:0");
+	pack.set_int(lt::settings_pack::alert_mask, 0);
+	lt::session ses(std::move(p));
+
+	std::vector<lt::torrent_handle> torrents;
+	for (int i = 0; i < num_torrents; ++i)
+	{
+		lt::add_torrent_params atp;
+		atp.ti = make_torrent(i);
+		atp.save_path = "a/fairly/long/save/path/to/make/sure/it/does/not/fit/in/sso";
+		atp.flags |= lt::torrent_flags::seed_mode | lt::torrent_flags::paused;
+		atp.flags &= ~lt::torrent_flags::auto_managed;
+		torrents.push_back(ses.add_torrent(std::move(atp)));
+	}
+
+	lt::status_flags_t const fields = lt::torrent_handle::query_pieces
+		| lt::torrent_handle::query_name
+		| lt::torrent_handle::query_save_path;
+
+	// the first update includes everything, regardless of mode
+	run_round(ses, torrents, 0, fields, lt::session::changed_fields_only, "initial");
+	for (int i = 1; i < 6; ++i)
+	{
+		run_round(ses, torrents, i, fields, {}, "full   ");
+		run_round(ses, torrents, i, fields, lt::session::changed_fields_only, "changed");
+	}
+	return 0;
+}
+catch (std::exception const& e)
+{
+	std::cerr << "FAILED WITH EXCEPTION: " << e.what() << '\n';
+	return 1;
+}